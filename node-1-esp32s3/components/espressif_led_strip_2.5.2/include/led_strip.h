@@ -54,6 +54,43 @@ esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t
  */
 esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
 
+/**
+ * @brief Set RGB for a run of consecutive pixels from a packed buffer
+ *
+ * @note Backends that encode pixels on the CPU (SPI) do the whole run in one pass, which is much cheaper than
+ *       calling `led_strip_set_pixel` for each pixel. The white component of RGBW strips is set to 0.
+ *
+ * @param strip: LED strip
+ * @param index: index of the first pixel to set
+ * @param count: number of pixels to set
+ * @param pixels: `count` pixels of 3 bytes each, in the given order
+ * @param order: component order of the buffer, LED_PIXEL_ORDER_GRB needs no reordering on WS2812 strips
+ *
+ * @return
+ *      - ESP_OK: Set the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Set the pixels failed because of invalid parameters, e.g. the run does not fit in the strip
+ *      - ESP_FAIL: Set the pixels failed because other error occurred
+ */
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t index, uint32_t count, const uint8_t *pixels, led_pixel_order_t order);
+
+/**
+ * @brief Set every pixel of the LED strip to the same RGB color
+ *
+ * @note The white component of RGBW strips is set to 0. As with `led_strip_set_pixel`, `led_strip_refresh` sends the colors to the strip.
+ *
+ * @param strip: LED strip
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ *
+ * @return
+ *      - ESP_OK: Set every pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set every pixel failed because of invalid parameters
+ *      - ESP_ERR_NOT_SUPPORTED: The backend has no fill operation
+ *      - ESP_FAIL: Set every pixel failed because other error occurred
+ */
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t red, uint32_t green, uint32_t blue);
+
 /**
  * @brief Set HSV for a specific pixel
  *
@@ -84,6 +121,35 @@ esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint
  */
 esp_err_t led_strip_refresh(led_strip_handle_t strip);
 
+/**
+ * @brief Start sending memory colors to LEDs and return without waiting for them to be sent
+ *
+ * @note Strips created with a second pixel buffer (RMT `flags.double_buffer`) swap buffers and return at once, so the
+ *       next frame can be set while this one is on the wire. A frame started while the previous one is still being sent
+ *       waits for it first. Other strips refresh as `led_strip_refresh` does.
+ * @note The pixel colors are kept across the swap, so a frame can also be updated pixel by pixel.
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Refresh started successfully
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip);
+
+/**
+ * @brief Wait for the frames started by `led_strip_refresh_async` to be sent
+ *
+ * @param strip: LED strip
+ * @param timeout_ms: longest wait in milliseconds, -1 to wait forever
+ *
+ * @return
+ *      - ESP_OK: All frames sent
+ *      - ESP_ERR_TIMEOUT: Frames still being sent after the timeout
+ *      - ESP_FAIL: Wait failed because some other error occurred
+ */
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int32_t timeout_ms);
+
 /**
  * @brief Clear LED strip (turn off all LEDs)
  *
@@ -31,6 +31,7 @@ typedef struct {
     size_t mem_block_symbols;   /*!< How many RMT symbols can one RMT channel hold at one time. Set to 0 will fallback to use the default size. */
     struct {
         uint32_t with_dma: 1;   /*!< Use DMA to transmit data */
+        uint32_t double_buffer: 1; /*!< Keep a second pixel buffer so `led_strip_refresh_async` returns while the frame is sent, IDF 5 driver only */
     } flags;                    /*!< Extra driver flags */
 } led_strip_rmt_config_t;
 
@@ -48,6 +49,62 @@ typedef struct {
  */
 esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip);
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+/**
+ * @brief Group of RMT LED strips refreshed together
+ */
+typedef struct led_strip_group_t *led_strip_group_handle_t;
+
+/**
+ * @brief LED strip group configuration
+ */
+typedef struct {
+    const led_strip_handle_t *strips; /*!< RMT LED strips, each on its own channel */
+    size_t num_strips;                /*!< Number of strips, at most the number of RMT TX channels */
+    struct {
+        uint32_t sync_start: 1;       /*!< Start all channels at the same time with an RMT sync manager, on chips that have one */
+    } flags;                          /*!< Extra group flags */
+} led_strip_group_config_t;
+
+/**
+ * @brief Group RMT LED strips so that one refresh drives all of them in parallel
+ *
+ * @note The strips' channels stay enabled while they are grouped. The strips can still be refreshed one by one,
+ *       except with `sync_start`: then `led_strip_refresh` and `led_strip_clear` return ESP_ERR_INVALID_STATE.
+ *
+ * @param config Group configuration
+ * @param ret_group Returned group handle
+ * @return
+ *      - ESP_OK: create the group successfully
+ *      - ESP_ERR_INVALID_ARG: create the group failed because of invalid argument, e.g. a strip is not an RMT strip
+ *      - ESP_ERR_INVALID_STATE: create the group failed because a strip is already in a group
+ *      - ESP_ERR_NOT_SUPPORTED: create the group failed because the chip cannot start RMT channels together
+ *      - ESP_ERR_NO_MEM: create the group failed because of out of memory
+ */
+esp_err_t led_strip_new_rmt_group(const led_strip_group_config_t *config, led_strip_group_handle_t *ret_group);
+
+/**
+ * @brief Refresh every strip of the group: all channels are started, then waited for once
+ *
+ * @note Takes as long as the longest strip rather than the sum of the strips
+ *
+ * @param group Group handle
+ * @return
+ *      - ESP_OK: Refresh successfully
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_rmt_group_refresh(led_strip_group_handle_t group);
+
+/**
+ * @brief Delete the group. The strips are left as they were before grouping, and must be deleted separately.
+ *
+ * @param group Group handle
+ * @return
+ *      - ESP_OK: Delete the group successfully
+ */
+esp_err_t led_strip_del_rmt_group(led_strip_group_handle_t group);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,15 @@ typedef enum {
     LED_PIXEL_FORMAT_INVALID /*!< Invalid pixel format */
 } led_pixel_format_t;
 
+/**
+ * @brief Component order of a pixel buffer given to `led_strip_set_pixels`
+ */
+typedef enum {
+    LED_PIXEL_ORDER_RGB,    /*!< 3 bytes per pixel: red, green, blue */
+    LED_PIXEL_ORDER_GRB,    /*!< 3 bytes per pixel: green, red, blue, the order WS2812 takes them in */
+    LED_PIXEL_ORDER_INVALID /*!< Invalid pixel order */
+} led_pixel_order_t;
+
 /**
  * @brief LED strip model
  * @note Different led model may have different timing parameters, so we need to distinguish them.
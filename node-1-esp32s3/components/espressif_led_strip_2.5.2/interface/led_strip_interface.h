@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include "esp_err.h"
+#include "led_strip_types.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,40 @@ struct led_strip_t {
      */
     esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
 
+    /**
+     * @brief Set RGB for a run of consecutive pixels from a packed buffer
+     *
+     * @note Optional, `led_strip_set_pixels` falls back to `set_pixel` for each pixel when it is NULL
+     *
+     * @param strip: LED strip
+     * @param index: index of the first pixel to set
+     * @param count: number of pixels to set
+     * @param pixels: 3 bytes per pixel, in the given order
+     * @param order: component order of the buffer
+     *
+     * @return
+     *      - ESP_OK: Set the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Set the pixels failed because of invalid parameters
+     *      - ESP_FAIL: Set the pixels failed because other error occurred
+     */
+    esp_err_t (*set_pixels)(led_strip_t *strip, uint32_t index, uint32_t count, const uint8_t *pixels, led_pixel_order_t order);
+
+    /**
+     * @brief Set every pixel to the same RGB color
+     *
+     * @note Optional, `led_strip_fill` returns ESP_ERR_NOT_SUPPORTED when it is NULL
+     *
+     * @param strip: LED strip
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     *
+     * @return
+     *      - ESP_OK: Set every pixel successfully
+     *      - ESP_FAIL: Set every pixel failed because other error occurred
+     */
+    esp_err_t (*fill)(led_strip_t *strip, uint32_t red, uint32_t green, uint32_t blue);
+
     /**
      * @brief Refresh memory colors to LEDs
      *
@@ -66,6 +101,34 @@ struct led_strip_t {
      */
     esp_err_t (*refresh)(led_strip_t *strip);
 
+    /**
+     * @brief Start sending memory colors to LEDs without waiting for them to be sent
+     *
+     * @note Optional, `led_strip_refresh_async` falls back to `refresh` when it is NULL.
+     *       The backend must let the caller set pixels for the next frame while this one is sent.
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Refresh started successfully
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     */
+    esp_err_t (*refresh_async)(led_strip_t *strip);
+
+    /**
+     * @brief Wait for the frames started by `refresh_async` to be sent
+     *
+     * @note Optional, NULL when `refresh_async` is NULL
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: longest wait in milliseconds, -1 to wait forever
+     *
+     * @return
+     *      - ESP_OK: All frames sent
+     *      - ESP_ERR_TIMEOUT: Frames still being sent after the timeout
+     */
+    esp_err_t (*wait_refresh_done)(led_strip_t *strip, int32_t timeout_ms);
+
     /**
      * @brief Clear LED strip (turn off all LEDs)
      *
@@ -16,6 +16,33 @@ esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t
     return strip->set_pixel(strip, index, red, green, blue);
 }
 
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t index, uint32_t count, const uint8_t *pixels, led_pixel_order_t order)
+{
+    ESP_RETURN_ON_FALSE(strip && (pixels || count == 0), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(order < LED_PIXEL_ORDER_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid pixel order");
+    if (strip->set_pixels) {
+        return strip->set_pixels(strip, index, count, pixels, order);
+    }
+
+    // Backend without a bulk path, one pixel at a time
+    uint32_t red_offset = order == LED_PIXEL_ORDER_RGB ? 0 : 1;
+    uint32_t green_offset = order == LED_PIXEL_ORDER_RGB ? 1 : 0;
+    for (uint32_t i = 0; i < count; i++, pixels += 3) {
+        ESP_RETURN_ON_ERROR(strip->set_pixel(strip, index + i, pixels[red_offset], pixels[green_offset], pixels[2]), TAG, "set pixel failed");
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t red, uint32_t green, uint32_t blue)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // Not an error: callers fall back to set_pixel when the backend has no fill
+    if (!strip->fill) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return strip->fill(strip, red, green, blue);
+}
+
 esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
@@ -81,6 +108,24 @@ esp_err_t led_strip_refresh(led_strip_handle_t strip)
     return strip->refresh(strip);
 }
 
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->refresh_async) {
+        return strip->refresh_async(strip);
+    }
+    return strip->refresh(strip);
+}
+
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->wait_refresh_done) {
+        return strip->wait_refresh_done(strip, timeout_ms);
+    }
+    return ESP_OK; // Nothing is ever in flight
+}
+
 esp_err_t led_strip_clear(led_strip_handle_t strip)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
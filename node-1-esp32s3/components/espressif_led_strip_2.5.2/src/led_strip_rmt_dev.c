@@ -9,6 +9,7 @@
 #include "esp_log.h"
 #include "esp_check.h"
 #include "driver/rmt_tx.h"
+#include "soc/soc_caps.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
 #include "led_strip_rmt_encoder.h"
@@ -30,9 +31,19 @@ typedef struct {
     rmt_encoder_handle_t strip_encoder;
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
-    uint8_t pixel_buf[];
+    uint8_t *pixel_buf;   // Pixels being set, the back buffer when double buffered
+    uint8_t *front_buf;   // Double buffered only: the frame on the wire, NULL otherwise
+    bool keep_enabled;    // The channel stays enabled between refreshes (double buffered or in a group)
+    struct led_strip_group_t *group;
+    uint8_t buffers[];
 } led_strip_rmt_obj;
 
+struct led_strip_group_t {
+    size_t num_strips;
+    led_strip_rmt_obj *strips[SOC_RMT_TX_CANDIDATES_PER_GROUP];
+    rmt_sync_manager_handle_t synchro; // NULL unless started together
+};
+
 static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -62,21 +73,105 @@ static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     return ESP_OK;
 }
 
-static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, uint32_t index, uint32_t count, const uint8_t *pixels, led_pixel_order_t order)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(index <= rmt_strip->strip_len && count <= rmt_strip->strip_len - index, ESP_ERR_INVALID_ARG, TAG,
+                        "pixels out of maximum number of LEDs");
+    uint8_t *buf = rmt_strip->pixel_buf + index * rmt_strip->bytes_per_pixel;
+    if (order == LED_PIXEL_ORDER_GRB && rmt_strip->bytes_per_pixel == 3) {
+        // Already in wire order
+        memcpy(buf, pixels, count * 3);
+        return ESP_OK;
+    }
+
+    uint32_t red_offset = order == LED_PIXEL_ORDER_RGB ? 0 : 1;
+    uint32_t green_offset = order == LED_PIXEL_ORDER_RGB ? 1 : 0;
+    for (uint32_t i = 0; i < count; i++, pixels += 3) {
+        *buf++ = pixels[green_offset];
+        *buf++ = pixels[red_offset];
+        *buf++ = pixels[2];
+        if (rmt_strip->bytes_per_pixel > 3) {
+            *buf++ = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_fill(led_strip_t *strip, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    size_t len = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+    if (len == 0) {
+        return ESP_OK;
+    }
+    uint8_t *buf = rmt_strip->pixel_buf;
+    buf[0] = green & 0xFF;
+    buf[1] = red & 0xFF;
+    buf[2] = blue & 0xFF;
+    if (rmt_strip->bytes_per_pixel > 3) {
+        buf[3] = 0;
+    }
+    // Copy the pixels filled so far onto the rest, doubling each time
+    for (size_t filled = rmt_strip->bytes_per_pixel; filled < len; filled *= 2) {
+        memcpy(buf + filled, buf, filled < len - filled ? filled : len - filled);
+    }
+    return ESP_OK;
+}
+
+// Queues the frame on the enabled channel. Double buffered, the back buffer goes on the wire and the caller carries on
+// setting pixels in the other one.
+static esp_err_t led_strip_rmt_transmit(led_strip_rmt_obj *rmt_strip)
+{
     rmt_transmit_config_t tx_conf = {
         .loop_count = 0,
     };
+    size_t len = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+    uint8_t *frame = rmt_strip->pixel_buf;
 
-    ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
-    ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, rmt_strip->pixel_buf,
-                                     rmt_strip->strip_len * rmt_strip->bytes_per_pixel, &tx_conf), TAG, "transmit pixels by RMT failed");
+    if (rmt_strip->front_buf) {
+        // The front buffer is free once the previous frame has been sent
+        ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+        rmt_strip->pixel_buf = rmt_strip->front_buf;
+        rmt_strip->front_buf = frame;
+        // Pixels persist across frames, as with a single buffer
+        memcpy(rmt_strip->pixel_buf, frame, len);
+    }
+    ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, frame, len, &tx_conf), TAG,
+                        "transmit pixels by RMT failed");
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(!rmt_strip->group || !rmt_strip->group->synchro, ESP_ERR_INVALID_STATE, TAG, "strip is refreshed by its group");
+
+    if (!rmt_strip->keep_enabled) {
+        ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
+    }
+    ESP_RETURN_ON_ERROR(led_strip_rmt_transmit(rmt_strip), TAG, "refresh failed");
     ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
-    ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    if (!rmt_strip->keep_enabled) {
+        ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    }
     return ESP_OK;
 }
 
+// Double buffered only
+static esp_err_t led_strip_rmt_refresh_async(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(!rmt_strip->group || !rmt_strip->group->synchro, ESP_ERR_INVALID_STATE, TAG, "strip is refreshed by its group");
+    return led_strip_rmt_transmit(rmt_strip);
+}
+
+static esp_err_t led_strip_rmt_wait_refresh_done(led_strip_t *strip, int32_t timeout_ms)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    return rmt_tx_wait_all_done(rmt_strip->rmt_chan, timeout_ms);
+}
+
 static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -88,6 +183,11 @@ static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
 static esp_err_t led_strip_rmt_del(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(!rmt_strip->group, ESP_ERR_INVALID_STATE, TAG, "strip is still in a group");
+    if (rmt_strip->keep_enabled) {
+        ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+        ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    }
     ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
     ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
     free(rmt_strip);
@@ -108,8 +208,10 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     } else {
         assert(false);
     }
-    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + led_config->max_leds * bytes_per_pixel);
+    size_t buf_len = led_config->max_leds * bytes_per_pixel;
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + buf_len * (rmt_config->flags.double_buffer ? 2 : 1));
     ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    rmt_strip->pixel_buf = rmt_strip->buffers;
     uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
 
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -139,11 +241,22 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     };
     ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
 
+    if (rmt_config->flags.double_buffer) {
+        // Enabled for the strip's lifetime, so a refresh only queues a transmission
+        ESP_GOTO_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), err, TAG, "enable RMT channel failed");
+        rmt_strip->keep_enabled = true;
+        rmt_strip->front_buf = rmt_strip->buffers + buf_len;
+        rmt_strip->base.refresh_async = led_strip_rmt_refresh_async;
+        rmt_strip->base.wait_refresh_done = led_strip_rmt_wait_refresh_done;
+    }
+
 
     rmt_strip->bytes_per_pixel = bytes_per_pixel;
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
     rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
+    rmt_strip->base.fill = led_strip_rmt_fill;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
@@ -162,3 +275,98 @@ err:
     }
     return ret;
 }
+
+// Takes the strips back out of the group, disabling the channels the group enabled
+static void led_strip_rmt_group_release(struct led_strip_group_t *group)
+{
+    if (group->synchro) {
+        rmt_del_sync_manager(group->synchro);
+        group->synchro = NULL;
+    }
+    for (size_t i = 0; i < group->num_strips; i++) {
+        led_strip_rmt_obj *rmt_strip = group->strips[i];
+        if (rmt_strip->keep_enabled && !rmt_strip->front_buf) {
+            rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1);
+            rmt_disable(rmt_strip->rmt_chan);
+            rmt_strip->keep_enabled = false;
+        }
+        rmt_strip->group = NULL;
+    }
+}
+
+esp_err_t led_strip_new_rmt_group(const led_strip_group_config_t *config, led_strip_group_handle_t *ret_group)
+{
+    struct led_strip_group_t *group = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(config && config->strips && ret_group, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->num_strips > 0 && config->num_strips <= SOC_RMT_TX_CANDIDATES_PER_GROUP, ESP_ERR_INVALID_ARG, err, TAG,
+                      "a group holds 1 to %d strips", SOC_RMT_TX_CANDIDATES_PER_GROUP);
+    group = calloc(1, sizeof(struct led_strip_group_t));
+    ESP_GOTO_ON_FALSE(group, ESP_ERR_NO_MEM, err, TAG, "no mem for strip group");
+
+    rmt_channel_handle_t channels[SOC_RMT_TX_CANDIDATES_PER_GROUP];
+    for (size_t i = 0; i < config->num_strips; i++) {
+        led_strip_handle_t strip = config->strips[i];
+        ESP_GOTO_ON_FALSE(strip && strip->del == led_strip_rmt_del, ESP_ERR_INVALID_ARG, err, TAG, "strip %u is not an RMT strip", (unsigned)i);
+        led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+        ESP_GOTO_ON_FALSE(!rmt_strip->group, ESP_ERR_INVALID_STATE, err, TAG, "strip %u is already in a group", (unsigned)i);
+        rmt_strip->group = group;
+        group->strips[group->num_strips++] = rmt_strip;
+        channels[i] = rmt_strip->rmt_chan;
+    }
+    // The channels stay enabled while grouped, a sync manager needs them enabled
+    for (size_t i = 0; i < group->num_strips; i++) {
+        led_strip_rmt_obj *rmt_strip = group->strips[i];
+        if (!rmt_strip->keep_enabled) {
+            ESP_GOTO_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), err, TAG, "enable RMT channel failed");
+            rmt_strip->keep_enabled = true;
+        }
+    }
+
+    if (config->flags.sync_start) {
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+        rmt_sync_manager_config_t synchro_config = {
+            .tx_channel_array = channels,
+            .array_size = group->num_strips,
+        };
+        ESP_GOTO_ON_ERROR(rmt_new_sync_manager(&synchro_config, &group->synchro), err, TAG, "create sync manager failed");
+#else
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, err, TAG, "RMT TX sync is not supported on this chip");
+#endif
+    }
+
+    *ret_group = group;
+    return ESP_OK;
+err:
+    if (group) {
+        led_strip_rmt_group_release(group);
+        free(group);
+    }
+    return ret;
+}
+
+esp_err_t led_strip_rmt_group_refresh(led_strip_group_handle_t group)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    if (group->synchro) {
+        ESP_RETURN_ON_ERROR(rmt_sync_reset(group->synchro), TAG, "reset sync manager failed");
+    }
+#endif
+    // Every channel is started before any is waited for, so the refresh takes as long as the longest strip
+    for (size_t i = 0; i < group->num_strips; i++) {
+        ESP_RETURN_ON_ERROR(led_strip_rmt_transmit(group->strips[i]), TAG, "refresh strip %u failed", (unsigned)i);
+    }
+    for (size_t i = 0; i < group->num_strips; i++) {
+        ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(group->strips[i]->rmt_chan, -1), TAG, "flush RMT channel failed");
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_del_rmt_group(led_strip_group_handle_t group)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_strip_rmt_group_release(group);
+    free(group);
+    return ESP_OK;
+}
@@ -93,6 +93,52 @@ static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uin
     return ESP_OK;
 }
 
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, uint32_t index, uint32_t count, const uint8_t *pixels, led_pixel_order_t order)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(index <= rmt_strip->strip_len && count <= rmt_strip->strip_len - index, ESP_ERR_INVALID_ARG, TAG,
+                        "pixels out of the maximum number of leds");
+    uint8_t *buf = rmt_strip->buffer + index * rmt_strip->bytes_per_pixel;
+    if (order == LED_PIXEL_ORDER_GRB && rmt_strip->bytes_per_pixel == 3) {
+        // Already in wire order
+        memcpy(buf, pixels, count * 3);
+        return ESP_OK;
+    }
+
+    uint32_t red_offset = order == LED_PIXEL_ORDER_RGB ? 0 : 1;
+    uint32_t green_offset = order == LED_PIXEL_ORDER_RGB ? 1 : 0;
+    for (uint32_t i = 0; i < count; i++, pixels += 3) {
+        *buf++ = pixels[green_offset];
+        *buf++ = pixels[red_offset];
+        *buf++ = pixels[2];
+        if (rmt_strip->bytes_per_pixel > 3) {
+            *buf++ = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_fill(led_strip_t *strip, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    size_t len = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+    if (len == 0) {
+        return ESP_OK;
+    }
+    uint8_t *buf = rmt_strip->buffer;
+    buf[0] = green & 0xFF;
+    buf[1] = red & 0xFF;
+    buf[2] = blue & 0xFF;
+    if (rmt_strip->bytes_per_pixel > 3) {
+        buf[3] = 0;
+    }
+    // Copy the pixels filled so far onto the rest, doubling each time
+    for (size_t filled = rmt_strip->bytes_per_pixel; filled < len; filled *= 2) {
+        memcpy(buf + filled, buf, filled < len - filled ? filled : len - filled);
+    }
+    return ESP_OK;
+}
+
 static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -125,6 +171,7 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     ESP_RETURN_ON_FALSE(led_config && dev_config && ret_strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
     ESP_RETURN_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid led_pixel_format");
     ESP_RETURN_ON_FALSE(dev_config->flags.with_dma == 0, ESP_ERR_NOT_SUPPORTED, TAG, "DMA is not supported");
+    ESP_RETURN_ON_FALSE(dev_config->flags.double_buffer == 0, ESP_ERR_NOT_SUPPORTED, TAG, "double buffering is not supported");
 
     uint8_t bytes_per_pixel = 3;
     if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
@@ -179,6 +226,8 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     rmt_strip->rmt_channel = (rmt_channel_t)dev_config->rmt_channel;
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
+    rmt_strip->base.fill = led_strip_rmt_fill;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
@@ -31,20 +31,27 @@ typedef struct {
     uint8_t pixel_buf[];
 } led_strip_spi_obj;
 
-// please make sure to zero-initialize the buf before calling this function
-static void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
+// Each color of 1 bit is represented by 3 bits of SPI, low_level:100 ,high_level:110
+// So a color byte occupies 3 bytes of SPI, MSB first: bit n of the color lands in bit 3n+1 of the 24-bit pattern
+#define LED_STRIP_SPI_PATTERN(d) (0x924924 | ((d) & BIT(0)) << 1 | ((d) & BIT(1)) << 3 | ((d) & BIT(2)) << 5 | ((d) & BIT(3)) << 7 | \
+                                  ((d) & BIT(4)) << 9 | ((d) & BIT(5)) << 11 | ((d) & BIT(6)) << 13 | ((d) & BIT(7)) << 15)
+#define LED_STRIP_SPI_LUT_1(d) { LED_STRIP_SPI_PATTERN(d) >> 16 & 0xFF, LED_STRIP_SPI_PATTERN(d) >> 8 & 0xFF, LED_STRIP_SPI_PATTERN(d) & 0xFF }
+#define LED_STRIP_SPI_LUT_4(d) LED_STRIP_SPI_LUT_1(d), LED_STRIP_SPI_LUT_1(d + 1), LED_STRIP_SPI_LUT_1(d + 2), LED_STRIP_SPI_LUT_1(d + 3)
+#define LED_STRIP_SPI_LUT_16(d) LED_STRIP_SPI_LUT_4(d), LED_STRIP_SPI_LUT_4(d + 4), LED_STRIP_SPI_LUT_4(d + 8), LED_STRIP_SPI_LUT_4(d + 12)
+#define LED_STRIP_SPI_LUT_64(d) LED_STRIP_SPI_LUT_16(d), LED_STRIP_SPI_LUT_16(d + 16), LED_STRIP_SPI_LUT_16(d + 32), LED_STRIP_SPI_LUT_16(d + 48)
+
+// SPI bytes of every color byte, built at compile time
+static const uint8_t s_spi_pattern[256][SPI_BYTES_PER_COLOR_BYTE] = {
+    LED_STRIP_SPI_LUT_64(0), LED_STRIP_SPI_LUT_64(64), LED_STRIP_SPI_LUT_64(128), LED_STRIP_SPI_LUT_64(192)
+};
+
+// Writes the 3 SPI bytes of a color byte, the buffer needs no initialization
+static inline void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
 {
-    // Each color of 1 bit is represented by 3 bits of SPI, low_level:100 ,high_level:110
-    // So a color byte occupies 3 bytes of SPI.
-    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
-    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
-    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
-    *(buf + 1) |= BIT(0);
-    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
-    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
-    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
-    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
-    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+    const uint8_t *pattern = s_spi_pattern[data];
+    buf[0] = pattern[0];
+    buf[1] = pattern[1];
+    buf[2] = pattern[2];
 }
 
 static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
@@ -53,7 +60,6 @@ static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uin
     ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
     // LED_PIXEL_FORMAT_GRB takes 72bits(9bytes)
     uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
     __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
     __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
     __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
@@ -71,7 +77,6 @@ static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     // LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
     uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
     // SK6812 component order is GRBW
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
     __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
     __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
     __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
@@ -80,6 +85,58 @@ static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     return ESP_OK;
 }
 
+static esp_err_t led_strip_spi_set_pixels(led_strip_t *strip, uint32_t index, uint32_t count, const uint8_t *pixels, led_pixel_order_t order)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index <= spi_strip->strip_len && count <= spi_strip->strip_len - index, ESP_ERR_INVALID_ARG, TAG,
+                        "pixels out of maximum number of LEDs");
+    uint8_t *buf = spi_strip->pixel_buf + index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    if (order == LED_PIXEL_ORDER_GRB && spi_strip->bytes_per_pixel == 3) {
+        // Already in wire order, expand the buffer byte by byte
+        for (uint32_t i = 0; i < count * 3; i++) {
+            __led_strip_spi_bit(pixels[i], buf);
+            buf += SPI_BYTES_PER_COLOR_BYTE;
+        }
+        return ESP_OK;
+    }
+
+    uint32_t red_offset = order == LED_PIXEL_ORDER_RGB ? 0 : 1;
+    uint32_t green_offset = order == LED_PIXEL_ORDER_RGB ? 1 : 0;
+    for (uint32_t i = 0; i < count; i++, pixels += 3) {
+        __led_strip_spi_bit(pixels[green_offset], buf);
+        __led_strip_spi_bit(pixels[red_offset], buf + SPI_BYTES_PER_COLOR_BYTE);
+        __led_strip_spi_bit(pixels[2], buf + SPI_BYTES_PER_COLOR_BYTE * 2);
+        buf += SPI_BYTES_PER_COLOR_BYTE * 3;
+        if (spi_strip->bytes_per_pixel > 3) {
+            __led_strip_spi_bit(0, buf);
+            buf += SPI_BYTES_PER_COLOR_BYTE;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_fill(led_strip_t *strip, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    size_t pixel_len = spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    size_t len = spi_strip->strip_len * pixel_len;
+    if (len == 0) {
+        return ESP_OK;
+    }
+    uint8_t *buf = spi_strip->pixel_buf;
+    __led_strip_spi_bit(green, buf);
+    __led_strip_spi_bit(red, buf + SPI_BYTES_PER_COLOR_BYTE);
+    __led_strip_spi_bit(blue, buf + SPI_BYTES_PER_COLOR_BYTE * 2);
+    if (spi_strip->bytes_per_pixel > 3) {
+        __led_strip_spi_bit(0, buf + SPI_BYTES_PER_COLOR_BYTE * 3);
+    }
+    // Copy the pixels encoded so far onto the rest, doubling each time
+    for (size_t filled = pixel_len; filled < len; filled *= 2) {
+        memcpy(buf + filled, buf, filled < len - filled ? filled : len - filled);
+    }
+    return ESP_OK;
+}
+
 static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
@@ -96,15 +153,8 @@ static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
 
 static esp_err_t led_strip_spi_clear(led_strip_t *strip)
 {
-    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
     //Write zero to turn off all leds
-    memset(spi_strip->pixel_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    uint8_t *buf = spi_strip->pixel_buf;
-    for (int index = 0; index < spi_strip->strip_len * spi_strip->bytes_per_pixel; index++) {
-        __led_strip_spi_bit(0, buf);
-        buf += SPI_BYTES_PER_COLOR_BYTE;
-    }
-
+    led_strip_spi_fill(strip, 0, 0, 0);
     return led_strip_spi_refresh(strip);
 }
 
@@ -189,6 +239,8 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     spi_strip->strip_len = led_config->max_leds;
     spi_strip->base.set_pixel = led_strip_spi_set_pixel;
     spi_strip->base.set_pixel_rgbw = led_strip_spi_set_pixel_rgbw;
+    spi_strip->base.set_pixels = led_strip_spi_set_pixels;
+    spi_strip->base.fill = led_strip_spi_fill;
     spi_strip->base.refresh = led_strip_spi_refresh;
     spi_strip->base.clear = led_strip_spi_clear;
     spi_strip->base.del = led_strip_spi_del;
@@ -0,0 +1,2511 @@
+/**
+ * Host benchmark for the node-1-esp32s3 libraries
+ *
+ * Runs the display, sensor, LED and menu paths against the simulated HAL and prints
+ * the simulated bus / wire time and traffic of each. These figures depend only on
+ * the protocol traffic the libraries generate, so they are reproducible and can be
+ * compared before and after a change. Host CPU times are printed for reference only.
+ *
+ * Usage: host_bench [-v] [-d] [-g] [-l] [-r]
+ *  -v  keep library log output
+ *  -d  dump the simulated display RAM after the display benchmarks, and write the
+ *      rendered graphics scenes as PGM to the working directory
+ *  -g  rewrite the SSD1306 golden images from the current renderer
+ *  -l  run the statistics drift test over 10^9 samples instead of 10^7
+ *  -r  run only the sample ring and I2C transaction stress tests (for a HOST_TSAN build)
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "sim_hal.h"
+
+// The C libraries' headers have no C++ guards, as in src/main.cpp
+extern "C"
+{
+#include "communication.h"
+#include "esp-ssd1306.h"
+#include "esp-ssd1306-gfx.h"
+#include "esp32_fdc1004_lls.h"
+#include "esp32_fdc1004_acq.h"
+#include "MovingAverage.h"
+#include "gesp-stats.h"
+#include "gesp-filter.h"
+#include "gesp-ring.h"
+#include "gled_strip.h"
+#include "gled_effect.h"
+#include "gesp-system.h"
+}
+#include "font8x8_basic.h"
+
+#define BENCH_DISPLAY_PORT I2C_NUM_0
+#define BENCH_SENSOR_PORT I2C_NUM_1
+#define BENCH_LED_GPIO GPIO_NUM_42
+#define BENCH_SPI_LED_GPIO GPIO_NUM_41
+#define BENCH_SPI_LEDS 1000   // 9000 SPI bytes, within SIM_SPI_MAX_FRAME_LEN
+#define BENCH_SPI_FRAMES 1000 // Frames encoded per encoder
+#define BENCH_BULK_PIXELS 3000000 // Pixels set per path and strip length
+#define BENCH_BULK_MAX_LEDS 3000
+#define BENCH_ASYNC_LEDS 300
+#define BENCH_ASYNC_FRAMES 50 // Frames per render cost and refresh mode, in realtime mode
+#define BENCH_GROUP_FRAMES 20 // Frames per refresh mode, in realtime mode
+#define BENCH_EFFECT_LEDS 300
+#define BENCH_EFFECT_FRAMES 10000 // Frames rendered per effect
+#define BENCH_CLOCK_FPS 100
+#define BENCH_CLOCK_FRAMES 100
+#define BENCH_CLOCK_RENDER_US 3000 // Render and refresh cost per frame in the frame clock benchmark
+#define BENCH_SETTLE_MS 20
+#define BENCH_FRAME_BUILDS 1000000 // Frames built per path in the bytes touched benchmark
+#define BENCH_GFX_DRAWS 100000 // Calls timed per graphics primitive
+#define BENCH_DISPLAY_ASYNC_FRAMES 30 // Frames per render cost and flush mode, in realtime mode
+#define BENCH_ENGINE_TRANSFERS 2000   // Transfers submitted per producer
+#define BENCH_ENGINE_PRODUCERS 2
+#define BENCH_MA_SAMPLES 100000
+#define BENCH_PIPELINE_SAMPLES 1000000
+#define BENCH_DRIFT_SAMPLES 10000000ULL     // -l runs BENCH_DRIFT_SAMPLES_LONG
+#define BENCH_DRIFT_SAMPLES_LONG 1000000000ULL
+#define BENCH_FILTER_FRAMES 256           // Frames per block
+#define BENCH_FILTER_SAMPLES (1 << 23)    // Samples (frames x channels) per kernel and channel count
+#define BENCH_FILTER_MAX_CHANNELS 16
+#define BENCH_RING_RECORDS 10000000 // Records pushed by the stress test producer
+#define BENCH_RING_SLOTS 64
+#define BENCH_STRESS_ADDRESS 0x42    // Frame checker, on both buses
+#define BENCH_STRESS_PRODUCERS 2     // Tasks building transactions per bus
+#define BENCH_STRESS_FRAMES 20000    // Frames per task
+#define BENCH_SOAK_CYCLES 2000       // Start/stop cycles per program in the lifecycle soak test
+#define BENCH_SOAK_WARMUP 50         // Cycles run before the heap baseline is taken
+#define BENCH_SOAK_HEAP_SLACK 4096   // Heap growth above the baseline allowed for allocator noise, bytes
+#define BENCH_SOAK_JITTER_US 1000    // Start to stop delays are spread over this range in the race test
+
+static FILE *out; // Report stream, stdout may be silenced
+
+static const gpio_num_t button_gpios[MAX_NUM_BUTTONS] = {GPIO_NUM_36, GPIO_NUM_35, GPIO_NUM_34, GPIO_NUM_33};
+
+static void report_i2c(const char *name, i2c_port_t port, uint32_t repeats)
+{
+    sim_i2c_stats_t stats;
+    sim_i2c_get_stats(port, &stats);
+    fprintf(out, "%-28s %10.1f us bus %8.1f bytes %6.1f transactions %4u nacks\n", name,
+            stats.bus_time_ns / 1000.0 / repeats, (double)stats.bytes / repeats,
+            (double)stats.transactions / repeats, stats.nacks);
+    sim_i2c_reset_stats(port);
+}
+
+// Waits until no bus traffic has happened for BENCH_SETTLE_MS, for work done by other tasks
+static void wait_bus_idle(i2c_port_t port)
+{
+    sim_i2c_stats_t before, after;
+    do
+    {
+        sim_i2c_get_stats(port, &before);
+        vTaskDelay(pdMS_TO_TICKS(BENCH_SETTLE_MS));
+        sim_i2c_get_stats(port, &after);
+    } while (before.transactions != after.transactions);
+}
+
+static bool panel_matches(sim_ssd1306_handle_t panel, const ssd1306_t *display)
+{
+    return memcmp(sim_ssd1306_gddram(panel), display->framebuffer, sizeof(display->framebuffer)) == 0;
+}
+
+// Expected panel RAM, rendered straight from font8x8_basic rather than through the driver
+typedef uint8_t bench_frame_t[MAX_PAGES][SSD1306_WIDTH];
+
+static void expected_text(bench_frame_t frame, uint8_t line, const char *text)
+{
+    memset(frame[line], 0, SSD1306_WIDTH);
+    for (size_t i = 0; text[i] != '\0'; i++)
+        memcpy(&frame[line][i * 8], font8x8_basic[(uint8_t)text[i]], 8);
+}
+
+// Pixel-exact check of the panel against the expected frame
+static void check_panel(const char *name, sim_ssd1306_handle_t panel, const bench_frame_t expected)
+{
+    const uint8_t(*gddram)[SSD1306_WIDTH] = sim_ssd1306_gddram(panel);
+    uint32_t differ = 0;
+    for (uint8_t page = 0; page < MAX_PAGES; page++)
+        for (uint8_t col = 0; col < SSD1306_WIDTH; col++)
+            differ += __builtin_popcount(gddram[page][col] ^ expected[page][col]);
+    fprintf(out, "%-28s %s, %u pixels differ\n", name, differ == 0 ? "PASS" : "FAIL", differ);
+}
+
+// Positions of buf that build() writes: it runs over two different fills and every byte that no longer
+// holds its fill in either run counts, so writes of a value equal to one fill are still seen
+template <typename build_t>
+static size_t bytes_touched(uint8_t *buf, size_t len, build_t build)
+{
+    static bool written[BUFF_LEN * 2];
+    memset(written, 0, sizeof(written));
+    for (uint8_t fill : {0x5A, 0xA5})
+    {
+        memset(buf, fill, len);
+        build();
+        for (size_t i = 0; i < len; i++)
+            written[i] = written[i] || buf[i] != fill;
+    }
+    return std::count(written, written + len, true);
+}
+
+// A segment list is gathered into one staging copy when it has more than one segment and the driver has
+// no multi-buffer transmit (ESP-IDF before 5.3), see i2c_segments_transmit()
+static size_t segments_copied(const i2c_segment_list_t *list, bool multi_buffer)
+{
+    return list->count > 1 && !multi_buffer ? list->len : 0;
+}
+
+// Bytes copied to put one line of text on the panel: through a transaction buffer as print_text_on_line()
+// did, as a segment list of font and zero page references, and as it is now, into the framebuffer and
+// out with a flush. Each path is sent to the panel, which must end up showing the same line.
+static void bench_text_copy(ssd1306_t *display, sim_ssd1306_handle_t panel)
+{
+    const char *text = "Level 42.5 mm";
+    const size_t text_len = strlen(text);
+    const uint8_t line = LINE_2;
+    uint8_t header[SSD1306_WINDOW_HEADER_LEN] = {
+        OLED_CONTROL_BYTE_CMD, OLED_CMD_SET_COLUMN_RANGE, OLED_CONTROL_BYTE_CMD, 0, OLED_CONTROL_BYTE_CMD, SSD1306_WIDTH - 1,
+        OLED_CONTROL_BYTE_CMD, OLED_CMD_SET_PAGE_RANGE, OLED_CONTROL_BYTE_CMD, line, OLED_CONTROL_BYTE_CMD, line,
+        OLED_CONTROL_BYTE_GDDRAM_DATA_STREAM};
+
+    fprintf(out, "\n-- SSD1306 text line copy volume (\"%s\", %zu of %d characters) --\n", text, text_len, MAX_CHARACTERS_PER_LINE);
+    fprintf(out, "%-28s %10s %10s %10s\n", "", "5.2.1", "5.3+", "wire");
+
+    // Before: every glyph and blank cell copied into the transaction buffer
+    static uint8_t buffer[BUFF_LEN];
+    i2c_transaction_t trans;
+    i2c_transaction_init(&trans, buffer, sizeof(buffer));
+    auto reference_line = [&]() {
+        i2c_transaction_clear(&trans);
+        i2c_transaction_write_bytes(&trans, header, sizeof(header));
+        for (size_t i = 0; i < MAX_CHARACTERS_PER_LINE; i++)
+        {
+            if (i < text_len)
+                i2c_transaction_write_bytes(&trans, ssd1306_glyph(text[i]), 8);
+            else
+                i2c_transaction_write_zero(&trans, 8);
+        }
+    };
+    size_t copied = bytes_touched(buffer, sizeof(buffer), reference_line);
+    size_t frame_len = trans.len;
+    ESP_ERROR_CHECK(i2c_transaction_transmit(&trans, display->slave_handle));
+    uint8_t expected[SSD1306_WIDTH];
+    memcpy(expected, sim_ssd1306_gddram(panel)[line], sizeof(expected));
+    fprintf(out, "%-28s %6zu bytes %6zu bytes %6zu bytes\n", "transaction buffer (before)", copied, copied, frame_len);
+
+    // Glyphs referenced in the font table, padding in the shared zero page
+    i2c_segment_list_t segments;
+    i2c_segments_init(&segments);
+    i2c_segments_add(&segments, header, sizeof(header));
+    for (size_t i = 0; i < text_len; i++)
+        i2c_segments_add(&segments, ssd1306_glyph(text[i]), 8);
+    i2c_segments_add_zero(&segments, (MAX_CHARACTERS_PER_LINE - text_len) * 8);
+    display->clear_line(display, line);
+    ESP_ERROR_CHECK(display->flush(display));
+    ESP_ERROR_CHECK(i2c_segments_transmit(&segments, display->slave_handle));
+    bool same = memcmp(sim_ssd1306_gddram(panel)[line], expected, sizeof(expected)) == 0;
+    fprintf(out, "%-28s %6zu bytes %6zu bytes %6zu bytes %zu segments\n", "segment list", segments_copied(&segments, false),
+            segments_copied(&segments, true), segments.len, segments.count);
+
+    // Now: the glyphs are copied into the framebuffer, the flush gathers the header and the dirty row
+    ssd1306_t copy = *display;
+    copied = bytes_touched(&copy.framebuffer[0][0], sizeof(copy.framebuffer), [&]() { copy.print_text_on_line(&copy, text, line); });
+    display->clear_line(display, line);
+    ESP_ERROR_CHECK(display->flush(display));
+    display->print_text_on_line(display, text, line);
+    i2c_segments_init(&segments); // As ssd1306_flush_window() builds it
+    i2c_segments_add(&segments, header, sizeof(header));
+    i2c_segments_add(&segments, display->framebuffer[line], SSD1306_WIDTH);
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+    ESP_ERROR_CHECK(display->flush(display));
+    sim_i2c_stats_t stats;
+    sim_i2c_get_stats(BENCH_DISPLAY_PORT, &stats);
+    same = same && panel_matches(panel, display) && memcmp(display->framebuffer[line], expected, sizeof(expected)) == 0;
+    fprintf(out, "%-28s %6zu bytes %6zu bytes %6u bytes\n", "framebuffer + flush (now)", copied + segments_copied(&segments, false),
+            copied + segments_copied(&segments, true), (unsigned)stats.bytes);
+    fprintf(out, "%-28s %s\n", "same panel line", same ? "PASS" : "FAIL");
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+}
+
+// Full screen text redrawn every frame, in realtime mode: flushed blocking, then through the I2C async
+// engine while the next frame renders. Then several tasks submitting short transfers straight to the
+// engine, for its queue depth, latency and throughput.
+static void bench_display_async(i2c_master_bus_handle_t bus, sim_ssd1306_handle_t panel)
+{
+    static const int64_t render_costs_us[] = {0, 10000, 25000};
+
+    fprintf(out, "\n-- SSD1306 uploads through the I2C async engine (full frame text, realtime) --\n");
+    fprintf(out, "%-28s %10s %8s %10s %8s %8s %8s %6s\n", "render cost", "blocking", "idle", "async", "idle", "p50", "p99",
+            "depth");
+    sim_set_realtime(true);
+    bool matches = true;
+    for (int64_t render_us : render_costs_us)
+    {
+        double fps[2], idle[2];
+        i2c_async_stats_t stats = {};
+        for (int async = 0; async < 2; async++)
+        {
+            ssd1306_t display;
+            i2c_async_handle_t engine = NULL;
+            ESP_ERROR_CHECK(gesp_ssd1306_init(bus, &display));
+            if (async)
+            {
+                ESP_ERROR_CHECK(i2c_async_new(bus, NULL, &engine));
+                ESP_ERROR_CHECK(ssd1306_set_async(&display, engine));
+            }
+            ESP_ERROR_CHECK(display.flush(&display));
+            ESP_ERROR_CHECK(ssd1306_flush_wait(&display, portMAX_DELAY));
+
+            int64_t busy_us = 0;
+            int64_t start_us = esp_timer_get_time();
+            for (uint32_t f = 0; f < BENCH_DISPLAY_ASYNC_FRAMES; f++)
+            {
+                int64_t render_start_us = esp_timer_get_time();
+                char text[MAX_CHARACTERS_PER_LINE + 1];
+                for (uint8_t line = 0; line < MAX_LINES; line++)
+                {
+                    snprintf(text, sizeof(text), "Frame %4u ln %u", f, line);
+                    display.print_text_on_line(&display, text, line);
+                }
+                int64_t remaining_us = render_us - (esp_timer_get_time() - render_start_us);
+                if (remaining_us > 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(remaining_us));
+                busy_us += esp_timer_get_time() - render_start_us;
+                ESP_ERROR_CHECK(display.flush(&display));
+            }
+            ESP_ERROR_CHECK(ssd1306_flush_wait(&display, portMAX_DELAY));
+            int64_t wall_us = esp_timer_get_time() - start_us;
+            fps[async] = BENCH_DISPLAY_ASYNC_FRAMES * 1e6 / wall_us;
+            idle[async] = 100.0 * (wall_us - busy_us) / wall_us;
+            matches = matches && panel_matches(panel, &display);
+
+            if (async)
+            {
+                ESP_ERROR_CHECK(ssd1306_set_async(&display, NULL));
+                ESP_ERROR_CHECK(i2c_async_get_stats(engine, &stats));
+                ESP_ERROR_CHECK(i2c_async_del(engine));
+            }
+            ESP_ERROR_CHECK(i2c_master_bus_rm_device(display.slave_handle));
+        }
+        char name[40];
+        snprintf(name, sizeof(name), "%.1f ms", render_us / 1000.0);
+        fprintf(out, "%-28s %6.1f fps %6.1f %% %6.1f fps %6.1f %% %5.1f ms %5.1f ms %6u\n", name, fps[0], idle[0], fps[1], idle[1],
+                i2c_async_latency_percentile(&stats, 50) / 1000.0, i2c_async_latency_percentile(&stats, 99) / 1000.0,
+                stats.depth_high_water);
+    }
+    fprintf(out, "%-28s %10s panel RAM equals the framebuffer after every run\n", "async uploads", matches ? "PASS" : "FAIL");
+
+    // Producers on other threads submitting 2 byte NOP commands as fast as the ring takes them
+    static const uint8_t nop[] = {OLED_CONTROL_BYTE_CMD, OLED_CMD_NOP};
+    static const uint16_t depths[] = {4, 16, 64};
+    i2c_master_dev_handle_t slave;
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = OLED_I2C_ADDRESS,
+        .scl_speed_hz = SSD1306_SCL_SPEED_HZ,
+    };
+    ESP_ERROR_CHECK(i2c_master_bus_add_device(bus, &dev_cfg, &slave));
+    fprintf(out, "\n-- I2C async engine (%d producers x %d NOP commands, realtime) --\n", BENCH_ENGINE_PRODUCERS,
+            BENCH_ENGINE_TRANSFERS);
+    fprintf(out, "%-28s %12s %8s %6s %8s %8s %8s\n", "queue depth", "throughput", "rejected", "depth", "p50", "p99", "max");
+    for (uint16_t depth : depths)
+    {
+        i2c_async_config_t config = {.queue_depth = depth, .task_stack = 0, .task_priority = 0, .core_id = tskNO_AFFINITY, .timeout_ms = 0};
+        i2c_async_handle_t engine;
+        ESP_ERROR_CHECK(i2c_async_new(bus, &config, &engine));
+        i2c_async_request_t request = {};
+        request.slave_handle = slave;
+        request.write_buffer = nop;
+        request.write_len = sizeof(nop);
+
+        int64_t start_us = esp_timer_get_time();
+        std::thread producers[BENCH_ENGINE_PRODUCERS];
+        for (std::thread &producer : producers)
+            producer = std::thread([&]() {
+                for (int i = 0; i < BENCH_ENGINE_TRANSFERS; i++)
+                    while (i2c_async_submit(engine, &request) != ESP_OK)
+                        std::this_thread::yield(); // Ring full, counted as rejected
+            });
+        for (std::thread &producer : producers)
+            producer.join();
+        ESP_ERROR_CHECK(i2c_async_wait_idle(engine, portMAX_DELAY));
+        int64_t wall_us = esp_timer_get_time() - start_us;
+
+        i2c_async_stats_t stats;
+        ESP_ERROR_CHECK(i2c_async_get_stats(engine, &stats));
+        ESP_ERROR_CHECK(i2c_async_del(engine));
+        char name[32];
+        snprintf(name, sizeof(name), "%u", depth);
+        fprintf(out, "%-28s %8.0f /s %8u %6u %5lld us %5lld us %5lld us\n", name, stats.completed * 1e6 / wall_us, stats.rejected,
+                stats.depth_high_water, (long long)i2c_async_latency_percentile(&stats, 50),
+                (long long)i2c_async_latency_percentile(&stats, 99), (long long)stats.latency_max_us);
+    }
+    ESP_ERROR_CHECK(i2c_master_bus_rm_device(slave));
+    sim_set_realtime(false);
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+}
+
+// Frame rate the bus allows for typical updates at each SCL speed, from the transactions and bytes of
+// one flush. Scattered changes are sent as a window per dirty page rather than the whole frame.
+static void bench_display_rates(ssd1306_t *display, sim_ssd1306_handle_t panel)
+{
+    const uint32_t speeds[] = {100000, 400000, 1000000};
+    const uint32_t repeats = 10;
+
+    fprintf(out, "\n-- SSD1306 frame rate by SCL speed (bus time only) --\n");
+    fprintf(out, "%-28s %8s %6s %9s %9s %9s\n", "update", "bytes", "trans", "100 kHz", "400 kHz", "1 MHz");
+    display->clear_display(display);
+    ESP_ERROR_CHECK(display->flush(display));
+
+    // One row from the bus statistics of repeats updates
+    auto print_rates = [&](const char *name, const sim_i2c_stats_t &stats) {
+        double bytes = (double)stats.bytes / repeats, transactions = (double)stats.transactions / repeats;
+        fprintf(out, "%-28s %8.1f %6.1f", name, bytes, transactions);
+        for (uint32_t speed : speeds)
+        {
+            // Every transaction pays START, address and STOP, every byte 9 clocks
+            double start_stop_ns = sim_i2c_transfer_time_ns(speed, 0);
+            double byte_ns = (sim_i2c_transfer_time_ns(speed, 1000) - start_stop_ns) / 1000.0;
+            fprintf(out, " %5.0f fps", 1e9 / (transactions * start_stop_ns + bytes * byte_ns));
+        }
+        fprintf(out, "\n");
+    };
+    auto report = [&](const char *name, auto draw) {
+        sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+        for (uint32_t i = 0; i < repeats; i++)
+        {
+            draw(i);
+            ESP_ERROR_CHECK(display->flush(display));
+        }
+        sim_i2c_stats_t stats;
+        sim_i2c_get_stats(BENCH_DISPLAY_PORT, &stats);
+        print_rates(name, stats);
+    };
+
+    auto gauge = [&](uint32_t i) {
+        char value[8];
+        snprintf(value, sizeof(value), "%3u %%", (unsigned)(i * 10));
+        ssd1306_draw_bar(display, 0, 48, 128, 16, i * 10, 100);
+        display->print_text_on_line(display, value, LINE_4);
+    };
+    // The program start case: cursor column and marker column leave the bounding window mostly clean
+    auto scattered = [&](uint32_t i) {
+        display->print_8x8basic(display, i % 2 ? '*' : ' ', LINE_0, 120);
+        display->print_8x8basic(display, i % 2 ? ' ' : '*', LINE_2, 120);
+        display->print_8x8basic(display, i % 2 ? '>' : ' ', LINE_4, 0);
+        display->print_8x8basic(display, i % 2 ? ' ' : '>', LINE_7, 0);
+    };
+    report("full frame", [&](uint32_t) { display->flush_frame(display); });
+    report("gauge (bar + value)", gauge);
+    report("menu cursor move", [&](uint32_t i) {
+        display->print_8x8basic(display, ' ', LINE_2 + i % 3, 0);
+        display->print_8x8basic(display, '>', LINE_2 + (i + 1) % 3, 0);
+    });
+    report("4 scattered glyphs", scattered);
+    bool matches = panel_matches(panel, display);
+
+    // The same updates queued on the async engine, as on the target, go out as the same windows
+    i2c_async_handle_t engine;
+    ESP_ERROR_CHECK(i2c_async_new(display->bus, NULL, &engine));
+    ESP_ERROR_CHECK(ssd1306_set_async(display, engine));
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        scattered(i);
+        ESP_ERROR_CHECK(display->flush(display));
+    }
+    ESP_ERROR_CHECK(ssd1306_flush_wait(display, portMAX_DELAY));
+    ESP_ERROR_CHECK(ssd1306_set_async(display, NULL));
+    ESP_ERROR_CHECK(i2c_async_del(engine));
+    sim_i2c_stats_t stats;
+    sim_i2c_get_stats(BENCH_DISPLAY_PORT, &stats);
+    print_rates("4 scattered glyphs (async)", stats);
+    matches = matches && panel_matches(panel, display);
+    fprintf(out, "%-28s %s\n", "panel after updates", matches ? "PASS" : "FAIL");
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+}
+
+// Reference transform of one source pixel at column x, row y (screen coordinates, y down)
+static void reference_rotate(int rotation, int x, int y, int *ret_x, int *ret_y)
+{
+    static const int turns[SSD1306_ROTATIONS][4] = {{1, 0, 0, 1}, {0, -1, 1, 0}, {-1, 0, 0, -1}, {0, 1, -1, 0}};
+    const int *m = turns[rotation]; // Clockwise quarter turns about the cell centre, in half pixels
+    int cx = 2 * x - 7, cy = 2 * y - 7;
+    *ret_x = (m[0] * cx + m[1] * cy + 7) / 2;
+    *ret_y = (m[2] * cx + m[3] * cy + 7) / 2;
+}
+
+// Every glyph of the compile time atlas against the same glyph transformed at run time from
+// font8x8_basic, pixel by pixel: each rotation, inverted and not, and the 2x glyphs
+static void bench_font_atlas(void)
+{
+    static const char *const rotations[SSD1306_ROTATIONS] = {"0", "90", "180", "270"};
+    fprintf(out, "\n-- SSD1306 font atlas (%d glyphs) --\n", SSD1306_FONT_GLYPHS);
+
+    for (int rotation = 0; rotation < SSD1306_ROTATIONS; rotation++)
+    {
+        uint32_t bad_glyphs = 0, bad_inverted = 0;
+        int first_bad = -1;
+        for (int c = 0; c < SSD1306_FONT_GLYPHS; c++)
+        {
+            uint8_t expected[8] = {0};
+            for (int x = 0; x < 8; x++)
+            {
+                for (int y = 0; y < 8; y++)
+                {
+                    if (!((font8x8_basic[c][x] >> y) & 1))
+                        continue;
+                    int rx, ry;
+                    reference_rotate(rotation, x, y, &rx, &ry);
+                    expected[rx] |= 1 << ry;
+                }
+            }
+            const uint8_t *glyph = ssd1306_font_glyph((char)c, (ssd1306_rotation_t)rotation, false);
+            const uint8_t *inverted = ssd1306_font_glyph((char)c, (ssd1306_rotation_t)rotation, true);
+            bool glyph_ok = memcmp(glyph, expected, 8) == 0, inverted_ok = true;
+            for (int x = 0; x < 8; x++)
+                inverted_ok = inverted_ok && inverted[x] == (uint8_t)~expected[x];
+            bad_glyphs += !glyph_ok;
+            bad_inverted += !inverted_ok;
+            if ((!glyph_ok || !inverted_ok) && first_bad < 0)
+                first_bad = c;
+        }
+        char name[40];
+        snprintf(name, sizeof(name), "rotated %s, inverted", rotations[rotation]);
+        fprintf(out, "%-28s %10s %u + %u glyphs differ", name, bad_glyphs + bad_inverted ? "FAIL" : "PASS", bad_glyphs, bad_inverted);
+        if (first_bad >= 0)
+            fprintf(out, ", first U+%04X", first_bad);
+        fprintf(out, "\n");
+    }
+
+    uint32_t bad_scaled = 0;
+    for (int c = 0; c < SSD1306_FONT_GLYPHS; c++)
+    {
+        const uint16_t *glyph = ssd1306_font_glyph_2x((char)c);
+        bool ok = true;
+        for (int x = 0; x < SSD1306_FONT_2X_WIDTH; x++)
+            for (int y = 0; y < 16; y++)
+                ok = ok && ((glyph[x] >> y) & 1) == ((font8x8_basic[c][x / 2] >> (y / 2)) & 1);
+        bad_scaled += !ok;
+    }
+    fprintf(out, "%-28s %10s %u glyphs differ\n", "scaled 2x", bad_scaled ? "FAIL" : "PASS", bad_scaled);
+}
+
+// Graphics scenes checked against the golden images in HOST_GOLDEN_DIR
+static const uint8_t gfx_bitmap[2 * 12] = {
+    0x00, 0xE0, 0x10, 0x08, 0x04, 0x02, 0x02, 0x04, 0x08, 0x10, 0xE0, 0x00, // 12 x 12 ring, top page
+    0x00, 0x00, 0x01, 0x02, 0x04, 0x08, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00,
+};
+
+static void scene_primitives(ssd1306_t *device)
+{
+    ssd1306_draw_pixel(device, 0, 0, SSD1306_COLOUR_ON);
+    ssd1306_draw_pixel(device, 127, 63, SSD1306_COLOUR_ON);
+    ssd1306_draw_hline(device, -10, 5, 60, SSD1306_COLOUR_ON); // Clipped on the left
+    ssd1306_draw_vline(device, 3, 9, 50, SSD1306_COLOUR_ON);   // Spans seven pages
+    ssd1306_draw_line(device, 10, 10, 60, 40, SSD1306_COLOUR_ON);
+    ssd1306_draw_line(device, 60, 10, 10, 60, SSD1306_COLOUR_ON);
+    ssd1306_draw_rect(device, 70, 3, 40, 21, SSD1306_COLOUR_ON);
+    ssd1306_fill_rect(device, 75, 30, 60, 13, SSD1306_COLOUR_ON); // Clipped on the right
+    ssd1306_fill_rect(device, 80, 34, 20, 4, SSD1306_COLOUR_INVERT);
+    ssd1306_draw_bitmap(device, 112, 47, gfx_bitmap, 12, 12, SSD1306_COLOUR_ON);
+}
+
+static void scene_gauge(ssd1306_t *device)
+{
+    static const float trend[] = {40, 41, 43, 42, 45, 48, 47, 50, 52, 51, 49, 53, 56, 55, 58, 60};
+    ssd1306_draw_string(device, 0, 0, "Level", 1, true);
+    ssd1306_draw_string(device, 0, 11, "42%", 2, false);
+    ssd1306_draw_bar(device, 0, 30, 128, 12, 42, 100);
+    ssd1306_draw_sparkline(device, 0, 45, 128, 19, trend, sizeof(trend) / sizeof(trend[0]), 40, 60);
+}
+
+static void scene_text(ssd1306_t *device)
+{
+    ssd1306_draw_string(device, 0, 0, "Fixed 8x8 cells", 1, false);
+    ssd1306_draw_string(device, 0, 9, "Proportional text", 1, true); // Not page aligned
+    ssd1306_draw_string(device, 2, 19, "x2 Ab", 2, false);
+    ssd1306_draw_char(device, 90, 19, 'Q', 4);
+    ssd1306_draw_glyph(device, 0, 40, 'R', SSD1306_ROTATE_90, false);
+    ssd1306_draw_glyph(device, 10, 40, 'R', SSD1306_ROTATE_180, false);
+    ssd1306_draw_glyph(device, 20, 40, 'R', SSD1306_ROTATE_270, false);
+    ssd1306_draw_glyph(device, 30, 43, 'R', SSD1306_ROTATE_0, true);
+    ssd1306_draw_string(device, 120, 56, "clip", 1, false); // Runs off the right edge
+}
+
+typedef struct
+{
+    const char *name;
+    void (*draw)(ssd1306_t *device);
+} gfx_scene_t;
+
+static const gfx_scene_t gfx_scenes[] = {
+    {"primitives", scene_primitives},
+    {"gauge", scene_gauge},
+    {"text", scene_text},
+};
+
+// Frames are stored as plain PGM (P2, maxval 1), a row of pixels per line, so they diff as text
+static bool write_pgm(const char *path, const uint8_t (*frame)[SSD1306_WIDTH])
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+    fprintf(file, "P2\n%d %d\n1\n", SSD1306_WIDTH, SSD1306_HEIGHT);
+    for (int y = 0; y < SSD1306_HEIGHT; y++)
+    {
+        for (int x = 0; x < SSD1306_WIDTH; x++)
+            fprintf(file, x ? " %d" : "%d", (frame[y / 8][x] >> (y % 8)) & 1);
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+static bool read_pgm(const char *path, bench_frame_t frame)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+    int width = 0, height = 0, maxval = 0;
+    bool valid = fscanf(file, "P2 %d %d %d", &width, &height, &maxval) == 3 && width == SSD1306_WIDTH &&
+                 height == SSD1306_HEIGHT && maxval == 1;
+    memset(frame, 0, sizeof(bench_frame_t));
+    for (int y = 0; valid && y < SSD1306_HEIGHT; y++)
+    {
+        for (int x = 0; valid && x < SSD1306_WIDTH; x++)
+        {
+            int pixel;
+            valid = fscanf(file, "%d", &pixel) == 1;
+            frame[y / 8][x] |= (pixel != 0) << (y % 8);
+        }
+    }
+    fclose(file);
+    return valid;
+}
+
+// Each scene against its golden image, then the host time of each primitive. -g rewrites the golden
+// images from the current renderer; check them by eye before committing. -d writes each rendered scene
+// to the working directory, and a scene that does not match is always written there.
+static void bench_gfx(const ssd1306_t *display, bool dump, bool regenerate)
+{
+    static ssd1306_t canvas;
+    canvas = *display;
+
+    fprintf(out, "\n-- SSD1306 graphics --\n");
+    for (const gfx_scene_t &scene : gfx_scenes)
+    {
+        char golden_path[256], path[64];
+        snprintf(golden_path, sizeof(golden_path), "%s/ssd1306_%s.pgm", HOST_GOLDEN_DIR, scene.name);
+        snprintf(path, sizeof(path), "ssd1306_%s.out.pgm", scene.name);
+        memset(canvas.framebuffer, 0, sizeof(canvas.framebuffer));
+        scene.draw(&canvas);
+
+        if (regenerate)
+        {
+            bool written = write_pgm(golden_path, canvas.framebuffer);
+            fprintf(out, "%-28s %10s %s\n", scene.name, written ? "WRITTEN" : "FAIL", golden_path);
+            continue;
+        }
+        static bench_frame_t golden;
+        if (!read_pgm(golden_path, golden))
+        {
+            fprintf(out, "%-28s %10s cannot read %s\n", scene.name, "FAIL", golden_path);
+            continue;
+        }
+        uint32_t differ = 0;
+        for (uint8_t page = 0; page < MAX_PAGES; page++)
+            for (uint8_t col = 0; col < SSD1306_WIDTH; col++)
+                differ += __builtin_popcount(canvas.framebuffer[page][col] ^ golden[page][col]);
+        fprintf(out, "%-28s %10s %u pixels differ from the golden image\n", scene.name, differ == 0 ? "PASS" : "FAIL", differ);
+        if (dump || differ != 0)
+            write_pgm(path, canvas.framebuffer);
+    }
+
+    static const float samples[64] = {0, 5, 3, 8, 12, 9, 15, 20, 18, 25};
+    const struct
+    {
+        const char *name;
+        void (*draw)(ssd1306_t *device);
+    } primitives[] = {
+        {"pixel", [](ssd1306_t *d) { ssd1306_draw_pixel(d, 40, 20, SSD1306_COLOUR_INVERT); }},
+        {"hline 128", [](ssd1306_t *d) { ssd1306_draw_hline(d, 0, 21, 128, SSD1306_COLOUR_INVERT); }},
+        {"vline 64", [](ssd1306_t *d) { ssd1306_draw_vline(d, 40, 0, 64, SSD1306_COLOUR_INVERT); }},
+        {"line 128 x 64", [](ssd1306_t *d) { ssd1306_draw_line(d, 0, 0, 127, 63, SSD1306_COLOUR_INVERT); }},
+        {"rect 64 x 32", [](ssd1306_t *d) { ssd1306_draw_rect(d, 3, 5, 64, 32, SSD1306_COLOUR_INVERT); }},
+        {"fill_rect 64 x 32", [](ssd1306_t *d) { ssd1306_fill_rect(d, 3, 5, 64, 32, SSD1306_COLOUR_INVERT); }},
+        {"bar 128 x 12", [](ssd1306_t *d) { ssd1306_draw_bar(d, 0, 30, 128, 12, 42, 100); }},
+        {"sparkline 64 samples", [](ssd1306_t *d) { ssd1306_draw_sparkline(d, 0, 45, 128, 19, samples, 64, 0, 25); }},
+        {"bitmap 12 x 12", [](ssd1306_t *d) { ssd1306_draw_bitmap(d, 50, 13, gfx_bitmap, 12, 12, SSD1306_COLOUR_INVERT); }},
+        {"char x1, page aligned", [](ssd1306_t *d) { ssd1306_draw_char(d, 16, 8, 'A', 1); }},
+        {"char x1, unaligned", [](ssd1306_t *d) { ssd1306_draw_char(d, 16, 11, 'A', 1); }},
+        {"char x2", [](ssd1306_t *d) { ssd1306_draw_char(d, 16, 11, 'A', 2); }},
+        {"char x4", [](ssd1306_t *d) { ssd1306_draw_char(d, 16, 11, 'A', 4); }},
+        {"glyph rotated 90", [](ssd1306_t *d) { ssd1306_draw_glyph(d, 16, 11, 'A', SSD1306_ROTATE_90, false); }},
+        {"string 16, fixed", [](ssd1306_t *d) { ssd1306_draw_string(d, 0, 11, "0123456789ABCDEF", 1, false); }},
+        {"string 16, proportional", [](ssd1306_t *d) { ssd1306_draw_string(d, 0, 11, "0123456789ABCDEF", 1, true); }},
+    };
+    for (const auto &primitive : primitives)
+    {
+        int64_t start_us = esp_timer_get_time();
+        for (int i = 0; i < BENCH_GFX_DRAWS; i++)
+            primitive.draw(&canvas);
+        double ns = (esp_timer_get_time() - start_us) * 1000.0 / BENCH_GFX_DRAWS;
+        fprintf(out, "%-28s %10.1f ns host\n", primitive.name, ns);
+    }
+}
+
+static sim_ssd1306_handle_t bench_display(i2c_master_bus_handle_t bus, ssd1306_t *display, bool dump)
+{
+    sim_ssd1306_handle_t panel;
+    ESP_ERROR_CHECK(sim_ssd1306_new(BENCH_DISPLAY_PORT, OLED_I2C_ADDRESS, &panel));
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+
+    fprintf(out, "\n-- SSD1306 (%u Hz SCL) --\n", SSD1306_SCL_SPEED_HZ);
+    ESP_ERROR_CHECK(gesp_ssd1306_init(bus, display));
+    report_i2c("init", BENCH_DISPLAY_PORT, 1);
+
+    // Each screen is checked pixel for pixel against the simulated panel after its flushes
+    static bench_frame_t expected;
+    memset(expected, 0, sizeof(expected));
+
+    const uint32_t repeats = 10;
+    for (uint32_t i = 0; i < repeats; i++)
+        ESP_ERROR_CHECK(display->flush_frame(display));
+    report_i2c("flush_frame", BENCH_DISPLAY_PORT, repeats);
+    check_panel("blank frame", panel, expected);
+
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        display->clear_display(display);
+        for (uint8_t line = 0; line < MAX_LINES; line++)
+            display->print_text_on_line(display, "0123456789ABCDEF", line);
+        ESP_ERROR_CHECK(display->flush(display));
+    }
+    report_i2c("full screen text + flush", BENCH_DISPLAY_PORT, repeats);
+    for (uint8_t line = 0; line < MAX_LINES; line++)
+        expected_text(expected, line, "0123456789ABCDEF");
+    check_panel("full screen text", panel, expected);
+
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        display->print_text_on_line(display, i % 2 ? ">1.Program 1" : " 1.Program 1", LINE_2);
+        ESP_ERROR_CHECK(display->flush(display));
+    }
+    report_i2c("one line + flush", BENCH_DISPLAY_PORT, repeats);
+    expected_text(expected, LINE_2, ">1.Program 1");
+    check_panel("one line", panel, expected);
+
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        ssd1306_draw_char(display, 0, 0, i % 2 ? '>' : ' ', 1);
+        ESP_ERROR_CHECK(display->flush(display));
+    }
+    report_i2c("one char + flush", BENCH_DISPLAY_PORT, repeats);
+    memcpy(expected[0], font8x8_basic[(uint8_t)'>'], 8); // Opaque cell over the '0'
+    check_panel("one char", panel, expected);
+
+    int64_t start_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        display->clear_display(display);
+        ssd1306_draw_string(display, 0, 3, "Level 42%", 2, true);
+        ssd1306_draw_rect(display, 0, 40, 128, 24, SSD1306_COLOUR_ON);
+        ssd1306_draw_bar(display, 2, 42, 124, 20, 42, 100);
+        ESP_ERROR_CHECK(display->flush(display));
+    }
+    int64_t cpu_us = esp_timer_get_time() - start_us;
+    report_i2c("gfx screen + flush", BENCH_DISPLAY_PORT, repeats);
+    fprintf(out, "%-28s %10.1f us host\n", "gfx screen + flush", (double)cpu_us / repeats);
+    memcpy(expected, display->framebuffer, sizeof(expected)); // Transfer only, the drawing is not modelled here
+    check_panel("gfx screen (framebuffer)", panel, expected);
+
+    uint32_t command_bytes, data_bytes;
+    sim_ssd1306_get_counts(panel, &command_bytes, &data_bytes);
+    fprintf(out, "%-28s %10u command bytes %8u data bytes\n", "panel totals", command_bytes, data_bytes);
+
+    if (dump)
+        sim_ssd1306_dump(panel, out);
+    bench_text_copy(display, panel);
+    bench_display_rates(display, panel);
+    // The panel stays attached for the asynchronous upload and menu benchmarks
+    bench_display_async(bus, panel);
+    return panel;
+}
+
+// Single shot sample rate per channel at each FDC1004 rate, for parts converting at and behind the datasheet time
+template <typename build_t>
+static double build_ns(build_t build)
+{
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < BENCH_FRAME_BUILDS; i++)
+        build();
+    return (esp_timer_get_time() - start_us) * 1000.0 / BENCH_FRAME_BUILDS;
+}
+
+// The transaction clear before it became O(1): the whole backing buffer was zeroed
+static void reference_clear_memset(i2c_transaction_t *trans)
+{
+    memset(trans->buffer, 0, trans->capacity);
+    i2c_transaction_clear(trans);
+}
+
+// One frame with each clear: build(clear) builds the frame in buffer
+template <typename build_t>
+static void report_frame_bytes(const char *name, uint8_t *buffer, size_t len, build_t build)
+{
+    size_t touched[2];
+    double ns[2];
+    touched[0] = bytes_touched(buffer, len, [&]() { build(reference_clear_memset); });
+    ns[0] = build_ns([&]() { build(reference_clear_memset); });
+    touched[1] = bytes_touched(buffer, len, [&]() { build(i2c_transaction_clear); });
+    ns[1] = build_ns([&]() { build(i2c_transaction_clear); });
+    fprintf(out, "%-28s %6zu bytes %7.1f ns %6zu bytes %7.1f ns host\n", name, touched[0], ns[0], touched[1], ns[1]);
+}
+
+// Memory written to build the FDC1004 read_register() pointer frame and the SSD1306 print_8x8basic()
+// frame of the time, in a BUFF_LEN transaction like the shared buffer the drivers used, with the old
+// memset clear and with the O(1) clear. Then print_8x8basic() as it is now, into the framebuffer.
+static void bench_frame_bytes(const ssd1306_t *display)
+{
+    static uint8_t buffer[BUFF_LEN];
+    i2c_transaction_t trans;
+    i2c_transaction_init(&trans, buffer, sizeof(buffer));
+
+    auto fdc_pointer = [&](auto clear) {
+        clear(&trans);
+        i2c_transaction_write_byte(&trans, FDC_DEVICE_ID_REG);
+    };
+    auto ssd1306_char = [&](auto clear) {
+        clear(&trans);
+        i2c_transaction_write_byte(&trans, OLED_CONTROL_BYTE_CMD);
+        i2c_transaction_write_byte(&trans, OLED_SET_PAGE_ADDRESS | LINE_2);
+        i2c_transaction_write_byte(&trans, OLED_CONTROL_BYTE_CMD);
+        i2c_transaction_write_byte(&trans, OLED_SET_LWR_COLOUMN_START_ADDR);
+        i2c_transaction_write_byte(&trans, OLED_CONTROL_BYTE_CMD);
+        i2c_transaction_write_byte(&trans, OLED_SET_UPR_COLOUMN_START_ADDR);
+        i2c_transaction_write_byte(&trans, OLED_CONTROL_BYTE_GDDRAM_DATA_STREAM);
+        i2c_transaction_write_bytes(&trans, ssd1306_glyph('A'), 8);
+    };
+
+    fprintf(out, "\n-- I2C frame building (%d byte transaction, memset clear vs O(1) clear) --\n", BUFF_LEN);
+    fprintf(out, "%-28s %10s %10s %10s %10s\n", "", "before", "", "after", "");
+    report_frame_bytes("FDC1004 read_register", buffer, sizeof(buffer), fdc_pointer);
+    report_frame_bytes("SSD1306 print_8x8basic", buffer, sizeof(buffer), ssd1306_char);
+
+    // Now the character only goes into the framebuffer, a flush later sends it with a 13 byte window header
+    ssd1306_t copy = *display;
+    uint8_t *framebuffer = &copy.framebuffer[0][0];
+    size_t touched = bytes_touched(framebuffer, sizeof(copy.framebuffer), [&]() { copy.print_8x8basic(&copy, 'A', LINE_2, 0); });
+    double ns = build_ns([&]() { copy.print_8x8basic(&copy, 'A', LINE_2, 0); });
+    fprintf(out, "%-28s %6zu bytes %7.1f ns into the framebuffer\n", "print_8x8basic (now)", touched, ns);
+}
+
+static void bench_sensor_rate(level_calc_t level, sim_fdc1004_handle_t sensor)
+{
+    static const uint8_t rates[] = {FDC1004_100HZ, FDC1004_200HZ, FDC1004_400HZ};
+    static const double scales[] = {1.0, 1.3};
+    const fdc_channel_t channels[] = {level->ref_channel, level->lev_channel, level->env_channel};
+    const uint32_t samples = 20;
+
+    fprintf(out, "\n-- FDC1004 sampling (%u single shots per channel) --\n", samples);
+    fprintf(out, "%-28s %10s %8s %8s\n", "", "REF", "LEV", "ENV");
+    for (double scale : scales)
+    {
+        sim_fdc1004_set_conversion_scale(sensor, scale);
+        for (uint8_t rate : rates)
+        {
+            double samples_per_s[3];
+            uint32_t reads_before, reads_after;
+            sim_fdc1004_get_counts(sensor, &reads_before, NULL);
+            for (int ch = 0; ch < 3; ch++)
+            {
+                channels[ch]->rate = rate;
+                int64_t start_us = esp_timer_get_time();
+                for (uint32_t i = 0; i < samples; i++)
+                    ESP_ERROR_CHECK(update_measurement(channels[ch]));
+                samples_per_s[ch] = samples * 1e6 / (esp_timer_get_time() - start_us);
+                channels[ch]->rate = FDC1004_400HZ;
+            }
+            sim_fdc1004_get_counts(sensor, &reads_after, NULL);
+
+            char name[32];
+            snprintf(name, sizeof(name), "%u S/s, conversion x%.1f", 1000000 / FDC1004_CONVERSION_US(rate), scale);
+            fprintf(out, "%-28s %10.1f %8.1f %8.1f samples/s %5.2f reads/sample\n", name,
+                    samples_per_s[0], samples_per_s[1], samples_per_s[2],
+                    (double)(reads_after - reads_before) / (3 * samples));
+        }
+    }
+    sim_fdc1004_set_conversion_scale(sensor, 1.0);
+    sim_i2c_reset_stats(BENCH_SENSOR_PORT);
+}
+
+// Repeat mode acquisition of the REF, LEV and ENV slots for one second at each rate
+static void bench_sensor_stream(level_calc_t level)
+{
+    static const uint8_t rates[] = {FDC1004_100HZ, FDC1004_200HZ, FDC1004_400HZ};
+    const fdc_channel_t channels[] = {level->ref_channel, level->lev_channel, level->env_channel};
+    const int64_t duration_us = 1000000;
+
+    fprintf(out, "\n-- FDC1004 streaming (repeat mode, 1 s) --\n");
+    fprintf(out, "%-28s %10s %8s %8s\n", "", "REF", "LEV", "ENV");
+    for (uint8_t rate : rates)
+    {
+        uint32_t counts[3] = {0};
+        sim_i2c_reset_stats(BENCH_SENSOR_PORT);
+        ESP_ERROR_CHECK(fdc_start_streaming(level, rate));
+        int64_t start_us = esp_timer_get_time();
+        int64_t elapsed_us;
+        do
+        {
+            uint8_t updated;
+            ESP_ERROR_CHECK(fdc_update_stream(level, &updated));
+            for (int ch = 0; ch < 3; ch++)
+                counts[ch] += (updated >> channels[ch]->channel) & 1;
+            elapsed_us = esp_timer_get_time() - start_us;
+        } while (elapsed_us < duration_us);
+        ESP_ERROR_CHECK(fdc_stop_streaming(level));
+
+        sim_i2c_stats_t stats;
+        sim_i2c_get_stats(BENCH_SENSOR_PORT, &stats);
+        uint32_t total = counts[0] + counts[1] + counts[2];
+        char name[32];
+        snprintf(name, sizeof(name), "%u S/s", 1000000 / FDC1004_CONVERSION_US(rate));
+        fprintf(out, "%-28s %10.1f %8.1f %8.1f samples/s %5.2f transactions/sample\n", name,
+                counts[0] * 1e6 / elapsed_us, counts[1] * 1e6 / elapsed_us, counts[2] * 1e6 / elapsed_us,
+                (double)stats.transactions / total);
+    }
+    fdc_sample_t latest;
+    ESP_ERROR_CHECK(sample_ring_read_latest(level->samples, &latest, NULL));
+    fprintf(out, "%-28s %10.3f %8.3f %8.3f pF REF / LEV / ENV, %u samples published\n", "readings (sample ring)",
+            fdc_af_to_pf(latest.ref_af), fdc_af_to_pf(latest.lev_af), fdc_af_to_pf(latest.env_af),
+            sample_ring_count(level->samples));
+    sim_i2c_reset_stats(BENCH_SENSOR_PORT);
+}
+
+// CAPDAC ranging on the LEV input: cold lock across the full input range, then tracking a slow ramp
+static void bench_sensor_capdac(level_calc_t level, sim_fdc1004_handle_t sensor)
+{
+    fdc_channel_t channel = level->lev_channel;
+    uint8_t cin = LEV_CHANNEL - 1;
+
+    fprintf(out, "\n-- FDC1004 CAPDAC ranging (LEV) --\n");
+    uint32_t points = 0, total_samples = 0, worst_samples = 0;
+    double min_error = 1e9, max_error = -1e9;
+    for (double pf = 0; pf <= 104; pf += 4)
+    {
+        sim_fdc1004_set_capacitance(sensor, cin, pf);
+        reset_capdac(channel);
+        uint32_t samples = 0;
+        do
+        {
+            ESP_ERROR_CHECK(update_measurement(channel));
+            samples++;
+        } while (!channel->capdac_locked && samples < 32);
+        ESP_ERROR_CHECK(update_measurement(channel)); // First sample taken at the locked CAPDAC
+
+        points++;
+        total_samples += samples;
+        worst_samples = samples > worst_samples ? samples : worst_samples;
+        double error = fdc_af_to_pf(channel->capacitance_af) - pf;
+        min_error = error < min_error ? error : min_error;
+        max_error = error > max_error ? error : max_error;
+    }
+    fprintf(out, "%-28s %10.2f mean %6u worst samples to lock (%u points, 0 - 104 pF)\n", "binary search",
+            (double)total_samples / points, worst_samples, points);
+    fprintf(out, "%-28s %10.3f pF error spread across the range\n", "locked reading", max_error - min_error);
+
+    // Ramp 0 - 100 pF at 0.5 pF per sample
+    sim_fdc1004_set_capacitance(sensor, cin, 0);
+    reset_capdac(channel);
+    for (int i = 0; i < 8; i++)
+        ESP_ERROR_CHECK(update_measurement(channel));
+    uint32_t steps = 0, relocks = 0, samples = 0;
+    min_error = 1e9, max_error = -1e9;
+    for (double pf = 0; pf <= 100; pf += 0.5, samples++)
+    {
+        sim_fdc1004_set_capacitance(sensor, cin, pf);
+        int capdac = channel->capdac;
+        ESP_ERROR_CHECK(update_measurement(channel));
+        steps += channel->capdac != capdac;
+        relocks += !channel->capdac_locked;
+        double error = fdc_af_to_pf(channel->capacitance_af) - pf;
+        min_error = error < min_error ? error : min_error;
+        max_error = error > max_error ? error : max_error;
+    }
+    fprintf(out, "%-28s %10u steps %6u unlocked samples of %u\n", "ramp tracking", steps, relocks, samples);
+    fprintf(out, "%-28s %10.3f pF error spread while tracking\n", "tracking reading", max_error - min_error);
+
+    sim_fdc1004_set_capacitance(sensor, cin, 6.5);
+    reset_capdac(channel);
+    for (int i = 0; i < 8; i++)
+        ESP_ERROR_CHECK(update_measurement(channel));
+    sim_i2c_reset_stats(BENCH_SENSOR_PORT);
+}
+
+// Deadline scheduled single shot sampling while every I2C transfer is delayed by a random synthetic latency
+static void bench_sensor_acq(level_calc_t level)
+{
+    static const uint32_t latencies_us[] = {0, 100, 300, 1000, 2000};
+    const uint32_t period_us = FDC_ACQ_DEFAULT_PERIOD_US;
+    const int64_t duration_us = 1000000;
+
+    fprintf(out, "\n-- FDC1004 acquisition (%u us period, 1 s, worst release and busy) --\n", period_us);
+    fprintf(out, "%-28s %7s %7s %6s %8s %8s %8s %7s %7s\n", "I2C latency", "samples", "overrun", "missed", "release", "busy", "p50",
+            "p99", "max");
+    for (uint32_t latency_us : latencies_us)
+    {
+        sim_i2c_set_latency(BENCH_SENSOR_PORT, 0, latency_us);
+        fdc_acq_config_t config = {.stream_rate = 0, .period_us = period_us, .task_stack = 0, .task_priority = 0, .core_id = 1}; // 0 for the defaults
+        fdc_acq_handle_t acq;
+        ESP_ERROR_CHECK(fdc_acq_start(level, &config, &acq));
+        vTaskDelay(pdMS_TO_TICKS(duration_us / 1000));
+        fdc_acq_stats_t stats;
+        ESP_ERROR_CHECK(fdc_acq_get_stats(acq, &stats));
+        ESP_ERROR_CHECK(fdc_acq_stop(acq));
+
+        char name[32];
+        snprintf(name, sizeof(name), "0 - %u us", latency_us);
+        fprintf(out, "%-28s %7u %7u %6u %5lld us %5.1f ms %5lld us %4lld us %4lld us jitter\n", name, stats.samples, stats.overrun,
+                stats.missed,
+                (long long)stats.release_max_us, stats.busy_max_us / 1000.0, (long long)fdc_acq_jitter_percentile(&stats, 50),
+                (long long)fdc_acq_jitter_percentile(&stats, 99), (long long)stats.jitter_max_us);
+        fprintf(out, "%-28s", "  jitter histogram");
+        for (uint8_t i = 0; i < FDC_ACQ_JITTER_BUCKETS; i++)
+            if (stats.jitter_histogram[i])
+                fprintf(out, " <%lldus:%u", 2LL << i, stats.jitter_histogram[i]);
+        fprintf(out, "\n");
+    }
+
+    // The firmware default: the task harvests the repeat-mode stream, paced by the device
+    fprintf(out, "\n-- FDC1004 acquisition (repeat-mode stream at 400 S/s, 1 s, jitter against one conversion per slot) --\n");
+    fprintf(out, "%-28s %7s %7s %8s %8s %8s %7s\n", "I2C latency", "samples", "errors", "busy", "p50", "p99", "max");
+    for (uint32_t latency_us : latencies_us)
+    {
+        sim_i2c_set_latency(BENCH_SENSOR_PORT, 0, latency_us);
+        fdc_acq_config_t config = {.stream_rate = FDC1004_400HZ, .period_us = 0, .task_stack = 0, .task_priority = 0, .core_id = 1};
+        fdc_acq_handle_t acq;
+        ESP_ERROR_CHECK(fdc_acq_start(level, &config, &acq));
+        vTaskDelay(pdMS_TO_TICKS(duration_us / 1000));
+        fdc_acq_stats_t stats;
+        ESP_ERROR_CHECK(fdc_acq_get_stats(acq, &stats));
+        ESP_ERROR_CHECK(fdc_acq_stop(acq));
+
+        char name[32];
+        snprintf(name, sizeof(name), "0 - %u us", latency_us);
+        fprintf(out, "%-28s %7u %7u %5.1f ms %5lld us %4lld us %4lld us jitter\n", name, stats.samples, stats.errors,
+                stats.busy_max_us / 1000.0, (long long)fdc_acq_jitter_percentile(&stats, 50),
+                (long long)fdc_acq_jitter_percentile(&stats, 99), (long long)stats.jitter_max_us);
+    }
+    sim_i2c_set_latency(BENCH_SENSOR_PORT, 0, 0);
+    sim_i2c_reset_stats(BENCH_SENSOR_PORT);
+}
+
+static void bench_sensor(i2c_master_bus_handle_t bus)
+{
+    sim_fdc1004_handle_t sensor;
+    ESP_ERROR_CHECK(sim_fdc1004_new(BENCH_SENSOR_PORT, &sensor));
+    sim_fdc1004_set_capacitance(sensor, ENV_CHANNEL - 1, 1.5);
+    sim_fdc1004_set_capacitance(sensor, LEV_CHANNEL - 1, 6.5);
+    sim_fdc1004_set_capacitance(sensor, REF_CHANNEL - 1, 2.0);
+    sim_i2c_reset_stats(BENCH_SENSOR_PORT);
+
+    fprintf(out, "\n-- FDC1004 --\n");
+    level_calc_t level = init_fdc1004(bus);
+    report_i2c("init", BENCH_SENSOR_PORT, 1);
+
+    // One level sample is a REF, LEV and ENV reading
+    const uint32_t repeats = 10;
+    int64_t start_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < repeats; i++)
+        ESP_ERROR_CHECK(update_measurements(level));
+    int64_t wall_us = esp_timer_get_time() - start_us;
+    report_i2c("update_measurements", BENCH_SENSOR_PORT, repeats);
+    fprintf(out, "%-28s %10.1f ms wall\n", "update_measurements", wall_us / 1000.0 / repeats);
+    fprintf(out, "%-28s %10.3f %8.3f %8.3f pF REF / LEV / ENV\n", "readings",
+            fdc_af_to_pf(level->ref_af), fdc_af_to_pf(level->lev_af), fdc_af_to_pf(level->env_af));
+
+    uint32_t reads, writes;
+    sim_fdc1004_get_counts(sensor, &reads, &writes);
+    fprintf(out, "%-28s %10u register reads %5u register writes\n", "sensor totals", reads, writes);
+
+    bench_sensor_rate(level, sensor);
+    bench_sensor_capdac(level, sensor);
+    bench_sensor_stream(level);
+    bench_sensor_acq(level);
+}
+
+// The float pipeline used before the fixed point one, kept as the reference
+static float float_capacitance_pf(int32_t raw_code, int capdac)
+{
+    return (float)raw_code / (1 << 19) + (float)(FEMTOFARADS_CAPDAC * capdac) / 1000;
+}
+
+static uint8_t float_level(float lev_value, float current_delta, float *ret_linear)
+{
+    float forecast_m = current_delta / 5;
+    float forecast_b = LEV_BASELINE - forecast_m * 5;
+    float correction_gain = 1 / forecast_m;
+    float correction_offset = -1 * correction_gain * forecast_b;
+    *ret_linear = (lev_value * CORRECTION_MULTIPLIER * correction_gain) + (CORRECTION_OFFSET + correction_offset);
+    if (lev_value < LEV_BASELINE)
+        return 0;
+    return (uint8_t)((int)((*ret_linear + (5 / 2)) / 5) * 5);
+}
+
+// Fixed point against exact and float results over the full input range, then cost per sample
+static void bench_fixed_point(void)
+{
+    fprintf(out, "\n-- FDC1004 fixed point pipeline --\n");
+
+    // Every 61st code of the 24 bit range, at every CAPDAC
+    double fixed_error = 0, float_error = 0;
+    for (int capdac = 0; capdac <= FDC1004_CAPDAC_MAX; capdac++)
+    {
+        for (int32_t code = -(1 << 23); code < (1 << 23); code += 61)
+        {
+            double exact_af = code * 1e6 / (1 << 19) + capdac * FEMTOFARADS_CAPDAC * 1000.0;
+            fixed_error = fmax(fixed_error, fabs(fdc_code_to_af(code, capdac) - exact_af));
+            float_error = fmax(float_error, fabs(float_capacitance_pf(code, capdac) * 1e6 - exact_af));
+        }
+    }
+    fprintf(out, "%-28s %10.3f fixed %8.3f float aF max error\n", "code to capacitance", fixed_error, float_error);
+
+    // Level pad 0 - 110 pF against calibration deltas 0.25 - 10 pF
+    uint32_t cases = 0, mismatches = 0, boundary = 0;
+    double linear_error = 0;
+    fdc_sample_t sample = {};
+    for (int32_t delta_af = 250000; delta_af <= 10000000; delta_af += 50000)
+    {
+        for (int32_t lev_af = 0; lev_af <= 110000000; lev_af += 50000)
+        {
+            sample.lev_af = lev_af;
+            sample.delta_af = delta_af;
+            float linear;
+            uint8_t expected = float_level(fdc_af_to_pf(lev_af), fdc_af_to_pf(delta_af), &linear);
+            linear_error = fmax(linear_error, fabs(calculate_sample_level_linear(&sample) - linear));
+            cases++;
+            if (calculate_sample_level(&sample) != expected)
+            {
+                // Only allowed where float rounding decides which side of a rounding boundary the level is on
+                float to_boundary = fabsf(fmodf(linear + 2, 5));
+                if (fminf(to_boundary, 5 - to_boundary) < 1e-3f * fmaxf(1, fabsf(linear)))
+                    boundary++;
+                else
+                    mismatches++;
+            }
+        }
+    }
+    fprintf(out, "%-28s %10.5f max |fixed - float| linear level (%u cases)\n", "level", linear_error, cases);
+    fprintf(out, "%-28s %10u mismatches %6u at rounding boundaries\n", "rounded level", mismatches, boundary);
+
+    // Cost of one REF / LEV / ENV sample through to the rounded level
+    int32_t codes[256];
+    for (int i = 0; i < 256; i++)
+        codes[i] = (int32_t)((i * 2654435761u) >> 8) - (1 << 23);
+    volatile uint32_t sink = 0;
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_PIPELINE_SAMPLES; i++)
+    {
+        sample.ref_af = fdc_code_to_af(codes[i & 255], 3);
+        sample.env_af = fdc_code_to_af(codes[(i + 1) & 255], 1);
+        sample.lev_af = fdc_code_to_af(codes[(i + 2) & 255], 5);
+        sample.delta_af = sample.ref_af - sample.env_af;
+        sink = sink + calculate_sample_level(&sample);
+    }
+    esp_cpu_cycle_count_t fixed_cycles = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_PIPELINE_SAMPLES; i++)
+    {
+        float ref = float_capacitance_pf(codes[i & 255], 3);
+        float env = float_capacitance_pf(codes[(i + 1) & 255], 1);
+        float lev = float_capacitance_pf(codes[(i + 2) & 255], 5);
+        float linear;
+        sink = sink + float_level(lev, ref - env, &linear);
+    }
+    esp_cpu_cycle_count_t float_cycles = esp_cpu_get_cycle_count() - start;
+    fprintf(out, "%-28s %10.1f fixed %8.1f float host cycles per level sample\n", "pipeline",
+            (double)fixed_cycles / BENCH_PIPELINE_SAMPLES, (double)float_cycles / BENCH_PIPELINE_SAMPLES);
+    (void)sink;
+}
+
+static void bench_leds(void)
+{
+    fprintf(out, "\n-- LED strip (RMT) --\n");
+    led_strip_handle_t strip;
+    ESP_ERROR_CHECK(create_led_strip_device(BENCH_LED_GPIO, NUM_LEDS, &strip));
+
+    const uint32_t repeats = 10;
+    int64_t start_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < repeats; i++)
+        led_strip_set_colour(strip, NUM_LEDS, (colour_t)(i % MAX_COLOURS));
+    int64_t cpu_us = esp_timer_get_time() - start_us;
+
+    sim_rmt_stats_t stats;
+    ESP_ERROR_CHECK(sim_rmt_get_stats(BENCH_LED_GPIO, &stats));
+    fprintf(out, "%-28s %10.1f us wire %8.1f bytes %6.1f symbols\n", "set_colour (refresh)",
+            stats.wire_time_ns / 1000.0 / stats.transmissions, (double)stats.bytes / stats.transmissions,
+            (double)stats.symbols / stats.transmissions);
+    fprintf(out, "%-28s %10.1f us host\n", "set_colour (refresh)", (double)cpu_us / repeats);
+
+    // Fewer LEDs than the strip holds: the rest must stay dark
+    ESP_ERROR_CHECK(led_strip_clear(strip));
+    led_strip_set_colour(strip, NUM_LEDS - 1, GREEN);
+    const uint8_t *frame;
+    size_t frame_len;
+    static const uint8_t expected[NUM_LEDS * 3] = {255, 0, 0}; // GRB
+    bool pass = sim_rmt_get_frame(BENCH_LED_GPIO, &frame, &frame_len) == ESP_OK && frame_len == sizeof(expected) &&
+                memcmp(frame, expected, sizeof(expected)) == 0;
+    fprintf(out, "%-28s %10s %u of %u LEDs set\n", "set_colour (partial)", pass ? "PASS" : "FAIL", NUM_LEDS - 1, NUM_LEDS);
+
+    ESP_ERROR_CHECK(led_strip_del(strip));
+}
+
+// The SPI backend's bit by bit expansion before its lookup table, the reference for the frame bytes
+static void reference_spi_bit(uint8_t data, uint8_t *buf)
+{
+    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
+    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
+    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
+    *(buf + 1) |= BIT(0);
+    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
+    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
+    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
+    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
+    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+}
+
+// As the old led_strip_spi_set_pixel() for every pixel of an RGB buffer
+static void reference_spi_encode(const uint8_t *rgb, uint32_t count, uint8_t *buf)
+{
+    for (uint32_t i = 0; i < count; i++, rgb += 3, buf += 9)
+    {
+        memset(buf, 0, 9);
+        reference_spi_bit(rgb[1], buf);
+        reference_spi_bit(rgb[0], buf + 3);
+        reference_spi_bit(rgb[2], buf + 6);
+    }
+}
+
+// Encodes a random frame with the old encoder and the backend's set_pixel and set_pixels paths,
+// and checks every path puts the same bytes on the wire
+static void bench_leds_spi(void)
+{
+    fprintf(out, "\n-- LED strip (SPI, %d pixels) --\n", BENCH_SPI_LEDS);
+    led_strip_config_t strip_config = {};
+    strip_config.strip_gpio_num = BENCH_SPI_LED_GPIO;
+    strip_config.max_leds = BENCH_SPI_LEDS;
+    strip_config.led_pixel_format = LED_PIXEL_FORMAT_GRB;
+    strip_config.led_model = LED_MODEL_WS2812;
+    led_strip_spi_config_t spi_config = {};
+    spi_config.clk_src = SPI_CLK_SRC_DEFAULT;
+    spi_config.spi_bus = SPI2_HOST;
+    spi_config.flags.with_dma = true;
+    led_strip_handle_t strip;
+    ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_config, &spi_config, &strip));
+
+    // Every byte value, then noise
+    static uint8_t rgb[BENCH_SPI_LEDS * 3], grb[BENCH_SPI_LEDS * 3], expected[BENCH_SPI_LEDS * 9];
+    for (uint32_t i = 0; i < sizeof(rgb); i++)
+        rgb[i] = i < 256 ? i : rand() & 0xFF;
+    for (uint32_t i = 0; i < BENCH_SPI_LEDS; i++)
+    {
+        grb[i * 3] = rgb[i * 3 + 1];
+        grb[i * 3 + 1] = rgb[i * 3];
+        grb[i * 3 + 2] = rgb[i * 3 + 2];
+    }
+
+    static const char *const encoders[] = {"bit by bit (old)", "set_pixel (table)", "set_pixels RGB", "set_pixels GRB"};
+    double rates[4];
+    bool exact = true;
+    auto encode = [&](int encoder) {
+        switch (encoder)
+        {
+        case 0:
+            reference_spi_encode(rgb, BENCH_SPI_LEDS, expected);
+            break;
+        case 1:
+            for (uint32_t i = 0; i < BENCH_SPI_LEDS; i++)
+                led_strip_set_pixel(strip, i, rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+            break;
+        case 2:
+            led_strip_set_pixels(strip, 0, BENCH_SPI_LEDS, rgb, LED_PIXEL_ORDER_RGB);
+            break;
+        default:
+            led_strip_set_pixels(strip, 0, BENCH_SPI_LEDS, grb, LED_PIXEL_ORDER_GRB);
+        }
+    };
+
+    for (int encoder = 0; encoder < 4; encoder++)
+    {
+        int64_t start_us = esp_timer_get_time();
+        for (uint32_t f = 0; f < BENCH_SPI_FRAMES; f++)
+            encode(encoder);
+        int64_t cpu_us = esp_timer_get_time() - start_us;
+        rates[encoder] = (double)BENCH_SPI_FRAMES * BENCH_SPI_LEDS / cpu_us; // Pixels per us = Mpixels/s
+    }
+
+    // Each path from a cleared strip, so no path passes on bytes left by another
+    for (int encoder = 1; encoder < 4; encoder++)
+    {
+        const uint8_t *frame;
+        size_t frame_len;
+        ESP_ERROR_CHECK(led_strip_clear(strip));
+        encode(encoder);
+        ESP_ERROR_CHECK(led_strip_refresh(strip));
+        ESP_ERROR_CHECK(sim_spi_get_frame(BENCH_SPI_LED_GPIO, &frame, &frame_len));
+        exact = exact && frame_len == sizeof(expected) && memcmp(frame, expected, sizeof(expected)) == 0;
+    }
+
+    for (int encoder = 0; encoder < 4; encoder++)
+        fprintf(out, "%-28s %10.1f Mpixels/s host %6.1fx\n", encoders[encoder], rates[encoder], rates[encoder] / rates[0]);
+    fprintf(out, "%-28s %10s frames bit-exact with the old encoder\n", "verification", exact ? "PASS" : "FAIL");
+
+    sim_spi_stats_t stats;
+    ESP_ERROR_CHECK(sim_spi_get_stats(BENCH_SPI_LED_GPIO, &stats));
+    fprintf(out, "%-28s %10.1f us wire %8.1f bytes\n", "refresh", stats.wire_time_ns / 1000.0 / stats.transmissions,
+            (double)stats.bytes / stats.transmissions);
+    ESP_ERROR_CHECK(led_strip_del(strip));
+}
+
+static led_strip_handle_t new_bench_strip(bool spi, uint32_t leds, bool double_buffer = false,
+                                          gpio_num_t rmt_gpio = BENCH_LED_GPIO)
+{
+    led_strip_config_t strip_config = {};
+    strip_config.strip_gpio_num = spi ? BENCH_SPI_LED_GPIO : rmt_gpio;
+    strip_config.max_leds = leds;
+    strip_config.led_pixel_format = LED_PIXEL_FORMAT_GRB;
+    strip_config.led_model = LED_MODEL_WS2812;
+    led_strip_handle_t strip;
+    if (spi)
+    {
+        led_strip_spi_config_t spi_config = {};
+        spi_config.clk_src = SPI_CLK_SRC_DEFAULT;
+        spi_config.spi_bus = SPI2_HOST;
+        spi_config.flags.with_dma = true;
+        ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_config, &spi_config, &strip));
+    }
+    else
+    {
+        led_strip_rmt_config_t rmt_config = {};
+        rmt_config.clk_src = RMT_CLK_SRC_DEFAULT;
+        rmt_config.resolution_hz = 10 * 1000 * 1000;
+        rmt_config.flags.with_dma = true;
+        rmt_config.flags.double_buffer = double_buffer;
+        ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &strip));
+    }
+    return strip;
+}
+
+// Whole frames through per pixel set_pixel calls against led_strip_set_pixels() and led_strip_fill().
+// The bulk paths must put the same bytes on the wire as the per pixel path.
+static void bench_leds_bulk(void)
+{
+    static const uint32_t lengths[] = {10, 300, BENCH_BULK_MAX_LEDS};
+    static const char *const paths[] = {"set_pixel loop", "set_pixels", "set_pixel, one colour", "fill"};
+    static uint8_t rgb[BENCH_BULK_MAX_LEDS * 3];
+    static uint8_t expected[SIM_SPI_MAX_FRAME_LEN];
+    for (uint32_t i = 0; i < sizeof(rgb); i++)
+        rgb[i] = rand() & 0xFF;
+
+    double rates[2][4][sizeof(lengths) / sizeof(lengths[0])];
+    bool exact = true;
+    for (int spi = 0; spi < 2; spi++)
+    {
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+        {
+            const uint32_t leds = lengths[l];
+            led_strip_handle_t strip = new_bench_strip(spi, leds);
+            auto set = [&](int path) {
+                switch (path)
+                {
+                case 0:
+                    for (uint32_t i = 0; i < leds; i++)
+                        led_strip_set_pixel(strip, i, rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+                    break;
+                case 1:
+                    led_strip_set_pixels(strip, 0, leds, rgb, LED_PIXEL_ORDER_RGB);
+                    break;
+                case 2:
+                    for (uint32_t i = 0; i < leds; i++)
+                        led_strip_set_pixel(strip, i, 12, 34, 56);
+                    break;
+                default:
+                    led_strip_fill(strip, 12, 34, 56);
+                }
+            };
+            auto frame = [&](const uint8_t **ret_data, size_t *ret_len) {
+                ESP_ERROR_CHECK(led_strip_refresh(strip));
+                const gpio_num_t gpio = spi ? BENCH_SPI_LED_GPIO : BENCH_LED_GPIO;
+                ESP_ERROR_CHECK(spi ? sim_spi_get_frame(gpio, ret_data, ret_len) : sim_rmt_get_frame(gpio, ret_data, ret_len));
+            };
+
+            for (int path = 0; path < 4; path++)
+            {
+                const uint32_t repeats = BENCH_BULK_PIXELS / leds;
+                int64_t start_us = esp_timer_get_time();
+                for (uint32_t r = 0; r < repeats; r++)
+                    set(path);
+                int64_t cpu_us = esp_timer_get_time() - start_us;
+                rates[spi][path][l] = (double)repeats * leds / (cpu_us > 0 ? cpu_us : 1); // Pixels per us = Mpixels/s
+
+                // Per pixel path first as the reference, each bulk path from a cleared strip
+                const uint8_t *data;
+                size_t len;
+                ESP_ERROR_CHECK(led_strip_clear(strip));
+                set(path);
+                frame(&data, &len);
+                if (path % 2 == 0)
+                    memcpy(expected, data, len);
+                else
+                    exact = exact && memcmp(data, expected, len) == 0;
+            }
+            ESP_ERROR_CHECK(led_strip_del(strip));
+        }
+    }
+
+    fprintf(out, "\n-- LED strip bulk API (Mpixels/s host) --\n%-28s", "pixels");
+    for (uint32_t leds : lengths)
+        fprintf(out, " %7u", leds);
+    fprintf(out, "\n");
+    for (int spi = 0; spi < 2; spi++)
+    {
+        for (int path = 0; path < 4; path++)
+        {
+            char name[40];
+            snprintf(name, sizeof(name), "%s %s", spi ? "SPI" : "RMT", paths[path]);
+            fprintf(out, "%-28s", name);
+            for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+                fprintf(out, " %7.0f", rates[spi][path][l]);
+            fprintf(out, "\n");
+        }
+    }
+    fprintf(out, "%-28s %10s bulk frames identical to the per pixel frames\n", "verification", exact ? "PASS" : "FAIL");
+}
+
+// An animation loop in realtime mode: render a frame (set_pixels, then sleep for the rest of the
+// render cost), refresh, repeat. Blocking refresh waits for the frame to be sent, a double
+// buffered strip renders the next frame while it is on the wire. Time outside rendering is time
+// the CPU is free for other tasks.
+static void bench_leds_async(void)
+{
+    static const int64_t render_costs_us[] = {0, 5000, 12000};
+    static uint8_t rgb[BENCH_ASYNC_LEDS * 3];
+
+    fprintf(out, "\n-- LED strip refresh (RMT, %d pixels, realtime) --\n", BENCH_ASYNC_LEDS);
+    fprintf(out, "%-28s %10s %8s %10s %8s\n", "render cost", "blocking", "idle", "async", "idle");
+    sim_set_realtime(true);
+    double wire_us = 0;
+    for (int64_t render_us : render_costs_us)
+    {
+        double fps[2], idle[2];
+        for (int async = 0; async < 2; async++)
+        {
+            led_strip_handle_t strip = new_bench_strip(false, BENCH_ASYNC_LEDS, async);
+            int64_t busy_us = 0;
+            int64_t start_us = esp_timer_get_time();
+            for (uint32_t f = 0; f < BENCH_ASYNC_FRAMES; f++)
+            {
+                int64_t render_start_us = esp_timer_get_time();
+                for (uint32_t i = 0; i < sizeof(rgb); i++)
+                    rgb[i] = (uint8_t)(f + i);
+                ESP_ERROR_CHECK(led_strip_set_pixels(strip, 0, BENCH_ASYNC_LEDS, rgb, LED_PIXEL_ORDER_RGB));
+                int64_t remaining_us = render_us - (esp_timer_get_time() - render_start_us);
+                if (remaining_us > 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(remaining_us));
+                busy_us += esp_timer_get_time() - render_start_us;
+                ESP_ERROR_CHECK(async ? led_strip_refresh_async(strip) : led_strip_refresh(strip));
+            }
+            ESP_ERROR_CHECK(led_strip_wait_refresh_done(strip, -1));
+            int64_t wall_us = esp_timer_get_time() - start_us;
+            fps[async] = BENCH_ASYNC_FRAMES * 1e6 / wall_us;
+            idle[async] = 100.0 * (wall_us - busy_us) / wall_us;
+
+            sim_rmt_stats_t stats;
+            ESP_ERROR_CHECK(sim_rmt_get_stats(BENCH_LED_GPIO, &stats));
+            wire_us = stats.wire_time_ns / 1000.0 / stats.transmissions;
+            ESP_ERROR_CHECK(led_strip_del(strip));
+        }
+        char name[40];
+        snprintf(name, sizeof(name), "%.1f ms", render_us / 1000.0);
+        fprintf(out, "%-28s %6.1f fps %6.1f %% %6.1f fps %6.1f %%\n", name, fps[0], idle[0], fps[1], idle[1]);
+    }
+    sim_set_realtime(false);
+    fprintf(out, "%-28s %10.1f us wire, at most %.1f fps\n", "frame", wire_us, 1e6 / wire_us);
+}
+
+// Four strips of different lengths, one per RMT TX channel, in realtime mode: refreshed one after the
+// other the frame takes the sum of the wire times, as a group it takes the longest. Start skew is the
+// spread of the channels' start times within a frame, at its worst over the frames.
+static void bench_leds_group(void)
+{
+    static const gpio_num_t gpios[] = {BENCH_LED_GPIO, GPIO_NUM_43, GPIO_NUM_44, GPIO_NUM_45};
+    static const uint32_t lengths[] = {300, 200, 150, 100};
+    static const char *const modes[] = {"one by one", "group", "group, sync start"};
+    const size_t num_strips = sizeof(lengths) / sizeof(lengths[0]);
+
+    sim_set_realtime(true);
+    led_strip_handle_t strips[sizeof(lengths) / sizeof(lengths[0])];
+    for (size_t s = 0; s < num_strips; s++)
+        strips[s] = new_bench_strip(false, lengths[s], false, gpios[s]);
+
+    fprintf(out, "\n-- LED strip group (RMT, 300/200/150/100 pixels, realtime) --\n");
+    fprintf(out, "%-28s %10s %10s\n", "mode", "refresh", "skew");
+    for (int mode = 0; mode < 3; mode++)
+    {
+        led_strip_group_handle_t group = NULL;
+        if (mode > 0)
+        {
+            led_strip_group_config_t group_config = {};
+            group_config.strips = strips;
+            group_config.num_strips = num_strips;
+            group_config.flags.sync_start = mode == 2;
+            ESP_ERROR_CHECK(led_strip_new_rmt_group(&group_config, &group));
+        }
+        int64_t skew_max_us = 0;
+        int64_t start_us = esp_timer_get_time();
+        for (uint32_t f = 0; f < BENCH_GROUP_FRAMES; f++)
+        {
+            for (size_t s = 0; s < num_strips; s++)
+                ESP_ERROR_CHECK(led_strip_fill(strips[s], f, 0, 255 - f));
+            if (group)
+            {
+                ESP_ERROR_CHECK(led_strip_rmt_group_refresh(group));
+                int64_t first_us = INT64_MAX, last_us = INT64_MIN;
+                for (size_t s = 0; s < num_strips; s++)
+                {
+                    sim_rmt_stats_t stats;
+                    ESP_ERROR_CHECK(sim_rmt_get_stats(gpios[s], &stats));
+                    first_us = std::min(first_us, stats.last_start_us);
+                    last_us = std::max(last_us, stats.last_start_us);
+                }
+                skew_max_us = std::max(skew_max_us, last_us - first_us);
+            }
+            else
+            {
+                for (size_t s = 0; s < num_strips; s++)
+                    ESP_ERROR_CHECK(led_strip_refresh(strips[s]));
+            }
+        }
+        double refresh_ms = (esp_timer_get_time() - start_us) / 1000.0 / BENCH_GROUP_FRAMES;
+        if (group)
+        {
+            ESP_ERROR_CHECK(led_strip_del_rmt_group(group));
+            fprintf(out, "%-28s %7.2f ms %7lld us\n", modes[mode], refresh_ms, (long long)skew_max_us);
+        }
+        else
+            fprintf(out, "%-28s %7.2f ms %10s\n", modes[mode], refresh_ms, "-");
+    }
+
+    double sum_us = 0, max_us = 0;
+    for (size_t s = 0; s < num_strips; s++)
+    {
+        sim_rmt_stats_t stats;
+        ESP_ERROR_CHECK(sim_rmt_get_stats(gpios[s], &stats));
+        double wire_us = stats.wire_time_ns / 1000.0 / stats.transmissions;
+        sum_us += wire_us;
+        max_us = std::max(max_us, wire_us);
+        ESP_ERROR_CHECK(led_strip_del(strips[s]));
+    }
+    sim_set_realtime(false);
+    fprintf(out, "%-28s %7.2f ms sum, %.2f ms longest\n", "wire", sum_us / 1000.0, max_us / 1000.0);
+}
+
+// Frames with known pixels, gamma 1 so the colour table is the identity unless a case says otherwise
+typedef struct
+{
+    const char *name;
+    gled_keyframe_t keyframes[2];
+    uint8_t num_keyframes;
+    uint16_t num_leds;
+    float gamma;
+    uint8_t brightness;
+    uint32_t time_ms;
+    uint8_t grb[8 * 3];
+} golden_frame_t;
+
+static const golden_frame_t golden_frames[] = {
+    {"fade quarter", {{GLED_EFFECT_FADE, {0, 0, 0}, {200, 100, 0}, 2000, 1000, 0}}, 1, 2, 1.0f, 255, 250,
+     {25, 50, 0, 25, 50, 0}},
+    {"fade held", {{GLED_EFFECT_FADE, {0, 0, 0}, {200, 100, 0}, 2000, 1000, 0}}, 1, 2, 1.0f, 255, 1500,
+     {100, 200, 0, 100, 200, 0}},
+    {"chase half pixel", {{GLED_EFFECT_CHASE, {255, 0, 0}, {0, 0, 0}, 800, 800, 2}}, 1, 8, 1.0f, 255, 150,
+     {0, 0, 0, 0, 127, 0, 0, 255, 0, 0, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    {"chase wrapped", {{GLED_EFFECT_CHASE, {255, 0, 0}, {0, 0, 16}, 800, 800, 2}}, 1, 8, 1.0f, 255, 750,
+     {0, 255, 0, 0, 127, 8, 0, 0, 16, 0, 0, 16, 0, 0, 16, 0, 0, 16, 0, 0, 16, 0, 127, 8}},
+    {"rainbow", {{GLED_EFFECT_RAINBOW, {0, 0, 0}, {0, 0, 0}, 1000, 1000, 0}}, 1, 6, 1.0f, 255, 0,
+     {0, 255, 0, 255, 255, 0, 255, 0, 0, 255, 0, 255, 0, 0, 255, 0, 255, 255}},
+    {"breathing", {{GLED_EFFECT_BREATHING, {0, 0, 255}, {0, 0, 0}, 1000, 1000, 0}}, 1, 1, 1.0f, 255, 250, {0, 0, 127}},
+    {"gradient", {{GLED_EFFECT_GRADIENT, {0, 0, 0}, {255, 0, 0}, 1000, 0, 0}}, 1, 5, 1.0f, 255, 0,
+     {0, 0, 0, 0, 63, 0, 0, 127, 0, 0, 191, 0, 0, 255, 0}},
+    {"second keyframe", {{GLED_EFFECT_RAINBOW, {0, 0, 0}, {0, 0, 0}, 500, 0, 0}, {GLED_EFFECT_GRADIENT, {0, 255, 0}, {0, 0, 255}, 500, 0, 0}},
+     2, 3, 1.0f, 255, 1600, {255, 0, 0, 127, 0, 127, 0, 0, 255}},
+    {"gamma 2.2, brightness 128", {{GLED_EFFECT_FADE, {255, 255, 255}, {0, 0, 0}, 1000, 0, 0}, {GLED_EFFECT_FADE, {255, 255, 255}, {128, 128, 128}, 1000, 0, 0}},
+     2, 1, 2.2f, 128, 1000, {28, 28, 28}},
+};
+
+// Render rate per effect, the frames of known pixels, then an animation loop paced by the frame
+// clock against a vTaskDelay loop
+static void bench_leds_effects(void)
+{
+    static const char *const names[GLED_EFFECT_MAX] = {"fade", "chase", "rainbow", "breathing", "gradient"};
+    fprintf(out, "\n-- LED effects (%d pixels) --\n", BENCH_EFFECT_LEDS);
+    volatile uint8_t sink = 0;
+    for (int effect = 0; effect < GLED_EFFECT_MAX; effect++)
+    {
+        gled_keyframe_t key = {(gled_effect_t)effect, {255, 64, 0}, {0, 16, 32}, 60000, 2000, 20};
+        gled_anim_config_t config = {&key, 1, BENCH_EFFECT_LEDS, 0, 200};
+        gled_anim_handle_t anim;
+        ESP_ERROR_CHECK(gled_anim_new(&config, &anim));
+        int64_t start_us = esp_timer_get_time();
+        for (uint32_t f = 0; f < BENCH_EFFECT_FRAMES; f++)
+            sink = sink + gled_anim_render(anim, f * 7)[0];
+        int64_t cpu_us = esp_timer_get_time() - start_us;
+        fprintf(out, "%-28s %10.1f Mpixels/s host\n", names[effect], (double)BENCH_EFFECT_FRAMES * BENCH_EFFECT_LEDS / cpu_us);
+        ESP_ERROR_CHECK(gled_anim_del(anim));
+    }
+
+    // The per pixel HSV path a rainbow took before the effects
+    led_strip_handle_t strip = new_bench_strip(false, BENCH_EFFECT_LEDS);
+    const uint32_t hsv_frames = BENCH_EFFECT_FRAMES / 10;
+    int64_t start_us = esp_timer_get_time();
+    for (uint32_t f = 0; f < hsv_frames; f++)
+        for (uint32_t i = 0; i < BENCH_EFFECT_LEDS; i++)
+            led_strip_set_pixel_hsv(strip, i, (f + i * 360 / BENCH_EFFECT_LEDS) % 360, 255, 200);
+    int64_t cpu_us = esp_timer_get_time() - start_us;
+    fprintf(out, "%-28s %10.1f Mpixels/s host\n", "rainbow, set_pixel_hsv", (double)hsv_frames * BENCH_EFFECT_LEDS / cpu_us);
+
+    uint32_t passed = 0;
+    for (const golden_frame_t &golden : golden_frames)
+    {
+        gled_anim_config_t config = {golden.keyframes, golden.num_keyframes, golden.num_leds, golden.gamma, golden.brightness};
+        gled_anim_handle_t anim;
+        ESP_ERROR_CHECK(gled_anim_new(&config, &anim));
+        const uint8_t *frame = gled_anim_render(anim, golden.time_ms);
+        if (memcmp(frame, golden.grb, golden.num_leds * 3) == 0)
+            passed++;
+        else
+        {
+            fprintf(out, "%-28s %10s", golden.name, "FAIL");
+            for (uint32_t i = 0; i < golden.num_leds * 3u; i++)
+                fprintf(out, " %u", frame[i]);
+            fprintf(out, "\n");
+        }
+        ESP_ERROR_CHECK(gled_anim_del(anim));
+    }
+    const uint32_t golden_count = sizeof(golden_frames) / sizeof(golden_frames[0]);
+    fprintf(out, "%-28s %10s %u/%u frames match\n", "golden frames", passed == golden_count ? "PASS" : "FAIL", passed, golden_count);
+
+    // A 3 ms frame at 100 fps: delaying a tick after each frame stretches the period, the frame clock does not
+    gled_keyframe_t key = {GLED_EFFECT_RAINBOW, {0, 0, 0}, {0, 0, 0}, 60000, 2000, 0};
+    gled_anim_config_t config = {&key, 1, BENCH_EFFECT_LEDS, 0, 255};
+    gled_anim_handle_t anim;
+    ESP_ERROR_CHECK(gled_anim_new(&config, &anim));
+    auto frame = [&](uint32_t time_ms) {
+        int64_t frame_start_us = esp_timer_get_time();
+        ESP_ERROR_CHECK(gled_anim_show(anim, strip, time_ms));
+        int64_t remaining_us = BENCH_CLOCK_RENDER_US - (esp_timer_get_time() - frame_start_us);
+        if (remaining_us > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(remaining_us));
+    };
+
+    start_us = esp_timer_get_time();
+    for (uint32_t f = 0; f < BENCH_CLOCK_FRAMES; f++)
+    {
+        frame(f * 1000 / BENCH_CLOCK_FPS);
+        vTaskDelay(pdMS_TO_TICKS(1000 / BENCH_CLOCK_FPS));
+    }
+    int64_t wall_us = esp_timer_get_time() - start_us;
+    fprintf(out, "%-28s %6.1f fps %+8.1f ms drift\n", "vTaskDelay loop", BENCH_CLOCK_FRAMES * 1e6 / wall_us,
+            (wall_us - BENCH_CLOCK_FRAMES * 1000000.0 / BENCH_CLOCK_FPS) / 1000.0);
+
+    gled_frame_clock_handle_t clock;
+    ESP_ERROR_CHECK(gled_frame_clock_start(BENCH_CLOCK_FPS, &clock));
+    start_us = esp_timer_get_time();
+    uint32_t time_ms = 0;
+    for (uint32_t f = 0; f < BENCH_CLOCK_FRAMES; f++)
+    {
+        ESP_ERROR_CHECK(gled_frame_clock_wait(clock, portMAX_DELAY, &time_ms));
+        frame(time_ms);
+    }
+    ESP_ERROR_CHECK(gled_frame_clock_wait(clock, portMAX_DELAY, &time_ms));
+    wall_us = esp_timer_get_time() - start_us;
+    fprintf(out, "%-28s %6.1f fps %+8.1f ms drift %u dropped\n", "frame clock", time_ms * 1000.0 * BENCH_CLOCK_FPS / wall_us,
+            (wall_us - time_ms * 1000.0) / 1000.0, gled_frame_clock_dropped(clock));
+    ESP_ERROR_CHECK(gled_frame_clock_stop(clock));
+    ESP_ERROR_CHECK(gled_anim_del(anim));
+    ESP_ERROR_CHECK(led_strip_del(strip));
+    (void)sink;
+}
+
+static void bench_stats(uint64_t drift_samples)
+{
+    fprintf(out, "\n-- Statistics (window %d) --\n", WINDOW_SIZE);
+    moving_average_t ma = init_moving_average();
+    volatile float sink = 0;
+
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < BENCH_MA_SAMPLES; i++)
+    {
+        moving_average_enqueue(ma, i);
+        sink = get_moving_average(ma);
+    }
+    int64_t cpu_us = esp_timer_get_time() - start_us;
+    fprintf(out, "%-28s %10.1f ns host\n", "MovingAverage", cpu_us * 1000.0 / BENCH_MA_SAMPLES);
+    free(ma);
+
+    static int32_t storage[256];
+    stats_window_t window;
+    volatile int32_t isink = 0;
+    static const uint32_t sizes[] = {WINDOW_SIZE, 256};
+    for (uint32_t size : sizes)
+    {
+        ESP_ERROR_CHECK(stats_window_init(&window, storage, 256, size));
+        start_us = esp_timer_get_time();
+        for (int i = 0; i < BENCH_MA_SAMPLES; i++)
+        {
+            stats_window_push(&window, i);
+            isink = stats_window_mean(&window);
+        }
+        cpu_us = esp_timer_get_time() - start_us;
+        char name[32];
+        snprintf(name, sizeof(name), "stats window (%u)", size);
+        fprintf(out, "%-28s %10.1f ns host\n", name, cpu_us * 1000.0 / BENCH_MA_SAMPLES);
+    }
+
+    // The level calculator's chain (median and window), then with the optional EMA and Welford statistics
+    stats_channel_t channel;
+    stats_config_t config = {.median_n = 3, .window = WINDOW_SIZE, .ema_alpha_q16 = 0, .welford = false};
+    for (int all = 0; all < 2; all++)
+    {
+        if (all)
+        {
+            config.ema_alpha_q16 = STATS_EMA_ALPHA_Q16(0.1);
+            config.welford = true;
+        }
+        ESP_ERROR_CHECK(stats_channel_init(&channel, &config, storage, 32));
+        start_us = esp_timer_get_time();
+        for (int i = 0; i < BENCH_MA_SAMPLES; i++)
+            isink = stats_channel_push(&channel, i);
+        cpu_us = esp_timer_get_time() - start_us;
+        fprintf(out, "%-28s %10.1f ns host\n", all ? "stats channel (all filters)" : "stats channel (med+window)",
+                cpu_us * 1000.0 / BENCH_MA_SAMPLES);
+    }
+    (void)sink;
+    (void)isink;
+
+    // Drift: whole periods of a permutation of 2^16 values around 6.5 pF (in aF), so the exact results are known
+    config.median_n = 1;
+    ESP_ERROR_CHECK(stats_channel_init(&channel, &config, storage, 32));
+    const uint64_t period = 1 << 16;
+    const uint64_t samples = (drift_samples + period - 1) / period * period;
+    const int32_t base = 6500000 - (int32_t)(period / 2);
+    start_us = esp_timer_get_time();
+    int32_t mean = 0;
+    for (uint64_t i = 0; i < samples; i++)
+        mean = stats_channel_push(&channel, base + (int32_t)((i * 40503) & (period - 1)));
+    cpu_us = esp_timer_get_time() - start_us;
+
+    int64_t exact_sum = 0;
+    for (uint64_t i = samples - WINDOW_SIZE; i < samples; i++)
+        exact_sum += base + (int32_t)((i * 40503) & (period - 1));
+    double exact_mean = base + (period - 1) / 2.0;
+    double exact_variance = ((double)period * period - 1) / 12 * samples / (samples - 1);
+    fprintf(out, "%-28s %10.3g samples in %.1f s host\n", "drift run", (double)samples, cpu_us / 1e6);
+    fprintf(out, "%-28s %10lld window sum error %8d mean (exact %.1f)\n", "drift", (long long)(channel.window.sum - exact_sum),
+            mean, (double)exact_sum / WINDOW_SIZE);
+    fprintf(out, "%-28s %10.3g mean %8.3g variance relative error\n", "drift Welford",
+            fabs(channel.welford.mean - exact_mean) / exact_mean, fabs(stats_welford_variance(&channel.welford) - exact_variance) / exact_variance);
+}
+
+// Channel at a time references: in double to check the block kernels, in float as the scalar baseline
+template <typename acc_t>
+static void reference_fir(const float *in, float *out, uint32_t frames, uint16_t channels, const float *coeffs, uint16_t taps,
+                          uint16_t decimation)
+{
+    const uint32_t stride = FILTER_STRIDE(channels);
+    for (uint16_t c = 0; c < channels; c++)
+    {
+        uint32_t outputs = 0;
+        for (uint32_t n = decimation - 1; n < frames; n += decimation, outputs++)
+        {
+            acc_t acc = 0;
+            for (uint16_t k = 0; k < taps && k <= n; k++)
+                acc += (acc_t)coeffs[k] * in[(n - k) * stride + c];
+            out[outputs * stride + c] = (float)acc;
+        }
+    }
+}
+
+static void reference_iir(const float *in, float *out, uint32_t frames, uint16_t channels, const filter_biquad_t *sections,
+                          uint8_t num_sections)
+{
+    const uint32_t stride = FILTER_STRIDE(channels);
+    for (uint16_t c = 0; c < channels; c++)
+    {
+        for (uint32_t n = 0; n < frames; n++)
+            out[n * stride + c] = in[n * stride + c];
+        for (uint8_t s = 0; s < num_sections; s++)
+        {
+            const filter_biquad_t &bq = sections[s];
+            double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+            for (uint32_t n = 0; n < frames; n++)
+            {
+                double x = out[n * stride + c];
+                double y = bq.b0 * x + bq.b1 * x1 + bq.b2 * x2 - bq.a1 * y1 - bq.a2 * y2;
+                x2 = x1, x1 = x, y2 = y1, y1 = y;
+                out[n * stride + c] = (float)y;
+            }
+        }
+    }
+}
+
+static float max_error(const float *a, const float *b, uint32_t frames, uint16_t channels)
+{
+    const uint32_t stride = FILTER_STRIDE(channels);
+    float error = 0;
+    for (uint32_t n = 0; n < frames; n++)
+        for (uint16_t c = 0; c < channels; c++)
+            error = fmaxf(error, fabsf(a[n * stride + c] - b[n * stride + c]));
+    return error;
+}
+
+static void bench_filters(void)
+{
+    // Low pass FIR (windowed sinc, cut-off fs / 8), 2 section Butterworth low pass at fs / 10
+    static float fir16[16], fir32[32];
+    float *firs[] = {fir16, fir32};
+    for (float *coeffs : firs)
+    {
+        const int taps = coeffs == fir16 ? 16 : 32;
+        float sum = 0;
+        for (int k = 0; k < taps; k++)
+        {
+            double t = k - (taps - 1) / 2.0;
+            double sinc = t == 0 ? 0.25 : sin(M_PI * 0.25 * t) / (M_PI * t);
+            coeffs[k] = (float)(sinc * (0.54 - 0.46 * cos(2 * M_PI * k / (taps - 1))));
+            sum += coeffs[k];
+        }
+        for (int k = 0; k < taps; k++)
+            coeffs[k] /= sum;
+    }
+    static const filter_biquad_t biquads[2] = {
+        {0.06745527f, 0.13491055f, 0.06745527f, -1.1429805f, 0.4128016f},
+        {0.07902868f, 0.15805737f, 0.07902868f, -1.3389928f, 0.6551077f},
+    };
+
+    static float input[BENCH_FILTER_FRAMES * FILTER_STRIDE(BENCH_FILTER_MAX_CHANNELS)];
+    static float output[BENCH_FILTER_FRAMES * FILTER_STRIDE(BENCH_FILTER_MAX_CHANNELS)];
+    static float expected[BENCH_FILTER_FRAMES * FILTER_STRIDE(BENCH_FILTER_MAX_CHANNELS)];
+    static float storage[FILTER_FIR_DELAY_LEN(32, BENCH_FILTER_MAX_CHANNELS)];
+
+    static const uint16_t channel_counts[] = {1, 2, 3, 4, 8, 12, 16};
+    static const char *const kernels[] = {"FIR 16 taps", "FIR 32 taps / 4", "IIR 2 biquads", "FIR 16 taps, per channel"};
+    double rates[4][sizeof(channel_counts) / sizeof(channel_counts[0])];
+    float errors[3] = {0};
+
+    for (size_t i = 0; i < sizeof(channel_counts) / sizeof(channel_counts[0]); i++)
+    {
+        const uint16_t channels = channel_counts[i];
+        const uint32_t stride = FILTER_STRIDE(channels);
+        // A few hundred fF of slow swell and noise per channel, padding lanes zero
+        memset(input, 0, sizeof(input));
+        for (uint32_t n = 0; n < BENCH_FILTER_FRAMES; n++)
+            for (uint16_t c = 0; c < channels; c++)
+                input[n * stride + c] = (float)(4.2 + 0.3 * sin(2 * M_PI * n / 97.0 + c) + 0.01 * ((rand() % 201) - 100) / 100.0);
+        const uint32_t blocks = BENCH_FILTER_SAMPLES / (BENCH_FILTER_FRAMES * channels);
+        const double samples = (double)blocks * BENCH_FILTER_FRAMES * channels;
+
+        for (int kernel = 0; kernel < 4; kernel++)
+        {
+            filter_fir_t fir;
+            filter_iir_t iir;
+            const size_t storage_len = sizeof(storage) / sizeof(float);
+            auto run = [&](float *dest) {
+                switch (kernel)
+                {
+                case 0:
+                case 1:
+                    filter_fir_process(&fir, input, dest, BENCH_FILTER_FRAMES);
+                    break;
+                case 2:
+                    filter_iir_process(&iir, input, dest, BENCH_FILTER_FRAMES);
+                    break;
+                default:
+                    reference_fir<float>(input, dest, BENCH_FILTER_FRAMES, channels, fir16, 16, 1);
+                }
+            };
+
+            // First block from zero state against the double reference
+            uint32_t checked = BENCH_FILTER_FRAMES;
+            if (kernel == 0)
+            {
+                ESP_ERROR_CHECK(filter_fir_init(&fir, fir16, 16, 1, channels, storage, storage_len));
+                reference_fir<double>(input, expected, BENCH_FILTER_FRAMES, channels, fir16, 16, 1);
+            }
+            else if (kernel == 1)
+            {
+                ESP_ERROR_CHECK(filter_fir_init(&fir, fir32, 32, 4, channels, storage, storage_len));
+                reference_fir<double>(input, expected, BENCH_FILTER_FRAMES, channels, fir32, 32, 4);
+                checked /= 4;
+            }
+            else if (kernel == 2)
+            {
+                ESP_ERROR_CHECK(filter_iir_init(&iir, biquads, 2, channels, storage, storage_len));
+                reference_iir(input, expected, BENCH_FILTER_FRAMES, channels, biquads, 2);
+            }
+            run(output);
+            if (kernel < 3)
+                errors[kernel] = fmaxf(errors[kernel], max_error(output, expected, checked, channels));
+
+            int64_t start_us = esp_timer_get_time();
+            for (uint32_t b = 0; b < blocks; b++)
+                run(output);
+            int64_t cpu_us = esp_timer_get_time() - start_us;
+            rates[kernel][i] = samples / cpu_us; // Samples per us = Msamples/s
+        }
+    }
+
+    fprintf(out, "\n-- Block filters (Msamples/s, one core) --\n%-28s", "channels");
+    for (uint16_t channels : channel_counts)
+        fprintf(out, " %6u", channels);
+    fprintf(out, "\n");
+    for (int kernel = 0; kernel < 4; kernel++)
+    {
+        fprintf(out, "%-28s", kernels[kernel]);
+        for (size_t i = 0; i < sizeof(channel_counts) / sizeof(channel_counts[0]); i++)
+            fprintf(out, " %6.0f", rates[kernel][i]);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "%-28s %10.2g FIR %8.2g FIR / 4 %8.2g IIR max error vs double\n", "accuracy", errors[0], errors[1], errors[2]);
+}
+
+// Stress test record: every word derives from seq, so a torn copy is detected
+struct ring_record
+{
+    uint32_t seq;
+    uint32_t check[5];
+};
+
+static ring_record make_record(uint32_t seq)
+{
+    ring_record record;
+    record.seq = seq;
+    for (uint32_t i = 0; i < 5; i++)
+        record.check[i] = (seq + i) * 2654435761u;
+    return record;
+}
+
+static bool record_valid(const ring_record &record)
+{
+    ring_record expected = make_record(record.seq);
+    return memcmp(&record, &expected, sizeof(record)) == 0;
+}
+
+struct ring_consumer
+{
+    const char *name;
+    uint32_t pause_every; // Sleep 1 ms after this many reads, 0 never
+    bool latest;          // sample_ring_read_latest() instead of a reader
+    uint64_t reads, overrun, torn, out_of_order;
+};
+
+static void ring_consume(sample_ring_handle_t ring, ring_consumer *consumer, const std::atomic<bool> *done)
+{
+    sample_ring_reader_t reader;
+    sample_ring_reader_init(&reader, ring);
+    ring_record record;
+    uint32_t seq, last_seq = 0;
+    bool first = true;
+
+    while (1)
+    {
+        bool finished = done->load(std::memory_order_acquire); // Checked before reading, so the final drain is complete
+        esp_err_t esp_rc = consumer->latest ? sample_ring_read_latest(ring, &record, &seq) : sample_ring_read(&reader, &record, &seq);
+        if (esp_rc != ESP_OK || (consumer->latest && !first && seq == last_seq))
+        {
+            if (finished)
+                break;
+            std::this_thread::yield(); // Caught up
+            continue;
+        }
+
+        consumer->reads++;
+        if (!record_valid(record) || record.seq != seq)
+            consumer->torn++;
+        if (!first && (int32_t)(seq - last_seq) <= 0)
+            consumer->out_of_order++;
+        first = false;
+        last_seq = seq;
+        if (consumer->pause_every && consumer->reads % consumer->pause_every == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    consumer->overrun = reader.overrun;
+}
+
+static void bench_ring(void)
+{
+    fprintf(out, "\n-- Sample ring (%d slots) --\n", BENCH_RING_SLOTS);
+    sample_ring_handle_t ring;
+
+    // Uncontended cost of a FDC1004 sample
+    ESP_ERROR_CHECK(sample_ring_new(BENCH_RING_SLOTS, sizeof(fdc_sample_t), &ring));
+    fdc_sample_t sample = {};
+    sample_ring_reader_t reader;
+    sample_ring_reader_init(&reader, ring);
+    const uint32_t repeats = 1000000;
+    int64_t start_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < repeats; i++)
+    {
+        sample.lev_af = i;
+        sample_ring_push(ring, &sample);
+        ESP_ERROR_CHECK(sample_ring_read(&reader, &sample, NULL));
+    }
+    int64_t cpu_us = esp_timer_get_time() - start_us;
+    fprintf(out, "%-28s %10.1f ns host\n", "push + read fdc_sample_t", cpu_us * 1000.0 / repeats);
+    ESP_ERROR_CHECK(sample_ring_del(ring));
+
+    // One producer against three consumers at their own pace. The producer yields every half ring so the
+    // readers also get to run on a single core host, and keep up for part of the time.
+    ESP_ERROR_CHECK(sample_ring_new(BENCH_RING_SLOTS, sizeof(ring_record), &ring));
+    ring_consumer consumers[] = {
+        {"reader (flat out)", 0, false, 0, 0, 0, 0},
+        {"reader (paced)", 1000, false, 0, 0, 0, 0},
+        {"latest", 0, true, 0, 0, 0, 0},
+    };
+    std::atomic<bool> done(false);
+    std::thread threads[3];
+    for (int i = 0; i < 3; i++)
+        threads[i] = std::thread(ring_consume, ring, &consumers[i], &done);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Readers attach before the first push
+
+    start_us = esp_timer_get_time();
+    for (uint32_t seq = 0; seq < BENCH_RING_RECORDS; seq++)
+    {
+        ring_record record = make_record(seq);
+        sample_ring_push(ring, &record);
+        if (seq % (BENCH_RING_SLOTS / 2) == 0)
+            std::this_thread::yield();
+    }
+    cpu_us = esp_timer_get_time() - start_us;
+    done.store(true, std::memory_order_release);
+    for (std::thread &thread : threads)
+        thread.join();
+
+    fprintf(out, "%-28s %10.1f M records/s pushed, %u host cores\n", "producer", BENCH_RING_RECORDS / (double)cpu_us,
+            std::thread::hardware_concurrency());
+    bool consistent = true;
+    for (const ring_consumer &consumer : consumers)
+    {
+        fprintf(out, "%-28s %10llu reads %9llu overrun %3llu torn %3llu out of order\n", consumer.name,
+                (unsigned long long)consumer.reads, (unsigned long long)consumer.overrun, (unsigned long long)consumer.torn, (unsigned long long)consumer.out_of_order);
+        consistent &= consumer.torn == 0 && consumer.out_of_order == 0;
+        if (!consumer.latest)
+            consistent &= consumer.reads + consumer.overrun == BENCH_RING_RECORDS;
+    }
+    fprintf(out, "%-28s %10s every reader record read or counted as overrun, none torn\n", "stress test", consistent ? "PASS" : "FAIL");
+    ESP_ERROR_CHECK(sample_ring_del(ring));
+}
+
+// Stress frame: port, producer, sequence (16 bits), pattern length, then the first half of the pattern,
+// seq % 16 zeros and the second half, so every append function of i2c_transaction_t is used
+#define STRESS_HEADER_LEN 5
+
+static uint8_t stress_byte(uint8_t producer, uint32_t seq, uint32_t i)
+{
+    return (uint8_t)(producer * 61 + seq * 7 + i * 13 + 1);
+}
+
+// Virtual device that checks every write phase is one whole frame, for its bus, from one producer, in order
+struct frame_checker
+{
+    sim_i2c_device_t device; // First member, see sim_i2c_device_t
+    i2c_port_t port;
+    std::atomic<bool> busy; // Set while a frame is checked, two at once means the bus let transfers overlap
+    std::atomic<uint32_t> frames, torn;
+    uint16_t next_seq[BENCH_STRESS_PRODUCERS];
+};
+
+static bool stress_frame_valid(frame_checker *checker, const uint8_t *data, size_t len)
+{
+    if (len < STRESS_HEADER_LEN || data[0] != checker->port || data[1] >= BENCH_STRESS_PRODUCERS)
+        return false;
+    uint8_t producer = data[1];
+    uint16_t seq = data[2] | data[3] << 8;
+    uint8_t pattern_len = data[4], zero_len = seq % 16;
+    if (seq != checker->next_seq[producer] || len != (size_t)(STRESS_HEADER_LEN + pattern_len + zero_len))
+        return false;
+    checker->next_seq[producer] = seq + 1;
+
+    const uint8_t *payload = data + STRESS_HEADER_LEN;
+    for (uint32_t i = 0, p = 0; i < (uint32_t)pattern_len + zero_len; i++)
+    {
+        bool zero = i >= pattern_len / 2u && i < pattern_len / 2u + zero_len;
+        if (payload[i] != (zero ? 0 : stress_byte(producer, seq, p++)))
+            return false;
+    }
+    return true;
+}
+
+static esp_err_t frame_checker_write(sim_i2c_device_t *device, const uint8_t *data, size_t len)
+{
+    frame_checker *checker = (frame_checker *)device;
+    bool overlapped = checker->busy.exchange(true);
+    bool valid = stress_frame_valid(checker, data, len);
+    if (!overlapped)
+        checker->busy.store(false);
+    checker->frames++;
+    if (overlapped || !valid)
+        checker->torn++;
+    return ESP_OK;
+}
+
+// Builds frames in a stack transaction, yielding between appends so the tasks interleave
+static void stress_produce(i2c_master_bus_handle_t bus, i2c_port_t port, uint8_t producer)
+{
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = BENCH_STRESS_ADDRESS,
+        .scl_speed_hz = 400000,
+    };
+    i2c_master_dev_handle_t slave;
+    ESP_ERROR_CHECK(i2c_master_bus_add_device(bus, &dev_cfg, &slave));
+
+    I2C_TRANSACTION_DECLARE(trans, STRESS_HEADER_LEN + 255 + 15);
+    uint8_t pattern[128];
+    for (uint32_t seq = 0; seq < BENCH_STRESS_FRAMES; seq++)
+    {
+        uint8_t pattern_len = seq % 97 + 1;
+        uint8_t header[STRESS_HEADER_LEN] = {(uint8_t)port, producer, (uint8_t)seq, (uint8_t)(seq >> 8), pattern_len};
+        i2c_transaction_write_bytes(&trans, header, sizeof(header));
+        for (uint32_t i = 0; i < pattern_len / 2u; i++)
+        {
+            i2c_transaction_write_byte(&trans, stress_byte(producer, seq, i));
+            if (i % 8 == 0)
+                std::this_thread::yield();
+        }
+        i2c_transaction_write_zero(&trans, seq % 16);
+        std::this_thread::yield();
+        for (uint32_t i = pattern_len / 2u; i < pattern_len; i++)
+            pattern[i - pattern_len / 2u] = stress_byte(producer, seq, i);
+        i2c_transaction_write_bytes(&trans, pattern, pattern_len - pattern_len / 2u);
+        ESP_ERROR_CHECK(i2c_transaction_transmit(&trans, slave));
+    }
+    ESP_ERROR_CHECK(i2c_master_bus_rm_device(slave));
+}
+
+// Tasks on both buses build and send caller-owned transactions at once. The checker on each bus must
+// see every frame whole, in order and never overlapping another.
+static void bench_i2c_stress(i2c_master_bus_handle_t display_bus, i2c_master_bus_handle_t sensor_bus)
+{
+    fprintf(out, "\n-- I2C transactions (%d tasks on each of 2 buses, %d frames each) --\n", BENCH_STRESS_PRODUCERS,
+            BENCH_STRESS_FRAMES);
+    const struct
+    {
+        i2c_master_bus_handle_t bus;
+        i2c_port_t port;
+    } buses[] = {{display_bus, BENCH_DISPLAY_PORT}, {sensor_bus, BENCH_SENSOR_PORT}};
+    static frame_checker checkers[2];
+
+    for (int b = 0; b < 2; b++)
+    {
+        frame_checker *checker = &checkers[b];
+        checker->device.write = frame_checker_write;
+        checker->device.read = NULL;
+        checker->port = buses[b].port;
+        checker->busy = false;
+        checker->frames = 0;
+        checker->torn = 0;
+        memset(checker->next_seq, 0, sizeof(checker->next_seq));
+        ESP_ERROR_CHECK(sim_i2c_attach(buses[b].port, BENCH_STRESS_ADDRESS, &checker->device));
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    std::thread producers[2][BENCH_STRESS_PRODUCERS];
+    for (int b = 0; b < 2; b++)
+        for (uint8_t p = 0; p < BENCH_STRESS_PRODUCERS; p++)
+            producers[b][p] = std::thread(stress_produce, buses[b].bus, buses[b].port, p);
+    for (int b = 0; b < 2; b++)
+        for (std::thread &producer : producers[b])
+            producer.join();
+    int64_t wall_us = esp_timer_get_time() - start_us;
+
+    bool pass = true;
+    for (int b = 0; b < 2; b++)
+    {
+        frame_checker *checker = &checkers[b];
+        bool complete = checker->frames == BENCH_STRESS_PRODUCERS * BENCH_STRESS_FRAMES;
+        for (uint16_t next_seq : checker->next_seq)
+            complete = complete && next_seq == (uint16_t)BENCH_STRESS_FRAMES;
+        pass = pass && complete && checker->torn == 0;
+        char name[32];
+        snprintf(name, sizeof(name), "bus %d", buses[b].port);
+        fprintf(out, "%-28s %10u frames %8u torn or out of order\n", name, checker->frames.load(), checker->torn.load());
+        sim_i2c_detach(buses[b].port, BENCH_STRESS_ADDRESS);
+        sim_i2c_reset_stats(buses[b].port);
+    }
+    fprintf(out, "%-28s %10s every frame whole, in order and on its own bus, in %.2f s host\n", "stress test",
+            pass ? "PASS" : "FAIL", wall_us / 1e6);
+}
+
+// Lifecycle soak test programs. Each hook that owns memory allocates it in init or run and frees it
+// in stop, so a stop hook run twice aborts on the double free and one never run shows up as heap growth.
+static SemaphoreHandle_t soak_entered; // Given when a program reaches the hook the test is waiting for
+static std::atomic<uint32_t> soak_stops;
+
+static size_t heap_in_use(void)
+{
+    struct mallinfo2 info = mallinfo2(); // Summed over every arena, so allocations from any task count
+    return info.uordblks + info.hblkhd;
+}
+
+static esp_err_t soak_alloc_init(program_ctx_t *ctx)
+{
+    ctx->user = malloc(256);
+    return ctx->user != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static void soak_free_stop(program_ctx_t *ctx)
+{
+    free(ctx->user);
+    ctx->user = NULL;
+    soak_stops++;
+}
+
+static void soak_ignore_run(program_ctx_t *ctx)
+{
+    (void)ctx;
+    xSemaphoreGive(soak_entered);
+    for (;;) // Never looks at its events, so it can only be deleted
+        vTaskDelay(portMAX_DELAY);
+}
+
+static esp_err_t soak_hang_init(program_ctx_t *ctx)
+{
+    (void)ctx;
+    xSemaphoreGive(soak_entered);
+    for (;;)
+        vTaskDelay(portMAX_DELAY);
+    return ESP_OK;
+}
+
+static void soak_return_run(program_ctx_t *ctx)
+{
+    ctx->user = malloc(256);
+}
+
+static void soak_hang_stop(program_ctx_t *ctx)
+{
+    soak_free_stop(ctx);
+    xSemaphoreGive(soak_entered);
+    for (;;)
+        vTaskDelay(portMAX_DELAY);
+}
+
+static void soak_count_stop(program_ctx_t *ctx)
+{
+    (void)ctx;
+    soak_stops++;
+}
+
+static void soak_noop_run(program_ctx_t *ctx)
+{
+    (void)ctx;
+}
+
+// Registers a callback on every program button, each one a chance for the stop to land part way through
+static esp_err_t soak_register_init(program_ctx_t *ctx)
+{
+    for (uint8_t i = 0; i < MAX_PROGRAM_BUTTONS; i++)
+    {
+        esp_err_t esp_rc = program_register_button(ctx, i, BUTTON_SINGLE_CLICK, i);
+        if (esp_rc != ESP_OK)
+            return esp_rc; // Registrations so far are unregistered by program_stop()
+    }
+    return ESP_OK;
+}
+
+static void soak_wait_run(program_ctx_t *ctx)
+{
+    uint8_t event;
+    while (program_wait_event(ctx, &event, portMAX_DELAY))
+        ;
+}
+
+// Button callbacks left behind by a stopped program
+static size_t soak_callbacks(button_handle_t buttons[])
+{
+    size_t count = 0;
+    for (uint8_t i = 0; i < MAX_PROGRAM_BUTTONS; i++)
+        count += iot_button_count_cb(buttons[i]);
+    return count;
+}
+
+/**
+ * Starts and stops one program BENCH_SOAK_CYCLES times.
+ *
+ * wait_entered: wait for the program to give soak_entered before stopping it, otherwise stop it after
+ * a delay that sweeps 0 to BENCH_SOAK_JITTER_US so the stop lands at every point of the task's life
+ * timeout: join timeout passed to program_stop()
+ * expect_rc: result program_stop() must return every cycle, ESP_FAIL to accept either outcome
+ * expect_stops: stop hook runs expected over the measured cycles, UINT32_MAX to skip the check
+ */
+static void soak_program(const char *name, const program_ops_t *ops, button_handle_t buttons[], bool wait_entered,
+                         TickType_t timeout, esp_err_t expect_rc, uint32_t expect_stops)
+{
+    static program_t program;
+    ESP_ERROR_CHECK(program_init(&program, "soak", ops));
+
+    uint32_t rc_mismatch = 0, deleted = 0, not_idle = 0;
+    size_t baseline = 0, high_water = 0, callbacks = 0;
+    for (uint32_t i = 0; i < BENCH_SOAK_WARMUP + BENCH_SOAK_CYCLES; i++)
+    {
+        if (i == BENCH_SOAK_WARMUP)
+        {
+            soak_stops = 0;
+            baseline = high_water = heap_in_use();
+        }
+        ESP_ERROR_CHECK(program_start(&program, buttons));
+        if (wait_entered)
+            xSemaphoreTake(soak_entered, portMAX_DELAY);
+        else
+        {
+            int64_t until_us = esp_timer_get_time() + i % BENCH_SOAK_JITTER_US;
+            while (esp_timer_get_time() < until_us)
+                ;
+        }
+        esp_err_t esp_rc = program_stop(&program, timeout);
+        if (i < BENCH_SOAK_WARMUP)
+            continue;
+
+        deleted += esp_rc == ESP_ERR_TIMEOUT;
+        rc_mismatch += expect_rc != ESP_FAIL && esp_rc != expect_rc;
+        not_idle += program.state != PROGRAM_STATE_IDLE || program.handle != NULL;
+        callbacks += soak_callbacks(buttons);
+        high_water = std::max(high_water, heap_in_use());
+    }
+    size_t end = heap_in_use();
+    program_deinit(&program);
+
+    bool pass = rc_mismatch == 0 && not_idle == 0 && callbacks == 0 && high_water - baseline <= BENCH_SOAK_HEAP_SLACK &&
+                (expect_stops == UINT32_MAX || soak_stops == expect_stops) && sim_rmt_channels_in_use() == 0;
+    fprintf(out, "%-28s %10s %5u deleted %5u stop hooks, heap %+6td high-water %+6td bytes, %zu callbacks left\n", name,
+            pass ? "PASS" : "FAIL", deleted, soak_stops.load(), (ptrdiff_t)(end - baseline), (ptrdiff_t)(high_water - baseline),
+            callbacks);
+}
+
+// Program start/stop cycles through every way a program task can end: exiting in time, deleted in each
+// hook, exiting just as program_stop() times out and stopped while init registers buttons. The heap,
+// button callbacks and RMT channels must come back every cycle.
+static void bench_program_soak(button_handle_t buttons[])
+{
+    fprintf(out, "\n-- Program lifecycle (%d start/stop cycles each) --\n", BENCH_SOAK_CYCLES);
+    soak_entered = xSemaphoreCreateBinary();
+
+    const program_ops_t ignore_stop = {.init = soak_alloc_init, .run = soak_ignore_run, .stop = soak_free_stop, .task_stack = 0};
+    const program_ops_t hang_init = {.init = soak_hang_init, .run = soak_noop_run, .stop = soak_count_stop, .task_stack = 0};
+    const program_ops_t hang_stop = {.init = NULL, .run = soak_return_run, .stop = soak_hang_stop, .task_stack = 0};
+    const program_ops_t exit_race = {.init = NULL, .run = soak_noop_run, .stop = soak_count_stop, .task_stack = 0};
+    const program_ops_t register_race = {.init = soak_register_init, .run = soak_wait_run, .stop = NULL, .task_stack = 0};
+
+    soak_program("LED strip, exits in time", &led_strip_program, buttons, false, pdMS_TO_TICKS(PROGRAM_JOIN_TIMEOUT_MS),
+                 ESP_OK, UINT32_MAX);
+    soak_program("deleted while running", &ignore_stop, buttons, true, 0, ESP_ERR_TIMEOUT, BENCH_SOAK_CYCLES);
+    soak_program("deleted in init", &hang_init, buttons, true, 0, ESP_ERR_TIMEOUT, 0);
+    soak_program("deleted in stop", &hang_stop, buttons, true, 0, ESP_ERR_TIMEOUT, BENCH_SOAK_CYCLES);
+    soak_program("exit races the timeout", &exit_race, buttons, false, 0, ESP_FAIL, UINT32_MAX);
+    soak_program("stop races registration", &register_race, buttons, false, pdMS_TO_TICKS(PROGRAM_JOIN_TIMEOUT_MS), ESP_OK,
+                 UINT32_MAX);
+
+    vSemaphoreDelete(soak_entered);
+}
+
+// Menu::handle_events() on bursts of presses queued while the menu task is busy, as a state machine
+// stepped by hand: each burst must be handled as one batch with one redraw, costing no more than a
+// single paced press, and leave the cursor on the right row
+static void bench_menu_coalescing(ssd1306_t *display, sim_ssd1306_handle_t panel, button_handle_t buttons[])
+{
+    static const uint32_t bursts[] = {1, 2, 3, 5, 8, MENU_EVENT_QUEUE_LEN};
+    const uint8_t rows = 3, first_row = LINE_2; // The placeholder programs of a new menu
+    Menu *menu = new Menu(display, buttons);
+    uint32_t row = 0;
+
+    fprintf(out, "\n-- Menu event coalescing (cursor down bursts, %u rows) --\n", rows);
+    fprintf(out, "%-28s %10s %10s %8s\n", "presses", "paced", "burst", "batches");
+    sim_i2c_stats_t stats;
+    for (uint32_t presses : bursts)
+    {
+        // The same presses handled one at a time, a redraw each
+        uint64_t paced_bytes = 0, single_bytes = 0;
+        for (uint32_t i = 0; i < presses; i++)
+        {
+            sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+            menu->post_event(MENU_EVENT_CURSOR_DOWN);
+            menu->handle_events(0);
+            sim_i2c_get_stats(BENCH_DISPLAY_PORT, &stats);
+            paced_bytes += stats.bytes;
+            single_bytes = std::max(single_bytes, stats.bytes);
+        }
+        row = (row + presses) % rows;
+
+        sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+        for (uint32_t i = 0; i < presses; i++)
+            menu->post_event(MENU_EVENT_CURSOR_DOWN);
+        uint32_t batches = 0;
+        while (menu->handle_events(0))
+            batches++;
+        sim_i2c_get_stats(BENCH_DISPLAY_PORT, &stats);
+        row = (row + presses) % rows;
+
+        // Only the row under the cursor shows it
+        const uint8_t(*gddram)[SSD1306_WIDTH] = sim_ssd1306_gddram(panel);
+        static const uint8_t blank[8] = {0};
+        bool cursor_ok = true;
+        for (uint8_t r = 0; r < rows; r++)
+            cursor_ok = cursor_ok && memcmp(gddram[first_row + r], r == row ? font8x8_basic[(uint8_t)'>'] : blank, 8) == 0;
+
+        // A whole lap of the rows leaves the cursor where it was, so nothing is sent
+        bool cost_ok = presses % rows == 0 ? stats.bytes == 0 : stats.bytes <= single_bytes;
+        bool pass = batches == 1 && cost_ok && cursor_ok;
+        char name[16];
+        snprintf(name, sizeof(name), "%u", presses);
+        fprintf(out, "%-28s %4llu bytes %4llu bytes %8u %s\n", name, (unsigned long long)paced_bytes, (unsigned long long)stats.bytes,
+                batches, pass ? "PASS" : "FAIL");
+    }
+    delete menu;
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+}
+
+static void bench_menu(i2c_master_bus_handle_t bus, ssd1306_t *display, sim_ssd1306_handle_t panel)
+{
+    static menu_peripherals_t params;
+    params.master_handle = bus;
+    params.display = display;
+
+    button_config_t button_config = {
+        .type = BUTTON_TYPE_GPIO,
+        .long_press_time = CONFIG_BUTTON_LONG_PRESS_TIME_MS,
+        .short_press_time = CONFIG_BUTTON_SHORT_PRESS_TIME_MS,
+        .gpio_button_config = {.gpio_num = 0, .active_level = 0},
+    };
+    for (uint8_t i = 0; i < MAX_NUM_BUTTONS; i++)
+    {
+        button_config.gpio_button_config.gpio_num = button_gpios[i];
+        params.button_handles[i] = iot_button_create(&button_config);
+    }
+    bench_program_soak(params.button_handles);
+    bench_menu_coalescing(display, panel, params.button_handles);
+    fprintf(out, "\n-- Menu --\n");
+
+    sim_i2c_reset_stats(BENCH_DISPLAY_PORT);
+    xTaskCreate(menu_main, "menu_main", 4096, &params, 1, NULL);
+    wait_bus_idle(BENCH_DISPLAY_PORT);
+    report_i2c("start-up", BENCH_DISPLAY_PORT, 1);
+
+    const uint32_t presses = 8; // A multiple of the menu rows, so the cursor ends where it started
+    for (uint32_t i = 0; i < presses; i++)
+    {
+        sim_gpio_click(button_gpios[1]); // Cursor down
+        wait_bus_idle(BENCH_DISPLAY_PORT);
+    }
+    report_i2c("cursor press (paced)", BENCH_DISPLAY_PORT, presses);
+
+    for (uint32_t i = 0; i < presses; i++)
+        sim_gpio_click(button_gpios[1]); // Burst, faster than the menu task redraws
+    wait_bus_idle(BENCH_DISPLAY_PORT);
+    report_i2c("cursor press (burst)", BENCH_DISPLAY_PORT, presses);
+
+    // The LED program is added after the placeholder rows, one up from the first row
+    sim_gpio_click(button_gpios[0]);
+    sim_gpio_click(button_gpios[2]);
+    wait_bus_idle(BENCH_DISPLAY_PORT);
+    report_i2c("program start", BENCH_DISPLAY_PORT, 1);
+    fprintf(out, "%-28s %10u RMT channels in use\n", "program start", sim_rmt_channels_in_use());
+
+    sim_gpio_click(button_gpios[0]); // Handled by the program: strip to red
+    vTaskDelay(pdMS_TO_TICKS(BENCH_SETTLE_MS));
+    const uint8_t *frame;
+    size_t frame_len;
+    if (sim_rmt_get_frame(BENCH_LED_GPIO, &frame, &frame_len) == ESP_OK && frame_len >= 3)
+        fprintf(out, "%-28s %10zu bytes, first pixel G %u R %u B %u\n", "program button", frame_len, frame[0], frame[1], frame[2]);
+
+    sim_gpio_click(button_gpios[3]); // End: stop it and redraw the menu
+    wait_bus_idle(BENCH_DISPLAY_PORT);
+    report_i2c("program end", BENCH_DISPLAY_PORT, 1);
+    fprintf(out, "%-28s %10u RMT channels in use\n", "program end", sim_rmt_channels_in_use());
+}
+
+int main(int argc, char **argv)
+{
+    bool verbose = false, dump = false, regenerate = false;
+    bool ring_only = false;
+    uint64_t drift_samples = BENCH_DRIFT_SAMPLES;
+    int opt;
+    while ((opt = getopt(argc, argv, "vdglr")) != -1)
+    {
+        if (opt == 'v')
+            verbose = true;
+        else if (opt == 'd')
+            dump = true;
+        else if (opt == 'g')
+            regenerate = true;
+        else if (opt == 'l')
+            drift_samples = BENCH_DRIFT_SAMPLES_LONG;
+        else if (opt == 'r')
+            ring_only = true;
+    }
+
+    // The libraries print progress to stdout, keep it out of the report unless asked for
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!verbose)
+    {
+        esp_log_level_set("*", ESP_LOG_NONE);
+        if (freopen("/dev/null", "w", stdout) == NULL)
+            return 1;
+    }
+
+    i2c_master_bus_handle_t display_bus, sensor_bus;
+    ESP_ERROR_CHECK(i2c_master_init(BENCH_DISPLAY_PORT, GPIO_NUM_14, GPIO_NUM_13, &display_bus));
+    ESP_ERROR_CHECK(i2c_master_init(BENCH_SENSOR_PORT, GPIO_NUM_10, GPIO_NUM_9, &sensor_bus));
+
+    if (ring_only)
+    {
+        bench_ring();
+        bench_i2c_stress(display_bus, sensor_bus);
+        fflush(out);
+        return 0;
+    }
+
+    ssd1306_t display;
+    sim_ssd1306_handle_t panel = bench_display(display_bus, &display, dump);
+    bench_frame_bytes(&display);
+    bench_gfx(&display, dump, regenerate);
+    bench_font_atlas();
+    bench_sensor(sensor_bus);
+    bench_fixed_point();
+    bench_leds();
+    bench_leds_spi();
+    bench_leds_bulk();
+    bench_leds_async();
+    bench_leds_group();
+    bench_leds_effects();
+    bench_stats(drift_samples);
+    bench_filters();
+    bench_ring();
+    bench_i2c_stress(display_bus, sensor_bus);
+    bench_menu(display_bus, &display, panel);
+
+    fflush(out);
+    return 0; // The menu task never returns, exiting ends it
+}
@@ -0,0 +1,39 @@
+/**
+ * Host simulation of driver/rmt_encoder.h
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include "driver/rmt_types.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    struct
+    {
+        uint32_t msb_first : 1;
+    } flags;
+} rmt_bytes_encoder_config_t;
+
+typedef struct
+{
+} rmt_copy_encoder_config_t;
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder);
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder);
+
+#ifdef __cplusplus
+}
+#endif
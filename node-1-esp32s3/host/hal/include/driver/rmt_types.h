@@ -0,0 +1,63 @@
+/**
+ * Host simulation of driver/rmt_types.h
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct rmt_channel_t *rmt_channel_handle_t;
+typedef struct rmt_encoder_t rmt_encoder_t;
+typedef rmt_encoder_t *rmt_encoder_handle_t;
+typedef struct rmt_sync_manager_t *rmt_sync_manager_handle_t;
+
+typedef enum
+{
+    RMT_CLK_SRC_DEFAULT = 1,
+} rmt_clock_source_t;
+
+typedef enum
+{
+    RMT_ENCODING_RESET = 0,
+    RMT_ENCODING_COMPLETE = (1 << 0),
+    RMT_ENCODING_MEM_FULL = (1 << 1),
+} rmt_encode_state_t;
+
+typedef union
+{
+    struct
+    {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
+
+typedef struct
+{
+    size_t num_symbols;
+} rmt_tx_done_event_data_t;
+
+typedef bool (*rmt_tx_done_callback_t)(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata, void *user_ctx);
+
+struct rmt_encoder_t
+{
+    size_t (*encode)(rmt_encoder_t *encoder, rmt_channel_handle_t tx_channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state);
+    esp_err_t (*reset)(rmt_encoder_t *encoder);
+    esp_err_t (*del)(rmt_encoder_t *encoder);
+};
+
+#ifdef __cplusplus
+}
+#endif
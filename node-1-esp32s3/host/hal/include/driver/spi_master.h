@@ -0,0 +1,81 @@
+/**
+ * Host simulation of driver/spi_master.h, enough for the SPI LED strip backend: one device
+ * per bus, MOSI only, polling transmissions. Frames are recorded and timed from the clock.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum
+{
+    SPI1_HOST = 0,
+    SPI2_HOST = 1,
+    SPI3_HOST = 2,
+    SPI_HOST_MAX,
+} spi_host_device_t;
+
+typedef enum
+{
+    SPI_CLK_SRC_DEFAULT = 1,
+} spi_clock_source_t;
+
+typedef enum
+{
+    SPI_DMA_DISABLED = 0,
+    SPI_DMA_CH_AUTO = 3,
+} spi_common_dma_t;
+
+typedef struct
+{
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz; // Bytes, 0 for the default of 4092
+} spi_bus_config_t;
+
+typedef struct
+{
+    spi_clock_source_t clock_source;
+    uint8_t command_bits;
+    uint8_t address_bits;
+    uint8_t dummy_bits;
+    uint8_t mode;
+    int clock_speed_hz;
+    int spics_io_num;
+    int queue_size;
+} spi_device_interface_config_t;
+
+typedef struct
+{
+    uint32_t flags;
+    size_t length;   // Bits
+    size_t rxlength; // Bits
+    const void *tx_buffer;
+    void *rx_buffer;
+} spi_transaction_t;
+
+typedef struct spi_device_t *spi_device_handle_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_common_dma_t dma_chan);
+esp_err_t spi_bus_free(spi_host_device_t host_id);
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config, spi_device_handle_t *handle);
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle);
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc);
+esp_err_t spi_device_get_actual_freq(spi_device_handle_t handle, int *freq_khz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,32 @@
+/**
+ * Host simulation of esp_cpu.h, cycle counter only. On x86 hosts this is the TSC, which
+ * counts at a constant reference rate rather than core clock; elsewhere it is nanoseconds.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (esp_cpu_cycle_count_t)__builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (esp_cpu_cycle_count_t)((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
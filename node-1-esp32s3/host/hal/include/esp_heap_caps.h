@@ -0,0 +1,30 @@
+/**
+ * Host simulation of esp_heap_caps.h. There is one heap, capabilities are ignored.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+static inline void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+static inline void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+static inline void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
@@ -0,0 +1,11 @@
+/**
+ * Host simulation of esp_idf_version.h. Matches the IDF pinned in dependencies.lock.
+ */
+#pragma once
+
+#define ESP_IDF_VERSION_MAJOR 5
+#define ESP_IDF_VERSION_MINOR 2
+#define ESP_IDF_VERSION_PATCH 1
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) ((major << 16) | (minor << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(ESP_IDF_VERSION_MAJOR, ESP_IDF_VERSION_MINOR, ESP_IDF_VERSION_PATCH)
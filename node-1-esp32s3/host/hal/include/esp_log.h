@@ -0,0 +1,48 @@
+/**
+ * Host simulation of esp_log.h. Messages go to stderr, filtered by a global level.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+extern esp_log_level_t sim_log_level;
+
+uint32_t esp_log_timestamp(void);
+
+// Tags are ignored, the level applies to every tag
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+#define SIM_LOG(level, letter, tag, format, ...)                                                   \
+    do                                                                                             \
+    {                                                                                              \
+        if (sim_log_level >= (level))                                                              \
+            fprintf(stderr, letter " (%u) %s: " format "\n", (unsigned)esp_log_timestamp(), tag, ##__VA_ARGS__); \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) SIM_LOG(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) SIM_LOG(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) SIM_LOG(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) SIM_LOG(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) SIM_LOG(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
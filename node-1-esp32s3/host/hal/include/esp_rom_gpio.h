@@ -0,0 +1,17 @@
+/**
+ * Host simulation of esp_rom_gpio.h. The GPIO matrix is not modelled, routing is a no-op.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+static inline void esp_rom_gpio_connect_out_signal(uint32_t gpio_num, uint32_t signal_idx, bool out_inv, bool oen_inv)
+{
+    (void)gpio_num;
+    (void)signal_idx;
+    (void)out_inv;
+    (void)oen_inv;
+}
@@ -0,0 +1,71 @@
+/**
+ * Host simulation of esp_timer.h. Time is the host monotonic clock since start-up.
+ *
+ * Callbacks run one at a time in a dispatch thread, like the esp_timer task on the
+ * target. ESP_TIMER_ISR dispatch is treated as ESP_TIMER_TASK.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+    ESP_TIMER_MAX,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+/**
+ * @brief Microseconds since the simulation started
+ */
+int64_t esp_timer_get_time(void);
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+
+/**
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the timer is already running
+ */
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+
+/**
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the timer is already running
+ */
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+
+/**
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the timer is not running
+ */
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+/**
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the timer is running
+ */
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+bool esp_timer_is_active(esp_timer_handle_t timer);
+
+#ifdef __cplusplus
+}
+#endif
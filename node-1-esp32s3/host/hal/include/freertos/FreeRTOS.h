@@ -0,0 +1,62 @@
+/**
+ * Host simulation of FreeRTOS on POSIX threads
+ *
+ * Tasks are pthreads. The tick rate matches the firmware's CONFIG_FREERTOS_HZ, so one
+ * tick is 10 ms of host time. Priorities and core affinity are recorded but not enforced.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL (pdFALSE)
+#define pdPASS (pdTRUE)
+
+#define configTICK_RATE_HZ 100 // CONFIG_FREERTOS_HZ in sdkconfig.node-1-esp32s3
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define pdTICKS_TO_MS(xTicks) ((TickType_t)(((uint64_t)(xTicks) * 1000U) / configTICK_RATE_HZ))
+
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
+#define configMAX_PRIORITIES 25
+
+// Critical sections are one process-wide recursive lock
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void sim_enter_critical(void);
+void sim_exit_critical(void);
+
+#define portENTER_CRITICAL(mux) sim_enter_critical()
+#define portEXIT_CRITICAL(mux) sim_exit_critical()
+#define portENTER_CRITICAL_ISR(mux) sim_enter_critical()
+#define portEXIT_CRITICAL_ISR(mux) sim_exit_critical()
+#define taskENTER_CRITICAL(mux) sim_enter_critical()
+#define taskEXIT_CRITICAL(mux) sim_exit_critical()
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "freertos/task.h"
@@ -0,0 +1,30 @@
+/**
+ * Host simulation of freertos/semphr.h. Semaphores are zero-size item queues, as in FreeRTOS.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+
+#define xSemaphoreCreateBinary() xSemaphoreCreateCounting(1, 0)
+#define xSemaphoreCreateMutex() xSemaphoreCreateCounting(1, 1)
+#define xSemaphoreTake(xSemaphore, xBlockTime) xQueueReceive((xSemaphore), NULL, (xBlockTime))
+#define xSemaphoreGive(xSemaphore) xQueueGenericSend((xSemaphore), NULL, 0, queueSEND_TO_BACK)
+#define xSemaphoreGiveFromISR(xSemaphore, pxHigherPriorityTaskWoken) xQueueGenericSend((xSemaphore), NULL, 0, queueSEND_TO_BACK)
+#define xSemaphoreTakeFromISR(xSemaphore, pxHigherPriorityTaskWoken) xQueueReceive((xSemaphore), NULL, 0)
+#define vSemaphoreDelete(xSemaphore) vQueueDelete(xSemaphore)
+#define uxSemaphoreGetCount(xSemaphore) uxQueueMessagesWaiting(xSemaphore)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+/**
+ * Host simulation of freertos/task.h
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum
+{
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, const uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask, const BaseType_t xCoreID);
+
+static inline BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, const uint32_t usStackDepth,
+                                     void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+
+void vTaskDelay(const TickType_t xTicksToDelay);
+
+BaseType_t xTaskDelayUntil(TickType_t *const pxPreviousWakeTime, const TickType_t xTimeIncrement);
+
+#define vTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement) ((void)xTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement))
+
+TickType_t xTaskGetTickCount(void);
+
+TickType_t xTaskGetTickCountFromISR(void);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery);
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask);
+
+// Stack usage is not tracked on the host, always reports the full stack as unused
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction, uint32_t *pulPreviousNotificationValue);
+
+#define xTaskNotify(xTaskToNotify, ulValue, eAction) xTaskGenericNotify((xTaskToNotify), (ulValue), (eAction), NULL)
+#define xTaskNotifyGive(xTaskToNotify) xTaskGenericNotify((xTaskToNotify), 0, eIncrement, NULL)
+#define xTaskNotifyFromISR(xTaskToNotify, ulValue, eAction, pxHigherPriorityTaskWoken) \
+    xTaskGenericNotify((xTaskToNotify), (ulValue), (eAction), NULL)
+#define vTaskNotifyGiveFromISR(xTaskToNotify, pxHigherPriorityTaskWoken) \
+    ((void)xTaskGenericNotify((xTaskToNotify), 0, eIncrement, NULL))
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue, TickType_t xTicksToWait);
+
+#ifdef __cplusplus
+}
+#endif
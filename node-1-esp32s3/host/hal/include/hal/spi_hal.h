@@ -0,0 +1,6 @@
+/**
+ * Host simulation of hal/spi_hal.h. Nothing from the SPI HAL is used on the host.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
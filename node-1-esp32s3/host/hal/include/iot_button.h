@@ -0,0 +1,83 @@
+/**
+ * Host simulation of the espressif/button component (GPIO buttons only)
+ *
+ * Buttons follow their virtual GPIO: sim_gpio_set_level() to the active level fires
+ * BUTTON_PRESS_DOWN, back to idle fires BUTTON_PRESS_UP and BUTTON_SINGLE_CLICK.
+ * Callbacks run in the thread that changed the level, which stands in for the
+ * esp_timer task on the target.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CONFIG_BUTTON_LONG_PRESS_TIME_MS 1500
+#define CONFIG_BUTTON_SHORT_PRESS_TIME_MS 180
+
+typedef void (*button_cb_t)(void *button_handle, void *usr_data);
+typedef void *button_handle_t;
+
+typedef enum
+{
+    BUTTON_PRESS_DOWN = 0,
+    BUTTON_PRESS_UP,
+    BUTTON_PRESS_REPEAT,
+    BUTTON_PRESS_REPEAT_DONE,
+    BUTTON_SINGLE_CLICK,
+    BUTTON_DOUBLE_CLICK,
+    BUTTON_MULTIPLE_CLICK,
+    BUTTON_LONG_PRESS_START,
+    BUTTON_LONG_PRESS_HOLD,
+    BUTTON_LONG_PRESS_UP,
+    BUTTON_EVENT_MAX,
+    BUTTON_NONE_PRESS,
+} button_event_t;
+
+typedef enum
+{
+    BUTTON_TYPE_GPIO,
+    BUTTON_TYPE_ADC,
+    BUTTON_TYPE_MATRIX,
+    BUTTON_TYPE_CUSTOM
+} button_type_t;
+
+typedef struct
+{
+    int32_t gpio_num;
+    uint8_t active_level;
+} button_gpio_config_t;
+
+typedef struct
+{
+    button_type_t type;
+    uint16_t long_press_time;
+    uint16_t short_press_time;
+    union
+    {
+        button_gpio_config_t gpio_button_config;
+    };
+} button_config_t;
+
+button_handle_t iot_button_create(const button_config_t *config);
+
+esp_err_t iot_button_delete(button_handle_t btn_handle);
+
+esp_err_t iot_button_register_cb(button_handle_t btn_handle, button_event_t event, button_cb_t cb, void *usr_data);
+
+esp_err_t iot_button_unregister_cb(button_handle_t btn_handle, button_event_t event);
+
+size_t iot_button_count_cb(button_handle_t btn_handle);
+
+button_event_t iot_button_get_event(button_handle_t btn_handle);
+
+#ifdef __cplusplus
+}
+#endif
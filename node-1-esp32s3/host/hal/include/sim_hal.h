@@ -0,0 +1,267 @@
+/**
+ * Simulated HAL control API for host builds
+ *
+ * The IDF headers in this directory are implemented on top of virtual hardware:
+ *  - I2C buses that account every transfer in simulated bus time, with virtual
+ *    devices attached by address (an SSD1306 and an FDC1004 model are provided)
+ *  - RMT TX channels that record the encoded frame and its on-wire duration
+ *  - SPI buses that do the same for the bytes shifted out on MOSI
+ *  - GPIO pins whose levels drive iot_button instances
+ *
+ * Bus and wire times are computed from the protocol, not measured, so they are
+ * reproducible between runs and machines. Wall clock time (esp_timer_get_time(),
+ * ticks) is real host time.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/i2c_master.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SIM_I2C_MAX_ADDRESS 0x80
+#define SIM_RMT_TX_CHANNELS 4       // ESP32-S3 has 4 RMT TX channels
+#define SIM_RMT_MAX_FRAME_LEN 4096  // Bytes recorded per transmission
+#define SIM_SPI_MAX_FRAME_LEN 32768 // Bytes recorded per SPI transmission
+
+/* ---------------------------------------------------------------------------
+ * Timing
+ * ------------------------------------------------------------------------- */
+
+/**
+ * @brief When enabled, I2C transfers and RMT transmissions also sleep for their simulated
+ * duration so that wall clock latencies resemble the target. Disabled by default.
+ */
+void sim_set_realtime(bool realtime);
+
+/* ---------------------------------------------------------------------------
+ * I2C
+ * ------------------------------------------------------------------------- */
+
+/**
+ * @brief A virtual I2C target. Embed as the first member of a device model.
+ *
+ * Each callback handles one transfer phase (between START/repeated START and STOP).
+ * Return ESP_OK to ACK, anything else is reported to the caller as the transfer result.
+ */
+typedef struct sim_i2c_device
+{
+    esp_err_t (*write)(struct sim_i2c_device *device, const uint8_t *data, size_t len);
+    esp_err_t (*read)(struct sim_i2c_device *device, uint8_t *data, size_t len);
+} sim_i2c_device_t;
+
+// Transfer accounting for one bus
+typedef struct sim_i2c_stats
+{
+    uint32_t transactions; // START ... STOP sequences, a write-read counts once
+    uint32_t nacks;        // Transfers to addresses with no device attached
+    uint64_t bytes;        // Payload bytes, excluding address bytes
+    uint64_t bus_time_ns;  // Simulated time the bus was busy
+} sim_i2c_stats_t;
+
+/**
+ * @brief Attaches a virtual device to a bus. The bus does not need to exist yet.
+ *
+ * @param port I2C port
+ * @param address 7 bit address
+ * @param device Device model, must outlive the attachment
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad port or address, ESP_ERR_INVALID_STATE if the address is taken
+ */
+esp_err_t sim_i2c_attach(i2c_port_t port, uint16_t address, sim_i2c_device_t *device);
+
+/**
+ * @brief Detaches the device at an address
+ */
+void sim_i2c_detach(i2c_port_t port, uint16_t address);
+
+/**
+ * @brief Copies the transfer accounting of a bus
+ */
+void sim_i2c_get_stats(i2c_port_t port, sim_i2c_stats_t *ret_stats);
+
+/**
+ * @brief Adds a synthetic latency to every transfer on a bus, uniform in min_us - max_us and
+ * repeatable between runs, to model driver / ISR latency or clock stretching. It is slept
+ * in wall clock time whether or not realtime mode is enabled, and not counted as bus time.
+ * 0, 0 (the default) disables it.
+ */
+void sim_i2c_set_latency(i2c_port_t port, uint32_t min_us, uint32_t max_us);
+
+/**
+ * @brief Zeroes the transfer accounting of a bus
+ */
+void sim_i2c_reset_stats(i2c_port_t port);
+
+/**
+ * @brief Simulated duration of one transfer phase: START, address byte, len data bytes
+ * (9 clocks each, including ACK) and STOP.
+ *
+ * @param scl_speed_hz SCL frequency
+ * @param len Data bytes
+ *
+ * @return Duration in nanoseconds
+ */
+uint64_t sim_i2c_transfer_time_ns(uint32_t scl_speed_hz, size_t len);
+
+/* ---------------------------------------------------------------------------
+ * Virtual SSD1306 (128x64, I2C)
+ * ------------------------------------------------------------------------- */
+
+typedef struct sim_ssd1306 *sim_ssd1306_handle_t;
+
+/**
+ * @brief Creates a virtual SSD1306 and attaches it to the bus
+ */
+esp_err_t sim_ssd1306_new(i2c_port_t port, uint16_t address, sim_ssd1306_handle_t *ret_display);
+
+/**
+ * @brief Detaches and frees a virtual SSD1306
+ */
+void sim_ssd1306_del(sim_ssd1306_handle_t display);
+
+/**
+ * @brief Display RAM, page-organised like the framebuffer: [page][column], bit 0 the top row
+ */
+const uint8_t (*sim_ssd1306_gddram(sim_ssd1306_handle_t display))[128];
+
+/**
+ * @brief Number of command and GDDRAM data bytes received since creation
+ */
+void sim_ssd1306_get_counts(sim_ssd1306_handle_t display, uint32_t *ret_command_bytes, uint32_t *ret_data_bytes);
+
+/**
+ * @brief Prints the display RAM as text, one character per pixel
+ */
+void sim_ssd1306_dump(sim_ssd1306_handle_t display, FILE *stream);
+
+/* ---------------------------------------------------------------------------
+ * Virtual FDC1004 (4 channel capacitance to digital converter)
+ * ------------------------------------------------------------------------- */
+
+typedef struct sim_fdc1004 *sim_fdc1004_handle_t;
+
+/**
+ * @brief Creates a virtual FDC1004 at its fixed address (0x50) and attaches it to the bus
+ */
+esp_err_t sim_fdc1004_new(i2c_port_t port, sim_fdc1004_handle_t *ret_sensor);
+
+/**
+ * @brief Detaches and frees a virtual FDC1004
+ */
+void sim_fdc1004_del(sim_fdc1004_handle_t sensor);
+
+/**
+ * @brief Sets the capacitance seen on an input
+ *
+ * @param sensor Virtual sensor
+ * @param cin Input, 0 - 3 for CIN1 - CIN4
+ * @param picofarads Capacitance in pF
+ */
+void sim_fdc1004_set_capacitance(sim_fdc1004_handle_t sensor, uint8_t cin, double picofarads);
+
+/**
+ * @brief Scales the conversion time of every rate, to model parts slower or faster than the
+ * datasheet figure (10 / 5 / 2.5 ms at 100 / 200 / 400 S/s). Defaults to 1.0.
+ *
+ * @param sensor Virtual sensor
+ * @param scale Conversion time multiplier, must be positive
+ */
+void sim_fdc1004_set_conversion_scale(sim_fdc1004_handle_t sensor, double scale);
+
+/**
+ * @brief Number of register reads and writes received since creation
+ */
+void sim_fdc1004_get_counts(sim_fdc1004_handle_t sensor, uint32_t *ret_reads, uint32_t *ret_writes);
+
+/* ---------------------------------------------------------------------------
+ * RMT
+ * ------------------------------------------------------------------------- */
+
+// Accounting for the RMT channel driving one GPIO
+typedef struct sim_rmt_stats
+{
+    uint32_t transmissions;
+    uint64_t bytes;       // Bytes given to bytes encoders
+    uint64_t symbols;     // RMT symbols produced
+    uint64_t wire_time_ns; // Simulated time on the wire
+    int64_t last_start_us; // esp_timer_get_time() when the last transmission went on the wire
+} sim_rmt_stats_t;
+
+/**
+ * @brief Bytes of the last transmission on the channel driving a GPIO
+ *
+ * @param gpio_num GPIO the channel drives
+ * @param ret_data Returned pointer to the recorded bytes, valid until the next transmission
+ * @param ret_len Returned number of bytes
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if no channel drives the GPIO
+ */
+esp_err_t sim_rmt_get_frame(gpio_num_t gpio_num, const uint8_t **ret_data, size_t *ret_len);
+
+/**
+ * @brief Accounting for the channel driving a GPIO
+ */
+esp_err_t sim_rmt_get_stats(gpio_num_t gpio_num, sim_rmt_stats_t *ret_stats);
+
+/**
+ * @brief Number of RMT TX channels currently allocated
+ */
+uint8_t sim_rmt_channels_in_use(void);
+
+/* ---------------------------------------------------------------------------
+ * SPI
+ * ------------------------------------------------------------------------- */
+
+// Accounting for the SPI device whose bus drives one MOSI GPIO
+typedef struct sim_spi_stats
+{
+    uint32_t transmissions;
+    uint64_t bytes;        // Bytes shifted out
+    uint64_t wire_time_ns; // Simulated time on the wire
+} sim_spi_stats_t;
+
+/**
+ * @brief Bytes of the last transmission on the bus driving a MOSI GPIO
+ *
+ * @param gpio_num MOSI GPIO of the bus
+ * @param ret_data Returned pointer to the recorded bytes, valid until the next transmission
+ * @param ret_len Returned number of bytes, at most SIM_SPI_MAX_FRAME_LEN
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if no device is on a bus driving the GPIO
+ */
+esp_err_t sim_spi_get_frame(gpio_num_t gpio_num, const uint8_t **ret_data, size_t *ret_len);
+
+/**
+ * @brief Accounting for the device on the bus driving a MOSI GPIO
+ */
+esp_err_t sim_spi_get_stats(gpio_num_t gpio_num, sim_spi_stats_t *ret_stats);
+
+/* ---------------------------------------------------------------------------
+ * GPIO
+ * ------------------------------------------------------------------------- */
+
+/**
+ * @brief Drives a GPIO from outside, as a button or external circuit would.
+ * Buttons on the pin fire their callbacks from the calling thread.
+ */
+void sim_gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+
+/**
+ * @brief Presses and releases the button on a GPIO
+ */
+void sim_gpio_click(gpio_num_t gpio_num);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,9 @@
+/**
+ * Host simulation of soc/soc_caps.h, the ESP32-S3 capabilities the libraries check
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#define SOC_RMT_TX_CANDIDATES_PER_GROUP 4 // See SIM_RMT_TX_CHANNELS
+#define SOC_RMT_SUPPORT_TX_SYNCHRO 1
@@ -0,0 +1,17 @@
+/**
+ * Host simulation of soc/spi_periph.h, the MOSI output signal of each SPI host only
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define SOC_SPI_PERIPH_NUM 3
+
+typedef struct
+{
+    uint32_t spid_out;
+} spi_signal_conn_t;
+
+extern const spi_signal_conn_t spi_periph_signal[SOC_SPI_PERIPH_NUM];
@@ -0,0 +1,117 @@
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sim_hal.h"
+#include "sim_internal.h"
+
+esp_log_level_t sim_log_level = ESP_LOG_INFO;
+
+static atomic_bool realtime = false;
+static pthread_mutex_t critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static int64_t monotonic_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int64_t start_us;
+
+__attribute__((constructor)) static void sim_core_init(void)
+{
+    start_us = monotonic_us();
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return monotonic_us() - start_us;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    sim_log_level = level;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:
+        return "ESP_ERR_INVALID_RESPONSE";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void sim_set_realtime(bool enable)
+{
+    atomic_store(&realtime, enable);
+}
+
+bool sim_realtime_enabled(void)
+{
+    return atomic_load(&realtime);
+}
+
+void sim_realtime_sleep_ns(uint64_t duration_ns)
+{
+    if (atomic_load(&realtime))
+        sim_sleep_ns(duration_ns);
+}
+
+void sim_sleep_ns(uint64_t duration_ns)
+{
+    if (duration_ns == 0)
+        return;
+    struct timespec duration = {
+        .tv_sec = duration_ns / 1000000000ULL,
+        .tv_nsec = duration_ns % 1000000000ULL,
+    };
+    nanosleep(&duration, NULL);
+}
+
+void sim_deadline(TickType_t ticks, struct timespec *ret_deadline)
+{
+    clock_gettime(CLOCK_MONOTONIC, ret_deadline);
+    uint64_t ns = (uint64_t)ret_deadline->tv_nsec + (uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ);
+    ret_deadline->tv_sec += ns / 1000000000ULL;
+    ret_deadline->tv_nsec = ns % 1000000000ULL;
+}
+
+void sim_enter_critical(void)
+{
+    pthread_mutex_lock(&critical_lock);
+}
+
+void sim_exit_critical(void)
+{
+    pthread_mutex_unlock(&critical_lock);
+}
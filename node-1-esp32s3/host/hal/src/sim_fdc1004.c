@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "sim_hal.h"
+
+#define SIM_FDC_TAG "sim_fdc1004"
+#define SIM_FDC_ADDRESS 0x50
+#define SIM_FDC_REGISTERS 0x15 // 0x00 - 0x14, plus the two ID registers below
+#define SIM_FDC_MANUFACTURER_ID_REG 0xFE
+#define SIM_FDC_DEVICE_ID_REG 0xFF
+#define SIM_FDC_MEASUREMENTS 4
+
+#define REG_CONF_MEAS1 0x08
+#define REG_FDC_CONF 0x0C
+#define REG_OFFSET_CAL1 0x0D
+#define REG_GAIN_CAL1 0x11
+
+#define FDC_CONF_RESET 0x8000
+#define FDC_CONF_REPEAT 0x0100
+#define FDC_CONF_MEAS_SHIFT 4 // MEAS_1 is bit 7, MEAS_4 bit 4
+#define FDC_CONF_DONE_MASK 0x000F // DONE_1 is bit 3, DONE_4 bit 0
+
+#define CAPDAC_STEP_PF 3.125
+#define CHB_CAPDAC 0x4
+
+// Register file plus conversion sequencing. Conversions are evaluated lazily from the host clock.
+struct sim_fdc1004
+{
+    sim_i2c_device_t device; // Must be first
+    i2c_port_t port;
+
+    uint16_t registers[SIM_FDC_REGISTERS];
+    uint8_t pointer;
+    double capacitance_pf[4]; // CIN1 - CIN4
+    double conversion_scale;  // Conversion time relative to the datasheet figure
+
+    int64_t trigger_us;   // When the current conversion sequence started
+    uint64_t processed;   // Conversions of the sequence already latched
+    uint8_t sequence[SIM_FDC_MEASUREMENTS];
+    uint8_t sequence_len;
+
+    uint32_t reads;
+    uint32_t writes;
+};
+
+static void reset_registers(struct sim_fdc1004 *sensor)
+{
+    memset(sensor->registers, 0, sizeof(sensor->registers));
+    for (uint8_t meas = 0; meas < SIM_FDC_MEASUREMENTS; meas++)
+    {
+        sensor->registers[REG_CONF_MEAS1 + meas] = (uint16_t)(meas << 13) | 0x1C00; // CHA = CINn, CHB disabled
+        sensor->registers[REG_GAIN_CAL1 + meas] = 0x4000;                            // Gain 1.0
+    }
+    sensor->sequence_len = 0;
+    sensor->processed = 0;
+}
+
+static uint32_t conversion_period_us(const struct sim_fdc1004 *sensor, uint16_t fdc_conf)
+{
+    uint32_t period_us;
+    switch ((fdc_conf >> 10) & 0x3)
+    {
+    case 0x2:
+        period_us = 1000000 / 200;
+        break;
+    case 0x3:
+        period_us = 1000000 / 400;
+        break;
+    default: // 0x1 is 100 S/s, 0x0 is reserved and treated the same
+        period_us = 1000000 / 100;
+        break;
+    }
+    return (uint32_t)(period_us * sensor->conversion_scale);
+}
+
+// Converts one measurement with the current inputs and its configuration registers
+static void convert(struct sim_fdc1004 *sensor, uint8_t meas)
+{
+    uint16_t conf = sensor->registers[REG_CONF_MEAS1 + meas];
+    uint8_t cha = (conf >> 13) & 0x7;
+    uint8_t chb = (conf >> 10) & 0x7;
+    uint8_t capdac = (conf >> 5) & 0x1F;
+
+    double value = cha < 4 ? sensor->capacitance_pf[cha] : 0;
+    if (chb == CHB_CAPDAC)
+        value -= capdac * CAPDAC_STEP_PF;
+    else if (chb < 4)
+        value -= sensor->capacitance_pf[chb];
+
+    int16_t offset = (int16_t)sensor->registers[REG_OFFSET_CAL1 + meas]; // 5.11 fixed point pF
+    double gain = sensor->registers[REG_GAIN_CAL1 + meas] / 16384.0;     // 2.14 fixed point
+    value = (value + offset / 2048.0) * gain;
+
+    double scaled = round(value * (1 << 19));
+    int32_t code = scaled > 0x7FFFFF ? 0x7FFFFF : scaled < -0x800000 ? -0x800000 : (int32_t)scaled;
+    sensor->registers[meas * 2] = (uint16_t)((uint32_t)code >> 8);
+    sensor->registers[meas * 2 + 1] = (uint16_t)((code & 0xFF) << 8);
+    sensor->registers[REG_FDC_CONF] |= 0x8 >> meas;
+}
+
+// Latches every conversion that has finished since the last access
+static void advance(struct sim_fdc1004 *sensor)
+{
+    if (sensor->sequence_len == 0)
+        return;
+
+    uint16_t fdc_conf = sensor->registers[REG_FDC_CONF];
+    uint64_t finished = (uint64_t)(esp_timer_get_time() - sensor->trigger_us) / conversion_period_us(sensor, fdc_conf);
+    if (!(fdc_conf & FDC_CONF_REPEAT) && finished > sensor->sequence_len)
+        finished = sensor->sequence_len;
+    // Only the latest result of each measurement is visible, skip older rounds
+    if (finished - sensor->processed > sensor->sequence_len)
+        sensor->processed = finished - sensor->sequence_len;
+
+    for (; sensor->processed < finished; sensor->processed++)
+        convert(sensor, sensor->sequence[sensor->processed % sensor->sequence_len]);
+}
+
+static void write_fdc_conf(struct sim_fdc1004 *sensor, uint16_t value)
+{
+    if (value & FDC_CONF_RESET)
+    {
+        reset_registers(sensor);
+        return;
+    }
+
+    // DONE bits are read only, a new configuration restarts the sequence
+    sensor->registers[REG_FDC_CONF] = value & ~FDC_CONF_DONE_MASK;
+    sensor->sequence_len = 0;
+    sensor->processed = 0;
+    for (uint8_t meas = 0; meas < SIM_FDC_MEASUREMENTS; meas++)
+    {
+        if (value & (0x80 >> meas))
+            sensor->sequence[sensor->sequence_len++] = meas;
+    }
+    sensor->trigger_us = esp_timer_get_time();
+}
+
+static uint16_t *register_at(struct sim_fdc1004 *sensor, uint8_t address)
+{
+    static const uint16_t manufacturer_id = 0x5449; // "TI"
+    static const uint16_t device_id = 0x1004;
+    if (address < SIM_FDC_REGISTERS)
+        return &sensor->registers[address];
+    if (address == SIM_FDC_MANUFACTURER_ID_REG)
+        return (uint16_t *)&manufacturer_id;
+    if (address == SIM_FDC_DEVICE_ID_REG)
+        return (uint16_t *)&device_id;
+    return NULL;
+}
+
+// Pointer byte, optionally followed by a 16 bit register value (MSB first)
+static esp_err_t sim_fdc1004_write(sim_i2c_device_t *device, const uint8_t *data, size_t len)
+{
+    struct sim_fdc1004 *sensor = (struct sim_fdc1004 *)device;
+    advance(sensor);
+
+    if (register_at(sensor, data[0]) == NULL)
+        return ESP_ERR_INVALID_STATE; // Invalid pointer is NACKed
+    sensor->pointer = data[0];
+    if (len < 3)
+        return ESP_OK;
+
+    sensor->writes++;
+    uint16_t value = ((uint16_t)data[1] << 8) | data[2];
+    if (sensor->pointer == REG_FDC_CONF)
+        write_fdc_conf(sensor, value);
+    else if (sensor->pointer >= REG_CONF_MEAS1 && sensor->pointer < SIM_FDC_REGISTERS)
+        sensor->registers[sensor->pointer] = value; // Results and IDs are read only
+    return ESP_OK;
+}
+
+// Returns the register at the pointer. The pointer does not auto-increment.
+static esp_err_t sim_fdc1004_read(sim_i2c_device_t *device, uint8_t *data, size_t len)
+{
+    struct sim_fdc1004 *sensor = (struct sim_fdc1004 *)device;
+    advance(sensor);
+
+    sensor->reads++;
+    uint16_t value = *register_at(sensor, sensor->pointer);
+    for (size_t i = 0; i < len; i++)
+        data[i] = i % 2 == 0 ? (uint8_t)(value >> 8) : (uint8_t)value;
+
+    // Reading a result MSB clears its DONE bit
+    if (sensor->pointer < REG_CONF_MEAS1 && sensor->pointer % 2 == 0)
+        sensor->registers[REG_FDC_CONF] &= ~(0x8 >> (sensor->pointer / 2));
+    return ESP_OK;
+}
+
+esp_err_t sim_fdc1004_new(i2c_port_t port, sim_fdc1004_handle_t *ret_sensor)
+{
+    struct sim_fdc1004 *sensor = calloc(1, sizeof(struct sim_fdc1004));
+    ESP_RETURN_ON_FALSE(sensor != NULL, ESP_ERR_NO_MEM, SIM_FDC_TAG, "No memory for virtual FDC1004");
+
+    sensor->device.write = sim_fdc1004_write;
+    sensor->device.read = sim_fdc1004_read;
+    sensor->port = port;
+    sensor->conversion_scale = 1.0;
+    reset_registers(sensor);
+
+    esp_err_t esp_rc = sim_i2c_attach(port, SIM_FDC_ADDRESS, &sensor->device);
+    if (esp_rc != ESP_OK)
+    {
+        free(sensor);
+        ESP_LOGE(SIM_FDC_TAG, "Address 0x%02X is taken", SIM_FDC_ADDRESS);
+        return esp_rc;
+    }
+    *ret_sensor = sensor;
+    return ESP_OK;
+}
+
+void sim_fdc1004_del(sim_fdc1004_handle_t sensor)
+{
+    sim_i2c_detach(sensor->port, SIM_FDC_ADDRESS);
+    free(sensor);
+}
+
+void sim_fdc1004_set_capacitance(sim_fdc1004_handle_t sensor, uint8_t cin, double picofarads)
+{
+    if (cin < 4)
+        sensor->capacitance_pf[cin] = picofarads;
+}
+
+void sim_fdc1004_set_conversion_scale(sim_fdc1004_handle_t sensor, double scale)
+{
+    if (scale > 0)
+        sensor->conversion_scale = scale;
+}
+
+void sim_fdc1004_get_counts(sim_fdc1004_handle_t sensor, uint32_t *ret_reads, uint32_t *ret_writes)
+{
+    if (ret_reads != NULL)
+        *ret_reads = sensor->reads;
+    if (ret_writes != NULL)
+        *ret_writes = sensor->writes;
+}
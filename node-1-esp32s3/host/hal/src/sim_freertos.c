@@ -0,0 +1,455 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "sim_internal.h"
+
+#define SIM_RTOS_TAG "sim_freertos"
+#define SIM_TASK_NAME_LEN 16
+
+struct tskTaskControlBlock
+{
+    pthread_t thread;
+    TaskFunction_t function;
+    void *parameter;
+    char name[SIM_TASK_NAME_LEN];
+    UBaseType_t priority;
+    uint32_t stack_depth;
+
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct QueueDefinition
+{
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    UBaseType_t length;
+    UBaseType_t item_size; // 0 for semaphores
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *storage;
+};
+
+static __thread TaskHandle_t current_task;
+
+static void init_cond(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void unlock_mutex(void *mutex)
+{
+    pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+/**
+ * @brief Waits on cond until the deadline. portMAX_DELAY waits forever.
+ *
+ * @return false on timeout
+ */
+static bool wait_cond(pthread_cond_t *cond, pthread_mutex_t *mutex, TickType_t ticks, const struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY)
+        return pthread_cond_wait(cond, mutex) == 0;
+    return pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+}
+
+static TaskHandle_t new_tcb(const char *name, UBaseType_t priority, uint32_t stack_depth)
+{
+    TaskHandle_t task = calloc(1, sizeof(struct tskTaskControlBlock));
+    if (task == NULL)
+        return NULL;
+    strncpy(task->name, name != NULL ? name : "", SIM_TASK_NAME_LEN - 1);
+    task->priority = priority;
+    task->stack_depth = stack_depth;
+    pthread_mutex_init(&task->lock, NULL);
+    init_cond(&task->notified);
+    return task;
+}
+
+static void free_tcb(TaskHandle_t task)
+{
+    pthread_mutex_destroy(&task->lock);
+    pthread_cond_destroy(&task->notified);
+    free(task);
+}
+
+static void *task_entry(void *arg)
+{
+    current_task = (TaskHandle_t)arg;
+    current_task->function(current_task->parameter);
+
+    // FreeRTOS tasks must never return
+    ESP_LOGE(SIM_RTOS_TAG, "Task %s returned from its function", current_task->name);
+    abort();
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Tasks
+ * ------------------------------------------------------------------------- */
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, const uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask, const BaseType_t xCoreID)
+{
+    (void)xCoreID;
+    TaskHandle_t task = new_tcb(pcName, uxPriority, usStackDepth);
+    if (task == NULL)
+        return pdFAIL;
+    task->function = pxTaskCode;
+    task->parameter = pvParameters;
+
+    // Publish the handle before the task runs, as FreeRTOS does
+    if (pxCreatedTask != NULL)
+        *pxCreatedTask = task;
+
+    if (pthread_create(&task->thread, NULL, task_entry, task) != 0)
+    {
+        free_tcb(task);
+        if (pxCreatedTask != NULL)
+            *pxCreatedTask = NULL;
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (xTaskToDelete == NULL || xTaskToDelete == self)
+    {
+        pthread_detach(pthread_self());
+        current_task = NULL;
+        free_tcb(self);
+        pthread_exit(NULL);
+    }
+
+    // Other tasks are cancelled at their next blocking call
+    pthread_cancel(xTaskToDelete->thread);
+    pthread_join(xTaskToDelete->thread, NULL);
+    free_tcb(xTaskToDelete);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    if (xTicksToDelay == 0)
+    {
+        sched_yield();
+        pthread_testcancel();
+        return;
+    }
+    struct timespec deadline;
+    sim_deadline(xTicksToDelay, &deadline);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        ;
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+    *pxPreviousWakeTime = wake;
+
+    // Same overflow-safe test as FreeRTOS: has the wake time already passed?
+    if ((TickType_t)(wake - now) == 0 || (TickType_t)(wake - now) > xTimeIncrement)
+    {
+        pthread_testcancel();
+        return pdFALSE;
+    }
+    vTaskDelay(wake - now);
+    return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // Threads not created through xTaskCreate (the main thread) are adopted on first use
+    if (current_task == NULL)
+    {
+        current_task = new_tcb("main", 1, 0);
+        if (current_task == NULL)
+            abort();
+        current_task->thread = pthread_self();
+    }
+    return current_task;
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+    return (xTaskToQuery != NULL ? xTaskToQuery : xTaskGetCurrentTaskHandle())->name;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask)
+{
+    return (xTask != NULL ? xTask : xTaskGetCurrentTaskHandle())->priority;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+    return (xTask != NULL ? xTask : xTaskGetCurrentTaskHandle())->stack_depth;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction, uint32_t *pulPreviousNotificationValue)
+{
+    BaseType_t result = pdPASS;
+
+    pthread_mutex_lock(&xTaskToNotify->lock);
+    if (pulPreviousNotificationValue != NULL)
+        *pulPreviousNotificationValue = xTaskToNotify->notify_value;
+
+    switch (eAction)
+    {
+    case eSetBits:
+        xTaskToNotify->notify_value |= ulValue;
+        break;
+    case eIncrement:
+        xTaskToNotify->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+        xTaskToNotify->notify_value = ulValue;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (xTaskToNotify->notify_pending)
+            result = pdFAIL;
+        else
+            xTaskToNotify->notify_value = ulValue;
+        break;
+    case eNoAction:
+        break;
+    }
+
+    if (result == pdPASS)
+    {
+        xTaskToNotify->notify_pending = true;
+        pthread_cond_broadcast(&xTaskToNotify->notified);
+    }
+    pthread_mutex_unlock(&xTaskToNotify->lock);
+    return result;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    sim_deadline(xTicksToWait, &deadline);
+
+    pthread_mutex_lock(&self->lock);
+    pthread_cleanup_push(unlock_mutex, &self->lock);
+    while (self->notify_value == 0 && xTicksToWait != 0)
+    {
+        if (!wait_cond(&self->notified, &self->lock, xTicksToWait, &deadline))
+            break;
+    }
+    pthread_cleanup_pop(0);
+
+    uint32_t value = self->notify_value;
+    if (value != 0)
+        self->notify_value = xClearCountOnExit ? 0 : value - 1;
+    self->notify_pending = false;
+    pthread_mutex_unlock(&self->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue, TickType_t xTicksToWait)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    sim_deadline(xTicksToWait, &deadline);
+
+    pthread_mutex_lock(&self->lock);
+    if (!self->notify_pending)
+        self->notify_value &= ~ulBitsToClearOnEntry;
+
+    pthread_cleanup_push(unlock_mutex, &self->lock);
+    while (!self->notify_pending && xTicksToWait != 0)
+    {
+        if (!wait_cond(&self->notified, &self->lock, xTicksToWait, &deadline))
+            break;
+    }
+    pthread_cleanup_pop(0);
+
+    BaseType_t result = self->notify_pending ? pdTRUE : pdFALSE;
+    if (pulNotificationValue != NULL)
+        *pulNotificationValue = self->notify_value;
+    if (result == pdTRUE)
+        self->notify_value &= ~ulBitsToClearOnExit;
+    self->notify_pending = false;
+    pthread_mutex_unlock(&self->lock);
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * Queues and semaphores
+ * ------------------------------------------------------------------------- */
+
+static QueueHandle_t queue_create(UBaseType_t length, UBaseType_t item_size, UBaseType_t initial_count)
+{
+    if (length == 0)
+        return NULL;
+    QueueHandle_t queue = calloc(1, sizeof(struct QueueDefinition));
+    if (queue == NULL)
+        return NULL;
+    if (item_size > 0)
+    {
+        queue->storage = malloc((size_t)length * item_size);
+        if (queue->storage == NULL)
+        {
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->count = initial_count;
+    pthread_mutex_init(&queue->lock, NULL);
+    init_cond(&queue->not_empty);
+    init_cond(&queue->not_full);
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    return queue_create(uxQueueLength, uxItemSize, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    return queue_create(uxMaxCount, 0, uxInitialCount);
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    pthread_mutex_destroy(&xQueue->lock);
+    pthread_cond_destroy(&xQueue->not_empty);
+    pthread_cond_destroy(&xQueue->not_full);
+    free(xQueue->storage);
+    free(xQueue);
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void *const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition)
+{
+    struct timespec deadline;
+    sim_deadline(xTicksToWait, &deadline);
+
+    pthread_mutex_lock(&xQueue->lock);
+    pthread_cleanup_push(unlock_mutex, &xQueue->lock);
+    while (xQueue->count == xQueue->length && xCopyPosition != queueOVERWRITE && xTicksToWait != 0)
+    {
+        if (!wait_cond(&xQueue->not_full, &xQueue->lock, xTicksToWait, &deadline))
+            break;
+    }
+    pthread_cleanup_pop(0);
+
+    if (xQueue->count == xQueue->length && xCopyPosition != queueOVERWRITE)
+    {
+        pthread_mutex_unlock(&xQueue->lock);
+        return errQUEUE_FULL;
+    }
+
+    if (xQueue->item_size > 0)
+    {
+        UBaseType_t slot;
+        if (xCopyPosition == queueOVERWRITE && xQueue->count == xQueue->length)
+            slot = xQueue->head; // Length 1 queue, replace the item
+        else if (xCopyPosition == queueSEND_TO_FRONT)
+            slot = xQueue->head = (xQueue->head + xQueue->length - 1) % xQueue->length;
+        else
+            slot = (xQueue->head + xQueue->count) % xQueue->length;
+        memcpy(xQueue->storage + (size_t)slot * xQueue->item_size, pvItemToQueue, xQueue->item_size);
+    }
+    if (xQueue->count < xQueue->length)
+        xQueue->count++;
+
+    pthread_cond_signal(&xQueue->not_empty);
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+static BaseType_t queue_receive(QueueHandle_t xQueue, void *const pvBuffer, TickType_t xTicksToWait, bool remove)
+{
+    struct timespec deadline;
+    sim_deadline(xTicksToWait, &deadline);
+
+    pthread_mutex_lock(&xQueue->lock);
+    pthread_cleanup_push(unlock_mutex, &xQueue->lock);
+    while (xQueue->count == 0 && xTicksToWait != 0)
+    {
+        if (!wait_cond(&xQueue->not_empty, &xQueue->lock, xTicksToWait, &deadline))
+            break;
+    }
+    pthread_cleanup_pop(0);
+
+    if (xQueue->count == 0)
+    {
+        pthread_mutex_unlock(&xQueue->lock);
+        return errQUEUE_EMPTY;
+    }
+
+    if (xQueue->item_size > 0 && pvBuffer != NULL)
+        memcpy(pvBuffer, xQueue->storage + (size_t)xQueue->head * xQueue->item_size, xQueue->item_size);
+    if (remove)
+    {
+        xQueue->head = (xQueue->head + 1) % xQueue->length;
+        xQueue->count--;
+        pthread_cond_signal(&xQueue->not_full);
+    }
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *const pvBuffer, TickType_t xTicksToWait)
+{
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *const pvBuffer, TickType_t xTicksToWait)
+{
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    xQueue->count = 0;
+    xQueue->head = 0;
+    pthread_cond_broadcast(&xQueue->not_full);
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    UBaseType_t count = xQueue->count;
+    pthread_mutex_unlock(&xQueue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue)
+{
+    return xQueue->length - uxQueueMessagesWaiting(xQueue);
+}
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "driver/gpio.h"
+#include "iot_button.h"
+#include "sim_hal.h"
+
+#define SIM_GPIO_TAG "sim_gpio"
+#define SIM_BUTTON_MAX_CBS 8 // Callbacks per event
+
+typedef struct
+{
+    button_cb_t cb;
+    void *usr_data;
+} sim_button_cb_t;
+
+typedef struct sim_button
+{
+    gpio_num_t gpio_num;
+    uint8_t active_level;
+    bool pressed;
+    button_event_t event;
+    sim_button_cb_t cbs[BUTTON_EVENT_MAX][SIM_BUTTON_MAX_CBS];
+    uint8_t cb_count[BUTTON_EVENT_MAX];
+    struct sim_button *next;
+} sim_button_t;
+
+static pthread_mutex_t gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t levels[GPIO_NUM_MAX];
+static sim_button_t *buttons;
+
+static bool valid_gpio(gpio_num_t gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (!valid_gpio(gpio_num))
+        return 0;
+    pthread_mutex_lock(&gpio_lock);
+    int level = levels[gpio_num];
+    pthread_mutex_unlock(&gpio_lock);
+    return level;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    ESP_RETURN_ON_FALSE(valid_gpio(gpio_num), ESP_ERR_INVALID_ARG, SIM_GPIO_TAG, "GPIO number error");
+    pthread_mutex_lock(&gpio_lock);
+    levels[gpio_num] = level ? 1 : 0;
+    pthread_mutex_unlock(&gpio_lock);
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------------------
+ * Buttons
+ * ------------------------------------------------------------------------- */
+
+button_handle_t iot_button_create(const button_config_t *config)
+{
+    if (config == NULL || config->type != BUTTON_TYPE_GPIO || !valid_gpio((gpio_num_t)config->gpio_button_config.gpio_num))
+    {
+        ESP_LOGE(SIM_GPIO_TAG, "Only GPIO buttons are simulated");
+        return NULL;
+    }
+
+    sim_button_t *button = calloc(1, sizeof(sim_button_t));
+    if (button == NULL)
+        return NULL;
+    button->gpio_num = (gpio_num_t)config->gpio_button_config.gpio_num;
+    button->active_level = config->gpio_button_config.active_level;
+    button->event = BUTTON_NONE_PRESS;
+
+    // Pull the pin to its idle level, as the driver's internal pull resistor would
+    pthread_mutex_lock(&gpio_lock);
+    levels[button->gpio_num] = !button->active_level;
+    button->next = buttons;
+    buttons = button;
+    pthread_mutex_unlock(&gpio_lock);
+    return button;
+}
+
+esp_err_t iot_button_delete(button_handle_t btn_handle)
+{
+    ESP_RETURN_ON_FALSE(btn_handle != NULL, ESP_ERR_INVALID_ARG, SIM_GPIO_TAG, "Pointer of handle is invalid");
+    pthread_mutex_lock(&gpio_lock);
+    for (sim_button_t **link = &buttons; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == btn_handle)
+        {
+            *link = (*link)->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gpio_lock);
+    free(btn_handle);
+    return ESP_OK;
+}
+
+esp_err_t iot_button_register_cb(button_handle_t btn_handle, button_event_t event, button_cb_t cb, void *usr_data)
+{
+    ESP_RETURN_ON_FALSE(btn_handle != NULL && cb != NULL && event < BUTTON_EVENT_MAX, ESP_ERR_INVALID_ARG, SIM_GPIO_TAG, "Invalid argument");
+    sim_button_t *button = (sim_button_t *)btn_handle;
+
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&gpio_lock);
+    if (button->cb_count[event] < SIM_BUTTON_MAX_CBS)
+    {
+        button->cbs[event][button->cb_count[event]].cb = cb;
+        button->cbs[event][button->cb_count[event]].usr_data = usr_data;
+        button->cb_count[event]++;
+    }
+    else
+        esp_rc = ESP_ERR_NO_MEM;
+    pthread_mutex_unlock(&gpio_lock);
+    return esp_rc;
+}
+
+esp_err_t iot_button_unregister_cb(button_handle_t btn_handle, button_event_t event)
+{
+    ESP_RETURN_ON_FALSE(btn_handle != NULL && event < BUTTON_EVENT_MAX, ESP_ERR_INVALID_ARG, SIM_GPIO_TAG, "Invalid argument");
+    sim_button_t *button = (sim_button_t *)btn_handle;
+
+    pthread_mutex_lock(&gpio_lock);
+    bool registered = button->cb_count[event] > 0;
+    button->cb_count[event] = 0;
+    pthread_mutex_unlock(&gpio_lock);
+    ESP_RETURN_ON_FALSE(registered, ESP_ERR_INVALID_STATE, SIM_GPIO_TAG, "No callbacks registered for event %d", event);
+    return ESP_OK;
+}
+
+size_t iot_button_count_cb(button_handle_t btn_handle)
+{
+    if (btn_handle == NULL)
+        return 0;
+    sim_button_t *button = (sim_button_t *)btn_handle;
+    size_t count = 0;
+    pthread_mutex_lock(&gpio_lock);
+    for (uint8_t event = 0; event < BUTTON_EVENT_MAX; event++)
+        count += button->cb_count[event];
+    pthread_mutex_unlock(&gpio_lock);
+    return count;
+}
+
+button_event_t iot_button_get_event(button_handle_t btn_handle)
+{
+    if (btn_handle == NULL)
+        return BUTTON_NONE_PRESS;
+    pthread_mutex_lock(&gpio_lock);
+    button_event_t event = ((sim_button_t *)btn_handle)->event;
+    pthread_mutex_unlock(&gpio_lock);
+    return event;
+}
+
+/* ---------------------------------------------------------------------------
+ * Simulation control
+ * ------------------------------------------------------------------------- */
+
+// Callbacks are copied out under the lock and run without it, so they may (un)register callbacks
+typedef struct
+{
+    button_handle_t button;
+    sim_button_cb_t cbs[SIM_BUTTON_MAX_CBS];
+    uint8_t count;
+} pending_event_t;
+
+static void collect_event(sim_button_t *button, button_event_t event, pending_event_t *pending)
+{
+    button->event = event;
+    pending->button = button;
+    pending->count = button->cb_count[event];
+    memcpy(pending->cbs, button->cbs[event], pending->count * sizeof(sim_button_cb_t));
+}
+
+static void fire(const pending_event_t *pending)
+{
+    for (uint8_t i = 0; i < pending->count; i++)
+        pending->cbs[i].cb(pending->button, pending->cbs[i].usr_data);
+}
+
+void sim_gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!valid_gpio(gpio_num))
+        return;
+
+    // One button per pin is plenty for the boards this simulates
+    pending_event_t first = {0}, second = {0};
+    pthread_mutex_lock(&gpio_lock);
+    levels[gpio_num] = level ? 1 : 0;
+    for (sim_button_t *button = buttons; button != NULL; button = button->next)
+    {
+        if (button->gpio_num != gpio_num)
+            continue;
+        bool pressed = levels[gpio_num] == button->active_level;
+        if (pressed == button->pressed)
+            break;
+        button->pressed = pressed;
+        if (pressed)
+            collect_event(button, BUTTON_PRESS_DOWN, &first);
+        else
+        {
+            collect_event(button, BUTTON_PRESS_UP, &first);
+            collect_event(button, BUTTON_SINGLE_CLICK, &second);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&gpio_lock);
+
+    fire(&first);
+    fire(&second);
+}
+
+void sim_gpio_click(gpio_num_t gpio_num)
+{
+    uint8_t active_level = 0;
+    pthread_mutex_lock(&gpio_lock);
+    for (sim_button_t *button = buttons; button != NULL; button = button->next)
+    {
+        if (button->gpio_num == gpio_num)
+            active_level = button->active_level;
+    }
+    pthread_mutex_unlock(&gpio_lock);
+
+    sim_gpio_set_level(gpio_num, active_level);
+    sim_gpio_set_level(gpio_num, !active_level);
+}
@@ -0,0 +1,250 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "driver/i2c_master.h"
+#include "sim_hal.h"
+#include "sim_internal.h"
+
+#define SIM_I2C_TAG "sim_i2c"
+
+struct i2c_master_bus_t
+{
+    i2c_port_t port;
+};
+
+struct i2c_master_dev_t
+{
+    i2c_port_t port;
+    uint16_t address;
+    uint32_t scl_speed_hz;
+};
+
+// One simulated bus. Transfers hold the lock, so they are serialised as on a real bus.
+typedef struct sim_i2c_port
+{
+    pthread_mutex_t lock;
+    struct i2c_master_bus_t *bus; // NULL until i2c_new_master_bus()
+    sim_i2c_device_t *devices[SIM_I2C_MAX_ADDRESS];
+    sim_i2c_stats_t stats;
+    uint32_t latency_min_us; // Synthetic latency added to every transfer
+    uint32_t latency_max_us;
+    uint32_t latency_rng;    // xorshift32 state, so runs are repeatable
+} sim_i2c_port_t;
+
+static sim_i2c_port_t ports[I2C_NUM_MAX] = {
+    {.lock = PTHREAD_MUTEX_INITIALIZER, .latency_rng = 1},
+    {.lock = PTHREAD_MUTEX_INITIALIZER, .latency_rng = 1},
+};
+
+// Next synthetic latency of a bus, called with its lock held
+static uint64_t next_latency_ns(sim_i2c_port_t *bus)
+{
+    if (bus->latency_max_us == 0)
+        return 0;
+    uint32_t x = bus->latency_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bus->latency_rng = x;
+    uint32_t span = bus->latency_max_us - bus->latency_min_us + 1;
+    return (uint64_t)(bus->latency_min_us + x % span) * 1000;
+}
+
+uint64_t sim_i2c_transfer_time_ns(uint32_t scl_speed_hz, size_t len)
+{
+    if (scl_speed_hz == 0)
+        return 0;
+    // START and STOP are about a clock each, every byte (address included) is 8 bits plus ACK
+    uint64_t clocks = 2 + 9 * (1 + (uint64_t)len);
+    return clocks * 1000000000ULL / scl_speed_hz;
+}
+
+esp_err_t sim_i2c_attach(i2c_port_t port, uint16_t address, sim_i2c_device_t *device)
+{
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX && address < SIM_I2C_MAX_ADDRESS && device != NULL,
+                        ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid attachment");
+
+    sim_i2c_port_t *bus = &ports[port];
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&bus->lock);
+    if (bus->devices[address] != NULL)
+        esp_rc = ESP_ERR_INVALID_STATE;
+    else
+        bus->devices[address] = device;
+    pthread_mutex_unlock(&bus->lock);
+    return esp_rc;
+}
+
+void sim_i2c_detach(i2c_port_t port, uint16_t address)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || address >= SIM_I2C_MAX_ADDRESS)
+        return;
+    pthread_mutex_lock(&ports[port].lock);
+    ports[port].devices[address] = NULL;
+    pthread_mutex_unlock(&ports[port].lock);
+}
+
+void sim_i2c_get_stats(i2c_port_t port, sim_i2c_stats_t *ret_stats)
+{
+    pthread_mutex_lock(&ports[port].lock);
+    *ret_stats = ports[port].stats;
+    pthread_mutex_unlock(&ports[port].lock);
+}
+
+void sim_i2c_set_latency(i2c_port_t port, uint32_t min_us, uint32_t max_us)
+{
+    if (port < 0 || port >= I2C_NUM_MAX)
+        return;
+    pthread_mutex_lock(&ports[port].lock);
+    ports[port].latency_min_us = min_us < max_us ? min_us : max_us;
+    ports[port].latency_max_us = max_us;
+    ports[port].latency_rng = 1;
+    pthread_mutex_unlock(&ports[port].lock);
+}
+
+void sim_i2c_reset_stats(i2c_port_t port)
+{
+    pthread_mutex_lock(&ports[port].lock);
+    memset(&ports[port].stats, 0, sizeof(sim_i2c_stats_t));
+    pthread_mutex_unlock(&ports[port].lock);
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle)
+{
+    ESP_RETURN_ON_FALSE(bus_config != NULL && ret_bus_handle != NULL, ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid argument");
+    i2c_port_t port = bus_config->i2c_port;
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid I2C port %d", port);
+
+    sim_i2c_port_t *bus = &ports[port];
+    pthread_mutex_lock(&bus->lock);
+    if (bus->bus != NULL)
+    {
+        pthread_mutex_unlock(&bus->lock);
+        ESP_LOGE(SIM_I2C_TAG, "I2C bus %d already acquired", port);
+        return ESP_ERR_INVALID_STATE;
+    }
+    bus->bus = calloc(1, sizeof(struct i2c_master_bus_t));
+    if (bus->bus != NULL)
+        bus->bus->port = port;
+    *ret_bus_handle = bus->bus;
+    pthread_mutex_unlock(&bus->lock);
+    return *ret_bus_handle != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle)
+{
+    ESP_RETURN_ON_FALSE(bus_handle != NULL, ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid argument");
+    sim_i2c_port_t *bus = &ports[bus_handle->port];
+    pthread_mutex_lock(&bus->lock);
+    bus->bus = NULL;
+    pthread_mutex_unlock(&bus->lock);
+    free(bus_handle);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config, i2c_master_dev_handle_t *ret_handle)
+{
+    ESP_RETURN_ON_FALSE(bus_handle != NULL && dev_config != NULL && ret_handle != NULL, ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(dev_config->dev_addr_length == I2C_ADDR_BIT_LEN_7 && dev_config->device_address < SIM_I2C_MAX_ADDRESS,
+                        ESP_ERR_NOT_SUPPORTED, SIM_I2C_TAG, "Only 7 bit addresses are simulated");
+
+    i2c_master_dev_handle_t dev = calloc(1, sizeof(struct i2c_master_dev_t));
+    ESP_RETURN_ON_FALSE(dev != NULL, ESP_ERR_NO_MEM, SIM_I2C_TAG, "No memory for I2C device");
+    dev->port = bus_handle->port;
+    dev->address = dev_config->device_address;
+    dev->scl_speed_hz = dev_config->scl_speed_hz;
+    *ret_handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid argument");
+    free(handle);
+    return ESP_OK;
+}
+
+/**
+ * @brief Runs one transaction: an optional write phase then an optional read phase
+ * after a repeated START. Accounting and realtime sleep cover both phases, a repeated
+ * START is costed like the STOP it replaces. Synthetic latency is slept on top, outside
+ * the accounting.
+ */
+static esp_err_t sim_i2c_transfer(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size,
+                                  uint8_t *read_buffer, size_t read_size)
+{
+    ESP_RETURN_ON_FALSE(dev != NULL, ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid device handle");
+    sim_i2c_port_t *bus = &ports[dev->port];
+    esp_err_t esp_rc = ESP_OK;
+    uint64_t duration_ns = 0;
+
+    pthread_mutex_lock(&bus->lock);
+    uint64_t latency_ns = next_latency_ns(bus);
+    sim_i2c_device_t *device = bus->devices[dev->address];
+    bus->stats.transactions++;
+    if (device == NULL)
+    {
+        // Address byte NACKed, the master gives up after it
+        bus->stats.nacks++;
+        duration_ns = sim_i2c_transfer_time_ns(dev->scl_speed_hz, 0);
+        esp_rc = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        if (write_size > 0)
+        {
+            esp_rc = device->write != NULL ? device->write(device, write_buffer, write_size) : ESP_ERR_NOT_SUPPORTED;
+            duration_ns += sim_i2c_transfer_time_ns(dev->scl_speed_hz, write_size);
+            bus->stats.bytes += write_size;
+        }
+        if (esp_rc == ESP_OK && read_size > 0)
+        {
+            esp_rc = device->read != NULL ? device->read(device, read_buffer, read_size) : ESP_ERR_NOT_SUPPORTED;
+            duration_ns += sim_i2c_transfer_time_ns(dev->scl_speed_hz, read_size);
+            bus->stats.bytes += read_size;
+        }
+    }
+    bus->stats.bus_time_ns += duration_ns;
+    pthread_mutex_unlock(&bus->lock);
+
+    sim_realtime_sleep_ns(duration_ns);
+    sim_sleep_ns(latency_ns);
+    return esp_rc;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size, int xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    return sim_i2c_transfer(i2c_dev, write_buffer, write_size, NULL, 0);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev, uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    return sim_i2c_transfer(i2c_dev, NULL, 0, read_buffer, read_size);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+                                      uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    return sim_i2c_transfer(i2c_dev, write_buffer, write_size, read_buffer, read_size);
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus_handle, uint16_t address, int xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    ESP_RETURN_ON_FALSE(bus_handle != NULL && address < SIM_I2C_MAX_ADDRESS, ESP_ERR_INVALID_ARG, SIM_I2C_TAG, "Invalid argument");
+
+    sim_i2c_port_t *bus = &ports[bus_handle->port];
+    pthread_mutex_lock(&bus->lock);
+    bool present = bus->devices[address] != NULL;
+    bus->stats.transactions++;
+    if (!present)
+        bus->stats.nacks++;
+    bus->stats.bus_time_ns += sim_i2c_transfer_time_ns(100000, 0); // The driver probes at 100 kHz
+    pthread_mutex_unlock(&bus->lock);
+    return present ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
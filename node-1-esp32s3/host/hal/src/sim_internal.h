@@ -0,0 +1,31 @@
+/**
+ * Shared helpers for the simulated HAL
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Whether realtime mode is enabled, see sim_set_realtime()
+ */
+bool sim_realtime_enabled(void);
+
+/**
+ * @brief Sleeps for a simulated duration if realtime mode is enabled
+ */
+void sim_realtime_sleep_ns(uint64_t duration_ns);
+
+/**
+ * @brief Sleeps for a duration of host time
+ */
+void sim_sleep_ns(uint64_t duration_ns);
+
+/**
+ * @brief Absolute CLOCK_MONOTONIC deadline ticks from now
+ */
+void sim_deadline(TickType_t ticks, struct timespec *ret_deadline);
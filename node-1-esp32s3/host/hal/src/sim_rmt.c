@@ -0,0 +1,503 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "driver/rmt_tx.h"
+#include "sim_hal.h"
+#include "sim_internal.h"
+
+#define SIM_RMT_TAG "sim_rmt"
+#define SIM_RMT_MAX_QUEUE_DEPTH 8
+
+typedef enum
+{
+    RMT_FSM_INIT,
+    RMT_FSM_ENABLE,
+} rmt_fsm_t;
+
+struct rmt_channel_t
+{
+    bool allocated;
+    gpio_num_t gpio_num;
+    uint32_t resolution_hz;
+    rmt_fsm_t fsm;
+
+    rmt_tx_done_callback_t on_trans_done;
+    void *user_data;
+
+    // Realtime mode: transmissions queued or on the wire, each ends at its end_us
+    size_t queue_depth;
+    esp_timer_handle_t done_timer;
+    uint32_t queue_head;
+    uint32_t queued;
+    int64_t end_us[SIM_RMT_MAX_QUEUE_DEPTH]; // INT64_MAX while held by the sync manager
+    int64_t wire_us[SIM_RMT_MAX_QUEUE_DEPTH];
+    size_t queued_symbols[SIM_RMT_MAX_QUEUE_DEPTH];
+    struct rmt_sync_manager_t *synchro;
+
+    // Encoder output of the transmission in progress
+    uint8_t frame[SIM_RMT_MAX_FRAME_LEN];
+    size_t frame_len;
+    uint64_t frame_symbols;
+    uint64_t frame_ticks;
+
+    sim_rmt_stats_t stats;
+};
+
+typedef struct
+{
+    rmt_encoder_t base;
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+} sim_bytes_encoder_t;
+
+typedef struct
+{
+    rmt_encoder_t base;
+} sim_copy_encoder_t;
+
+// Transmissions on the channels of a sync manager are held until every channel has one
+struct rmt_sync_manager_t
+{
+    size_t array_size;
+    rmt_channel_handle_t channels[SIM_RMT_TX_CHANNELS];
+};
+
+static pthread_mutex_t rmt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rmt_cond; // Signalled when a queued transmission ends
+static pthread_once_t rmt_once = PTHREAD_ONCE_INIT;
+static struct rmt_channel_t channels[SIM_RMT_TX_CHANNELS];
+
+static void rmt_init_cond(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&rmt_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static uint32_t symbol_ticks(rmt_symbol_word_t symbol)
+{
+    return symbol.duration0 + symbol.duration1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Encoders. Nothing is ever produced into channel memory, so encoding never yields
+ * with RMT_ENCODING_MEM_FULL.
+ * ------------------------------------------------------------------------- */
+
+static size_t sim_bytes_encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    sim_bytes_encoder_t *bytes_encoder = __containerof(encoder, sim_bytes_encoder_t, base);
+    const uint8_t *data = (const uint8_t *)primary_data;
+
+    size_t room = SIM_RMT_MAX_FRAME_LEN - channel->frame_len;
+    memcpy(channel->frame + channel->frame_len, data, data_size < room ? data_size : room);
+    channel->frame_len += data_size < room ? data_size : room;
+
+    uint64_t ones = 0;
+    for (size_t i = 0; i < data_size; i++)
+        ones += __builtin_popcount(data[i]);
+    uint64_t bits = (uint64_t)data_size * 8;
+    channel->frame_ticks += ones * symbol_ticks(bytes_encoder->bit1) + (bits - ones) * symbol_ticks(bytes_encoder->bit0);
+    channel->frame_symbols += bits;
+    channel->stats.bytes += data_size;
+
+    *ret_state = RMT_ENCODING_COMPLETE;
+    return bits;
+}
+
+static size_t sim_copy_encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    (void)encoder;
+    const rmt_symbol_word_t *symbols = (const rmt_symbol_word_t *)primary_data;
+    size_t count = data_size / sizeof(rmt_symbol_word_t);
+    for (size_t i = 0; i < count; i++)
+        channel->frame_ticks += symbol_ticks(symbols[i]);
+    channel->frame_symbols += count;
+
+    *ret_state = RMT_ENCODING_COMPLETE;
+    return count;
+}
+
+static esp_err_t sim_encoder_reset(rmt_encoder_t *encoder)
+{
+    (void)encoder;
+    return ESP_OK;
+}
+
+static esp_err_t sim_encoder_del(rmt_encoder_t *encoder)
+{
+    free(encoder);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    ESP_RETURN_ON_FALSE(config != NULL && ret_encoder != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    sim_bytes_encoder_t *encoder = calloc(1, sizeof(sim_bytes_encoder_t));
+    ESP_RETURN_ON_FALSE(encoder != NULL, ESP_ERR_NO_MEM, SIM_RMT_TAG, "No memory for bytes encoder");
+    encoder->base.encode = sim_bytes_encode;
+    encoder->base.reset = sim_encoder_reset;
+    encoder->base.del = sim_encoder_del;
+    encoder->bit0 = config->bit0;
+    encoder->bit1 = config->bit1;
+    *ret_encoder = &encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    ESP_RETURN_ON_FALSE(config != NULL && ret_encoder != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    sim_copy_encoder_t *encoder = calloc(1, sizeof(sim_copy_encoder_t));
+    ESP_RETURN_ON_FALSE(encoder != NULL, ESP_ERR_NO_MEM, SIM_RMT_TAG, "No memory for copy encoder");
+    encoder->base.encode = sim_copy_encode;
+    encoder->base.reset = sim_encoder_reset;
+    encoder->base.del = sim_encoder_del;
+    *ret_encoder = &encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    ESP_RETURN_ON_FALSE(encoder != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder)
+{
+    ESP_RETURN_ON_FALSE(encoder != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    return encoder->reset(encoder);
+}
+
+// Starts the held transmissions of a sync manager together once every channel has one
+static void sim_rmt_sync_start(struct rmt_sync_manager_t *synchro, int64_t now_us)
+{
+    for (size_t i = 0; i < synchro->array_size; i++)
+    {
+        rmt_channel_handle_t channel = synchro->channels[i];
+        if (channel->queued == 0 || channel->end_us[channel->queue_head] != INT64_MAX)
+            return;
+    }
+    for (size_t i = 0; i < synchro->array_size; i++)
+    {
+        rmt_channel_handle_t channel = synchro->channels[i];
+        channel->end_us[channel->queue_head] = now_us + channel->wire_us[channel->queue_head];
+        channel->stats.last_start_us = now_us;
+        esp_timer_start_once(channel->done_timer, channel->wire_us[channel->queue_head]);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * TX channels. Outside realtime mode a transmission completes inside rmt_transmit().
+ * In realtime mode it is queued and ends after its wire time, in the esp_timer task.
+ * ------------------------------------------------------------------------- */
+
+// The transmission at the head of the queue has left the wire
+static void sim_rmt_done(void *arg)
+{
+    rmt_channel_handle_t channel = (rmt_channel_handle_t)arg;
+    pthread_mutex_lock(&rmt_lock);
+    int64_t now_us = esp_timer_get_time();
+    // A stale alarm after rmt_disable() finds an empty queue or a transmission not yet done
+    if (channel->queued == 0 || channel->end_us[channel->queue_head] > now_us)
+    {
+        pthread_mutex_unlock(&rmt_lock);
+        return;
+    }
+    size_t symbols = channel->queued_symbols[channel->queue_head];
+    channel->queue_head = (channel->queue_head + 1) % SIM_RMT_MAX_QUEUE_DEPTH;
+    if (--channel->queued > 0)
+    {
+        int64_t next_us = channel->end_us[channel->queue_head] - now_us;
+        channel->stats.last_start_us = channel->end_us[channel->queue_head] - channel->wire_us[channel->queue_head];
+        esp_timer_start_once(channel->done_timer, next_us > 0 ? next_us : 0);
+    }
+    rmt_tx_done_callback_t on_trans_done = channel->on_trans_done;
+    void *user_data = channel->user_data;
+    pthread_cond_broadcast(&rmt_cond);
+    pthread_mutex_unlock(&rmt_lock);
+
+    if (on_trans_done != NULL)
+    {
+        rmt_tx_done_event_data_t edata = {.num_symbols = symbols};
+        on_trans_done(channel, &edata, user_data);
+    }
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan)
+{
+    ESP_RETURN_ON_FALSE(config != NULL && ret_chan != NULL && config->resolution_hz > 0, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(config->trans_queue_depth <= SIM_RMT_MAX_QUEUE_DEPTH, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Queue deeper than %d",
+                        SIM_RMT_MAX_QUEUE_DEPTH);
+    pthread_once(&rmt_once, rmt_init_cond);
+
+    esp_timer_handle_t done_timer;
+    esp_timer_create_args_t timer_args = {
+        .callback = sim_rmt_done,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "sim_rmt",
+    };
+
+    pthread_mutex_lock(&rmt_lock);
+    rmt_channel_handle_t channel = NULL;
+    for (uint8_t i = 0; i < SIM_RMT_TX_CHANNELS && channel == NULL; i++)
+    {
+        if (!channels[i].allocated)
+            channel = &channels[i];
+    }
+    if (channel != NULL)
+    {
+        memset(channel, 0, sizeof(struct rmt_channel_t));
+        channel->allocated = true;
+        channel->gpio_num = config->gpio_num;
+        channel->resolution_hz = config->resolution_hz;
+        channel->fsm = RMT_FSM_INIT;
+        channel->queue_depth = config->trans_queue_depth > 0 ? config->trans_queue_depth : 1;
+    }
+    pthread_mutex_unlock(&rmt_lock);
+
+    ESP_RETURN_ON_FALSE(channel != NULL, ESP_ERR_NOT_FOUND, SIM_RMT_TAG, "No free TX channels");
+    timer_args.arg = channel;
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &done_timer));
+    channel->done_timer = done_timer;
+    *ret_chan = channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel)
+{
+    ESP_RETURN_ON_FALSE(channel != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(channel->fsm == RMT_FSM_INIT, ESP_ERR_INVALID_STATE, SIM_RMT_TAG, "Channel not in init state");
+    pthread_mutex_lock(&rmt_lock);
+    channel->allocated = false;
+    esp_timer_stop(channel->done_timer); // Disabled, so nothing is queued
+    esp_timer_delete(channel->done_timer);
+    pthread_mutex_unlock(&rmt_lock);
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel)
+{
+    ESP_RETURN_ON_FALSE(channel != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(channel->fsm == RMT_FSM_INIT, ESP_ERR_INVALID_STATE, SIM_RMT_TAG, "Channel not in init state");
+    channel->fsm = RMT_FSM_ENABLE;
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel)
+{
+    ESP_RETURN_ON_FALSE(channel != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(channel->fsm == RMT_FSM_ENABLE, ESP_ERR_INVALID_STATE, SIM_RMT_TAG, "Channel not enabled yet");
+    pthread_mutex_lock(&rmt_lock);
+    // Aborts anything still queued, without done callbacks
+    channel->fsm = RMT_FSM_INIT;
+    channel->queued = 0;
+    esp_timer_stop(channel->done_timer);
+    pthread_cond_broadcast(&rmt_cond);
+    pthread_mutex_unlock(&rmt_lock);
+    return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void *payload, size_t payload_bytes, const rmt_transmit_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(tx_channel != NULL && encoder != NULL && payload != NULL && config != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(tx_channel->fsm == RMT_FSM_ENABLE, ESP_ERR_INVALID_STATE, SIM_RMT_TAG, "Channel not enabled");
+
+    pthread_mutex_lock(&rmt_lock);
+    bool realtime = sim_realtime_enabled();
+    if (realtime)
+    {
+        // A full queue blocks, as the driver does
+        while (tx_channel->queued == tx_channel->queue_depth && tx_channel->fsm == RMT_FSM_ENABLE)
+            pthread_cond_wait(&rmt_cond, &rmt_lock);
+    }
+
+    tx_channel->frame_len = 0;
+    tx_channel->frame_symbols = 0;
+    tx_channel->frame_ticks = 0;
+
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t symbols = 0;
+    while (!(state & RMT_ENCODING_COMPLETE))
+        symbols += encoder->encode(encoder, tx_channel, payload, payload_bytes, &state);
+
+    uint64_t wire_time_ns = tx_channel->frame_ticks * 1000000000ULL / tx_channel->resolution_hz;
+    tx_channel->stats.transmissions++;
+    tx_channel->stats.symbols += tx_channel->frame_symbols;
+    tx_channel->stats.wire_time_ns += wire_time_ns;
+
+    if (realtime)
+    {
+        int64_t now_us = esp_timer_get_time();
+        uint32_t slot = (tx_channel->queue_head + tx_channel->queued) % SIM_RMT_MAX_QUEUE_DEPTH;
+        tx_channel->wire_us[slot] = (int64_t)(wire_time_ns / 1000);
+        tx_channel->queued_symbols[slot] = symbols;
+        if (tx_channel->queued == 0 && tx_channel->synchro != NULL)
+        {
+            tx_channel->end_us[slot] = INT64_MAX;
+            tx_channel->queued = 1;
+            sim_rmt_sync_start(tx_channel->synchro, now_us);
+        }
+        else
+        {
+            // On the wire after the transmissions ahead of it, done when its timer fires
+            int64_t start_us = now_us;
+            if (tx_channel->queued > 0)
+                start_us = tx_channel->end_us[(tx_channel->queue_head + tx_channel->queued - 1) % SIM_RMT_MAX_QUEUE_DEPTH];
+            tx_channel->end_us[slot] = start_us + tx_channel->wire_us[slot];
+            if (tx_channel->queued++ == 0)
+            {
+                tx_channel->stats.last_start_us = start_us;
+                esp_timer_start_once(tx_channel->done_timer, tx_channel->end_us[slot] - now_us);
+            }
+        }
+        pthread_mutex_unlock(&rmt_lock);
+        return ESP_OK;
+    }
+
+    tx_channel->stats.last_start_us = esp_timer_get_time();
+    rmt_tx_done_callback_t on_trans_done = tx_channel->on_trans_done;
+    void *user_data = tx_channel->user_data;
+    pthread_mutex_unlock(&rmt_lock);
+
+    if (on_trans_done != NULL)
+    {
+        rmt_tx_done_event_data_t edata = {.num_symbols = symbols};
+        on_trans_done(tx_channel, &edata, user_data);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(tx_channel != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ULL;
+    deadline.tv_sec += ns / 1000000000ULL;
+    deadline.tv_nsec = ns % 1000000000ULL;
+
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&rmt_lock);
+    while (tx_channel->queued > 0 && esp_rc == ESP_OK)
+    {
+        if (timeout_ms < 0)
+            pthread_cond_wait(&rmt_cond, &rmt_lock);
+        else if (pthread_cond_timedwait(&rmt_cond, &rmt_lock, &deadline) != 0)
+            esp_rc = ESP_ERR_TIMEOUT;
+    }
+    pthread_mutex_unlock(&rmt_lock);
+    return esp_rc;
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel, const rmt_tx_event_callbacks_t *cbs, void *user_data)
+{
+    ESP_RETURN_ON_FALSE(tx_channel != NULL && cbs != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(tx_channel->fsm == RMT_FSM_INIT, ESP_ERR_INVALID_STATE, SIM_RMT_TAG, "Channel not in init state");
+    pthread_mutex_lock(&rmt_lock);
+    tx_channel->on_trans_done = cbs->on_trans_done;
+    tx_channel->user_data = user_data;
+    pthread_mutex_unlock(&rmt_lock);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_sync_manager(const rmt_sync_manager_config_t *config, rmt_sync_manager_handle_t *ret_synchro)
+{
+    ESP_RETURN_ON_FALSE(config != NULL && ret_synchro != NULL && config->tx_channel_array != NULL && config->array_size > 0 &&
+                        config->array_size <= SIM_RMT_TX_CHANNELS, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    rmt_sync_manager_handle_t synchro = calloc(1, sizeof(struct rmt_sync_manager_t));
+    ESP_RETURN_ON_FALSE(synchro != NULL, ESP_ERR_NO_MEM, SIM_RMT_TAG, "No memory for sync manager");
+
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&rmt_lock);
+    for (size_t i = 0; i < config->array_size && esp_rc == ESP_OK; i++)
+    {
+        rmt_channel_handle_t channel = config->tx_channel_array[i];
+        // As the driver: every channel already enabled and in no other sync manager
+        if (channel == NULL || channel->fsm != RMT_FSM_ENABLE || channel->synchro != NULL)
+            esp_rc = ESP_ERR_INVALID_STATE;
+        else
+            synchro->channels[synchro->array_size++] = channel;
+    }
+    for (size_t i = 0; i < synchro->array_size; i++)
+        synchro->channels[i]->synchro = esp_rc == ESP_OK ? synchro : NULL;
+    pthread_mutex_unlock(&rmt_lock);
+
+    if (esp_rc != ESP_OK)
+    {
+        free(synchro);
+        ESP_LOGE(SIM_RMT_TAG, "Sync manager channels must be enabled and not already synchronised");
+        return esp_rc;
+    }
+    *ret_synchro = synchro;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_sync_manager(rmt_sync_manager_handle_t synchro)
+{
+    ESP_RETURN_ON_FALSE(synchro != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    pthread_mutex_lock(&rmt_lock);
+    for (size_t i = 0; i < synchro->array_size; i++)
+        synchro->channels[i]->synchro = NULL;
+    pthread_mutex_unlock(&rmt_lock);
+    free(synchro);
+    return ESP_OK;
+}
+
+esp_err_t rmt_sync_reset(rmt_sync_manager_handle_t synchro)
+{
+    ESP_RETURN_ON_FALSE(synchro != NULL, ESP_ERR_INVALID_ARG, SIM_RMT_TAG, "Invalid argument");
+    return ESP_OK; // Nothing is held between rounds
+}
+
+/* ---------------------------------------------------------------------------
+ * Simulation control
+ * ------------------------------------------------------------------------- */
+
+static rmt_channel_handle_t find_channel(gpio_num_t gpio_num)
+{
+    for (uint8_t i = 0; i < SIM_RMT_TX_CHANNELS; i++)
+    {
+        if (channels[i].allocated && channels[i].gpio_num == gpio_num)
+            return &channels[i];
+    }
+    return NULL;
+}
+
+esp_err_t sim_rmt_get_frame(gpio_num_t gpio_num, const uint8_t **ret_data, size_t *ret_len)
+{
+    pthread_mutex_lock(&rmt_lock);
+    rmt_channel_handle_t channel = find_channel(gpio_num);
+    if (channel != NULL)
+    {
+        *ret_data = channel->frame;
+        *ret_len = channel->frame_len;
+    }
+    pthread_mutex_unlock(&rmt_lock);
+    return channel != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t sim_rmt_get_stats(gpio_num_t gpio_num, sim_rmt_stats_t *ret_stats)
+{
+    pthread_mutex_lock(&rmt_lock);
+    rmt_channel_handle_t channel = find_channel(gpio_num);
+    if (channel != NULL)
+        *ret_stats = channel->stats;
+    pthread_mutex_unlock(&rmt_lock);
+    return channel != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+uint8_t sim_rmt_channels_in_use(void)
+{
+    uint8_t count = 0;
+    pthread_mutex_lock(&rmt_lock);
+    for (uint8_t i = 0; i < SIM_RMT_TX_CHANNELS; i++)
+        count += channels[i].allocated;
+    pthread_mutex_unlock(&rmt_lock);
+    return count;
+}
@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "driver/spi_master.h"
+#include "soc/spi_periph.h"
+#include "sim_hal.h"
+#include "sim_internal.h"
+
+#define SIM_SPI_TAG "sim_spi"
+#define SIM_SPI_DEFAULT_MAX_TRANSFER 4092 // Bytes, as the IDF driver without a bus max_transfer_sz
+
+// One device per bus is all the LED strip backend needs
+struct spi_device_t
+{
+    spi_host_device_t host;
+    int clock_speed_hz;
+};
+
+typedef struct
+{
+    bool initialized;
+    int mosi_io_num;
+    size_t max_transfer_sz;
+    struct spi_device_t *device;
+    struct spi_device_t device_mem;
+
+    uint8_t frame[SIM_SPI_MAX_FRAME_LEN];
+    size_t frame_len;
+    sim_spi_stats_t stats;
+} sim_spi_bus_t;
+
+const spi_signal_conn_t spi_periph_signal[SOC_SPI_PERIPH_NUM] = {
+    {.spid_out = 65},
+    {.spid_out = 102},
+    {.spid_out = 122},
+};
+
+static pthread_mutex_t spi_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_spi_bus_t buses[SPI_HOST_MAX];
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_common_dma_t dma_chan)
+{
+    (void)dma_chan;
+    ESP_RETURN_ON_FALSE(host_id > SPI1_HOST && host_id < SPI_HOST_MAX && bus_config != NULL, ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "Invalid argument");
+
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&spi_lock);
+    sim_spi_bus_t *bus = &buses[host_id];
+    if (bus->initialized)
+        esp_rc = ESP_ERR_INVALID_STATE;
+    else
+    {
+        memset(bus, 0, sizeof(sim_spi_bus_t));
+        bus->initialized = true;
+        bus->mosi_io_num = bus_config->mosi_io_num;
+        bus->max_transfer_sz = bus_config->max_transfer_sz > 0 ? (size_t)bus_config->max_transfer_sz : SIM_SPI_DEFAULT_MAX_TRANSFER;
+    }
+    pthread_mutex_unlock(&spi_lock);
+    ESP_RETURN_ON_FALSE(esp_rc == ESP_OK, esp_rc, SIM_SPI_TAG, "SPI bus already initialized");
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+    ESP_RETURN_ON_FALSE(host_id > SPI1_HOST && host_id < SPI_HOST_MAX, ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "Invalid argument");
+
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&spi_lock);
+    sim_spi_bus_t *bus = &buses[host_id];
+    if (!bus->initialized || bus->device != NULL)
+        esp_rc = ESP_ERR_INVALID_STATE;
+    else
+        bus->initialized = false;
+    pthread_mutex_unlock(&spi_lock);
+    ESP_RETURN_ON_FALSE(esp_rc == ESP_OK, esp_rc, SIM_SPI_TAG, "SPI bus not initialized or still has a device");
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config, spi_device_handle_t *handle)
+{
+    ESP_RETURN_ON_FALSE(host_id > SPI1_HOST && host_id < SPI_HOST_MAX && dev_config != NULL && handle != NULL && dev_config->clock_speed_hz > 0,
+                        ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "Invalid argument");
+
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&spi_lock);
+    sim_spi_bus_t *bus = &buses[host_id];
+    if (!bus->initialized)
+        esp_rc = ESP_ERR_INVALID_STATE;
+    else if (bus->device != NULL)
+        esp_rc = ESP_ERR_NOT_FOUND;
+    else
+    {
+        bus->device = &bus->device_mem;
+        bus->device->host = host_id;
+        bus->device->clock_speed_hz = dev_config->clock_speed_hz;
+        *handle = bus->device;
+    }
+    pthread_mutex_unlock(&spi_lock);
+    ESP_RETURN_ON_FALSE(esp_rc == ESP_OK, esp_rc, SIM_SPI_TAG, "No free device slot on the SPI bus");
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "Invalid argument");
+    pthread_mutex_lock(&spi_lock);
+    buses[handle->host].device = NULL;
+    pthread_mutex_unlock(&spi_lock);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_actual_freq(spi_device_handle_t handle, int *freq_khz)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL && freq_khz != NULL, ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "Invalid argument");
+    *freq_khz = handle->clock_speed_hz / 1000; // The clock divider is assumed exact
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL && trans_desc != NULL, ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(trans_desc->length == 0 || trans_desc->tx_buffer != NULL, ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "No TX buffer");
+
+    sim_spi_bus_t *bus = &buses[handle->host];
+    size_t bytes = (trans_desc->length + 7) / 8;
+    ESP_RETURN_ON_FALSE(bytes <= bus->max_transfer_sz, ESP_ERR_INVALID_ARG, SIM_SPI_TAG, "Transaction longer than the bus maximum");
+
+    pthread_mutex_lock(&spi_lock);
+    bus->frame_len = bytes < SIM_SPI_MAX_FRAME_LEN ? bytes : SIM_SPI_MAX_FRAME_LEN;
+    memcpy(bus->frame, trans_desc->tx_buffer, bus->frame_len);
+    uint64_t wire_time_ns = (uint64_t)trans_desc->length * 1000000000ULL / handle->clock_speed_hz;
+    bus->stats.transmissions++;
+    bus->stats.bytes += bytes;
+    bus->stats.wire_time_ns += wire_time_ns;
+    pthread_mutex_unlock(&spi_lock);
+
+    sim_realtime_sleep_ns(wire_time_ns);
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------------------
+ * Simulation control
+ * ------------------------------------------------------------------------- */
+
+static sim_spi_bus_t *find_bus(gpio_num_t gpio_num)
+{
+    for (uint8_t i = 0; i < SPI_HOST_MAX; i++)
+    {
+        if (buses[i].initialized && buses[i].device != NULL && buses[i].mosi_io_num == gpio_num)
+            return &buses[i];
+    }
+    return NULL;
+}
+
+esp_err_t sim_spi_get_frame(gpio_num_t gpio_num, const uint8_t **ret_data, size_t *ret_len)
+{
+    pthread_mutex_lock(&spi_lock);
+    sim_spi_bus_t *bus = find_bus(gpio_num);
+    if (bus != NULL)
+    {
+        *ret_data = bus->frame;
+        *ret_len = bus->frame_len;
+    }
+    pthread_mutex_unlock(&spi_lock);
+    return bus != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t sim_spi_get_stats(gpio_num_t gpio_num, sim_spi_stats_t *ret_stats)
+{
+    pthread_mutex_lock(&spi_lock);
+    sim_spi_bus_t *bus = find_bus(gpio_num);
+    if (bus != NULL)
+        *ret_stats = bus->stats;
+    pthread_mutex_unlock(&spi_lock);
+    return bus != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "sim_hal.h"
+
+#define SIM_SSD1306_TAG "sim_ssd1306"
+#define SIM_SSD1306_PAGES 8
+#define SIM_SSD1306_COLUMNS 128
+#define SIM_SSD1306_MAX_ARGS 6
+
+typedef enum
+{
+    MODE_HORIZONTAL = 0,
+    MODE_VERTICAL = 1,
+    MODE_PAGE = 2,
+} addressing_mode_t;
+
+// Display RAM and the subset of controller state that affects where data lands
+struct sim_ssd1306
+{
+    sim_i2c_device_t device; // Must be first
+    i2c_port_t port;
+    uint16_t address;
+
+    uint8_t gddram[SIM_SSD1306_PAGES][SIM_SSD1306_COLUMNS];
+    addressing_mode_t mode;
+    uint8_t col_start, col_end, page_start, page_end;
+    uint8_t col, page;
+
+    // Multi-byte commands may be split over control bytes
+    uint8_t command;
+    uint8_t args[SIM_SSD1306_MAX_ARGS];
+    uint8_t args_expected, args_received;
+
+    uint32_t command_bytes;
+    uint32_t data_bytes;
+};
+
+static uint8_t command_arg_count(uint8_t command)
+{
+    switch (command)
+    {
+    case 0x20: // Memory addressing mode
+    case 0x81: // Contrast
+    case 0x8D: // Charge pump
+    case 0xA8: // Multiplex ratio
+    case 0xD3: // Display offset
+    case 0xD5: // Clock divide
+    case 0xD9: // Pre-charge
+    case 0xDA: // COM pins
+    case 0xDB: // VCOMH deselect
+        return 1;
+    case 0x21: // Column range
+    case 0x22: // Page range
+    case 0xA3: // Vertical scroll area
+        return 2;
+    case 0x29: // Vertical and horizontal scroll
+    case 0x2A:
+        return 5;
+    case 0x26: // Horizontal scroll
+    case 0x27:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+static void execute_command(struct sim_ssd1306 *display)
+{
+    uint8_t command = display->command;
+    const uint8_t *args = display->args;
+
+    switch (command)
+    {
+    case 0x20:
+        if ((args[0] & 0x03) <= MODE_PAGE) // 0b11 is invalid and ignored
+            display->mode = (addressing_mode_t)(args[0] & 0x03);
+        return;
+    case 0x21:
+        display->col_start = display->col = args[0] & 0x7F;
+        display->col_end = args[1] & 0x7F;
+        return;
+    case 0x22:
+        display->page_start = display->page = args[0] & 0x07;
+        display->page_end = args[1] & 0x07;
+        return;
+    default:
+        break;
+    }
+
+    // Page addressing mode pointer commands
+    if (command >= 0xB0 && command <= 0xB7)
+        display->page = command & 0x07;
+    else if (command <= 0x0F)
+        display->col = (display->col & 0xF0) | command;
+    else if (command >= 0x10 && command <= 0x17)
+        display->col = ((command & 0x07) << 4) | (display->col & 0x0F);
+}
+
+static void receive_command(struct sim_ssd1306 *display, uint8_t byte)
+{
+    display->command_bytes++;
+    if (display->args_received < display->args_expected)
+    {
+        display->args[display->args_received++] = byte;
+        if (display->args_received == display->args_expected)
+            execute_command(display);
+        return;
+    }
+
+    display->command = byte;
+    display->args_expected = command_arg_count(byte);
+    display->args_received = 0;
+    if (display->args_expected == 0)
+        execute_command(display);
+}
+
+static void receive_data(struct sim_ssd1306 *display, uint8_t byte)
+{
+    display->data_bytes++;
+    display->gddram[display->page][display->col] = byte;
+
+    switch (display->mode)
+    {
+    case MODE_HORIZONTAL:
+        if (display->col < display->col_end)
+            display->col++;
+        else
+        {
+            display->col = display->col_start;
+            display->page = display->page < display->page_end ? display->page + 1 : display->page_start;
+        }
+        break;
+    case MODE_VERTICAL:
+        if (display->page < display->page_end)
+            display->page++;
+        else
+        {
+            display->page = display->page_start;
+            display->col = display->col < display->col_end ? display->col + 1 : display->col_start;
+        }
+        break;
+    case MODE_PAGE:
+        display->col = (display->col + 1) % SIM_SSD1306_COLUMNS; // Wraps within the page
+        break;
+    }
+}
+
+/**
+ * @brief One write transfer: control byte, then either one byte (Co set) and another control
+ * byte, or a stream of commands / data to the end of the transfer (Co clear)
+ */
+static esp_err_t sim_ssd1306_write(sim_i2c_device_t *device, const uint8_t *data, size_t len)
+{
+    struct sim_ssd1306 *display = (struct sim_ssd1306 *)device;
+    size_t i = 0;
+    while (i < len)
+    {
+        uint8_t control = data[i++];
+        bool continuation = control & 0x80;
+        bool is_data = control & 0x40;
+        size_t end = continuation ? (i + 1 < len ? i + 1 : len) : len;
+        for (; i < end; i++)
+        {
+            if (is_data)
+                receive_data(display, data[i]);
+            else
+                receive_command(display, data[i]);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sim_ssd1306_read(sim_i2c_device_t *device, uint8_t *data, size_t len)
+{
+    // Status byte: display on, not busy. The I2C interface cannot read GDDRAM.
+    (void)device;
+    memset(data, 0x00, len);
+    return ESP_OK;
+}
+
+esp_err_t sim_ssd1306_new(i2c_port_t port, uint16_t address, sim_ssd1306_handle_t *ret_display)
+{
+    struct sim_ssd1306 *display = calloc(1, sizeof(struct sim_ssd1306));
+    ESP_RETURN_ON_FALSE(display != NULL, ESP_ERR_NO_MEM, SIM_SSD1306_TAG, "No memory for virtual SSD1306");
+
+    display->device.write = sim_ssd1306_write;
+    display->device.read = sim_ssd1306_read;
+    display->port = port;
+    display->address = address;
+    // Reset state (datasheet pg.64): page addressing, full window
+    display->mode = MODE_PAGE;
+    display->col_end = SIM_SSD1306_COLUMNS - 1;
+    display->page_end = SIM_SSD1306_PAGES - 1;
+
+    esp_err_t esp_rc = sim_i2c_attach(port, address, &display->device);
+    if (esp_rc != ESP_OK)
+    {
+        free(display);
+        ESP_LOGE(SIM_SSD1306_TAG, "Address 0x%02X is taken", address);
+        return esp_rc;
+    }
+    *ret_display = display;
+    return ESP_OK;
+}
+
+void sim_ssd1306_del(sim_ssd1306_handle_t display)
+{
+    sim_i2c_detach(display->port, display->address);
+    free(display);
+}
+
+const uint8_t (*sim_ssd1306_gddram(sim_ssd1306_handle_t display))[128]
+{
+    return (const uint8_t (*)[128])display->gddram;
+}
+
+void sim_ssd1306_get_counts(sim_ssd1306_handle_t display, uint32_t *ret_command_bytes, uint32_t *ret_data_bytes)
+{
+    if (ret_command_bytes != NULL)
+        *ret_command_bytes = display->command_bytes;
+    if (ret_data_bytes != NULL)
+        *ret_data_bytes = display->data_bytes;
+}
+
+void sim_ssd1306_dump(sim_ssd1306_handle_t display, FILE *stream)
+{
+    for (int row = 0; row < SIM_SSD1306_PAGES * 8; row++)
+    {
+        char line[SIM_SSD1306_COLUMNS + 2];
+        for (int col = 0; col < SIM_SSD1306_COLUMNS; col++)
+            line[col] = (display->gddram[row / 8][col] >> (row % 8)) & 1 ? '#' : '.';
+        line[SIM_SSD1306_COLUMNS] = '\n';
+        line[SIM_SSD1306_COLUMNS + 1] = '\0';
+        fputs(line, stream);
+    }
+}
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#define SIM_TIMER_TAG "sim_esp_timer"
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t alarm_us;  // esp_timer_get_time() at which the timer fires
+    uint64_t period_us; // 0 for one shot
+    bool armed;
+    struct esp_timer *next; // Armed timers, earliest alarm first
+};
+
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *armed;
+
+static void insert(struct esp_timer *timer)
+{
+    struct esp_timer **link = &armed;
+    while (*link != NULL && (*link)->alarm_us <= timer->alarm_us)
+        link = &(*link)->next;
+    timer->next = *link;
+    *link = timer;
+    timer->armed = true;
+}
+
+static void unlink_timer(struct esp_timer *timer)
+{
+    for (struct esp_timer **link = &armed; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == timer)
+        {
+            *link = timer->next;
+            break;
+        }
+    }
+    timer->armed = false;
+}
+
+// The esp_timer task: sleeps until the earliest alarm and runs its callback without the lock
+static void *dispatch(void *unused)
+{
+    pthread_mutex_lock(&timer_lock);
+    while (1)
+    {
+        if (armed == NULL)
+        {
+            pthread_cond_wait(&timer_cond, &timer_lock);
+            continue;
+        }
+
+        int64_t wait_us = armed->alarm_us - esp_timer_get_time();
+        if (wait_us > 0)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)wait_us * 1000;
+            deadline.tv_sec += ns / 1000000000ULL;
+            deadline.tv_nsec = ns % 1000000000ULL;
+            pthread_cond_timedwait(&timer_cond, &timer_lock, &deadline);
+            continue; // The list may have changed
+        }
+
+        struct esp_timer *timer = armed;
+        unlink_timer(timer);
+        if (timer->period_us > 0)
+        {
+            timer->alarm_us += timer->period_us;
+            insert(timer);
+        }
+        esp_timer_cb_t callback = timer->callback;
+        void *arg = timer->arg;
+        pthread_mutex_unlock(&timer_lock);
+        callback(arg);
+        pthread_mutex_lock(&timer_lock);
+    }
+    return NULL;
+}
+
+static void start_dispatch(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, dispatch, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    ESP_RETURN_ON_FALSE(create_args != NULL && create_args->callback != NULL && out_handle != NULL, ESP_ERR_INVALID_ARG,
+                        SIM_TIMER_TAG, "Invalid argument");
+    pthread_once(&dispatch_once, start_dispatch);
+
+    struct esp_timer *timer = calloc(1, sizeof(struct esp_timer));
+    ESP_RETURN_ON_FALSE(timer != NULL, ESP_ERR_NO_MEM, SIM_TIMER_TAG, "No memory for timer");
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+    ESP_RETURN_ON_FALSE(timer != NULL, ESP_ERR_INVALID_ARG, SIM_TIMER_TAG, "Invalid argument");
+    esp_err_t esp_rc = ESP_OK;
+    pthread_mutex_lock(&timer_lock);
+    if (timer->armed)
+        esp_rc = ESP_ERR_INVALID_STATE;
+    else
+    {
+        timer->alarm_us = esp_timer_get_time() + (int64_t)timeout_us;
+        timer->period_us = period_us;
+        insert(timer);
+        pthread_cond_signal(&timer_cond);
+    }
+    pthread_mutex_unlock(&timer_lock);
+    return esp_rc;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    ESP_RETURN_ON_FALSE(period > 0, ESP_ERR_INVALID_ARG, SIM_TIMER_TAG, "Period must be non-zero");
+    return start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    ESP_RETURN_ON_FALSE(timer != NULL, ESP_ERR_INVALID_ARG, SIM_TIMER_TAG, "Invalid argument");
+    pthread_mutex_lock(&timer_lock);
+    bool was_armed = timer->armed;
+    if (was_armed)
+        unlink_timer(timer);
+    pthread_mutex_unlock(&timer_lock);
+    return was_armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    ESP_RETURN_ON_FALSE(timer != NULL, ESP_ERR_INVALID_ARG, SIM_TIMER_TAG, "Invalid argument");
+    pthread_mutex_lock(&timer_lock);
+    bool was_armed = timer->armed;
+    pthread_mutex_unlock(&timer_lock);
+    ESP_RETURN_ON_FALSE(!was_armed, ESP_ERR_INVALID_STATE, SIM_TIMER_TAG, "Timer is running");
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    bool active = timer->armed;
+    pthread_mutex_unlock(&timer_lock);
+    return active;
+}
@@ -1,7 +1,14 @@
 #include "communication.h"
 
-static unsigned int write_buffer_len = 0;
+#define COMMUNICATION_TAG "communication"
+
 static uint8_t write_buffer[BUFF_LEN] = {0};
+static i2c_transaction_t legacy_transaction = {
+	.buffer = write_buffer,
+	.capacity = BUFF_LEN,
+	.len = 0,
+	.overflow = false,
+};
 
 esp_err_t i2c_master_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, i2c_master_bus_handle_t *ret_handle)
 {
@@ -15,64 +22,217 @@ esp_err_t i2c_master_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, i2c_m
 	};
 
 	ESP_ERROR_CHECK(i2c_new_master_bus(&i2c_mst_config, ret_handle));
-	i2c_clear_write_buffer();
 	return ESP_OK;
 }
 
-void i2c_clear_write_buffer()
+void i2c_transaction_init(i2c_transaction_t *trans, uint8_t *buffer, size_t capacity)
 {
-	// printf("Asdhkahkjsdhjahsjd\n");
-	memset(write_buffer, 0, sizeof(uint8_t) * BUFF_LEN);
-	write_buffer_len = 0;
+	trans->buffer = buffer;
+	trans->capacity = capacity;
+	i2c_transaction_clear(trans);
 }
 
-void i2c_write_byte(const uint8_t byte)
+void i2c_transaction_clear(i2c_transaction_t *trans)
+{
+	// O(1): stale bytes past len are never sent, and zero runs are filled on append
+	trans->len = 0;
+	trans->overflow = false;
+}
+
+void i2c_transaction_write_byte(i2c_transaction_t *trans, const uint8_t byte)
 {
-	if (write_buffer_len == BUFF_LEN)
+	if (trans->len == trans->capacity)
 	{
-		ESP_LOGE("communication: i2c_add_write_buffer", "Buffer is full");
+		ESP_LOGE(COMMUNICATION_TAG, "Transaction is full");
+		trans->overflow = true;
 		return;
 	}
-	write_buffer[write_buffer_len] = byte;
-	write_buffer_len++;
+	trans->buffer[trans->len] = byte;
+	trans->len++;
 }
 
-void i2c_write_bytes(const uint8_t *bytes, const int len)
+void i2c_transaction_write_bytes(i2c_transaction_t *trans, const uint8_t *bytes, const int len)
+{
+	if (len < 0 || trans->len + len > trans->capacity)
+	{
+		ESP_LOGE(COMMUNICATION_TAG, "Transaction is full");
+		trans->overflow = true;
+		return;
+	}
+	memcpy(trans->buffer + trans->len, bytes, len);
+	trans->len += len;
+}
+
+void i2c_transaction_write_zero(i2c_transaction_t *trans, const int len)
+{
+	if (len < 0 || trans->len + len > trans->capacity)
+	{
+		ESP_LOGE(COMMUNICATION_TAG, "Transaction is full");
+		trans->overflow = true;
+		return;
+	}
+	memset(trans->buffer + trans->len, 0, len);
+	trans->len += len;
+}
+
+esp_err_t i2c_transaction_transmit(i2c_transaction_t *trans, i2c_master_dev_handle_t slave_handle)
+{
+	esp_err_t esp_rc;
+
+	if (trans->overflow)
+	{
+		ESP_LOGE(COMMUNICATION_TAG, "Refusing to transmit truncated frame");
+		i2c_transaction_clear(trans);
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	esp_rc = i2c_master_transmit(slave_handle, trans->buffer, trans->len, -1);
+	if (esp_rc != ESP_OK)
+	{
+		ESP_LOGE(COMMUNICATION_TAG, "Error transmitting buffer: %d", esp_rc);
+		return esp_rc;
+	}
+
+	i2c_transaction_clear(trans);
+	return ESP_OK;
+}
+
+const uint8_t i2c_zero_page[I2C_ZERO_PAGE_LEN] = {0};
+
+void i2c_segments_init(i2c_segment_list_t *list)
+{
+	list->count = 0;
+	list->len = 0;
+	list->overflow = false;
+}
+
+void i2c_segments_add(i2c_segment_list_t *list, const uint8_t *data, size_t len)
 {
-	for (int i = 0; i < len; i++)
+	if (len == 0)
+		return;
+
+	if (list->count > 0)
 	{
-		if (write_buffer_len == BUFF_LEN)
+		i2c_segment_t *last = &list->segments[list->count - 1];
+		if (last->data + last->len == data)
 		{
-			ESP_LOGE("communication: i2c_add_write_buffer", "Buffer is full");
+			last->len += len;
+			list->len += len;
 			return;
 		}
-		write_buffer[write_buffer_len + i] = bytes[i];
 	}
-	write_buffer_len = write_buffer_len + len;
+
+	if (list->count == I2C_MAX_SEGMENTS)
+	{
+		ESP_LOGE(COMMUNICATION_TAG, "Segment list is full");
+		list->overflow = true;
+		return;
+	}
+	list->segments[list->count].data = data;
+	list->segments[list->count].len = len;
+	list->count++;
+	list->len += len;
 }
 
-void i2c_write_zero(const int len)
+void i2c_segments_add_zero(i2c_segment_list_t *list, size_t len)
 {
-	write_buffer_len += len;
+	while (len > 0)
+	{
+		i2c_segment_t *last = list->count > 0 ? &list->segments[list->count - 1] : NULL;
+		size_t chunk;
+
+		// Extend a trailing zero segment in place before starting a new one
+		if (last != NULL && last->data == i2c_zero_page && last->len < I2C_ZERO_PAGE_LEN)
+		{
+			chunk = I2C_ZERO_PAGE_LEN - last->len;
+			chunk = len < chunk ? len : chunk;
+			last->len += chunk;
+		}
+		else
+		{
+			if (list->count == I2C_MAX_SEGMENTS)
+			{
+				ESP_LOGE(COMMUNICATION_TAG, "Segment list is full");
+				list->overflow = true;
+				return;
+			}
+			chunk = len < I2C_ZERO_PAGE_LEN ? len : I2C_ZERO_PAGE_LEN;
+			list->segments[list->count].data = i2c_zero_page;
+			list->segments[list->count].len = chunk;
+			list->count++;
+		}
+		list->len += chunk;
+		len -= chunk;
+	}
 }
 
-esp_err_t i2c_transmit_write_buffer(i2c_master_dev_handle_t slave_handle)
+esp_err_t i2c_segments_transmit(const i2c_segment_list_t *list, i2c_master_dev_handle_t slave_handle)
 {
 	esp_err_t esp_rc;
-	
-	esp_rc = i2c_master_transmit(slave_handle, write_buffer, write_buffer_len, -1);
-	// for (int i = 0; i < write_buffer_len; i++)
-	// {
-	// 	printf("Byte %d: %x\n", i, write_buffer[i]);
-	// }
 
-	if (esp_rc != ESP_OK)
+	if (list->overflow)
 	{
-		ESP_LOGE("communication: i2c_transmit_write_buffer", "Error transmitting buffer: %d", esp_rc);
-		return esp_rc;
+		ESP_LOGE(COMMUNICATION_TAG, "Refusing to transmit truncated frame");
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	if (list->count == 1)
+	{
+		esp_rc = i2c_master_transmit(slave_handle, list->segments[0].data, list->segments[0].len, -1);
 	}
 	else
-		i2c_clear_write_buffer();
+	{
+#if I2C_HAS_MULTI_BUFFER_TRANSMIT
+		i2c_master_transmit_multi_buffer_info_t buffers[I2C_MAX_SEGMENTS];
+		for (size_t i = 0; i < list->count; i++)
+		{
+			buffers[i].write_buffer = (uint8_t *)list->segments[i].data;
+			buffers[i].buffer_size = list->segments[i].len;
+		}
+		esp_rc = i2c_master_multi_buffer_transmit(slave_handle, buffers, list->count, -1);
+#else
+		if (list->len > I2C_SEGMENT_STAGING_LEN)
+		{
+			ESP_LOGE(COMMUNICATION_TAG, "Frame too large to stage: %d bytes", (int)list->len);
+			return ESP_ERR_INVALID_SIZE;
+		}
+		uint8_t staging[I2C_SEGMENT_STAGING_LEN];
+		size_t offset = 0;
+		for (size_t i = 0; i < list->count; i++)
+		{
+			memcpy(staging + offset, list->segments[i].data, list->segments[i].len);
+			offset += list->segments[i].len;
+		}
+		esp_rc = i2c_master_transmit(slave_handle, staging, offset, -1);
+#endif
+	}
 
-	return ESP_OK;
-}
\ No newline at end of file
+	if (esp_rc != ESP_OK)
+		ESP_LOGE(COMMUNICATION_TAG, "Error transmitting segments: %d", esp_rc);
+	return esp_rc;
+}
+
+void i2c_clear_write_buffer()
+{
+	i2c_transaction_clear(&legacy_transaction);
+}
+
+void i2c_write_byte(const uint8_t byte)
+{
+	i2c_transaction_write_byte(&legacy_transaction, byte);
+}
+
+void i2c_write_bytes(const uint8_t *bytes, const int len)
+{
+	i2c_transaction_write_bytes(&legacy_transaction, bytes, len);
+}
+
+void i2c_write_zero(const int len)
+{
+	i2c_transaction_write_zero(&legacy_transaction, len);
+}
+
+esp_err_t i2c_transmit_write_buffer(i2c_master_dev_handle_t slave_handle)
+{
+	return i2c_transaction_transmit(&legacy_transaction, slave_handle);
+}
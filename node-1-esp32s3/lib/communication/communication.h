@@ -10,15 +10,77 @@
 #pragma once
 
 #include <string.h>
+#include <stdbool.h>
 #include <esp_err.h>
 #include <driver/gpio.h>
 #include "driver/i2c_master.h"
 // #include <driver/uart.h>
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
+#include "esp_idf_version.h"
 
 #define BUFF_LEN 1024
 
+#define I2C_MAX_SEGMENTS 20			// Segments one scatter-gather frame can reference
+#define I2C_ZERO_PAGE_LEN 128		// Size of the shared read-only run of zeros
+#define I2C_SEGMENT_STAGING_LEN 256 // Largest multi-segment frame when the driver needs contiguous memory
+
+// The I2C master driver accepts a list of buffers for one transaction from ESP-IDF 5.3
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+#define I2C_HAS_MULTI_BUFFER_TRANSMIT 1
+#else
+#define I2C_HAS_MULTI_BUFFER_TRANSMIT 0
+#endif
+
+/**
+ * @brief Shared page of zeros, referenced by i2c_segments_add_zero() for padding
+ */
+extern const uint8_t i2c_zero_page[I2C_ZERO_PAGE_LEN];
+
+/**
+ * @brief One contiguous piece of a scatter-gather frame. Not copied, must stay
+ * valid until the frame has been transmitted.
+ */
+typedef struct i2c_segment
+{
+	const uint8_t *data;
+	size_t len;
+} i2c_segment_t;
+
+/**
+ * @brief Scatter-gather frame: an ordered list of const segments sent as one I2C
+ * transaction, so data such as font glyphs is never copied into a staging buffer
+ */
+typedef struct i2c_segment_list
+{
+	i2c_segment_t segments[I2C_MAX_SEGMENTS];
+	size_t count;  // Segments in use
+	size_t len;	   // Total frame length in bytes
+	bool overflow; // Set when a segment did not fit, transmit is refused
+} i2c_segment_list_t;
+
+/**
+ * @brief Caller-owned I2C write transaction.
+ *
+ * Each transaction carries its own backing buffer, so frames built by different
+ * tasks (or for different buses) never share memory and need no global lock.
+ * Typically declared on the stack with I2C_TRANSACTION_DECLARE.
+ */
+typedef struct i2c_transaction
+{
+	uint8_t *buffer; // Backing storage, owned by the caller
+	size_t capacity; // Size of the backing storage in bytes
+	size_t len;		 // Number of bytes appended so far
+	bool overflow;	 // Set when an append did not fit, transmit is refused
+} i2c_transaction_t;
+
+/**
+ * @brief Declares a transaction named `name` backed by `size` bytes of automatic storage
+ */
+#define I2C_TRANSACTION_DECLARE(name, size) \
+	uint8_t name##_storage[size];           \
+	i2c_transaction_t name = {.buffer = name##_storage, .capacity = (size), .len = 0, .overflow = false}
+
 /**
  * @brief Macro Function for shortcutting setting up I2C Master communication
  *
@@ -31,6 +93,116 @@
  */
 esp_err_t i2c_master_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, i2c_master_bus_handle_t *ret_handle);
 
+/**
+ * @brief Binds a transaction to caller-provided storage and empties it
+ *
+ * @param trans Transaction to initialise
+ * @param buffer Backing storage for the frame
+ * @param capacity Size of the backing storage in bytes
+ *
+ * @return void
+ */
+void i2c_transaction_init(i2c_transaction_t *trans, uint8_t *buffer, size_t capacity);
+
+/**
+ * @brief Empties a transaction so a new frame can be built in it. Constant time,
+ * the backing storage is not zeroed.
+ *
+ * @param trans Transaction handle
+ *
+ * @return void
+ */
+void i2c_transaction_clear(i2c_transaction_t *trans);
+
+/**
+ * @brief Appends a single byte to the transaction
+ *
+ * @param trans Transaction handle
+ * @param byte Byte to append
+ *
+ * @return void
+ */
+void i2c_transaction_write_byte(i2c_transaction_t *trans, const uint8_t byte);
+
+/**
+ * @brief Appends a run of bytes to the transaction
+ *
+ * @param trans Transaction handle
+ * @param bytes Bytes to append
+ * @param len Number of bytes
+ *
+ * @return void
+ */
+void i2c_transaction_write_bytes(i2c_transaction_t *trans, const uint8_t *bytes, const int len);
+
+/**
+ * @brief Appends a run of zero bytes to the transaction. Only the run itself is
+ * written, so the cost scales with the frame rather than the buffer capacity.
+ *
+ * @param trans Transaction handle
+ * @param len Number of zero bytes
+ *
+ * @return void
+ */
+void i2c_transaction_write_zero(i2c_transaction_t *trans, const int len);
+
+/**
+ * @brief Transmits the transaction to a device and empties it on success
+ *
+ * @param trans Transaction handle
+ * @param slave_handle I2C device handle
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the frame overflowed, otherwise the driver error
+ */
+esp_err_t i2c_transaction_transmit(i2c_transaction_t *trans, i2c_master_dev_handle_t slave_handle);
+
+/**
+ * @brief Empties a segment list
+ *
+ * @param list Segment list handle
+ *
+ * @return void
+ */
+void i2c_segments_init(i2c_segment_list_t *list);
+
+/**
+ * @brief Appends a reference to caller memory. Merged with the previous segment
+ * when the two are adjacent in memory.
+ *
+ * @param list Segment list handle
+ * @param data Bytes to reference
+ * @param len Number of bytes
+ *
+ * @return void
+ */
+void i2c_segments_add(i2c_segment_list_t *list, const uint8_t *data, size_t len);
+
+/**
+ * @brief Appends a run of zeros backed by the shared zero page
+ *
+ * @param list Segment list handle
+ * @param len Number of zero bytes
+ *
+ * @return void
+ */
+void i2c_segments_add_zero(i2c_segment_list_t *list, size_t len);
+
+/**
+ * @brief Transmits all segments as one I2C transaction. Single-segment frames and
+ * drivers with multi-buffer support are sent without copying. Otherwise the
+ * frame is gathered once into a stack staging buffer of I2C_SEGMENT_STAGING_LEN.
+ *
+ * @param list Segment list handle
+ * @param slave_handle I2C device handle
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the frame overflowed or cannot be staged, otherwise the driver error
+ */
+esp_err_t i2c_segments_transmit(const i2c_segment_list_t *list, i2c_master_dev_handle_t slave_handle);
+
+/*
+ * Legacy single-buffer API. Shares one static transaction between all callers,
+ * so it is NOT safe to use from more than one task. Prefer i2c_transaction_t.
+ */
 void i2c_clear_write_buffer();
 
 void i2c_write_byte(const uint8_t byte);
@@ -0,0 +1,276 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "gesp-stats.h"
+#include "i2c_async.h"
+
+/*
+ * Bounded multi-producer / single-consumer ring (per-slot sequence numbers).
+ * A producer claims a slot by advancing enqueue_pos with a CAS, fills it, then
+ * publishes it by bumping the slot sequence. The worker is the only consumer.
+ */
+typedef struct i2c_async_slot
+{
+    atomic_uint sequence;
+    i2c_async_request_t request;
+    int64_t submit_us;
+} i2c_async_slot_t;
+
+struct i2c_async_engine
+{
+    i2c_master_bus_handle_t bus;
+    TaskHandle_t worker;
+    SemaphoreHandle_t stopped;
+    int timeout_ms;
+    atomic_bool stop;
+
+    uint32_t mask;
+    atomic_uint enqueue_pos;
+    atomic_uint dequeue_pos;
+
+    // Written by producers
+    atomic_uint submitted;
+    atomic_uint rejected;
+    atomic_uint depth_high_water;
+
+    // Written by the worker, copied by i2c_async_get_stats() under stats_lock
+    atomic_uint finished;
+    portMUX_TYPE stats_lock;
+    i2c_async_stats_t stats;
+
+    i2c_async_slot_t slots[];
+};
+
+static uint32_t round_up_pow2(uint32_t value)
+{
+    uint32_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+static bool i2c_async_pop(i2c_async_handle_t engine, i2c_async_slot_t *ret_slot)
+{
+    unsigned int pos = atomic_load_explicit(&engine->dequeue_pos, memory_order_relaxed);
+    i2c_async_slot_t *slot = &engine->slots[pos & engine->mask];
+    unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+    if ((int)(sequence - (pos + 1)) < 0)
+        return false; // Empty
+
+    ret_slot->request = slot->request;
+    ret_slot->submit_us = slot->submit_us;
+    atomic_store_explicit(&engine->dequeue_pos, pos + 1, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, pos + engine->mask + 1, memory_order_release);
+    return true;
+}
+
+static void i2c_async_execute(i2c_async_handle_t engine, const i2c_async_slot_t *slot)
+{
+    const i2c_async_request_t *request = &slot->request;
+    esp_err_t esp_rc;
+
+    int64_t start_us = esp_timer_get_time();
+    if (request->read_len == 0)
+        esp_rc = i2c_master_transmit(request->slave_handle, request->write_buffer, request->write_len, engine->timeout_ms);
+    else if (request->write_len == 0)
+        esp_rc = i2c_master_receive(request->slave_handle, request->read_buffer, request->read_len, engine->timeout_ms);
+    else
+        esp_rc = i2c_master_transmit_receive(request->slave_handle, request->write_buffer, request->write_len,
+                                             request->read_buffer, request->read_len, engine->timeout_ms);
+    int64_t end_us = esp_timer_get_time();
+
+    if (esp_rc != ESP_OK)
+        ESP_LOGE(I2C_ASYNC_TAG, "Transfer failed | Code: 0x%.2X", esp_rc);
+
+    int64_t latency_us = end_us - slot->submit_us;
+    portENTER_CRITICAL(&engine->stats_lock);
+    i2c_async_stats_t *stats = &engine->stats;
+    if (esp_rc == ESP_OK)
+        stats->completed++;
+    else
+        stats->failed++;
+    stats->bytes += request->write_len + request->read_len;
+    stats->busy_us += end_us - start_us;
+    if (latency_us > stats->latency_max_us)
+        stats->latency_max_us = latency_us;
+    stats->latency_histogram[stats_log2_bucket(latency_us, I2C_ASYNC_LATENCY_BUCKETS)]++;
+    portEXIT_CRITICAL(&engine->stats_lock);
+
+    if (request->callback != NULL)
+        request->callback(esp_rc, request->user_ctx);
+    if (request->notify_task != NULL)
+        xTaskNotifyGive(request->notify_task);
+}
+
+static void i2c_async_worker(void *pvParameter)
+{
+    i2c_async_handle_t engine = (i2c_async_handle_t)pvParameter;
+    i2c_async_slot_t slot;
+
+    while (1)
+    {
+        if (i2c_async_pop(engine, &slot))
+        {
+            i2c_async_execute(engine, &slot);
+            atomic_fetch_add_explicit(&engine->finished, 1, memory_order_release);
+            continue;
+        }
+
+        if (atomic_load(&engine->stop))
+            break;
+
+        // Ring is empty, sleep until a producer publishes something
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(engine->stopped);
+    vTaskDelete(NULL);
+}
+
+esp_err_t i2c_async_new(i2c_master_bus_handle_t bus, const i2c_async_config_t *config, i2c_async_handle_t *ret_engine)
+{
+    ESP_RETURN_ON_FALSE(bus != NULL && ret_engine != NULL, ESP_ERR_INVALID_ARG, I2C_ASYNC_TAG, "Invalid argument");
+
+    i2c_async_config_t cfg = {
+        .queue_depth = I2C_ASYNC_DEFAULT_QUEUE_DEPTH,
+        .task_stack = I2C_ASYNC_DEFAULT_TASK_STACK,
+        .task_priority = I2C_ASYNC_DEFAULT_TASK_PRIORITY,
+        .core_id = tskNO_AFFINITY,
+        .timeout_ms = I2C_ASYNC_DEFAULT_TIMEOUT_MS,
+    };
+    if (config != NULL)
+    {
+        if (config->queue_depth)
+            cfg.queue_depth = config->queue_depth;
+        if (config->task_stack)
+            cfg.task_stack = config->task_stack;
+        if (config->task_priority)
+            cfg.task_priority = config->task_priority;
+        if (config->timeout_ms)
+            cfg.timeout_ms = config->timeout_ms;
+        cfg.core_id = config->core_id;
+    }
+
+    uint32_t depth = round_up_pow2(cfg.queue_depth);
+    i2c_async_handle_t engine = calloc(1, sizeof(struct i2c_async_engine) + depth * sizeof(i2c_async_slot_t));
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_NO_MEM, I2C_ASYNC_TAG, "No memory for I2C async engine");
+
+    engine->bus = bus;
+    engine->timeout_ms = cfg.timeout_ms;
+    engine->mask = depth - 1;
+    engine->stats_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    for (uint32_t i = 0; i < depth; i++)
+        atomic_init(&engine->slots[i].sequence, i);
+
+    engine->stopped = xSemaphoreCreateBinary();
+    if (engine->stopped == NULL)
+    {
+        free(engine);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreatePinnedToCore(i2c_async_worker, "i2c_async", cfg.task_stack, engine, cfg.task_priority,
+                                &engine->worker, cfg.core_id) != pdPASS)
+    {
+        vSemaphoreDelete(engine->stopped);
+        free(engine);
+        ESP_LOGE(I2C_ASYNC_TAG, "Worker task creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    *ret_engine = engine;
+    return ESP_OK;
+}
+
+esp_err_t i2c_async_submit(i2c_async_handle_t engine, const i2c_async_request_t *request)
+{
+    ESP_RETURN_ON_FALSE(engine != NULL && request != NULL && request->slave_handle != NULL, ESP_ERR_INVALID_ARG, I2C_ASYNC_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(request->write_len > 0 || request->read_len > 0, ESP_ERR_INVALID_ARG, I2C_ASYNC_TAG, "Empty transfer");
+
+    unsigned int pos = atomic_load_explicit(&engine->enqueue_pos, memory_order_relaxed);
+    i2c_async_slot_t *slot;
+    while (1)
+    {
+        slot = &engine->slots[pos & engine->mask];
+        unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int diff = (int)(sequence - pos);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&engine->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            atomic_fetch_add(&engine->rejected, 1);
+            return ESP_ERR_NO_MEM; // Full
+        }
+        else
+            pos = atomic_load_explicit(&engine->enqueue_pos, memory_order_relaxed);
+    }
+
+    slot->request = *request;
+    slot->submit_us = esp_timer_get_time();
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    atomic_fetch_add(&engine->submitted, 1);
+
+    unsigned int depth = pos + 1 - atomic_load_explicit(&engine->dequeue_pos, memory_order_relaxed);
+    unsigned int high_water = atomic_load(&engine->depth_high_water);
+    while (depth > high_water && !atomic_compare_exchange_weak(&engine->depth_high_water, &high_water, depth))
+        ;
+
+    xTaskNotifyGive(engine->worker);
+    return ESP_OK;
+}
+
+esp_err_t i2c_async_wait_idle(i2c_async_handle_t engine, TickType_t timeout)
+{
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, I2C_ASYNC_TAG, "Invalid argument");
+
+    unsigned int target = atomic_load(&engine->submitted);
+    TickType_t start = xTaskGetTickCount();
+    while ((int)(atomic_load_explicit(&engine->finished, memory_order_acquire) - target) < 0)
+    {
+        if (xTaskGetTickCount() - start >= timeout)
+            return ESP_ERR_TIMEOUT;
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_async_get_stats(i2c_async_handle_t engine, i2c_async_stats_t *ret_stats)
+{
+    ESP_RETURN_ON_FALSE(engine != NULL && ret_stats != NULL, ESP_ERR_INVALID_ARG, I2C_ASYNC_TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&engine->stats_lock);
+    *ret_stats = engine->stats;
+    portEXIT_CRITICAL(&engine->stats_lock);
+    ret_stats->submitted = atomic_load(&engine->submitted);
+    ret_stats->rejected = atomic_load(&engine->rejected);
+    ret_stats->depth_high_water = atomic_load(&engine->depth_high_water);
+    ret_stats->depth = atomic_load(&engine->enqueue_pos) - atomic_load(&engine->dequeue_pos);
+    return ESP_OK;
+}
+
+int64_t i2c_async_latency_percentile(const i2c_async_stats_t *stats, uint8_t percentile)
+{
+    return stats_log2_percentile(stats->latency_histogram, I2C_ASYNC_LATENCY_BUCKETS, stats->latency_max_us, percentile);
+}
+
+esp_err_t i2c_async_del(i2c_async_handle_t engine)
+{
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, I2C_ASYNC_TAG, "Invalid argument");
+
+    atomic_store(&engine->stop, true);
+    xTaskNotifyGive(engine->worker);
+    xSemaphoreTake(engine->stopped, portMAX_DELAY);
+
+    vSemaphoreDelete(engine->stopped);
+    free(engine);
+    return ESP_OK;
+}
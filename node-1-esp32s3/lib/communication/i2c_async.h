@@ -0,0 +1,147 @@
+/**
+ * Asynchronous I2C transaction engine
+ *
+ * Callers submit transactions to a bounded lock-free ring and return immediately.
+ * One worker task per bus drains the ring, performs the transfers and reports
+ * completion through a callback and/or a task notification. This keeps blocking
+ * bus transfers out of button callbacks (esp_timer context) and lets display and
+ * sensor traffic be pipelined.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define I2C_ASYNC_TAG "I2C_ASYNC"
+
+#define I2C_ASYNC_DEFAULT_QUEUE_DEPTH 16
+#define I2C_ASYNC_DEFAULT_TASK_STACK 3072
+#define I2C_ASYNC_DEFAULT_TASK_PRIORITY 5
+#define I2C_ASYNC_DEFAULT_TIMEOUT_MS 100
+
+#define I2C_ASYNC_LATENCY_BUCKETS 20 // Bucket n counts latencies in [2^n, 2^(n+1)) microseconds
+
+/**
+ * @brief Completion callback. Runs in the bus worker task, keep it short.
+ *
+ * @param result Result of the transfer
+ * @param user_ctx Context pointer given at submission
+ */
+typedef void (*i2c_async_cb_t)(esp_err_t result, void *user_ctx);
+
+/**
+ * @brief A single queued transfer
+ *
+ * Write only when read_len is 0, read only when write_len is 0, otherwise a
+ * write followed by a repeated-start read. Buffers are NOT copied and must stay
+ * valid until the transfer completes.
+ */
+typedef struct i2c_async_request
+{
+    i2c_master_dev_handle_t slave_handle; // Target device, must be on the engine's bus
+    const uint8_t *write_buffer;          // Bytes to write
+    size_t write_len;                     // Number of bytes to write
+    uint8_t *read_buffer;                 // Destination for read bytes
+    size_t read_len;                      // Number of bytes to read
+    i2c_async_cb_t callback;              // Optional completion callback
+    void *user_ctx;                       // Passed to the callback
+    TaskHandle_t notify_task;             // Optional task given a notification on completion
+} i2c_async_request_t;
+
+/**
+ * @brief Engine configuration. Zeroed fields fall back to the defaults above.
+ */
+typedef struct i2c_async_config
+{
+    uint16_t queue_depth;   // Ring size, rounded up to a power of two
+    uint32_t task_stack;    // Worker stack size
+    UBaseType_t task_priority; // Worker priority
+    BaseType_t core_id;     // Core to pin the worker to, tskNO_AFFINITY for any
+    int timeout_ms;         // Per-transfer bus timeout
+} i2c_async_config_t;
+
+/**
+ * @brief Engine statistics, a snapshot taken by i2c_async_get_stats()
+ */
+typedef struct i2c_async_stats
+{
+    uint32_t submitted;      // Requests accepted into the ring
+    uint32_t rejected;       // Requests refused because the ring was full
+    uint32_t completed;      // Requests finished successfully
+    uint32_t failed;         // Requests finished with a bus error
+    uint32_t depth;          // Requests currently queued
+    uint32_t depth_high_water; // Deepest the ring has been
+    uint64_t bytes;          // Total bytes written and read
+    int64_t busy_us;         // Time the worker spent on the bus
+    int64_t latency_max_us;  // Worst submit-to-complete latency
+    uint32_t latency_histogram[I2C_ASYNC_LATENCY_BUCKETS];
+} i2c_async_stats_t;
+
+typedef struct i2c_async_engine *i2c_async_handle_t;
+
+/**
+ * @brief Creates an engine and its worker task for one I2C bus
+ *
+ * @param bus I2C master bus the engine owns
+ * @param config Engine configuration, NULL for defaults
+ * @param ret_engine Returned engine handle
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if allocation or task creation failed
+ */
+esp_err_t i2c_async_new(i2c_master_bus_handle_t bus, const i2c_async_config_t *config, i2c_async_handle_t *ret_engine);
+
+/**
+ * @brief Queues a transfer without blocking. Safe to call from any task,
+ * including esp_timer callbacks. Not for use from an ISR.
+ *
+ * @param engine Engine handle
+ * @param request Transfer description, copied into the ring
+ *
+ * @return ESP_OK if queued, ESP_ERR_NO_MEM if the ring is full
+ */
+esp_err_t i2c_async_submit(i2c_async_handle_t engine, const i2c_async_request_t *request);
+
+/**
+ * @brief Blocks until every transfer queued so far has completed
+ *
+ * @param engine Engine handle
+ * @param timeout Maximum time to wait
+ *
+ * @return ESP_OK when idle, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t i2c_async_wait_idle(i2c_async_handle_t engine, TickType_t timeout);
+
+/**
+ * @brief Copies the engine statistics
+ *
+ * @param engine Engine handle
+ * @param ret_stats Returned statistics
+ *
+ * @return ESP_OK
+ */
+esp_err_t i2c_async_get_stats(i2c_async_handle_t engine, i2c_async_stats_t *ret_stats);
+
+/**
+ * @brief Estimates a latency percentile from the statistics histogram
+ *
+ * @param stats Statistics snapshot
+ * @param percentile Percentile to estimate (0 - 100)
+ *
+ * @return Upper bound of the bucket holding the percentile, at most latency_max_us, in microseconds
+ */
+int64_t i2c_async_latency_percentile(const i2c_async_stats_t *stats, uint8_t percentile);
+
+/**
+ * @brief Stops the worker after the ring drains and frees the engine
+ *
+ * @param engine Engine handle
+ *
+ * @return ESP_OK
+ */
+esp_err_t i2c_async_del(i2c_async_handle_t engine);
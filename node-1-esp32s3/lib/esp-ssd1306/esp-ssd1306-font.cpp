@@ -0,0 +1,103 @@
+#include "esp-ssd1306-font.h"
+#include "font8x8_basic.h"
+
+namespace
+{
+    constexpr bool pixel(const uint8_t *glyph, int col, int row)
+    {
+        return (glyph[col] >> row) & 1;
+    }
+
+    // Column col, row row of the source pixel that lands at (col, row) after rotation
+    constexpr bool rotated_pixel(const uint8_t *glyph, int rotation, int col, int row)
+    {
+        switch (rotation)
+        {
+        case SSD1306_ROTATE_90:
+            return pixel(glyph, row, 7 - col);
+        case SSD1306_ROTATE_180:
+            return pixel(glyph, 7 - col, 7 - row);
+        case SSD1306_ROTATE_270:
+            return pixel(glyph, 7 - row, col);
+        default:
+            return pixel(glyph, col, row);
+        }
+    }
+
+    constexpr uint16_t spread2(uint8_t bits)
+    {
+        uint16_t result = 0;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            if ((bits >> bit) & 1)
+                result |= 3u << (bit * 2);
+        }
+        return result;
+    }
+
+    constexpr ssd1306_font_atlas_t build_atlas()
+    {
+        ssd1306_font_atlas_t atlas{};
+        for (int c = 0; c < SSD1306_FONT_GLYPHS; c++)
+        {
+            const uint8_t *glyph = font8x8_basic[c];
+            for (int rotation = 0; rotation < SSD1306_ROTATIONS; rotation++)
+            {
+                for (int col = 0; col < 8; col++)
+                {
+                    uint8_t bits = 0;
+                    for (int row = 0; row < 8; row++)
+                    {
+                        if (rotated_pixel(glyph, rotation, col, row))
+                            bits |= 1u << row;
+                    }
+                    atlas.rotated[rotation][c][col] = bits;
+                    atlas.inverted[rotation][c][col] = ~bits;
+                }
+            }
+            for (int col = 0; col < 8; col++)
+            {
+                atlas.scaled2x[c][col * 2] = spread2(glyph[col]);
+                atlas.scaled2x[c][col * 2 + 1] = spread2(glyph[col]);
+            }
+        }
+        return atlas;
+    }
+}
+
+// Constant initialised at compile time, so it is placed in flash. Declared extern "C" in the header.
+constexpr ssd1306_font_atlas_t ssd1306_font_atlas = build_atlas();
+
+namespace
+{
+    constexpr const ssd1306_font_atlas_t &atlas = ssd1306_font_atlas;
+
+    constexpr bool rotations_compose()
+    {
+        for (int c = 0; c < SSD1306_FONT_GLYPHS; c++)
+        {
+            for (int col = 0; col < 8; col++)
+            {
+                for (int row = 0; row < 8; row++)
+                {
+                    // Two quarter turns make a half turn, and a half turn undone is upright
+                    if (rotated_pixel(atlas.rotated[SSD1306_ROTATE_90][c], SSD1306_ROTATE_90, col, row) !=
+                        pixel(atlas.rotated[SSD1306_ROTATE_180][c], col, row))
+                        return false;
+                    if (rotated_pixel(atlas.rotated[SSD1306_ROTATE_180][c], SSD1306_ROTATE_180, col, row) !=
+                        pixel(font8x8_basic[c], col, row))
+                        return false;
+                    if (rotated_pixel(atlas.rotated[SSD1306_ROTATE_270][c], SSD1306_ROTATE_90, col, row) !=
+                        pixel(font8x8_basic[c], col, row))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert(rotations_compose(), "Font atlas rotations are inconsistent");
+    static_assert(atlas.rotated[SSD1306_ROTATE_0]['A'][0] == font8x8_basic['A'][0], "Upright glyphs must match the source font");
+    static_assert(atlas.inverted[SSD1306_ROTATE_0][' '][3] == 0xFF, "Inverted space must be solid");
+    static_assert(atlas.scaled2x['|'][6] == 0x3F3F && atlas.scaled2x['|'][7] == 0x3F3F, "2x glyph columns must be doubled");
+}
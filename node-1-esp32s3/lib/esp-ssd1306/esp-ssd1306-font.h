@@ -0,0 +1,73 @@
+/**
+ * Pre-rendered font atlas for the SSD1306 driver
+ *
+ * Every glyph variant the driver draws (rotated, inverted, 2x scaled) is generated
+ * from font8x8_basic at compile time and placed in flash, so rendering one is a
+ * straight copy of its column bytes into the framebuffer.
+ *
+ * Glyph format is the same as font8x8_basic: byte n is column n, bit 0 the top row.
+ * 2x glyphs are 16 columns of 16 bit words.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SSD1306_FONT_GLYPHS 128
+#define SSD1306_FONT_2X_WIDTH 16
+
+typedef enum
+{
+    SSD1306_ROTATE_0,   // Upright
+    SSD1306_ROTATE_90,  // Quarter turn clockwise
+    SSD1306_ROTATE_180, // Upside down
+    SSD1306_ROTATE_270, // Quarter turn anticlockwise
+    SSD1306_ROTATIONS,
+} ssd1306_rotation_t;
+
+typedef struct ssd1306_font_atlas
+{
+    uint8_t rotated[SSD1306_ROTATIONS][SSD1306_FONT_GLYPHS][8];    // Indexed by ssd1306_rotation_t
+    uint8_t inverted[SSD1306_ROTATIONS][SSD1306_FONT_GLYPHS][8];   // Rotated glyphs with every pixel flipped
+    uint16_t scaled2x[SSD1306_FONT_GLYPHS][SSD1306_FONT_2X_WIDTH]; // Upright glyphs at 16x16
+} ssd1306_font_atlas_t;
+
+extern const ssd1306_font_atlas_t ssd1306_font_atlas;
+
+/**
+ * @brief Looks up a rotated, optionally inverted, 8x8 glyph
+ *
+ * @param character Character (U+0000 - U+007F)
+ * @param rotation Glyph rotation
+ * @param inverted Return the glyph with every pixel flipped (highlighted text)
+ *
+ * @return Pointer to the 8 glyph columns
+ */
+static inline const uint8_t *ssd1306_font_glyph(const char character, ssd1306_rotation_t rotation, bool inverted)
+{
+    const uint8_t(*set)[SSD1306_FONT_GLYPHS][8] = inverted ? ssd1306_font_atlas.inverted : ssd1306_font_atlas.rotated;
+    return set[rotation & 3][(uint8_t)character & 0x7F];
+}
+
+/**
+ * @brief Looks up a 16x16 (2x scaled) glyph
+ *
+ * @param character Character (U+0000 - U+007F)
+ *
+ * @return Pointer to the 16 glyph columns
+ */
+static inline const uint16_t *ssd1306_font_glyph_2x(const char character)
+{
+    return ssd1306_font_atlas.scaled2x[(uint8_t)character & 0x7F];
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,374 @@
+#include "esp-ssd1306-gfx.h"
+
+// Spreads each bit of a nibble over two adjacent bits (bit n -> bits 2n, 2n+1)
+static const uint8_t spread2_nibble[16] = {
+	0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F,
+	0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF,
+};
+
+static inline uint16_t spread2(uint8_t bits)
+{
+	return (uint16_t)spread2_nibble[bits & 0x0F] | ((uint16_t)spread2_nibble[bits >> 4] << 8);
+}
+
+static inline uint32_t spread4(uint8_t bits)
+{
+	uint16_t doubled = spread2(bits);
+	return (uint32_t)spread2(doubled & 0xFF) | ((uint32_t)spread2(doubled >> 8) << 16);
+}
+
+static inline void ssd1306_apply(uint8_t *cell, uint8_t bits, ssd1306_colour_t colour)
+{
+	switch (colour)
+	{
+	case SSD1306_COLOUR_OFF:
+		*cell &= ~bits;
+		break;
+	case SSD1306_COLOUR_ON:
+		*cell |= bits;
+		break;
+	case SSD1306_COLOUR_INVERT:
+		*cell ^= bits;
+		break;
+	}
+}
+
+/**
+ * @brief Merges up to 32 vertical pixels into one framebuffer column.
+ *
+ * The column is shifted to its row offset once, then written a page byte at a time.
+ * Opaque blits replace every pixel under mask with bits. Otherwise colour is applied
+ * to the set bits only.
+ */
+static void ssd1306_blit_column(ssd1306_t *device, int16_t x, int16_t y, uint32_t bits, uint32_t mask, bool opaque, ssd1306_colour_t colour)
+{
+	if (x < 0 || x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT || y <= -32 || mask == 0)
+		return;
+
+	uint64_t word_bits = bits & mask;
+	uint64_t word_mask = mask;
+	int16_t page;
+	if (y < 0)
+	{
+		word_bits >>= -y;
+		word_mask >>= -y;
+		page = 0;
+	}
+	else
+	{
+		word_bits <<= (y & 7);
+		word_mask <<= (y & 7);
+		page = y >> 3;
+	}
+
+	for (; page < MAX_PAGES && word_mask != 0; page++, word_bits >>= 8, word_mask >>= 8)
+	{
+		uint8_t page_mask = word_mask & 0xFF;
+		if (page_mask == 0)
+			continue;
+		uint8_t *cell = &device->framebuffer[page][x];
+		if (opaque)
+			*cell = (*cell & ~page_mask) | (word_bits & 0xFF);
+		else
+			ssd1306_apply(cell, word_bits & 0xFF, colour);
+		ssd1306_mark_dirty(device, page, x, x + 1);
+	}
+}
+
+void ssd1306_draw_pixel(ssd1306_t *device, int16_t x, int16_t y, ssd1306_colour_t colour)
+{
+	if (x < 0 || x >= SSD1306_WIDTH || y < 0 || y >= SSD1306_HEIGHT)
+		return;
+	ssd1306_apply(&device->framebuffer[y >> 3][x], 1 << (y & 7), colour);
+	ssd1306_mark_dirty(device, y >> 3, x, x + 1);
+}
+
+void ssd1306_fill_rect(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h, ssd1306_colour_t colour)
+{
+	// Clip to the panel
+	int16_t x_end = x + w;
+	int16_t y_end = y + h;
+	if (x < 0)
+		x = 0;
+	if (y < 0)
+		y = 0;
+	if (x_end > SSD1306_WIDTH)
+		x_end = SSD1306_WIDTH;
+	if (y_end > SSD1306_HEIGHT)
+		y_end = SSD1306_HEIGHT;
+	if (x >= x_end || y >= y_end)
+		return;
+
+	// One mask per page, applied a byte at a time along the row
+	for (int16_t page = y >> 3; page <= (y_end - 1) >> 3; page++)
+	{
+		int16_t top = page * 8;
+		uint8_t mask = 0xFF;
+		if (y > top)
+			mask &= 0xFF << (y - top);
+		if (y_end < top + 8)
+			mask &= 0xFF >> (top + 8 - y_end);
+
+		uint8_t *row = device->framebuffer[page];
+		for (int16_t col = x; col < x_end; col++)
+		{
+			ssd1306_apply(&row[col], mask, colour);
+		}
+		ssd1306_mark_dirty(device, page, x, x_end);
+	}
+}
+
+void ssd1306_draw_hline(ssd1306_t *device, int16_t x, int16_t y, int16_t w, ssd1306_colour_t colour)
+{
+	ssd1306_fill_rect(device, x, y, w, 1, colour);
+}
+
+void ssd1306_draw_vline(ssd1306_t *device, int16_t x, int16_t y, int16_t h, ssd1306_colour_t colour)
+{
+	ssd1306_fill_rect(device, x, y, 1, h, colour);
+}
+
+void ssd1306_draw_line(ssd1306_t *device, int16_t x0, int16_t y0, int16_t x1, int16_t y1, ssd1306_colour_t colour)
+{
+	if (y0 == y1)
+	{
+		ssd1306_draw_hline(device, x0 < x1 ? x0 : x1, y0, (x0 < x1 ? x1 - x0 : x0 - x1) + 1, colour);
+		return;
+	}
+	if (x0 == x1)
+	{
+		ssd1306_draw_vline(device, x0, y0 < y1 ? y0 : y1, (y0 < y1 ? y1 - y0 : y0 - y1) + 1, colour);
+		return;
+	}
+
+	int16_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+	int16_t dy = y1 > y0 ? y0 - y1 : y1 - y0; // Negative
+	int16_t step_x = x0 < x1 ? 1 : -1;
+	int16_t step_y = y0 < y1 ? 1 : -1;
+	int16_t error = dx + dy;
+
+	while (1)
+	{
+		ssd1306_draw_pixel(device, x0, y0, colour);
+		if (x0 == x1 && y0 == y1)
+			break;
+		int16_t error2 = 2 * error;
+		if (error2 >= dy)
+		{
+			error += dy;
+			x0 += step_x;
+		}
+		if (error2 <= dx)
+		{
+			error += dx;
+			y0 += step_y;
+		}
+	}
+}
+
+void ssd1306_draw_rect(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h, ssd1306_colour_t colour)
+{
+	if (w <= 0 || h <= 0)
+		return;
+	ssd1306_draw_hline(device, x, y, w, colour);
+	if (h > 1)
+		ssd1306_draw_hline(device, x, y + h - 1, w, colour);
+	if (h > 2)
+	{
+		ssd1306_draw_vline(device, x, y + 1, h - 2, colour);
+		if (w > 1)
+			ssd1306_draw_vline(device, x + w - 1, y + 1, h - 2, colour);
+	}
+}
+
+void ssd1306_draw_bar(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h, int32_t value, int32_t max)
+{
+	if (w < 5 || h < 5 || max <= 0)
+		return;
+	if (value < 0)
+		value = 0;
+	if (value > max)
+		value = max;
+
+	// Outline, a one pixel gap, then the fill
+	int16_t inner_w = w - 4;
+	int16_t filled = (int16_t)(((int32_t)inner_w * value) / max);
+	ssd1306_draw_rect(device, x, y, w, h, SSD1306_COLOUR_ON);
+	ssd1306_fill_rect(device, x + 1, y + 1, w - 2, h - 2, SSD1306_COLOUR_OFF);
+	ssd1306_fill_rect(device, x + 2, y + 2, filled, h - 4, SSD1306_COLOUR_ON);
+}
+
+void ssd1306_draw_sparkline(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h,
+							const float *values, uint16_t n, float min, float max)
+{
+	if (w <= 0 || h <= 0 || n == 0)
+		return;
+	ssd1306_fill_rect(device, x, y, w, h, SSD1306_COLOUR_OFF);
+
+	float range = max - min;
+	int16_t prev_x = 0, prev_y = 0;
+	for (uint16_t i = 0; i < n; i++)
+	{
+		float scaled = range > 0 ? (values[i] - min) / range : 0.5f;
+		if (scaled < 0)
+			scaled = 0;
+		if (scaled > 1)
+			scaled = 1;
+
+		int16_t px = x + (n > 1 ? (int16_t)(((int32_t)i * (w - 1)) / (n - 1)) : 0);
+		int16_t py = y + (h - 1) - (int16_t)(scaled * (h - 1) + 0.5f);
+		if (i == 0)
+			ssd1306_draw_pixel(device, px, py, SSD1306_COLOUR_ON);
+		else
+			ssd1306_draw_line(device, prev_x, prev_y, px, py, SSD1306_COLOUR_ON);
+		prev_x = px;
+		prev_y = py;
+	}
+}
+
+void ssd1306_draw_bitmap(ssd1306_t *device, int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, ssd1306_colour_t colour)
+{
+	if (w <= 0 || h <= 0)
+		return;
+
+	int16_t pages = (h + 7) / 8;
+	for (int16_t col = 0; col < w; col++)
+	{
+		// Up to four source pages are packed into one 32 bit column word per blit
+		for (int16_t page = 0; page < pages; page += 4)
+		{
+			uint32_t bits = 0;
+			for (int16_t i = 0; i < 4 && page + i < pages; i++)
+			{
+				bits |= (uint32_t)bitmap[(page + i) * w + col] << (8 * i);
+			}
+			int16_t rows = h - page * 8;
+			uint32_t mask = rows >= 32 ? 0xFFFFFFFF : ((uint32_t)1 << rows) - 1;
+			ssd1306_blit_column(device, x + col, y + page * 8, bits & mask, bits & mask, false, colour);
+		}
+	}
+}
+
+/**
+ * @brief Inked column range of a glyph, [first, last]. Returns false for blank glyphs.
+ */
+static bool ssd1306_glyph_extent(const uint8_t *glyph, uint8_t *first, uint8_t *last)
+{
+	int8_t start = -1, end = -1;
+	for (uint8_t col = 0; col < SSD1306_FONT_WIDTH; col++)
+	{
+		if (glyph[col] == 0)
+			continue;
+		if (start < 0)
+			start = col;
+		end = col;
+	}
+	if (start < 0)
+		return false;
+	*first = start;
+	*last = end;
+	return true;
+}
+
+static int16_t ssd1306_blit_glyph(ssd1306_t *device, int16_t x, int16_t y, const char character,
+								  uint8_t scale, bool proportional, bool draw)
+{
+	const uint8_t *glyph = ssd1306_glyph(character);
+	uint8_t first = 0, last = SSD1306_FONT_WIDTH - 1;
+	uint8_t trailing = 0;
+
+	if (proportional)
+	{
+		if (!ssd1306_glyph_extent(glyph, &first, &last))
+		{
+			if (draw)
+				ssd1306_fill_rect(device, x, y, SSD1306_PROPORTIONAL_SPACE_WIDTH * scale, SSD1306_FONT_HEIGHT * scale, SSD1306_COLOUR_OFF);
+			return SSD1306_PROPORTIONAL_SPACE_WIDTH * scale;
+		}
+		trailing = SSD1306_PROPORTIONAL_GAP;
+	}
+
+	int16_t advance = (last - first + 1 + trailing) * scale;
+	if (!draw)
+		return advance;
+
+	uint32_t mask = scale == 4 ? 0xFFFFFFFF : scale == 2 ? 0xFFFF : 0xFF;
+	int16_t column = x;
+	if (scale == 2)
+	{
+		// Pre-scaled in the font atlas, columns are already doubled
+		const uint16_t *glyph_2x = ssd1306_font_glyph_2x(character);
+		for (uint8_t col = first * 2; col < (last + 1) * 2; col++)
+		{
+			ssd1306_blit_column(device, column++, y, glyph_2x[col], mask, true, SSD1306_COLOUR_ON);
+		}
+		for (uint8_t col = 0; col < trailing * 2; col++)
+		{
+			ssd1306_blit_column(device, column++, y, 0, mask, true, SSD1306_COLOUR_ON);
+		}
+		return advance;
+	}
+
+	for (uint8_t col = first; col <= last + trailing; col++)
+	{
+		uint8_t source = col <= last ? glyph[col] : 0;
+		uint32_t bits = scale == 4 ? spread4(source) : source;
+		for (uint8_t repeat = 0; repeat < scale; repeat++)
+		{
+			ssd1306_blit_column(device, column++, y, bits, mask, true, SSD1306_COLOUR_ON);
+		}
+	}
+	return advance;
+}
+
+static uint8_t ssd1306_valid_scale(uint8_t scale)
+{
+	return (scale == 2 || scale == 4) ? scale : 1;
+}
+
+int16_t ssd1306_draw_char(ssd1306_t *device, int16_t x, int16_t y, const char character, uint8_t scale)
+{
+	return ssd1306_blit_glyph(device, x, y, character, ssd1306_valid_scale(scale), false, true);
+}
+
+void ssd1306_draw_glyph(ssd1306_t *device, int16_t x, int16_t y, const char character,
+						ssd1306_rotation_t rotation, bool inverted)
+{
+	const uint8_t *glyph = ssd1306_font_glyph(character, rotation, inverted);
+
+	if ((y & 7) == 0 && y >= 0 && y < SSD1306_HEIGHT && x >= 0 && x < SSD1306_WIDTH)
+	{
+		// Page aligned: the atlas glyph is copied straight into the framebuffer
+		uint8_t width = (SSD1306_WIDTH - x < SSD1306_FONT_WIDTH) ? SSD1306_WIDTH - x : SSD1306_FONT_WIDTH;
+		memcpy(&device->framebuffer[y >> 3][x], glyph, width);
+		ssd1306_mark_dirty(device, y >> 3, x, x + width);
+		return;
+	}
+
+	for (uint8_t col = 0; col < SSD1306_FONT_WIDTH; col++)
+	{
+		ssd1306_blit_column(device, x + col, y, glyph[col], 0xFF, true, SSD1306_COLOUR_ON);
+	}
+}
+
+int16_t ssd1306_draw_string(ssd1306_t *device, int16_t x, int16_t y, const char *text, uint8_t scale, bool proportional)
+{
+	scale = ssd1306_valid_scale(scale);
+	int16_t start = x;
+	for (; *text != '\0' && x < SSD1306_WIDTH; text++)
+	{
+		x += ssd1306_blit_glyph(device, x, y, *text, scale, proportional, true);
+	}
+	return x - start;
+}
+
+int16_t ssd1306_text_width(const char *text, uint8_t scale, bool proportional)
+{
+	scale = ssd1306_valid_scale(scale);
+	int16_t width = 0;
+	for (; *text != '\0'; text++)
+	{
+		width += ssd1306_blit_glyph(NULL, 0, 0, *text, scale, proportional, false);
+	}
+	return width;
+}
@@ -0,0 +1,172 @@
+/**
+ * Graphics primitives for the SSD1306 framebuffer
+ *
+ * Pixel-addressed drawing into ssd1306_t::framebuffer. Nothing is sent to the
+ * panel until flush() is called. Coordinates are clipped to the panel, so shapes
+ * may be partially off-screen.
+ *
+ * The framebuffer is page-organised (each byte is 8 vertical pixels), so vertical
+ * runs, bitmaps and text are blitted a column-word at a time: the source column is
+ * shifted into place once and merged into each page it spans with a mask.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp-ssd1306.h"
+#include "esp-ssd1306-font.h"
+
+#define SSD1306_FONT_WIDTH 8
+#define SSD1306_FONT_HEIGHT 8
+#define SSD1306_PROPORTIONAL_SPACE_WIDTH 4 // Advance of ' ' in proportional text
+#define SSD1306_PROPORTIONAL_GAP 1         // Blank columns between proportional glyphs
+
+typedef enum
+{
+    SSD1306_COLOUR_OFF,    // Clear pixels
+    SSD1306_COLOUR_ON,     // Set pixels
+    SSD1306_COLOUR_INVERT, // Toggle pixels
+} ssd1306_colour_t;
+
+/**
+ * @brief Sets, clears or toggles a single pixel
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param x Column (0 - SSD1306_WIDTH)
+ * @param y Row (0 - SSD1306_HEIGHT)
+ * @param colour Pixel operation
+ *
+ * @return void
+ */
+void ssd1306_draw_pixel(ssd1306_t *device, int16_t x, int16_t y, ssd1306_colour_t colour);
+
+/**
+ * @brief Draws a horizontal line of w pixels starting at (x, y)
+ */
+void ssd1306_draw_hline(ssd1306_t *device, int16_t x, int16_t y, int16_t w, ssd1306_colour_t colour);
+
+/**
+ * @brief Draws a vertical line of h pixels starting at (x, y)
+ */
+void ssd1306_draw_vline(ssd1306_t *device, int16_t x, int16_t y, int16_t h, ssd1306_colour_t colour);
+
+/**
+ * @brief Draws a line between two points (Bresenham)
+ */
+void ssd1306_draw_line(ssd1306_t *device, int16_t x0, int16_t y0, int16_t x1, int16_t y1, ssd1306_colour_t colour);
+
+/**
+ * @brief Draws the outline of a w x h rectangle with its top left corner at (x, y)
+ */
+void ssd1306_draw_rect(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h, ssd1306_colour_t colour);
+
+/**
+ * @brief Fills a w x h rectangle with its top left corner at (x, y)
+ */
+void ssd1306_fill_rect(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h, ssd1306_colour_t colour);
+
+/**
+ * @brief Draws a horizontal gauge: an outlined w x h box filled in proportion to value / max
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param x Left column
+ * @param y Top row
+ * @param w Width in pixels, including the outline
+ * @param h Height in pixels, including the outline
+ * @param value Current value, clamped to 0 - max
+ * @param max Full scale value
+ *
+ * @return void
+ */
+void ssd1306_draw_bar(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h, int32_t value, int32_t max);
+
+/**
+ * @brief Draws a sparkline of n samples scaled into a w x h box. The box is cleared first.
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param x Left column
+ * @param y Top row
+ * @param w Width in pixels
+ * @param h Height in pixels
+ * @param values Samples, oldest first
+ * @param n Number of samples
+ * @param min Value drawn on the bottom row
+ * @param max Value drawn on the top row
+ *
+ * @return void
+ */
+void ssd1306_draw_sparkline(ssd1306_t *device, int16_t x, int16_t y, int16_t w, int16_t h,
+                            const float *values, uint16_t n, float min, float max);
+
+/**
+ * @brief Blits a page-format bitmap: ceil(h / 8) rows of w column bytes, bit 0 at the top.
+ * Set bits are drawn in colour, clear bits are left untouched.
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param x Left column
+ * @param y Top row, need not be page aligned
+ * @param bitmap Bitmap data
+ * @param w Width in pixels
+ * @param h Height in pixels
+ * @param colour Pixel operation for set bits
+ *
+ * @return void
+ */
+void ssd1306_draw_bitmap(ssd1306_t *device, int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, ssd1306_colour_t colour);
+
+/**
+ * @brief Draws one character at any pixel position, scaled by 1, 2 or 4. The glyph cell
+ * is drawn opaque (background cleared). 2x glyphs come pre-scaled from the font atlas.
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param x Left column
+ * @param y Top row
+ * @param character Character (U+0000 - U+007F)
+ * @param scale Scale factor (1, 2 or 4)
+ *
+ * @return Horizontal advance in pixels
+ */
+int16_t ssd1306_draw_char(ssd1306_t *device, int16_t x, int16_t y, const char character, uint8_t scale);
+
+/**
+ * @brief Draws one rotated and/or inverted 8x8 character from the font atlas, opaque.
+ * When y is page aligned the glyph is copied straight into the framebuffer.
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param x Left column
+ * @param y Top row
+ * @param character Character (U+0000 - U+007F)
+ * @param rotation Glyph rotation
+ * @param inverted Draw dark text on a lit cell (highlighted rows)
+ *
+ * @return void
+ */
+void ssd1306_draw_glyph(ssd1306_t *device, int16_t x, int16_t y, const char character,
+                        ssd1306_rotation_t rotation, bool inverted);
+
+/**
+ * @brief Draws a string at any pixel position
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param x Left column
+ * @param y Top row
+ * @param text Null terminated text
+ * @param scale Scale factor (1, 2 or 4)
+ * @param proportional Advance by each glyph's inked width instead of the fixed 8 pixel cell
+ *
+ * @return Width of the drawn text in pixels
+ */
+int16_t ssd1306_draw_string(ssd1306_t *device, int16_t x, int16_t y, const char *text, uint8_t scale, bool proportional);
+
+/**
+ * @brief Measures a string without drawing it
+ *
+ * @param text Null terminated text
+ * @param scale Scale factor (1, 2 or 4)
+ * @param proportional Measure proportional rather than fixed-cell advance
+ *
+ * @return Width in pixels
+ */
+int16_t ssd1306_text_width(const char *text, uint8_t scale, bool proportional);
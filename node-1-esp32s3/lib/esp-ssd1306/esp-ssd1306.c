@@ -1,5 +1,11 @@
-#include "font8x8_basic.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include "esp-ssd1306.h"
+#include "esp-ssd1306-font.h"
+
+// Bus bytes of one window transaction: address byte, window header and data
+#define SSD1306_WINDOW_COST(len) (1 + SSD1306_WINDOW_HEADER_LEN + (size_t)(len))
 
 // void task_ssd1306_scroll(void *ignore)
 // {
@@ -40,32 +46,326 @@
 // 	vTaskDelete(NULL);
 // }
 
+/**
+ * @brief Fills the command header that limits GDDRAM writes to a column and page window
+ * (horizontal addressing mode), followed by the data stream control byte
+ */
+static void ssd1306_window_header(uint8_t header[SSD1306_WINDOW_HEADER_LEN], uint8_t col_start, uint8_t col_end, uint8_t page_start, uint8_t page_end)
+{
+	header[0] = OLED_CONTROL_BYTE_CMD;
+	header[1] = OLED_CMD_SET_COLUMN_RANGE;
+	header[2] = OLED_CONTROL_BYTE_CMD;
+	header[3] = col_start;
+	header[4] = OLED_CONTROL_BYTE_CMD;
+	header[5] = col_end;
+	header[6] = OLED_CONTROL_BYTE_CMD;
+	header[7] = OLED_CMD_SET_PAGE_RANGE;
+	header[8] = OLED_CONTROL_BYTE_CMD;
+	header[9] = page_start;
+	header[10] = OLED_CONTROL_BYTE_CMD;
+	header[11] = page_end;
+	header[12] = OLED_CONTROL_BYTE_GDDRAM_DATA_STREAM;
+}
+
+const uint8_t *ssd1306_glyph(const char character)
+{
+	return ssd1306_font_glyph(character, SSD1306_ROTATE_0, false);
+}
+
+void ssd1306_mark_dirty(ssd1306_t *device, uint8_t page, uint8_t start, uint8_t end)
+{
+	if (device->dirty_start[page] == device->dirty_end[page])
+	{
+		device->dirty_start[page] = start;
+		device->dirty_end[page] = end;
+		return;
+	}
+	if (start < device->dirty_start[page])
+		device->dirty_start[page] = start;
+	if (end > device->dirty_end[page])
+		device->dirty_end[page] = end;
+}
+
+_Static_assert(offsetof(ssd1306_t, framebuffer) == offsetof(ssd1306_t, frame_header) + SSD1306_WINDOW_HEADER_LEN,
+			   "frame_header must directly precede framebuffer");
+
+static void ssd1306_mark_clean(ssd1306_t *device, uint8_t page_start, uint8_t page_end)
+{
+	for (uint8_t page = page_start; page < MAX_PAGES && page <= page_end; page++)
+	{
+		device->dirty_start[page] = 0;
+		device->dirty_end[page] = 0;
+	}
+}
+
+/**
+ * @brief Drops one reference to the queued upload: each queued window holds one and the flush
+ * queueing them holds one. The last gives async_idle back. Runs in the engine's worker task for windows.
+ */
+static void ssd1306_async_release(ssd1306_t *device, esp_err_t result)
+{
+	portENTER_CRITICAL(&device->async_lock);
+	if (result != ESP_OK)
+		device->async_result = result;
+	bool idle = --device->async_refs == 0;
+	portEXIT_CRITICAL(&device->async_lock);
+	if (idle)
+		xSemaphoreGive(device->async_idle);
+}
+
+// Runs in the engine's worker task
+static void ssd1306_async_done(esp_err_t result, void *user_ctx)
+{
+	ssd1306_async_release((ssd1306_t *)user_ctx, result);
+}
+
+/**
+ * @brief Waits for the previous asynchronous upload and takes the flush's reference to the next.
+ * A failed upload left the panel in an unknown state, so the whole frame is marked dirty.
+ */
+static esp_err_t ssd1306_async_acquire(ssd1306_t *device)
+{
+	if (xSemaphoreTake(device->async_idle, pdMS_TO_TICKS(SSD1306_ASYNC_WAIT_MS)) != pdTRUE)
+	{
+		ESP_LOGE(SSD1306_TAG, "Previous upload still queued");
+		return ESP_ERR_TIMEOUT;
+	}
+	if (device->async_result != ESP_OK)
+	{
+		for (uint8_t page = 0; page < MAX_PAGES; page++)
+			ssd1306_mark_dirty(device, page, 0, SSD1306_WIDTH);
+		device->async_result = ESP_OK;
+	}
+	device->async_refs = 1;
+	return ESP_OK;
+}
+
+/**
+ * @brief Packs one window into the transmit buffer at offset and queues it, then moves offset past
+ * it. Called between ssd1306_async_acquire() and ssd1306_async_release().
+ */
+static esp_err_t ssd1306_queue_window(ssd1306_t *device, size_t *offset, uint8_t col_start, uint8_t col_end, uint8_t page_start, uint8_t page_end)
+{
+	uint8_t *window = device->async_buffer + *offset;
+	uint8_t *data = window + SSD1306_WINDOW_HEADER_LEN;
+	uint8_t width = col_end - col_start;
+
+	ssd1306_window_header(window, col_start, col_end - 1, page_start, page_end);
+	for (uint8_t page = page_start; page <= page_end; page++, data += width)
+	{
+		memcpy(data, &device->framebuffer[page][col_start], width);
+	}
+
+	i2c_async_request_t request = {
+		.slave_handle = device->slave_handle,
+		.write_buffer = window,
+		.write_len = data - window,
+		.callback = ssd1306_async_done,
+		.user_ctx = device,
+	};
+	portENTER_CRITICAL(&device->async_lock);
+	device->async_refs++;
+	portEXIT_CRITICAL(&device->async_lock);
+	esp_err_t esp_rc = i2c_async_submit(device->async, &request);
+	if (esp_rc != ESP_OK)
+	{
+		ESP_LOGE(SSD1306_TAG, "Queueing pages %d-%d failed. code: 0x%.2X", page_start, page_end, esp_rc);
+		portENTER_CRITICAL(&device->async_lock);
+		device->async_refs--; // Never the last, the flush still holds its own
+		portEXIT_CRITICAL(&device->async_lock);
+		return esp_rc; // Leave the window dirty for the next flush
+	}
+	*offset = data - device->async_buffer;
+	ssd1306_mark_clean(device, page_start, page_end);
+	return ESP_OK;
+}
+
+esp_err_t ssd1306_flush_frame(ssd1306_t *device)
+{
+	if (device->async != NULL)
+	{
+		size_t offset = 0;
+		ESP_RETURN_ON_ERROR(ssd1306_async_acquire(device), SSD1306_TAG, "Frame upload failed");
+		esp_err_t esp_rc = ssd1306_queue_window(device, &offset, 0, SSD1306_WIDTH, 0, MAX_PAGES - 1);
+		ssd1306_async_release(device, ESP_OK);
+		return esp_rc;
+	}
+
+	// Header and framebuffer are contiguous, so the whole frame is one segment and is never copied
+	ssd1306_window_header(device->frame_header, 0, SSD1306_WIDTH - 1, 0, MAX_PAGES - 1);
+	esp_err_t esp_rc = i2c_master_transmit(device->slave_handle, device->frame_header,
+										   SSD1306_WINDOW_HEADER_LEN + SSD1306_FRAME_LEN, -1);
+	if (esp_rc != ESP_OK)
+	{
+		ESP_LOGE(SSD1306_TAG, "Frame upload failed. code: 0x%.2X", esp_rc);
+		return esp_rc;
+	}
+	ssd1306_mark_clean(device, 0, MAX_PAGES - 1);
+	return ESP_OK;
+}
+
+/**
+ * @brief Sends one window to the panel, gathering its rows straight out of the framebuffer,
+ * or queues it on the asynchronous engine
+ */
+static esp_err_t ssd1306_flush_window(ssd1306_t *device, size_t *offset, uint8_t col_start, uint8_t col_end, uint8_t page_start, uint8_t page_end)
+{
+	if (device->async != NULL)
+		return ssd1306_queue_window(device, offset, col_start, col_end, page_start, page_end);
+
+	uint8_t header[SSD1306_WINDOW_HEADER_LEN];
+	i2c_segment_list_t segments;
+
+	ssd1306_window_header(header, col_start, col_end - 1, page_start, page_end);
+	i2c_segments_init(&segments);
+	i2c_segments_add(&segments, header, sizeof(header));
+	for (uint8_t page = page_start; page < MAX_PAGES && page <= page_end; page++)
+	{
+		i2c_segments_add(&segments, &device->framebuffer[page][col_start], col_end - col_start);
+	}
+
+	esp_err_t esp_rc = i2c_segments_transmit(&segments, device->slave_handle);
+	if (esp_rc != ESP_OK)
+	{
+		ESP_LOGE(SSD1306_TAG, "Flush of pages %d-%d failed. code: 0x%.2X", page_start, page_end, esp_rc);
+		return esp_rc; // Leave the window dirty for the next flush
+	}
+	ssd1306_mark_clean(device, page_start, page_end);
+	return ESP_OK;
+}
+
+/**
+ * @brief Sends the dirty parts of the framebuffer the cheapest way on the bus: the whole frame, the
+ * bounding window of every dirty span, or a window per dirty page
+ */
+static esp_err_t ssd1306_flush_dirty(ssd1306_t *device)
+{
+	// Bounding window of everything dirty, and the cost of sending each dirty span on its own
+	uint8_t page_start = MAX_PAGES, page_end = 0;
+	uint8_t col_start = SSD1306_WIDTH, col_end = 0;
+	size_t pages_cost = 0;
+	for (uint8_t page = 0; page < MAX_PAGES; page++)
+	{
+		if (device->dirty_start[page] == device->dirty_end[page])
+			continue;
+		if (page_start == MAX_PAGES)
+			page_start = page;
+		page_end = page;
+		if (device->dirty_start[page] < col_start)
+			col_start = device->dirty_start[page];
+		if (device->dirty_end[page] > col_end)
+			col_end = device->dirty_end[page];
+		pages_cost += SSD1306_WINDOW_COST(device->dirty_end[page] - device->dirty_start[page]);
+	}
+	if (page_start == MAX_PAGES)
+		return ESP_OK; // Nothing to do
+
+	size_t frame_cost = SSD1306_WINDOW_COST(SSD1306_FRAME_LEN);
+	size_t window_len = (size_t)(page_end - page_start + 1) * (col_end - col_start);
+	size_t window_cost = SSD1306_WINDOW_COST(window_len);
+	// A blocking multi-segment window is staged on IDFs without multi-buffer transmit, so it must fit
+	if (device->async == NULL && !I2C_HAS_MULTI_BUFFER_TRANSMIT && window_len + SSD1306_WINDOW_HEADER_LEN > I2C_SEGMENT_STAGING_LEN)
+		window_cost = SIZE_MAX;
+
+	// Ties go to fewer transactions. Per-page windows are only picked when cheaper than the frame,
+	// so they always fit the asynchronous transmit buffer.
+	size_t offset = 0;
+	if (frame_cost <= window_cost && frame_cost <= pages_cost)
+	{
+		if (device->async != NULL)
+			return ssd1306_queue_window(device, &offset, 0, SSD1306_WIDTH, 0, MAX_PAGES - 1);
+		return ssd1306_flush_frame(device);
+	}
+	if (window_cost <= pages_cost)
+		return ssd1306_flush_window(device, &offset, col_start, col_end, page_start, page_end);
+
+	for (uint8_t page = page_start; page < MAX_PAGES && page <= page_end; page++)
+	{
+		if (device->dirty_start[page] == device->dirty_end[page])
+			continue;
+		ESP_RETURN_ON_ERROR(ssd1306_flush_window(device, &offset, device->dirty_start[page], device->dirty_end[page], page, page),
+							SSD1306_TAG, "Flush failed");
+	}
+	return ESP_OK;
+}
+
+esp_err_t ssd1306_flush(ssd1306_t *device)
+{
+	if (device->async == NULL)
+		return ssd1306_flush_dirty(device);
+
+	ESP_RETURN_ON_ERROR(ssd1306_async_acquire(device), SSD1306_TAG, "Flush failed");
+	esp_err_t esp_rc = ssd1306_flush_dirty(device);
+	ssd1306_async_release(device, ESP_OK);
+	return esp_rc;
+}
+
+esp_err_t ssd1306_set_async(ssd1306_t *device, i2c_async_handle_t engine)
+{
+	ESP_RETURN_ON_FALSE(device != NULL, ESP_ERR_INVALID_ARG, SSD1306_TAG, "Invalid argument");
+
+	if (device->async != NULL)
+	{
+		// Back to blocking flushes once the queued upload is done with the transmit buffer
+		ESP_RETURN_ON_FALSE(xSemaphoreTake(device->async_idle, pdMS_TO_TICKS(SSD1306_ASYNC_WAIT_MS)) == pdTRUE, ESP_ERR_TIMEOUT,
+							SSD1306_TAG, "Previous upload still queued");
+		if (device->async_result != ESP_OK)
+		{
+			for (uint8_t page = 0; page < MAX_PAGES; page++)
+				ssd1306_mark_dirty(device, page, 0, SSD1306_WIDTH);
+		}
+		vSemaphoreDelete(device->async_idle);
+		free(device->async_buffer);
+		device->async = NULL;
+		device->async_buffer = NULL;
+		device->async_idle = NULL;
+	}
+	if (engine == NULL)
+		return ESP_OK;
+
+	device->async_buffer = malloc(SSD1306_WINDOW_HEADER_LEN + SSD1306_FRAME_LEN);
+	device->async_idle = xSemaphoreCreateBinary();
+	if (device->async_buffer == NULL || device->async_idle == NULL)
+	{
+		free(device->async_buffer);
+		if (device->async_idle != NULL)
+			vSemaphoreDelete(device->async_idle);
+		device->async_buffer = NULL;
+		device->async_idle = NULL;
+		return ESP_ERR_NO_MEM;
+	}
+	device->async_result = ESP_OK;
+	device->async_refs = 0;
+	xSemaphoreGive(device->async_idle);
+	device->async = engine;
+	return ESP_OK;
+}
+
+esp_err_t ssd1306_flush_wait(ssd1306_t *device, TickType_t timeout)
+{
+	if (device->async == NULL)
+		return ESP_OK;
+	if (xSemaphoreTake(device->async_idle, timeout) != pdTRUE)
+		return ESP_ERR_TIMEOUT;
+	esp_err_t esp_rc = device->async_result;
+	xSemaphoreGive(device->async_idle);
+	return esp_rc;
+}
+
 void ssd1306_clear_display(ssd1306_t *device)
 {
 	for (uint8_t page = 0; page < MAX_PAGES; page++)
 	{
-		i2c_clear_write_buffer();
-		i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-		i2c_write_byte(OLED_SET_PAGE_ADDRESS | page);
-		i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-		i2c_write_byte(OLED_SET_LWR_COLOUMN_START_ADDR);
-		i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-		i2c_write_byte(OLED_SET_UPR_COLOUMN_START_ADDR);
-		i2c_write_byte(OLED_CONTROL_BYTE_GDDRAM_DATA_STREAM);
-		i2c_write_zero(128);
-		i2c_transmit_write_buffer(device->slave_handle);
+		device->clear_line(device, page);
 	}
 }
 
 void ssd1306_clear_line(ssd1306_t *device, uint8_t line)
 {
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD_STREAM);
-	i2c_write_byte(OLED_SET_PAGE_ADDRESS | line);
-	i2c_write_byte(OLED_SET_LWR_COLOUMN_START_ADDR);
-	i2c_write_byte(OLED_SET_UPR_COLOUMN_START_ADDR);
-	i2c_write_byte(OLED_CONTROL_BYTE_GDDRAM_DATA_STREAM);
-	i2c_write_zero(128);
-	i2c_transmit_write_buffer(device->slave_handle);
+	if (line >= MAX_LINES)
+		return;
+	memset(device->framebuffer[line], 0, SSD1306_WIDTH);
+	ssd1306_mark_dirty(device, line, 0, SSD1306_WIDTH);
 
 	// i2c_cmd_handle_t cmd;
 
@@ -102,47 +402,25 @@ esp_err_t ssd1306_print_text_on_line(ssd1306_t *device, const char *text, uint8_
 	ESP_RETURN_ON_FALSE(text_len <= MAX_CHARACTERS_PER_LINE, ESP_ERR_INVALID_ARG, SSD1306_TAG, "More characters than can fit on one line");
 	ESP_RETURN_ON_FALSE(line < MAX_LINES, ESP_ERR_INVALID_ARG, SSD1306_TAG, "Invalid line number");
 
-	i2c_clear_write_buffer();
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-	i2c_write_byte(OLED_SET_PAGE_ADDRESS | line);
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-	i2c_write_byte(OLED_SET_LWR_COLOUMN_START_ADDR);
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-	i2c_write_byte(OLED_SET_UPR_COLOUMN_START_ADDR);
-	i2c_write_byte(OLED_CONTROL_BYTE_GDDRAM_DATA_STREAM);
-
-	uint8_t zero[8] = {0};
-	for (uint8_t i = 0; i < MAX_CHARACTERS_PER_LINE; i++)
+	uint8_t *row = device->framebuffer[line];
+	for (uint8_t i = 0; i < text_len; i++)
 	{
-		if (i < text_len)
-		{
-			i2c_write_bytes((uint8_t *)(font8x8_basic[(uint8_t)text[i]]), 8);
-		}
-		else
-		{
-			i2c_write_bytes(zero, 8); // Writes 8x8 bits, 1 char
-		}
+		memcpy(row + i * 8, ssd1306_glyph(text[i]), 8);
 	}
+	memset(row + text_len * 8, 0, (MAX_CHARACTERS_PER_LINE - text_len) * 8); // 8x8 bits per blank char
+	ssd1306_mark_dirty(device, line, 0, SSD1306_WIDTH);
 
-	i2c_transmit_write_buffer(device->slave_handle);
 	return ESP_OK;
 }
 
 esp_err_t ssd1306_print_8x8basic(ssd1306_t *device, const char character, uint8_t line, uint8_t col)
 {
 	ESP_RETURN_ON_FALSE(line < MAX_LINES, ESP_ERR_INVALID_ARG, SSD1306_TAG, "Invalid line number");
+	ESP_RETURN_ON_FALSE(col < SSD1306_WIDTH, ESP_ERR_INVALID_ARG, SSD1306_TAG, "Invalid column");
 
-	i2c_clear_write_buffer();
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-	i2c_write_byte(OLED_SET_PAGE_ADDRESS | line);
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-	i2c_write_byte(OLED_SET_LWR_COLOUMN_START_ADDR | (col & 0x0F));
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD);
-	i2c_write_byte(OLED_SET_UPR_COLOUMN_START_ADDR | ((col & 0xF0) >> 4));
-	i2c_write_byte(OLED_CONTROL_BYTE_GDDRAM_DATA_STREAM);
-	i2c_write_bytes((uint8_t *)(font8x8_basic[(uint8_t)character]), 8);
-
-	i2c_transmit_write_buffer(device->slave_handle);
+	uint8_t width = (SSD1306_WIDTH - col < 8) ? SSD1306_WIDTH - col : 8;
+	memcpy(&device->framebuffer[line][col], ssd1306_glyph(character), width);
+	ssd1306_mark_dirty(device, line, col, col + width);
 
 	return ESP_OK;
 }
@@ -156,40 +434,62 @@ esp_err_t gesp_ssd1306_init(i2c_master_bus_handle_t master_bus, ssd1306_t *ret_s
 	i2c_device_config_t dev_cfg = {
 		.dev_addr_length = I2C_ADDR_BIT_LEN_7,
 		.device_address = OLED_I2C_ADDRESS,
-		.scl_speed_hz = 400000,
+		.scl_speed_hz = SSD1306_SCL_SPEED_HZ,
 	};
 	ESP_ERROR_CHECK(i2c_master_bus_add_device(master_bus, &dev_cfg, &slave_handle));
 
 	ret_ssd1306_device->bus = master_bus;
 	ret_ssd1306_device->slave_handle = slave_handle;
+	ret_ssd1306_device->async = NULL;
+	ret_ssd1306_device->async_buffer = NULL;
+	ret_ssd1306_device->async_idle = NULL;
+	ret_ssd1306_device->async_result = ESP_OK;
+	ret_ssd1306_device->async_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+	ret_ssd1306_device->async_refs = 0;
 	ret_ssd1306_device->clear_display = ssd1306_clear_display;
 	ret_ssd1306_device->clear_line = ssd1306_clear_line;
 	ret_ssd1306_device->print_text_on_line = ssd1306_print_text_on_line;
 	ret_ssd1306_device->print_8x8basic = ssd1306_print_8x8basic;
+	ret_ssd1306_device->flush = ssd1306_flush;
+	ret_ssd1306_device->flush_frame = ssd1306_flush_frame;
+
+	// Panel RAM is undefined after power up, so the first flush sends the whole (blank) frame
+	memset(ret_ssd1306_device->framebuffer, 0, sizeof(ret_ssd1306_device->framebuffer));
+	for (uint8_t page = 0; page < MAX_PAGES; page++)
+	{
+		ret_ssd1306_device->dirty_start[page] = 0;
+		ret_ssd1306_device->dirty_end[page] = SSD1306_WIDTH;
+	}
 
-	i2c_clear_write_buffer();
-	i2c_write_byte(OLED_CONTROL_BYTE_CMD_STREAM);
+	I2C_TRANSACTION_DECLARE(trans, 32);
+	i2c_transaction_write_byte(&trans, OLED_CONTROL_BYTE_CMD_STREAM);
 
-	i2c_write_byte(OLED_CMD_SET_PAGE_ADDR_MODE);
-	i2c_write_byte(OLED_SET_LWR_COLOUMN_START_ADDR);
-	i2c_write_byte(OLED_SET_UPR_COLOUMN_START_ADDR);
+	// Horizontal addressing, so any window (up to the whole frame) streams in one transaction
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_MEMORY_ADDR_MODE);
+	i2c_transaction_write_byte(&trans, OLED_MEMORY_ADDR_MODE_HORZ);
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_COLUMN_RANGE);
+	i2c_transaction_write_byte(&trans, 0);
+	i2c_transaction_write_byte(&trans, SSD1306_WIDTH - 1);
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_PAGE_RANGE);
+	i2c_transaction_write_byte(&trans, 0);
+	i2c_transaction_write_byte(&trans, MAX_PAGES - 1);
 
-	i2c_write_byte(OLED_CMD_SET_MUX_RATIO); // 1
-	i2c_write_byte(0x3F);
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_MUX_RATIO); // 1
+	i2c_transaction_write_byte(&trans, 0x3F);
 
-	i2c_write_byte(OLED_CMD_SET_DISPLAY_OFFSET); // 2
-	i2c_write_byte(0x00);
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_DISPLAY_OFFSET); // 2
+	i2c_transaction_write_byte(&trans, 0x00);
 
-	i2c_write_byte(OLED_CMD_SET_DISPLAY_START_LINE); // 3
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_DISPLAY_START_LINE); // 3
 
-	i2c_write_byte(OLED_CMD_SET_SEGMENT_REMAP); // 4
-	i2c_write_byte(OLED_CMD_SET_COM_SCAN_MODE); // 5
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_SEGMENT_REMAP); // 4
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_COM_SCAN_MODE); // 5
 
-	i2c_write_byte(OLED_CMD_SET_CHARGE_PUMP);
-	i2c_write_byte(OLED_CMD_CHARGE_PUMP_ON);
+	i2c_transaction_write_byte(&trans, OLED_CMD_SET_CHARGE_PUMP);
+	i2c_transaction_write_byte(&trans, OLED_CMD_CHARGE_PUMP_ON);
 
-	i2c_write_byte(OLED_CMD_DISPLAY_ON);
-	esp_rc = i2c_transmit_write_buffer(slave_handle);
+	i2c_transaction_write_byte(&trans, OLED_CMD_DISPLAY_ON);
+	esp_rc = i2c_transaction_transmit(&trans, slave_handle);
 
 	if (esp_rc == ESP_OK)
 	{
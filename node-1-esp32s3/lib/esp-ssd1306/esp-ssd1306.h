@@ -23,6 +23,8 @@
 
 // Gabriel's Convenience Library
 #include "communication.h"
+#include "i2c_async.h"
+#include "freertos/semphr.h"
 
 #ifndef MAIN_SSD1366_H_
 #define MAIN_SSD1366_H_
@@ -32,6 +34,21 @@
 
 #define MAX_CHARACTERS_PER_LINE 16
 #define MAX_PAGES 8
+#define SSD1306_WIDTH 128
+#define SSD1306_HEIGHT (MAX_PAGES * 8)
+
+#define SSD1306_FRAME_LEN (MAX_PAGES * SSD1306_WIDTH)
+
+// Column and page range commands (each byte with its control byte) plus the data stream control byte
+#define SSD1306_WINDOW_HEADER_LEN 13
+
+#define SSD1306_ASYNC_WAIT_MS 1000 // Longest a flush waits for the previous asynchronous upload
+
+// SCL speed for the panel. Fast mode (400 kHz) by default. Raise to 1000000 for fast-mode plus
+// where the panel, pull-ups and wiring tolerate it.
+#ifndef SSD1306_SCL_SPEED_HZ
+#define SSD1306_SCL_SPEED_HZ 400000
+#endif
 
 // Following definitions are bollowed from
 // http://robotcantalk.blogspot.com/2015/03/interfacing-arduino-with-ssd1306-driven.html
@@ -57,9 +74,12 @@
 #define OLED_SET_UPR_COLOUMN_START_ADDR 0x10 // Upper bits of coloumn number in [3:0], 0x10 -> 0x1F
 
 // Addressing Command Table (pg.30)
-#define OLED_CMD_SET_HORZ_ADDR_MODE 0x20 // Set Horizontal Addresing Mode
-#define OLED_CMD_SET_VERT_ADDR_MODE 0x21 // Set Vertical Addresing Mode
-#define OLED_CMD_SET_PAGE_ADDR_MODE 0x22 // Set Page Addresing Mode
+#define OLED_CMD_SET_MEMORY_ADDR_MODE 0x20 // follow with one of the modes below
+#define OLED_MEMORY_ADDR_MODE_HORZ 0x00    // Horizontal Addressing Mode
+#define OLED_MEMORY_ADDR_MODE_VERT 0x01    // Vertical Addressing Mode
+#define OLED_MEMORY_ADDR_MODE_PAGE 0x02    // Page Addressing Mode
+#define OLED_CMD_SET_COLUMN_RANGE 0x21     // follow with start and end column (0 - 127)
+#define OLED_CMD_SET_PAGE_RANGE 0x22       // follow with start and end page (0 - 7)
 
 // Hardware Config (pg.31)
 #define OLED_CMD_SET_DISPLAY_START_LINE 0x40
@@ -96,8 +116,44 @@ typedef struct ssd1306_display
     i2c_master_bus_handle_t bus;
     i2c_master_dev_handle_t slave_handle;
 
+    // Window header for full-frame uploads. Must sit directly before framebuffer so the
+    // header and frame go out as one contiguous buffer without being copied.
+    uint8_t frame_header[SSD1306_WINDOW_HEADER_LEN];
+
+    // Off-screen copy of GDDRAM. Drawing calls only touch this, flush() sends the dirty parts.
+    uint8_t framebuffer[MAX_PAGES][SSD1306_WIDTH];
+    uint8_t dirty_start[MAX_PAGES]; // First dirty column of each page
+    uint8_t dirty_end[MAX_PAGES];   // One past the last dirty column, equal to dirty_start when clean
+
+    // Asynchronous uploads, see ssd1306_set_async(). NULL engine for blocking flushes.
+    i2c_async_handle_t async;
+    uint8_t *async_buffer;        // Window header and rows of the queued upload
+    SemaphoreHandle_t async_idle; // Taken while an upload is queued, given back on completion
+    esp_err_t async_result;       // Result of the last upload, valid while async_idle is available
+    portMUX_TYPE async_lock;      // Guards async_refs and async_result while windows complete
+    uint8_t async_refs;           // Queued windows of the upload, plus one while a flush queues them
+
+    /**
+     * @brief Sends every dirty column range of every dirty page to the panel, as whichever of the
+     * whole frame, the bounding window of the dirty ranges or a window per dirty page is fewest bytes
+     *
+     * @param self Pointer to ssd1306_t struct
+     *
+     * @return ESP_OK if successful, otherwise error code
+     */
+    esp_err_t (*flush)(struct ssd1306_display *device);
+
+    /**
+     * @brief Streams the whole framebuffer to the panel in a single transaction, regardless of dirty state
+     *
+     * @param self Pointer to ssd1306_t struct
+     *
+     * @return ESP_OK if successful, otherwise error code
+     */
+    esp_err_t (*flush_frame)(struct ssd1306_display *device);
+
     /**
-     * @brief Clear entire display. Zeroes all memory.
+     * @brief Clear entire display. Zeroes the framebuffer, call flush() to show.
      *
      * @param self Pointer to ssd1306_t struct
      *
@@ -106,7 +162,7 @@ typedef struct ssd1306_display
     void (*clear_display)(struct ssd1306_display *device);
 
     /**
-     * @brief Clears a single line on the display.
+     * @brief Clears a single line in the framebuffer, call flush() to show.
      *
      * @param self Pointer to ssd1306_t struct
      * @param line Line to clear (0 - MAX_ROWS)
@@ -116,7 +172,7 @@ typedef struct ssd1306_display
     void (*clear_line)(struct ssd1306_display *device, uint8_t line);
 
     /**
-     * @brief Writes text onto specified line on the display.
+     * @brief Writes text onto specified line in the framebuffer, call flush() to show.
      * 
      * @param self Pointer to ssd1306_t struct
      * @param text Text to display
@@ -127,7 +183,7 @@ typedef struct ssd1306_display
     esp_err_t (*print_text_on_line)(struct ssd1306_display *device, const char *text, uint8_t line);
 
     /**
-     * @brief Writes text onto specified line on the display.
+     * @brief Writes a character at a column of the specified line in the framebuffer, call flush() to show.
      * 
      * @param self Pointer to ssd1306_t struct
      * @param char Char to display
@@ -149,6 +205,52 @@ typedef struct ssd1306_display
 */
 esp_err_t gesp_ssd1306_init(i2c_master_bus_handle_t master_bus, ssd1306_t *ret_ssd1306_device);
 
+/**
+ * @brief Sends later flushes through an asynchronous I2C engine. flush() and flush_frame() then copy
+ * the dirty window into a transmit buffer, queue it and return, so drawing can continue while the panel
+ * updates. A flush only waits for the previous upload. A failed upload makes the next flush resend
+ * the whole frame.
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param engine Engine of the display's bus, NULL to wait for the queued upload and go back to blocking flushes
+ *
+ * @return ESP_OK if successful, ESP_ERR_NO_MEM if the transmit buffer could not be allocated,
+ * ESP_ERR_TIMEOUT if the queued upload did not complete
+ */
+esp_err_t ssd1306_set_async(ssd1306_t *device, i2c_async_handle_t engine);
+
+/**
+ * @brief Waits for the queued upload to reach the panel. Returns at once for blocking flushes.
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param timeout Maximum time to wait
+ *
+ * @return ESP_OK, ESP_ERR_TIMEOUT if the upload is still queued, otherwise the upload's error
+ */
+esp_err_t ssd1306_flush_wait(ssd1306_t *device, TickType_t timeout);
+
+/**
+ * @brief Widens the dirty column range of a framebuffer page to cover [start, end).
+ * For drawing code that writes the framebuffer directly.
+ *
+ * @param device Pointer to ssd1306_t struct
+ * @param page Page (0 - MAX_PAGES)
+ * @param start First modified column
+ * @param end One past the last modified column
+ *
+ * @return void
+ */
+void ssd1306_mark_dirty(ssd1306_t *device, uint8_t page, uint8_t start, uint8_t end);
+
+/**
+ * @brief Looks up an 8x8 glyph. Byte n is column n, bit 0 the top row.
+ *
+ * @param character Character (U+0000 - U+007F)
+ *
+ * @return Pointer to the 8 glyph columns
+ */
+const uint8_t *ssd1306_glyph(const char character);
+
 /**
  * @brief Initialize SSD1306 display
  *
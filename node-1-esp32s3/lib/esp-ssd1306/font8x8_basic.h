@@ -18,9 +18,20 @@
  * Fetched from: http://dimensionalrift.homelinux.net/combuster/mos3/?p=viewsource&file=/modules/gfx/font8_8.asm
  **/
 
+#pragma once
+
+#include <stdint.h>
+
+// Constant in C, constexpr in C++ so the font atlas can be generated from it at compile time
+#ifdef __cplusplus
+#define FONT8X8_CONST constexpr
+#else
+#define FONT8X8_CONST const
+#endif
+
 // Constant: font8x8_basic
 // Contains an 8x8 font map for unicode points U+0000 - U+007F (basic latin) (rotated 90 degrees)
-char font8x8_basic[128][8] = {
+static FONT8X8_CONST uint8_t font8x8_basic[128][8] = {
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // U+0000 (nul)
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // U+0001
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // U+0002
@@ -0,0 +1,313 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "esp32_fdc1004_acq.h"
+
+struct fdc_acquisition
+{
+    level_calc_t level_calc;
+    uint8_t stream_rate;      // 0 for single shot sampling
+    uint32_t period_us;
+    esp_timer_handle_t timer; // Releases one single shot sample per period, NULL while streaming
+    esp_timer_handle_t fence; // Fired once by fdc_acq_stop(), behind any timer callback still running
+    atomic_bool fenced;
+    TaskHandle_t task;
+    SemaphoreHandle_t stopped;
+    atomic_bool stop;
+
+    int64_t start_us;    // Deadline k is start_us + k * period_us
+    uint32_t deadline;   // Index of the latest deadline released
+    int64_t previous_us; // Start of the previous sample or end of the previous harvest, 0 before the first
+
+    portMUX_TYPE stats_lock;
+    fdc_acq_stats_t stats;
+};
+
+// Runs in the esp_timer task: releases the next sample
+static void fdc_acq_timer_cb(void *arg)
+{
+    fdc_acq_handle_t acq = (fdc_acq_handle_t)arg;
+    xTaskNotifyGive(acq->task);
+}
+
+// The esp_timer task runs one callback at a time, so by now fdc_acq_timer_cb is done with acq
+static void fdc_acq_fence_cb(void *arg)
+{
+    fdc_acq_handle_t acq = (fdc_acq_handle_t)arg;
+    atomic_store(&acq->fenced, true); // Last touch of acq
+}
+
+static void fdc_acq_record(fdc_acq_handle_t acq, uint32_t released, int64_t start_us, int64_t end_us, esp_err_t esp_rc)
+{
+    // Deadlines that fired while the previous sample was running are skipped, this sample serves the latest
+    acq->deadline += released;
+    int64_t deadline_us = acq->start_us + (int64_t)acq->deadline * acq->period_us;
+    int64_t release_us = start_us - deadline_us;
+
+    portENTER_CRITICAL(&acq->stats_lock);
+    fdc_acq_stats_t *stats = &acq->stats;
+    stats->missed += released - 1;
+    if (esp_rc == ESP_OK)
+        stats->samples++;
+    else
+        stats->errors++;
+    stats->last_sample_us = start_us;
+    if (release_us > stats->release_max_us)
+        stats->release_max_us = release_us;
+    if (end_us > deadline_us + acq->period_us)
+        stats->overrun++;
+    if (end_us - start_us > stats->busy_max_us)
+        stats->busy_max_us = end_us - start_us;
+    if (acq->previous_us != 0)
+    {
+        int64_t jitter_us = start_us - acq->previous_us - (int64_t)released * acq->period_us;
+        if (jitter_us < 0)
+            jitter_us = -jitter_us;
+        if (jitter_us > stats->jitter_max_us)
+            stats->jitter_max_us = jitter_us;
+        stats->jitter_histogram[stats_log2_bucket(jitter_us, FDC_ACQ_JITTER_BUCKETS)]++;
+    }
+    portEXIT_CRITICAL(&acq->stats_lock);
+    acq->previous_us = start_us;
+}
+
+// Harvests are paced by the device, each slot completes one conversion time after the previous
+static void fdc_acq_record_stream(fdc_acq_handle_t acq, uint8_t harvested, int64_t start_us, int64_t end_us, esp_err_t esp_rc)
+{
+    portENTER_CRITICAL(&acq->stats_lock);
+    fdc_acq_stats_t *stats = &acq->stats;
+    if (esp_rc == ESP_OK)
+        stats->samples += harvested;
+    else
+        stats->errors++;
+    stats->last_sample_us = end_us;
+    if (end_us - start_us > stats->busy_max_us)
+        stats->busy_max_us = end_us - start_us;
+    if (acq->previous_us != 0 && esp_rc == ESP_OK)
+    {
+        int64_t jitter_us = end_us - acq->previous_us - (int64_t)harvested * acq->period_us;
+        if (jitter_us < 0)
+            jitter_us = -jitter_us;
+        if (jitter_us > stats->jitter_max_us)
+            stats->jitter_max_us = jitter_us;
+        stats->jitter_histogram[stats_log2_bucket(jitter_us, FDC_ACQ_JITTER_BUCKETS)]++;
+    }
+    portEXIT_CRITICAL(&acq->stats_lock);
+    acq->previous_us = esp_rc == ESP_OK ? end_us : 0; // The interval across an error or restart is not jitter
+}
+
+static esp_err_t fdc_acq_stream_start(fdc_acq_handle_t acq)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t esp_rc = fdc_start_streaming(acq->level_calc, acq->stream_rate);
+    if (esp_rc != ESP_OK)
+        fdc_acq_record_stream(acq, 0, start_us, esp_timer_get_time(), esp_rc);
+    return esp_rc;
+}
+
+static void fdc_acq_stream(fdc_acq_handle_t acq)
+{
+    esp_err_t esp_rc = fdc_acq_stream_start(acq);
+    while (!atomic_load(&acq->stop))
+    {
+        if (esp_rc != ESP_OK)
+        {
+            // Device lost or stalled: restart the stream after a pause, fdc_acq_stop() ends the pause early
+            ESP_LOGE(FDC_ACQ_TAG, "STREAM ERROR | Code: 0x%.2X", esp_rc);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FDC_ACQ_STREAM_RESTART_MS));
+            if (atomic_load(&acq->stop))
+                break;
+            fdc_stop_streaming(acq->level_calc);
+            esp_rc = fdc_acq_stream_start(acq);
+            continue;
+        }
+
+        uint8_t updated = 0;
+        int64_t start_us = esp_timer_get_time();
+        esp_rc = fdc_update_stream(acq->level_calc, &updated);
+        int64_t end_us = esp_timer_get_time();
+        uint8_t harvested = 0;
+        for (; updated; updated &= updated - 1)
+            harvested++;
+        fdc_acq_record_stream(acq, harvested, start_us, end_us, esp_rc);
+    }
+    fdc_stop_streaming(acq->level_calc);
+}
+
+static void fdc_acq_single_shot(fdc_acq_handle_t acq)
+{
+    while (1)
+    {
+        uint32_t released = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (atomic_load(&acq->stop))
+            break;
+        if (released == 0)
+            continue;
+
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t esp_rc = update_measurements(acq->level_calc);
+        int64_t end_us = esp_timer_get_time();
+        if (esp_rc != ESP_OK)
+            ESP_LOGE(FDC_ACQ_TAG, "SAMPLE ERROR | Code: 0x%.2X", esp_rc);
+        fdc_acq_record(acq, released, start_us, end_us, esp_rc);
+    }
+}
+
+static void fdc_acq_task(void *pvParameter)
+{
+    fdc_acq_handle_t acq = (fdc_acq_handle_t)pvParameter;
+
+    if (acq->stream_rate)
+        fdc_acq_stream(acq);
+    else
+        fdc_acq_single_shot(acq);
+
+    xSemaphoreGive(acq->stopped);
+    vTaskDelete(NULL);
+}
+
+esp_err_t fdc_acq_start(level_calc_t level_calc, const fdc_acq_config_t *config, fdc_acq_handle_t *ret_acq)
+{
+    ESP_RETURN_ON_FALSE(level_calc != NULL && ret_acq != NULL, ESP_ERR_INVALID_ARG, FDC_ACQ_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(config == NULL || config->stream_rate == 0 || FDC1004_IS_RATE(config->stream_rate), ESP_ERR_INVALID_ARG,
+                        FDC_ACQ_TAG, "Invalid stream rate");
+    ESP_RETURN_ON_FALSE(!level_calc->streaming, ESP_ERR_INVALID_STATE, FDC_ACQ_TAG, "Level calculator already streaming");
+
+    fdc_acq_config_t cfg = {
+        .stream_rate = 0,
+        .period_us = FDC_ACQ_DEFAULT_PERIOD_US,
+        .task_stack = FDC_ACQ_DEFAULT_TASK_STACK,
+        .task_priority = FDC_ACQ_DEFAULT_TASK_PRIORITY,
+        .core_id = tskNO_AFFINITY,
+    };
+    if (config != NULL)
+    {
+        cfg.stream_rate = config->stream_rate;
+        if (config->period_us)
+            cfg.period_us = config->period_us;
+        if (config->task_stack)
+            cfg.task_stack = config->task_stack;
+        if (config->task_priority)
+            cfg.task_priority = config->task_priority;
+        cfg.core_id = config->core_id;
+    }
+
+    fdc_acq_handle_t acq = calloc(1, sizeof(struct fdc_acquisition));
+    ESP_RETURN_ON_FALSE(acq != NULL, ESP_ERR_NO_MEM, FDC_ACQ_TAG, "No memory for acquisition");
+    acq->level_calc = level_calc;
+    acq->stream_rate = cfg.stream_rate;
+    acq->period_us = cfg.stream_rate ? (uint32_t)FDC1004_CONVERSION_US(cfg.stream_rate) : cfg.period_us;
+    acq->stats_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    atomic_init(&acq->stop, false);
+    atomic_init(&acq->fenced, false);
+
+    acq->stopped = xSemaphoreCreateBinary();
+    if (acq->stopped == NULL)
+    {
+        free(acq);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t esp_rc;
+    if (!acq->stream_rate)
+    {
+        esp_timer_create_args_t timer_args = {
+            .callback = fdc_acq_timer_cb,
+            .arg = acq,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "fdc_acq",
+            .skip_unhandled_events = false,
+        };
+        esp_rc = esp_timer_create(&timer_args, &acq->timer);
+        if (esp_rc == ESP_OK)
+        {
+            timer_args.callback = fdc_acq_fence_cb;
+            timer_args.name = "fdc_acq_fence";
+            esp_rc = esp_timer_create(&timer_args, &acq->fence);
+            if (esp_rc != ESP_OK)
+                esp_timer_delete(acq->timer);
+        }
+        if (esp_rc != ESP_OK)
+        {
+            vSemaphoreDelete(acq->stopped);
+            free(acq);
+            return esp_rc;
+        }
+    }
+
+    if (xTaskCreatePinnedToCore(fdc_acq_task, "fdc_acq", cfg.task_stack, acq, cfg.task_priority, &acq->task, cfg.core_id) != pdPASS)
+    {
+        if (acq->timer != NULL)
+        {
+            esp_timer_delete(acq->fence);
+            esp_timer_delete(acq->timer);
+        }
+        vSemaphoreDelete(acq->stopped);
+        free(acq);
+        ESP_LOGE(FDC_ACQ_TAG, "Acquisition task creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The periodic timer reloads from its previous alarm, so deadlines do not drift
+    acq->start_us = esp_timer_get_time();
+    if (acq->timer != NULL)
+    {
+        esp_rc = esp_timer_start_periodic(acq->timer, acq->period_us);
+        if (esp_rc != ESP_OK)
+        {
+            fdc_acq_stop(acq);
+            return esp_rc;
+        }
+    }
+
+    *ret_acq = acq;
+    return ESP_OK;
+}
+
+esp_err_t fdc_acq_get_stats(fdc_acq_handle_t acq, fdc_acq_stats_t *ret_stats)
+{
+    ESP_RETURN_ON_FALSE(acq != NULL && ret_stats != NULL, ESP_ERR_INVALID_ARG, FDC_ACQ_TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&acq->stats_lock);
+    *ret_stats = acq->stats;
+    portEXIT_CRITICAL(&acq->stats_lock);
+    return ESP_OK;
+}
+
+int64_t fdc_acq_jitter_percentile(const fdc_acq_stats_t *stats, uint8_t percentile)
+{
+    return stats_log2_percentile(stats->jitter_histogram, FDC_ACQ_JITTER_BUCKETS, stats->jitter_max_us, percentile);
+}
+
+esp_err_t fdc_acq_stop(fdc_acq_handle_t acq)
+{
+    ESP_RETURN_ON_FALSE(acq != NULL, ESP_ERR_INVALID_ARG, FDC_ACQ_TAG, "Invalid argument");
+
+    if (acq->timer != NULL)
+    {
+        esp_timer_stop(acq->timer); // Not running if start failed
+
+        // A timer callback may already be running: wait for the fence queued behind it, so it cannot
+        // notify the task once deleted or read acq once freed
+        esp_err_t esp_rc = esp_timer_start_once(acq->fence, 0);
+        if (esp_rc != ESP_OK)
+            return esp_rc;
+        while (!atomic_load(&acq->fenced))
+            vTaskDelay(1);
+    }
+    atomic_store(&acq->stop, true);
+    xTaskNotifyGive(acq->task);
+    xSemaphoreTake(acq->stopped, portMAX_DELAY);
+
+    if (acq->timer != NULL)
+    {
+        esp_timer_delete(acq->fence);
+        esp_timer_delete(acq->timer);
+    }
+    vSemaphoreDelete(acq->stopped);
+    free(acq);
+    return ESP_OK;
+}
@@ -0,0 +1,109 @@
+/**
+ * Deadline scheduled FDC1004 acquisition
+ *
+ * A dedicated task, optionally pinned to a core, samples the level calculator in one
+ * of two modes:
+ *  - streaming (stream_rate set): the device converts the REF, LEV and ENV slots back
+ *    to back in repeat mode and the task harvests each slot as it completes
+ *    (fdc_update_stream()), e.g. 400 slot samples/s at FDC1004_400HZ. The stream is
+ *    restarted after an error.
+ *  - single shot: one level sample (update_measurements()) per period. Sample k is
+ *    released at an absolute deadline, start + k * period, by a periodic esp_timer, so
+ *    I2C time does not accumulate into the sample period. Ticks (10 ms) are too coarse
+ *    for vTaskDelayUntil at these rates. A sample still running at the next deadline
+ *    makes the task skip that deadline rather than fall behind.
+ *
+ * Timing jitter against the expected interval is kept as statistics. Samples are
+ * published to the level calculator's sample ring with their timestamps.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <esp_err.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp32_fdc1004_lls.h"
+
+#define FDC_ACQ_TAG "FDC1004_ACQ"
+
+#define FDC_ACQ_DEFAULT_PERIOD_US 20000 // 50 samples/s, a single shot level sample takes about 8 ms at 400 S/s
+#define FDC_ACQ_STREAM_RESTART_MS 1000   // Pause before restarting a stream that failed
+#define FDC_ACQ_DEFAULT_TASK_STACK 4096
+#define FDC_ACQ_DEFAULT_TASK_PRIORITY (configMAX_PRIORITIES - 3) // Above the application, below esp_timer
+
+#define FDC_ACQ_JITTER_BUCKETS 16 // Bucket n counts jitter in [2^n, 2^(n+1)) microseconds, bucket 0 from 0
+
+/**
+ * @brief Acquisition configuration. Zeroed fields fall back to the defaults above.
+ */
+typedef struct fdc_acq_config
+{
+    uint8_t stream_rate;       // FDC1004_100HZ - FDC1004_400HZ to harvest the repeat-mode stream, 0 for single shot samples
+    uint32_t period_us;        // Single shot sample period
+    uint32_t task_stack;       // Acquisition task stack size
+    UBaseType_t task_priority; // Acquisition task priority
+    BaseType_t core_id;        // Core to pin the task to, tskNO_AFFINITY for any
+} fdc_acq_config_t;
+
+/**
+ * @brief Acquisition statistics, a snapshot taken by fdc_acq_get_stats()
+ */
+typedef struct fdc_acq_stats
+{
+    uint32_t samples;       // Samples taken, one per slot harvested while streaming
+    uint32_t errors;        // Samples that failed, see update_measurements() and fdc_update_stream()
+    uint32_t overrun;       // Single shot: samples that ran past the next deadline, which is then served late
+    uint32_t missed;        // Single shot: deadlines skipped because the previous sample overran by more than a period
+    int64_t last_sample_us; // Start of the latest single shot sample, end of the latest harvest while streaming
+    int64_t release_max_us; // Single shot: worst delay from a deadline to the start of its sample
+    int64_t busy_max_us;    // Longest sample, or harvest including its wait for the slot while streaming
+    int64_t jitter_max_us;  // Worst |interval between consecutive samples - period|, the period being one
+                            // conversion time per slot harvested while streaming
+    uint32_t jitter_histogram[FDC_ACQ_JITTER_BUCKETS];
+} fdc_acq_stats_t;
+
+typedef struct fdc_acquisition *fdc_acq_handle_t;
+
+/**
+ * @brief Creates the acquisition task and starts sampling. The level calculator must not be
+ * used by another task for measurements until fdc_acq_stop(), and must not be streaming.
+ *
+ * @param level_calc Level calculator to sample
+ * @param config Acquisition configuration, NULL for defaults
+ * @param ret_acq Returned acquisition handle
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad argument, ESP_ERR_NO_MEM if allocation or task creation failed
+ */
+esp_err_t fdc_acq_start(level_calc_t level_calc, const fdc_acq_config_t *config, fdc_acq_handle_t *ret_acq);
+
+/**
+ * @brief Copies the acquisition statistics
+ *
+ * @param acq Acquisition handle
+ * @param ret_stats Returned statistics
+ *
+ * @return ESP_OK
+ */
+esp_err_t fdc_acq_get_stats(fdc_acq_handle_t acq, fdc_acq_stats_t *ret_stats);
+
+/**
+ * @brief Estimates a period jitter percentile from the statistics histogram
+ *
+ * @param stats Statistics snapshot
+ * @param percentile Percentile to estimate (0 - 100)
+ *
+ * @return Upper bound of the bucket holding the percentile, at most jitter_max_us, in microseconds
+ */
+int64_t fdc_acq_jitter_percentile(const fdc_acq_stats_t *stats, uint8_t percentile);
+
+/**
+ * @brief Stops sampling after the current sample, stops the stream and deletes the acquisition task.
+ * Waits for a release timer callback already running, so must not be called from an esp_timer callback.
+ *
+ * @param acq Acquisition handle
+ *
+ * @return ESP_OK, or the esp_timer error if the wait could not be started and acquisition was left stopped
+ */
+esp_err_t fdc_acq_stop(fdc_acq_handle_t acq);
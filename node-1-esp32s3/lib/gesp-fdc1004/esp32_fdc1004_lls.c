@@ -1,4 +1,6 @@
+#include <inttypes.h>
 #include "esp32_fdc1004_lls.h"
+#include "esp32_fdc1004_acq.h"
 
 esp_err_t read_register(i2c_master_dev_handle_t slave, uint8_t reg_address, uint16_t *ret_data)
 {
@@ -7,16 +9,16 @@ esp_err_t read_register(i2c_master_dev_handle_t slave, uint8_t reg_address, uint
     uint8_t pointer_address = reg_address;
 
     // Specify which register to read with pointer byte
-    i2c_clear_write_buffer();
-    i2c_write_byte(pointer_address);
-    error = i2c_transmit_write_buffer(slave);
+    I2C_TRANSACTION_DECLARE(trans, 1);
+    i2c_transaction_write_byte(&trans, pointer_address);
+    error = i2c_transaction_transmit(&trans, slave);
     if (error != ESP_OK)
     {
         ESP_LOGE(FDC_TAG, "SPECIFY POINTER REGISTER ERROR | Code: 0x%.2X", error);
         return error;
     }
     // Sends read command for reading the current value in the register stored in the pointer register
-    i2c_master_receive(slave, data, sizeof(data), 100);
+    error = i2c_master_receive(slave, data, sizeof(data), 100);
     if (error != ESP_OK)
     {
         ESP_LOGE(FDC_TAG, "READ REGISTER ERROR | Code: 0x%.2X", error);
@@ -32,7 +34,9 @@ esp_err_t read_register(i2c_master_dev_handle_t slave, uint8_t reg_address, uint
 esp_err_t check_fdc1004(i2c_master_dev_handle_t slave_handle)
 {
     uint16_t data;
-    read_register(slave_handle, FDC_DEVICE_ID_REG, &data);
+    esp_err_t error = read_register(slave_handle, FDC_DEVICE_ID_REG, &data);
+    if (error != ESP_OK)
+        return error;
     if (data != 0x1004)
     {
         printf("FDC1004 not detected! Data: 0x%.4X\n", data);
@@ -46,12 +50,12 @@ esp_err_t fdc_reset(i2c_master_dev_handle_t slave_handle)
 {
     esp_err_t error;
 
-    i2c_clear_write_buffer();
-    i2c_write_byte(FDC_REGISTER);
-    i2c_write_byte(0x80);
-    i2c_write_byte(0);
-    
-    error = i2c_transmit_write_buffer(slave_handle);
+    I2C_TRANSACTION_DECLARE(trans, FDC_REGISTER_WRITE_LEN);
+    i2c_transaction_write_byte(&trans, FDC_REGISTER);
+    i2c_transaction_write_byte(&trans, 0x80);
+    i2c_transaction_write_byte(&trans, 0);
+
+    error = i2c_transaction_transmit(&trans, slave_handle);
     if (error != ESP_OK)
     {
         ESP_LOGE(FDC_TAG, "RESET ERROR | Code: 0x%.2X", error);
@@ -74,6 +78,20 @@ esp_err_t fdc_reset(i2c_master_dev_handle_t slave_handle)
     return ESP_ERR_NOT_FOUND;
 }
 
+// Runs in the esp_timer task: wakes the task waiting for a conversion on this channel
+static void wait_timer_cb(void *arg)
+{
+    fdc_channel_t channel_obj = (fdc_channel_t)arg;
+    xSemaphoreGive(channel_obj->wait_done);
+}
+
+// The esp_timer task runs one callback at a time, so by now wait_timer_cb is done with the channel
+static void fence_timer_cb(void *arg)
+{
+    fdc_channel_t channel_obj = (fdc_channel_t)arg;
+    channel_obj->fenced = true; // Last touch of the channel
+}
+
 fdc_channel_t init_channel(i2c_master_dev_handle_t slave_handle, uint8_t channel, uint8_t rate)
 {
     if (!FDC1004_IS_RATE(rate))
@@ -87,6 +105,32 @@ fdc_channel_t init_channel(i2c_master_dev_handle_t slave_handle, uint8_t channel
         return NULL;
     }
 
+    new_channel->wait_done = xSemaphoreCreateBinary();
+    new_channel->wait_timer = NULL;
+    new_channel->fence_timer = NULL;
+    new_channel->fenced = false;
+    esp_timer_create_args_t timer_args = {
+        .callback = wait_timer_cb,
+        .arg = new_channel,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "fdc_wait",
+        .skip_unhandled_events = false,
+    };
+    esp_timer_create_args_t fence_args = timer_args;
+    fence_args.callback = fence_timer_cb;
+    fence_args.name = "fdc_fence";
+    if (new_channel->wait_done == NULL || esp_timer_create(&timer_args, &new_channel->wait_timer) != ESP_OK ||
+        esp_timer_create(&fence_args, &new_channel->fence_timer) != ESP_OK)
+    {
+        printf("Wait timer creation for new channel failed!\n");
+        if (new_channel->wait_timer != NULL)
+            esp_timer_delete(new_channel->wait_timer);
+        if (new_channel->wait_done != NULL)
+            vSemaphoreDelete(new_channel->wait_done);
+        free(new_channel);
+        return NULL;
+    }
+
     // Assigning fields
     new_channel->slave_handle = slave_handle;
     new_channel->channel = channel;
@@ -102,9 +146,15 @@ fdc_channel_t init_channel(i2c_master_dev_handle_t slave_handle, uint8_t channel
 
     new_channel->raw_msb = 0;
     new_channel->raw_lsb = 0;
-    new_channel->capdac = 0;
-    new_channel->raw_value = 0;
-    new_channel->value = 0;
+    new_channel->config_cached = false;
+    new_channel->config_cache = 0;
+    new_channel->gain_cache = 0;
+    new_channel->offset_cache = 0;
+
+    new_channel->capdac = FDC1004_CAPDAC_MAX / 2; // Ranging starts from mid scale
+    reset_capdac(new_channel);
+    new_channel->raw_code = 0;
+    new_channel->capacitance_af = 0;
     return new_channel;
 }
 
@@ -112,6 +162,18 @@ esp_err_t del_channel(fdc_channel_t channel_obj)
 {
     if (channel_obj == NULL)
         return ESP_ERR_INVALID_ARG;
+    esp_timer_stop(channel_obj->wait_timer);
+
+    // wait_timer_cb may already be running: wait for the fence queued behind it before freeing
+    esp_err_t error = esp_timer_start_once(channel_obj->fence_timer, 0);
+    if (error != ESP_OK)
+        return error;
+    while (!channel_obj->fenced)
+        vTaskDelay(1);
+
+    esp_timer_delete(channel_obj->fence_timer);
+    esp_timer_delete(channel_obj->wait_timer);
+    vSemaphoreDelete(channel_obj->wait_done);
     free(channel_obj);
     return ESP_OK;
 }
@@ -136,6 +198,26 @@ esp_err_t validate_channel_obj(fdc_channel_t channel_obj)
     return ESP_OK;
 }
 
+// Writes a 16 bit register unless the channel's cache shows it already holds value
+static esp_err_t write_register_cached(fdc_channel_t channel_obj, uint8_t reg_address, uint16_t value, uint16_t *cache)
+{
+    if (channel_obj->config_cached && *cache == value)
+        return ESP_OK;
+
+    I2C_TRANSACTION_DECLARE(trans, FDC_REGISTER_WRITE_LEN);
+    i2c_transaction_write_byte(&trans, reg_address);
+    i2c_transaction_write_byte(&trans, (uint8_t)(value >> 8));
+    i2c_transaction_write_byte(&trans, (uint8_t)(value));
+    esp_err_t error = i2c_transaction_transmit(&trans, channel_obj->slave_handle);
+    if (error != ESP_OK)
+    {
+        channel_obj->config_cached = false;
+        return error;
+    }
+    *cache = value;
+    return ESP_OK;
+}
+
 esp_err_t configure_channel(fdc_channel_t channel_obj)
 {
     esp_err_t error;
@@ -145,18 +227,11 @@ esp_err_t configure_channel(fdc_channel_t channel_obj)
     // Build 16 bit configuration
     uint16_t configuration = (uint16_t)(channel_obj->channel) << 13; // CHA
     configuration |= 0x1000;                                         // CAPDAC
-    // configuration |= ((uint16_t)0x04) << 10;                         // CHB disable / CAPDAC enable
-    // configuration |= 20 << 5;                                        // CAPDAC value
+    configuration |= (uint16_t)(channel_obj->capdac & FDC1004_CAPDAC_MAX) << 5; // CAPDAC value
 
-    i2c_clear_write_buffer();
-    i2c_write_byte(channel_obj->config_address);
-    i2c_write_byte((uint8_t)(configuration >> 8));
-    i2c_write_byte((uint8_t)(configuration));
-    error = i2c_transmit_write_buffer(channel_obj->slave_handle);
-
-    // error = i2c_master_write_to_device(channel_obj->port, FDC_SLAVE_ADDRESS, config, sizeof(config), pdMS_TO_TICKS(200));
-    if (error != ESP_OK)
-        ESP_LOGE(FDC_TAG, "CONFIG ERROR | Code: 0x%.2X", error);
+    esp_err_t config_error = write_register_cached(channel_obj, channel_obj->config_address, configuration, &channel_obj->config_cache);
+    if (config_error != ESP_OK)
+        ESP_LOGE(FDC_TAG, "CONFIG ERROR | Code: 0x%.2X", config_error);
 
     int16_t integer_part;
     uint8_t decimal_part;
@@ -171,13 +246,10 @@ esp_err_t configure_channel(fdc_channel_t channel_obj)
     encoded_gain |= encoded_decimal;
     encoded_gain = 0x4000;
 
-    i2c_clear_write_buffer();
-    i2c_write_byte(channel_obj->gain_register);
-    i2c_write_byte((uint8_t)(encoded_gain >> 8));
-    i2c_write_byte((uint8_t)(encoded_gain));
-    error = i2c_transmit_write_buffer(channel_obj->slave_handle);
+    error = write_register_cached(channel_obj, channel_obj->gain_register, encoded_gain, &channel_obj->gain_cache);
     if (error != ESP_OK)
         ESP_LOGE(FDC_TAG, "GAIN CONFIG ERROR | Code: 0x%.2X", error);
+    config_error = config_error != ESP_OK ? config_error : error;
 
     // Configure offset
     integer_part = (uint16_t)(OFFSET_CAL);
@@ -193,78 +265,135 @@ esp_err_t configure_channel(fdc_channel_t channel_obj)
     }
     encoded_offset |= encoded_decimal;
 
-    i2c_clear_write_buffer();
-    i2c_write_byte(channel_obj->offset_register);
-    i2c_write_byte((uint8_t)(encoded_offset >> 8));
-    i2c_write_byte((uint8_t)(encoded_offset));
-    error = i2c_transmit_write_buffer(channel_obj->slave_handle);
+    error = write_register_cached(channel_obj, channel_obj->offset_register, encoded_offset, &channel_obj->offset_cache);
     if (error != ESP_OK)
         ESP_LOGE(FDC_TAG, "OFFSET CONFIG ERROR | Code: 0x%.2X", error);
-    
+    config_error = config_error != ESP_OK ? config_error : error;
+
+    // Later calls only write registers whose value changed
+    channel_obj->config_cached = config_error == ESP_OK;
+    return config_error;
+}
+
+// Blocks the calling task for at least wait_us on the channel's one shot timer
+static esp_err_t sleep_us(fdc_channel_t channel_obj, uint32_t wait_us)
+{
+    xSemaphoreTake(channel_obj->wait_done, 0); // Drop a wake-up left over from a late timer
+    esp_err_t error = esp_timer_start_once(channel_obj->wait_timer, wait_us);
+    if (error != ESP_OK)
+        return error;
+
+    // The tick bound is already past wait_us, so a late or lost timer callback is not an error.
+    // The caller polls the DONE bits next and its own deadline decides when to give up.
+    if (xSemaphoreTake(channel_obj->wait_done, pdMS_TO_TICKS(wait_us / 1000) + 2) != pdTRUE)
+        esp_timer_stop(channel_obj->wait_timer);
     return ESP_OK;
 }
 
-esp_err_t update_measurement(fdc_channel_t channel_obj)
+// Waits until any DONE bit in done_mask is set, first checking after first_wait_us. If the result is
+// late, polls back off from FDC1004_DONE_POLL_MIN_US up to a conversion time. The timer of channel_obj is used.
+static esp_err_t wait_done(fdc_channel_t channel_obj, uint16_t done_mask, uint32_t first_wait_us, uint16_t *ret_status)
 {
+    esp_err_t error;
     uint16_t done_status;
+    uint32_t conversion_us = FDC1004_CONVERSION_US(channel_obj->rate);
+    int64_t deadline_us = esp_timer_get_time() + first_wait_us + (int64_t)conversion_us * FDC1004_DONE_TIMEOUT_CONVERSIONS;
+
+    uint32_t next_us = first_wait_us;
+    uint32_t backoff_us = FDC1004_DONE_POLL_MIN_US;
+    while (1)
+    {
+        if (next_us > 0)
+        {
+            error = sleep_us(channel_obj, next_us);
+            if (error != ESP_OK)
+                return error;
+        }
+
+        error = read_register(channel_obj->slave_handle, FDC_REGISTER, &done_status);
+        if (error != ESP_OK)
+            return error;
+        if (done_status & done_mask)
+        {
+            *ret_status = done_status;
+            return ESP_OK;
+        }
+
+        if (esp_timer_get_time() >= deadline_us)
+        {
+            ESP_LOGE(FDC_TAG, "MEASUREMENT TIMEOUT | Status: 0x%.4X", done_status);
+            return ESP_ERR_TIMEOUT;
+        }
+        next_us = backoff_us;
+        if (backoff_us < conversion_us)
+            backoff_us = backoff_us * 2 < conversion_us ? backoff_us * 2 : conversion_us;
+    }
+}
+
+// Reads the latest result of the channel's measurement. Reading the MSB clears its DONE bit.
+static esp_err_t read_result(fdc_channel_t channel_obj)
+{
+    esp_err_t error;
+    uint16_t raw_msb = 0;
+    uint16_t raw_lsb = 0;
+    error = read_register(channel_obj->slave_handle, channel_obj->lsb_address, &raw_lsb);
+    if (error == ESP_OK)
+        error = read_register(channel_obj->slave_handle, channel_obj->msb_address, &raw_msb);
+    if (error != ESP_OK)
+        return error;
+    channel_obj->raw_msb = raw_msb;
+    channel_obj->raw_lsb = raw_lsb;
+
+    // 24 bit two's complement result
+    channel_obj->raw_code = ((int32_t)(int16_t)raw_msb << 8) | ((int32_t)raw_lsb >> 8);
+
+    // A saturated result says nothing about the input, keep the last capacitance
+    if (!FDC1004_IS_SATURATED(raw_msb))
+        channel_obj->capacitance_af = fdc_code_to_af(channel_obj->raw_code, channel_obj->capdac);
+    return ESP_OK;
+}
+
+esp_err_t update_measurement(fdc_channel_t channel_obj)
+{
+    esp_err_t error;
 
     // Build trigger for 16 bit register 0x0C
     uint16_t trigger_config = 0x0000;
-    trigger_config |= 0x0040;         // Sample Rate
-    trigger_config |= 0x0080 >> channel_obj->channel; // Measurement channel
-
-    i2c_clear_write_buffer();
-    i2c_write_byte(FDC_REGISTER);
-    i2c_write_byte((uint8_t)(trigger_config >> 8));
-    i2c_write_byte((uint8_t)(trigger_config));
-    i2c_transmit_write_buffer(channel_obj->slave_handle);
-
-    // done_status = 0;
-    // read_register(channel_obj->port, FDC_REGISTER, &done_status);
-    // printf("Done Status Post Trigger: %d\n", done_status);
-
-    // error = i2c_master_write_to_device(channel_obj->port, FDC_SLAVE_ADDRESS, trigger, sizeof(trigger), pdMS_TO_TICKS(50));
-    // if (error != ESP_OK)
-    // {
-    //     printf("Trigger failed! %d\n", error);
-    //     return error;
-    // }
-
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    done_status = 0;
-    read_register(channel_obj->slave_handle, FDC_REGISTER, &done_status);
-    printf("Done Status Post Result: %d\n", done_status);
-    done_status &= (0x0008 >> channel_obj->channel);
-    // Check measurement done status
-    if (done_status > 0)
-    // if ((done_status > 0) && (uint16_t)(1 << (channel_obj->channel + 4)))
+    trigger_config |= (uint16_t)channel_obj->rate << 10; // Sample Rate
+    trigger_config |= 0x0080 >> channel_obj->channel;    // Measurement channel
+
+    I2C_TRANSACTION_DECLARE(trans, FDC_REGISTER_WRITE_LEN);
+    i2c_transaction_write_byte(&trans, FDC_REGISTER);
+    i2c_transaction_write_byte(&trans, (uint8_t)(trigger_config >> 8));
+    i2c_transaction_write_byte(&trans, (uint8_t)(trigger_config));
+    error = i2c_transaction_transmit(&trans, channel_obj->slave_handle);
+    if (error != ESP_OK)
     {
-        // Measurement Done!
-        uint16_t raw_msb = 0;
-        uint16_t raw_lsb = 0;
-        read_register(channel_obj->slave_handle, channel_obj->lsb_address, &raw_lsb);
-        read_register(channel_obj->slave_handle, channel_obj->msb_address, &raw_msb);
-        channel_obj->raw_msb = raw_msb;
-        channel_obj->raw_lsb = raw_lsb;
-
-        // read_register(channel_obj->port, FDC_REGISTER, &done_status);
-        // printf("Done Status Post Result Return: %d\n", done_status);
-
-        int32_t raw_measurement_value = ((int32_t)raw_msb << 8) | ((int32_t)raw_lsb >> 8);
-        printf("Raw value: %ld\n", raw_measurement_value);
-        printf("Capacitance: %.2f pF\n", (float)(raw_measurement_value >> 16) / 8);
-        printf("========================================\n");
-        channel_obj->raw_value = (float)((raw_measurement_value >> 16) / 8);
+        ESP_LOGE(FDC_TAG, "TRIGGER ERROR | Code: 0x%.2X", error);
+        return error;
     }
 
+    uint16_t done_status;
+    error = wait_done(channel_obj, 0x0008 >> channel_obj->channel, FDC1004_CONVERSION_US(channel_obj->rate), &done_status);
+    if (error != ESP_OK)
+        return error;
+
+    // Measurement Done!
+    error = read_result(channel_obj);
+    if (error != ESP_OK)
+        return error;
+    ESP_LOGD(FDC_TAG, "CIN%d | Code: %" PRId32 " CAPDAC: %d | %" PRId32 " aF", channel_obj->channel + 1,
+             channel_obj->raw_code, channel_obj->capdac, channel_obj->capacitance_af);
+
+    error = update_capdac(channel_obj);
+    if (error != ESP_OK)
+        return error;
+
     // Calculate capacitance
     // int32_t capacitance = (int32_t)ATTOFARADS_UPPER_WORD * (int32_t)raw_measurement_value; // in attofarads
     // capacitance /= 1000;                                                               // in femtofarads
     // capacitance += (int32_t)FEMTOFARADS_CAPDAC * (int32_t)(channel_obj->capdac);
 
-    // update_capdac(channel_obj);
-
     // moving_average_enqueue(channel_obj->ma, (float)capacitance);
 
     // channel_obj->value = get_moving_average(channel_obj->ma) / 1000;
@@ -272,52 +401,295 @@ esp_err_t update_measurement(fdc_channel_t channel_obj)
     return ESP_OK;
 }
 
-esp_err_t update_measurements(level_calc_t level_calc)
+// Feeds the new results of the channels in updated (1 << channel) through their filters into the level values,
+// then publishes them as one sample
+static void filter_results(level_calc_t level_calc, uint8_t updated)
 {
+    if (updated & (1 << level_calc->ref_channel->channel))
+        level_calc->ref_af = stats_channel_push(&level_calc->filters[0], level_calc->ref_channel->capacitance_af);
+    if (updated & (1 << level_calc->lev_channel->channel))
+        level_calc->lev_af = stats_channel_push(&level_calc->filters[1], level_calc->lev_channel->capacitance_af);
+    if (updated & (1 << level_calc->env_channel->channel))
+        level_calc->env_af = stats_channel_push(&level_calc->filters[2], level_calc->env_channel->capacitance_af);
+
+    fdc_sample_t sample = {
+        .timestamp_us = esp_timer_get_time(),
+        .ref_af = level_calc->ref_af,
+        .lev_af = level_calc->lev_af,
+        .env_af = level_calc->env_af,
+        .delta_af = level_calc->current_delta_af,
+        .updated = updated,
+    };
+    sample_ring_push(level_calc->samples, &sample);
+}
+
+// The device may have reset to its defaults: rewrite all configuration and probe it before the next sample
+static void measurement_error(level_calc_t level_calc)
+{
+    level_calc->ref_channel->config_cached = false;
+    level_calc->lev_channel->config_cached = false;
+    level_calc->env_channel->config_cached = false;
+    level_calc->health_check_pending = true;
+}
+
+// Writes the configuration of all three channels, stopping at the first failed write
+static esp_err_t configure_channels(level_calc_t level_calc)
+{
+    esp_err_t esp_rc = configure_channel(level_calc->ref_channel);
+    if (esp_rc == ESP_OK)
+        esp_rc = configure_channel(level_calc->lev_channel);
+    if (esp_rc == ESP_OK)
+        esp_rc = configure_channel(level_calc->env_channel);
+    return esp_rc;
+}
+
+// Probes the device ID after an error, or every HEALTH_CHECK_FREQ ms while healthy
+static esp_err_t health_check(level_calc_t level_calc)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (!level_calc->health_check_pending && now_us - level_calc->last_health_check_us < (int64_t)HEALTH_CHECK_FREQ * 1000)
+        return ESP_OK;
+
     esp_err_t esp_rc = check_fdc1004(level_calc->slave_handle);
     if (esp_rc != ESP_OK)
+    {
+        measurement_error(level_calc);
         return esp_rc;
+    }
+    level_calc->health_check_pending = false;
+    level_calc->last_health_check_us = now_us;
+    return ESP_OK;
+}
+
+esp_err_t update_measurements(level_calc_t level_calc)
+{
+    if (level_calc->streaming)
+        return ESP_ERR_INVALID_STATE;
 
-    configure_channel(level_calc->ref_channel);
-    configure_channel(level_calc->lev_channel);
-    configure_channel(level_calc->env_channel);
+    esp_err_t esp_rc = health_check(level_calc);
+    if (esp_rc != ESP_OK)
+        return esp_rc;
 
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    // Only writes registers that changed since the last call. A sample taken after a failed write
+    // would be compensated with a CAPDAC the device never received.
+    esp_rc = configure_channels(level_calc);
+    if (esp_rc != ESP_OK)
+    {
+        measurement_error(level_calc);
+        return esp_rc;
+    }
 
     // Update all readings on all channels
-    printf("REF PAD: \n");
-    update_measurement(level_calc->ref_channel);
-    printf("LEV PAD: \n");
-    update_measurement(level_calc->lev_channel);
-    printf("ENV PAD: \n");
-    update_measurement(level_calc->env_channel);
-
-    level_calc->ref_value = level_calc->ref_channel->value;
-    level_calc->lev_value = level_calc->lev_channel->value;
-    level_calc->env_value = level_calc->env_channel->value;
+    esp_rc = update_measurement(level_calc->ref_channel);
+    if (esp_rc != ESP_OK)
+    {
+        measurement_error(level_calc);
+        return esp_rc;
+    }
+    esp_rc = update_measurement(level_calc->lev_channel);
+    if (esp_rc != ESP_OK)
+    {
+        measurement_error(level_calc);
+        return esp_rc;
+    }
+    esp_rc = update_measurement(level_calc->env_channel);
+    if (esp_rc != ESP_OK)
+    {
+        measurement_error(level_calc);
+        return esp_rc;
+    }
+
+    filter_results(level_calc, (1 << level_calc->ref_channel->channel) | (1 << level_calc->lev_channel->channel) |
+                                   (1 << level_calc->env_channel->channel));
     // level_calc->env_value = update_measurement(level_calc->lvl_env_channel);
     return ESP_OK;
 }
 
-esp_err_t update_capdac(fdc_channel_t channel_obj)
+// Writes FDC_REGISTER: rate, repeat and measurement enables
+static esp_err_t write_fdc_conf(level_calc_t level_calc, uint16_t fdc_conf)
 {
-    if ((int16_t)(channel_obj->raw_msb) > FDC1004_UPPER_BOUND) // adjust capdac accordingly
+    I2C_TRANSACTION_DECLARE(trans, FDC_REGISTER_WRITE_LEN);
+    i2c_transaction_write_byte(&trans, FDC_REGISTER);
+    i2c_transaction_write_byte(&trans, (uint8_t)(fdc_conf >> 8));
+    i2c_transaction_write_byte(&trans, (uint8_t)(fdc_conf));
+    return i2c_transaction_transmit(&trans, level_calc->slave_handle);
+}
+
+esp_err_t fdc_start_streaming(level_calc_t level_calc, uint8_t rate)
+{
+    if (!FDC1004_IS_RATE(rate))
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t error = health_check(level_calc);
+    if (error != ESP_OK)
+        return error;
+
+    fdc_channel_t channels[] = {level_calc->ref_channel, level_calc->lev_channel, level_calc->env_channel};
+    uint16_t fdc_conf = ((uint16_t)rate << 10) | FDC1004_REPEAT;
+    for (uint8_t i = 0; i < FDC1004_STREAM_CHANNELS; i++)
     {
-        if (channel_obj->capdac < FDC1004_CAPDAC_MAX)
-            channel_obj->capdac++;
+        channels[i]->rate = rate;
+        error = configure_channel(channels[i]);
+        if (error != ESP_OK)
+        {
+            measurement_error(level_calc);
+            return error;
+        }
+        fdc_conf |= 0x0080 >> channels[i]->channel; // Measurement slot n converts CINn
     }
-    else if ((int16_t)(channel_obj->raw_msb) < FDC1004_LOWER_BOUND)
+
+    error = write_fdc_conf(level_calc, fdc_conf);
+    if (error != ESP_OK)
     {
-        if (channel_obj->capdac > 0)
-            channel_obj->capdac--;
+        ESP_LOGE(FDC_TAG, "STREAM START ERROR | Code: 0x%.2X", error);
+        measurement_error(level_calc);
+        return error;
     }
+    level_calc->streaming = true;
+    level_calc->stream_next_us = esp_timer_get_time() + FDC1004_CONVERSION_US(rate);
     return ESP_OK;
 }
 
+esp_err_t fdc_update_stream(level_calc_t level_calc, uint8_t *ret_updated)
+{
+    if (!level_calc->streaming)
+        return ESP_ERR_INVALID_STATE;
+
+    fdc_channel_t channels[] = {level_calc->ref_channel, level_calc->lev_channel, level_calc->env_channel};
+    uint16_t done_mask = 0;
+    for (uint8_t i = 0; i < FDC1004_STREAM_CHANNELS; i++)
+        done_mask |= 0x0008 >> channels[i]->channel;
+
+    // Sleep until the next slot is due, then harvest every slot that has completed
+    int64_t now_us = esp_timer_get_time();
+    uint32_t first_wait_us = level_calc->stream_next_us > now_us ? (uint32_t)(level_calc->stream_next_us - now_us) : 0;
+    uint16_t done_status;
+    esp_err_t error = wait_done(level_calc->ref_channel, done_mask, first_wait_us, &done_status);
+    if (error != ESP_OK)
+    {
+        measurement_error(level_calc);
+        return error;
+    }
+
+    uint8_t updated = 0;
+    uint8_t harvested = 0;
+    for (uint8_t i = 0; i < FDC1004_STREAM_CHANNELS; i++)
+    {
+        if (!(done_status & (0x0008 >> channels[i]->channel)))
+            continue;
+        error = read_result(channels[i]);
+        if (error == ESP_OK)
+            error = update_capdac(channels[i]);
+        if (error != ESP_OK)
+        {
+            measurement_error(level_calc);
+            return error;
+        }
+        updated |= 1 << channels[i]->channel;
+        harvested++;
+    }
+
+    filter_results(level_calc, updated);
+
+    // Slots complete one conversion time apart, follow the device's own cadence
+    level_calc->stream_next_us += (int64_t)FDC1004_CONVERSION_US(level_calc->ref_channel->rate) * harvested;
+    now_us = esp_timer_get_time();
+    if (level_calc->stream_next_us < now_us)
+        level_calc->stream_next_us = now_us;
+
+    if (ret_updated != NULL)
+        *ret_updated = updated;
+    return health_check(level_calc);
+}
+
+esp_err_t fdc_stop_streaming(level_calc_t level_calc)
+{
+    if (!level_calc->streaming)
+        return ESP_ERR_INVALID_STATE;
+
+    esp_err_t error = write_fdc_conf(level_calc, 0);
+    if (error != ESP_OK)
+    {
+        ESP_LOGE(FDC_TAG, "STREAM STOP ERROR | Code: 0x%.2X", error);
+        return error;
+    }
+    level_calc->streaming = false;
+    return ESP_OK;
+}
+
+void reset_capdac(fdc_channel_t channel_obj)
+{
+    channel_obj->capdac_locked = false;
+    channel_obj->capdac_low = 0;
+    channel_obj->capdac_high = FDC1004_CAPDAC_MAX;
+}
+
+esp_err_t update_capdac(fdc_channel_t channel_obj)
+{
+    int16_t msb = (int16_t)channel_obj->raw_msb;
+    int capdac = channel_obj->capdac;
+
+    // The input moved further than one step can follow, search again
+    if (channel_obj->capdac_locked && FDC1004_IS_SATURATED(channel_obj->raw_msb))
+        reset_capdac(channel_obj);
+
+    if (!channel_obj->capdac_locked)
+    {
+        // Binary search: each reading says which side of the window the CAPDAC is on
+        if (msb > FDC1004_UPPER_BOUND)
+            channel_obj->capdac_low = capdac + 1;
+        else if (msb < FDC1004_LOWER_BOUND)
+            channel_obj->capdac_high = capdac - 1;
+        else
+            channel_obj->capdac_locked = true;
+
+        if (!channel_obj->capdac_locked)
+        {
+            if (channel_obj->capdac_low > channel_obj->capdac_high)
+            {
+                // Input beyond what the CAPDAC can offset, settle at the nearest end
+                capdac = channel_obj->capdac_low > FDC1004_CAPDAC_MAX ? FDC1004_CAPDAC_MAX : 0;
+                channel_obj->capdac_locked = true;
+            }
+            else
+                capdac = (channel_obj->capdac_low + channel_obj->capdac_high) / 2;
+        }
+    }
+    else if (msb > FDC1004_UPPER_BOUND) // Tracking: one step per sample
+    {
+        if (capdac < FDC1004_CAPDAC_MAX)
+            capdac++;
+    }
+    else if (msb < FDC1004_LOWER_BOUND)
+    {
+        if (capdac > 0)
+            capdac--;
+    }
+
+    if (capdac == channel_obj->capdac)
+        return ESP_OK;
+    channel_obj->capdac = capdac;
+    return configure_channel(channel_obj); // Only the config register changes
+}
+
 level_calc_t init_fdc1004(i2c_master_bus_handle_t master_bus)
 {
     level_calc_t new_calc = malloc(sizeof(level_calculator));
 
+    new_calc->ref_af = 0;
+    new_calc->lev_af = 0;
+    new_calc->env_af = 0;
+
+    stats_config_t filter_config = {
+        .median_n = FDC1004_FILTER_MEDIAN,
+        .window = FDC1004_FILTER_WINDOW,
+        .ema_alpha_q16 = 0, // Only the windowed means are published
+        .welford = false,
+    };
+    for (uint8_t i = 0; i < FDC1004_STREAM_CHANNELS; i++)
+        ESP_ERROR_CHECK(stats_channel_init(&new_calc->filters[i], &filter_config, new_calc->filter_storage[i], FDC1004_FILTER_CAPACITY));
+    ESP_ERROR_CHECK(sample_ring_new(FDC1004_SAMPLE_RING_SLOTS, sizeof(fdc_sample_t), &new_calc->samples));
+
     // Initial calibration
     calibrate(new_calc);
 
@@ -329,9 +701,10 @@ level_calc_t init_fdc1004(i2c_master_bus_handle_t master_bus)
 
     // xTimerStart(timer, 0);
 
-    new_calc->ref_value = 0;
-    new_calc->lev_value = 0;
-    new_calc->env_value = 0;
+    new_calc->streaming = false;
+    new_calc->stream_next_us = 0;
+    new_calc->health_check_pending = true; // Probe the device before the first sample
+    new_calc->last_health_check_us = 0;
 
     i2c_device_config_t dev_cfg = {
         .dev_addr_length = I2C_ADDR_BIT_LEN_7,
@@ -348,78 +721,119 @@ level_calc_t init_fdc1004(i2c_master_bus_handle_t master_bus)
     new_calc->lev_channel = init_channel(slave_handle, LEV_CHANNEL - 1, FDC1004_400HZ);
     new_calc->env_channel = init_channel(slave_handle, ENV_CHANNEL - 1, FDC1004_400HZ);
 
-    configure_channel(new_calc->ref_channel);
-    configure_channel(new_calc->lev_channel);
-    configure_channel(new_calc->env_channel);
+    // A device that does not answer yet is configured again, and probed, before the first sample
+    if (configure_channels(new_calc) != ESP_OK)
+        measurement_error(new_calc);
 
     return new_calc;
 }
 
 esp_err_t calibrate(level_calc_t level)
 {
-    level->current_delta = level->ref_value - level->env_value;
+    level->current_delta_af = level->ref_af - level->env_af;
     // level->current_delta = level->ref_value - REF_BASELINE;
-    if (level->current_delta == 0)
+    if (level->current_delta_af == 0)
     {
         printf("Calibration Failed! DELTA 0\n");
     }
 
-    // Calculates the predicted trend
-    float forecast_m = 0, forecast_b = 0;
-    forecast_m = level->current_delta / 5;
-    forecast_b = LEV_BASELINE - forecast_m * 5;
+    // The predicted trend, forecast_m = delta / 5 and forecast_b = LEV_BASELINE - delta, is applied
+    // directly by fdc_linear_level_q16()
+    return ESP_OK;
+}
 
-    // printf("(2) Forecast m: %.2f\n", forecast_m);
-    // printf("(2) Forecast b: %.2f\n", forecast_b);
+int32_t fdc_code_to_af(int32_t raw_code, int capdac)
+{
+    // 2^19 codes per pF: 10^6 / 2^19 = 15625 / 2^13 aF per code, rounded to nearest
+    int32_t attofarads = (int32_t)(((int64_t)raw_code * 15625 + (1 << 12)) >> 13);
+    return attofarads + capdac * FEMTOFARADS_CAPDAC * 1000;
+}
 
-    level->correction_gain = 1 / forecast_m;
-    level->correction_offset = -1 * level->correction_gain * forecast_b;
+float fdc_af_to_pf(int32_t attofarads)
+{
+    return (float)attofarads / 1000000;
+}
 
-    return ESP_OK;
+int32_t fdc_linear_level_q16(int32_t lev_af, int32_t delta_af)
+{
+    if (delta_af == 0)
+        return 0;
+
+    // gain = 5 / delta, offset = -gain * (LEV_BASELINE - delta)
+    int64_t forecast_b_af = (int64_t)LEV_BASELINE_AF - delta_af;
+    int64_t corrected_af = (((int64_t)lev_af * CORRECTION_MULTIPLIER_Q16) >> 16) - forecast_b_af;
+    return (int32_t)((corrected_af * (5 << 16)) / delta_af) + (int32_t)CORRECTION_OFFSET * 65536;
 }
 
-uint8_t round_nearest_multiple(float value, uint8_t multiple)
+// Rounds a Q16.16 value to the nearest multiple, halves rounding towards zero as before
+static uint8_t round_nearest_multiple(int32_t value_q16, uint8_t multiple)
 {
-    return (int)((value + (multiple / 2)) / multiple) * multiple;
+    return (uint8_t)(((int64_t)value_q16 + ((int64_t)(multiple / 2) << 16)) / ((int64_t)multiple << 16) * multiple);
 }
 
-uint8_t calculate_level(level_calc_t level)
+float calculate_sample_level_linear(const fdc_sample_t *sample)
 {
-    esp_err_t esp_rc = check_fdc1004(level->slave_handle);
-    if (esp_rc != ESP_OK)
-        return esp_rc;
+    return (float)fdc_linear_level_q16(sample->lev_af, sample->delta_af) / (1 << 16);
+}
 
+uint8_t calculate_sample_level(const fdc_sample_t *sample)
+{
+    // Device presence is checked by the measurement path, see health_check()
     // if (level->ref_value < 0 || level->lev_value < 0 || level->env_value < 0)
     //     printf("ERROR: NEGATIVE VAL!\n");
 
     // if (level->ref_value < REF_BASELINE - 0.2)
     //     fdc_reset(level->ref_channel->port);
 
-    if (level->lev_value < LEV_BASELINE)
+    if (sample->lev_af < LEV_BASELINE_AF)
         return 0;
 
     // Apply linear correction
-    float linear_corrected = (level->lev_value * CORRECTION_MULTIPLIER * level->correction_gain) + (CORRECTION_OFFSET + level->correction_offset);
-
-    printf("Linear Corrected: %f\n", linear_corrected);
+    int32_t linear_corrected = fdc_linear_level_q16(sample->lev_af, sample->delta_af);
+    ESP_LOGD(FDC_TAG, "Linear Corrected: %" PRId32 "/65536", linear_corrected);
 
     return round_nearest_multiple(linear_corrected, 5);
 }
 
-void fdc1004_main(void *pvParameter)
+// The level values are rewritten by the measuring task, a published sample is one consistent copy of them
+float calculate_level_linear(level_calc_t level)
+{
+    fdc_sample_t sample;
+    if (sample_ring_read_latest(level->samples, &sample, NULL) != ESP_OK)
+        return 0;
+    return calculate_sample_level_linear(&sample);
+}
+
+uint8_t calculate_level(level_calc_t level)
 {
-    esp_err_t esp_rc;
+    fdc_sample_t sample;
+    if (sample_ring_read_latest(level->samples, &sample, NULL) != ESP_OK)
+        return 0;
+    return calculate_sample_level(&sample);
+}
 
+void fdc1004_main(void *pvParameter)
+{
     i2c_master_bus_handle_t bus = *((i2c_master_bus_handle_t *)pvParameter);
     level_calc_t level_sensor = init_fdc1004(bus);
 
+    // Sampling runs in its own task on the second core, away from the display and menu. The device
+    // streams the REF, LEV and ENV slots in repeat mode at 400 S/s and the task harvests each slot.
+    fdc_acq_config_t acq_config = {.stream_rate = FDC1004_400HZ, .core_id = 1};
+    fdc_acq_handle_t acq;
+    ESP_ERROR_CHECK(fdc_acq_start(level_sensor, &acq_config, &acq));
+
+    fdc_acq_stats_t stats;
     while (1)
     {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        esp_rc = update_measurements(level_sensor);
-        // if (esp_rc == ESP_OK)
-        // {
-        //     calculate_level(level_sensor);
-        // }
+        vTaskDelay(pdMS_TO_TICKS(FDC_ACQ_LOG_PERIOD_MS));
+        fdc_acq_get_stats(acq, &stats);
+        ESP_LOGI(FDC_TAG, "%" PRIu32 " samples, %" PRIu32 " errors, %" PRIu32 " missed, jitter p99 %" PRId64 " us max %" PRId64 " us",
+                 stats.samples, stats.errors, stats.missed, fdc_acq_jitter_percentile(&stats, 99), stats.jitter_max_us);
+
+        // The acquisition task owns level_sensor's values, read its latest published sample instead
+        fdc_sample_t sample;
+        if (sample_ring_read_latest(level_sensor->samples, &sample, NULL) == ESP_OK)
+            ESP_LOGI(FDC_TAG, "Level: %u (%.1f)", calculate_sample_level(&sample), calculate_sample_level_linear(&sample));
     }
-}
\ No newline at end of file
+}
@@ -11,9 +11,12 @@
 // #include <driver/i2c.h>
 #include <driver/i2c_master.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
-// #include "MovingAverage.h"
+#include "gesp-stats.h"
+#include "gesp-ring.h"
 
 #include "communication.h"
 
@@ -25,6 +28,19 @@
 #define FDC1004_200HZ (0x2)
 #define FDC1004_400HZ (0x3)
 #define FDC1004_IS_RATE(x) (FDC1004_100HZ <= x && x <= FDC1004_400HZ)
+#define FDC1004_CONVERSION_US(rate) (10000 >> ((rate) - 1)) // 10 / 5 / 2.5 ms at 100 / 200 / 400 S/s
+
+#define FDC1004_REPEAT (0x0100)        // FDC_REGISTER repeat bit: enabled measurements convert back to back
+#define FDC1004_STREAM_CHANNELS (3)     // REF, LEV and ENV slots converted while streaming
+
+#define FDC1004_FILTER_CAPACITY (32)   // Window storage per channel, a power of two
+#define FDC1004_FILTER_WINDOW (30)     // Samples averaged into the level values, up to FDC1004_FILTER_CAPACITY
+#define FDC1004_FILTER_MEDIAN (3)      // Spike filter length
+
+#define FDC1004_SAMPLE_RING_SLOTS (128) // Published samples held for readers, about 0.3 s while streaming at 400 S/s
+
+#define FDC1004_DONE_POLL_MIN_US (250)       // Re-poll interval after the first missed DONE, doubles up to a conversion time
+#define FDC1004_DONE_TIMEOUT_CONVERSIONS (4) // Give up on a measurement after this many conversion times
 
 #define FDC1004_CAPDAC_MAX (0x1F)
 
@@ -37,34 +53,41 @@
 
 #define FDC_REGISTER (0x0C)
 #define FDC_DEVICE_ID_REG (0xFF)
+#define FDC_REGISTER_WRITE_LEN (3) // Pointer byte followed by a 16 bit register value
 
 #define ATTOFARADS_UPPER_WORD (457) // number of attofarads for each 8th most lsb (lsb of the upper 16 bit half-word)
-#define FEMTOFARADS_CAPDAC (3028)   // number of femtofarads for each lsb of the capdac
+#define FEMTOFARADS_CAPDAC (3125)   // number of femtofarads for each lsb of the capdac
 
 #define FDC1004_UPPER_BOUND ((int16_t)0x4000)
 #define FDC1004_LOWER_BOUND (-1 * FDC1004_UPPER_BOUND)
+#define FDC1004_SATURATION ((int16_t)0x7800) // +-15 pF full scale, as a result MSB
+#define FDC1004_IS_SATURATED(msb) ((int16_t)(msb) >= FDC1004_SATURATION || (int16_t)(msb) <= -FDC1004_SATURATION)
 
 #define GAIN_CAL 1
 #define OFFSET_CAL -10
 
-const uint8_t config_address[4] = {0x08, 0x09, 0x0A, 0x0B};
-const uint8_t msb_addresses[4] = {0x00, 0x02, 0x04, 0x06};
-const uint8_t lsb_addresses[4] = {0x01, 0x03, 0x05, 0x07};
-const uint8_t offset_registers[4] = {0x0D, 0x0E, 0x0F, 0x10};
-const uint8_t gain_registers[4] = {0x11, 0x12, 0x13, 0x14};
+static const uint8_t config_address[4] = {0x08, 0x09, 0x0A, 0x0B};
+static const uint8_t msb_addresses[4] = {0x00, 0x02, 0x04, 0x06};
+static const uint8_t lsb_addresses[4] = {0x01, 0x03, 0x05, 0x07};
+static const uint8_t offset_registers[4] = {0x0D, 0x0E, 0x0F, 0x10};
+static const uint8_t gain_registers[4] = {0x11, 0x12, 0x13, 0x14};
 
 // Calibration Parameters
 #define REF_BASELINE 1.80 // can be replaced with environment later
 #define REF_FULL 2.4      // can be replaced with environment later
 #define LEV_BASELINE 6.28
+#define LEV_BASELINE_AF ((int32_t)(LEV_BASELINE * 1000000)) // Folded at compile time for the fixed point path
 
 #define FORECAST_NUM_INCREMENTS 20
 
 // Increase if undershooting, Decrease if overshooting
 #define CORRECTION_MULTIPLIER 1.00
 #define CORRECTION_OFFSET -10
+#define CORRECTION_MULTIPLIER_Q16 ((int32_t)(CORRECTION_MULTIPLIER * 65536))
 
 #define CALIBRATION_FREQ 5000 // frequency of self calibration (ms)
+#define HEALTH_CHECK_FREQ 5000 // frequency of device ID checks while measurements succeed (ms)
+#define FDC_ACQ_LOG_PERIOD_MS 5000 // fdc1004_main logs the acquisition statistics this often
 
 #define ENV_CHANNEL 1 // CIN1
 #define LEV_CHANNEL 2 // CIN2
@@ -88,28 +111,50 @@ struct fdc1004_channel
     // Utility
     // moving_average_t ma;
 
+    // Last values written to the config, gain and offset registers, valid while config_cached
+    bool config_cached;
+    uint16_t config_cache;
+    uint16_t gain_cache;
+    uint16_t offset_cache;
+
+    esp_timer_handle_t wait_timer; // Wakes the measuring task, ticks are too coarse for a conversion
+    SemaphoreHandle_t wait_done;
+    esp_timer_handle_t fence_timer; // Fired once by del_channel(), behind any wait_timer callback still running
+    volatile bool fenced;
+
     // Continuously changed
     uint16_t raw_msb;
     uint16_t raw_lsb;
     int capdac;
-    float raw_value;
-    float value;
+    bool capdac_locked; // CAPDAC ranging: binary search until locked, single steps after
+    int8_t capdac_low;  // Search bounds while not locked
+    int8_t capdac_high;
+    int32_t raw_code;       // Latest 24 bit result, 2^19 codes per pF
+    int32_t capacitance_af; // Latest unsaturated capacitance including the CAPDAC offset, attofarads
 };
 typedef struct fdc1004_channel* fdc_channel_t;
 
+// Published sample, read by other tasks from the level calculator's sample ring
+typedef struct fdc_sample
+{
+    int64_t timestamp_us; // When the results were read
+    int32_t ref_af;       // Filtered values, attofarads
+    int32_t lev_af;
+    int32_t env_af;
+    int32_t delta_af;     // Calibration delta the level is computed against, attofarads
+    uint8_t updated;      // Channels read for this sample (1 << channel)
+} fdc_sample_t;
+
 // Level Calculator Struct
 typedef struct level_calculator
 {
-    float current_delta; // Current delta that the sensor is calibrated for
+    int32_t current_delta_af; // Current delta that the sensor is calibrated for, attofarads
 
-    // Correction Values (calculated and used in level predictions)
-    float correction_gain;
-    float correction_offset;
-
-    // Result Values (Constantly updated)
-    float ref_value;
-    float lev_value;
-    float env_value;
+    // Result Values (Constantly updated), attofarads, filtered
+    // Private to the measuring task, which may run on another core: other tasks must read samples instead
+    int32_t ref_af;
+    int32_t lev_af;
+    int32_t env_af;
 
     // Channel Objects
     i2c_master_bus_handle_t master_bus;
@@ -119,6 +164,21 @@ typedef struct level_calculator
     fdc_channel_t ref_channel;
     fdc_channel_t lev_channel;
     fdc_channel_t env_channel;
+
+    // REF, LEV and ENV filter chains, packed with their window storage
+    stats_channel_t filters[FDC1004_STREAM_CHANNELS];
+    int32_t filter_storage[FDC1004_STREAM_CHANNELS][FDC1004_FILTER_CAPACITY];
+
+    // Every filtered sample is pushed here, see fdc_sample_t
+    sample_ring_handle_t samples;
+
+    // Repeat mode acquisition
+    bool streaming;
+    int64_t stream_next_us; // When the next measurement slot is expected to complete
+
+    // Device presence
+    bool health_check_pending; // Set by measurement errors, the device ID is read before the next sample
+    int64_t last_health_check_us;
 } level_calculator;
 typedef level_calculator *level_calc_t;
 
@@ -132,32 +192,87 @@ typedef level_calculator *level_calc_t;
 esp_err_t fdc_reset(i2c_master_dev_handle_t slave_handle);
 
 /**
- * @brief Frees associated memory with pointer
+ * @brief Frees associated memory with pointer. Waits for a wait timer callback already running in the
+ * esp_timer task, so must not be called from an esp_timer callback.
  *
  * @param channel_obj Pointer to channel struct
  *
- * @return ESP_OK if all good.
+ * @return ESP_OK if all good, the esp_timer error if the wait could not be started and nothing was freed
  */
 esp_err_t del_channel(fdc_channel_t channel_obj);
 
 /**
- * @brief Triggers and updates measurements of the channel struct
+ * @brief Triggers a single measurement on the channel and reads the result once its DONE bit is set.
+ * The DONE bit is first polled one conversion time (from the channel rate) after the trigger.
+ *
+ * @param channel_obj Pointer to channel struct
+ *
+ * @return ESP_OK if good, ESP_ERR_TIMEOUT if the measurement did not complete, I2C error otherwise
+ */
+esp_err_t update_measurement(fdc_channel_t channel_obj);
+
+/**
+ * @brief Triggers and updates measurements of the channel struct.
+ * Publishes an fdc_sample_t to level_calc->samples.
  *
  * @param level_calc Pointer to level calculator
  *
- * @return ESP_OK if good, ESP_ERR_INVLD_ARG if there is mismatch data
+ * @return ESP_OK if good, ESP_ERR_INVLD_ARG if there is mismatch data, ESP_ERR_INVALID_STATE while streaming,
+ * I2C error if a configuration write or a measurement failed
  */
 esp_err_t update_measurements(level_calc_t level_calc);
 
 /**
- * @brief Updates the capdac associated to the channel
+ * @brief Starts continuous acquisition. The REF, LEV and ENV measurement slots are configured once and
+ * converted back to back in repeat mode, so each channel updates at a third of the rate.
+ * update_measurements() is unavailable until the stream is stopped.
+ *
+ * @param level_calc Pointer to level calculator
+ * @param rate FDC1004_100HZ, FDC1004_200HZ or FDC1004_400HZ
+ *
+ * @return ESP_OK if good, ESP_ERR_INVALID_ARG for a bad rate, I2C error otherwise
+ */
+esp_err_t fdc_start_streaming(level_calc_t level_calc, uint8_t rate);
+
+/**
+ * @brief Waits for the next measurement slot to complete, then reads every completed slot into its
+ * channel and the level calculator values. Publishes an fdc_sample_t to level_calc->samples.
+ *
+ * @param level_calc Pointer to level calculator
+ * @param ret_updated Returned bitmask of updated channels (1 << channel), may be NULL
+ *
+ * @return ESP_OK if good, ESP_ERR_INVALID_STATE if not streaming, ESP_ERR_TIMEOUT if no slot completed, I2C error otherwise
+ */
+esp_err_t fdc_update_stream(level_calc_t level_calc, uint8_t *ret_updated);
+
+/**
+ * @brief Stops continuous acquisition
+ *
+ * @param level_calc Pointer to level calculator
+ *
+ * @return ESP_OK if good, ESP_ERR_INVALID_STATE if not streaming, I2C error otherwise
+ */
+esp_err_t fdc_stop_streaming(level_calc_t level_calc);
+
+/**
+ * @brief Updates the capdac associated to the channel from its latest result. Until locked, the capdac
+ * is binary searched so that the result lies within FDC1004_LOWER_BOUND - FDC1004_UPPER_BOUND (at most
+ * 7 samples). Once locked it follows the input one step per sample, and searches again if the result saturates.
+ * Called for every sample by update_measurement() and fdc_update_stream().
  *
  * @param channel_obj Pointer to channel struct
  *
- * @return ESP_OK if good, ESP_ERR_INVLD_ARG if there is mismatch data
+ * @return ESP_OK if good, I2C error if the new capdac could not be written
  */
 esp_err_t update_capdac(fdc_channel_t channel_obj);
 
+/**
+ * @brief Restarts capdac ranging with a binary search over the full capdac range, from the next sample
+ *
+ * @param channel_obj Pointer to channel struct
+ */
+void reset_capdac(fdc_channel_t channel_obj);
+
 /**
  * @brief Initialises a level calculator struct for storing all computation data related to levels
  *
@@ -168,7 +283,8 @@ esp_err_t update_capdac(fdc_channel_t channel_obj);
 level_calc_t init_fdc1004(i2c_master_bus_handle_t master_bus);
 
 /**
- * @brief Force calibrates the level calculator linear correction
+ * @brief Force calibrates the level calculator linear correction. Reads the measuring task's own
+ * values, so only call it from that task or before acquisition starts.
  *
  * @param level level_t struct pointer
  *
@@ -177,12 +293,66 @@ level_calc_t init_fdc1004(i2c_master_bus_handle_t master_bus);
 esp_err_t calibrate(level_calc_t level);
 
 /**
- * @brief Calculates the current predicted level through linear correction
+ * @brief Calculates the predicted level of a sample through linear correction, rounded to a multiple of 5.
+ * Integer only.
  *
- * @param level level_t struct pointer
+ * @param sample Sample read from level->samples
  *
  * @return unsigned integer
  */
+uint8_t calculate_sample_level(const fdc_sample_t *sample);
+
+/**
+ * @brief Float wrapper of the unrounded level of a sample, for display and logging
+ *
+ * @param sample Sample read from level->samples
+ *
+ * @return Linear corrected level
+ */
+float calculate_sample_level_linear(const fdc_sample_t *sample);
+
+/**
+ * @brief Calculates the current predicted level from the newest published sample, rounded to a multiple of 5.
+ * Safe to call from any task while the measuring task runs.
+ *
+ * @param level level_t struct pointer
+ *
+ * @return unsigned integer, 0 if no sample has been published yet
+ */
 uint8_t calculate_level(level_calc_t level);
 
+/**
+ * @brief Float wrapper of the unrounded level of the newest published sample, for display and logging
+ *
+ * @param level level_t struct pointer
+ *
+ * @return Linear corrected level, 0 if no sample has been published yet
+ */
+float calculate_level_linear(level_calc_t level);
+
+/**
+ * @brief Converts a 24 bit result to capacitance
+ *
+ * @param raw_code Sign extended 24 bit result, 2^19 codes per pF
+ * @param capdac CAPDAC value the result was converted with
+ *
+ * @return Capacitance in attofarads, rounded to nearest
+ */
+int32_t fdc_code_to_af(int32_t raw_code, int capdac);
+
+/**
+ * @brief Float wrapper: attofarads to picofarads
+ */
+float fdc_af_to_pf(int32_t attofarads);
+
+/**
+ * @brief Linear corrected level for a level pad capacitance, calibrated with the REF - ENV delta
+ *
+ * @param lev_af Level pad capacitance, attofarads
+ * @param delta_af Calibration delta, attofarads
+ *
+ * @return Level as Q16.16, 0 if the delta is 0
+ */
+int32_t fdc_linear_level_q16(int32_t lev_af, int32_t delta_af);
+
 void fdc1004_main(void *pvParameters);
\ No newline at end of file
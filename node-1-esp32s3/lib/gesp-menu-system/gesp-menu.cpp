@@ -7,44 +7,42 @@ extern "C"
 {
 #endif
 
-    Menu::Menu(ssd1306_t display1, button_handle_t button_handles[]) : display(display1)
+    Menu::Menu(ssd1306_t *display1, button_handle_t button_handles[]) : display(display1)
     {
-        // gesp_ssd1306_init(bus, &display);
+        // gesp_ssd1306_init(bus, display);
+        events = xQueueCreate(MENU_EVENT_QUEUE_LEN, sizeof(menu_event_t));
+        if (events == NULL)
+            ESP_LOGE(MENU_TAG, "Failed to create menu event queue");
+
         register_menu_buttons(*this, button_handles);
 
         memcpy(buttons, button_handles, MAX_NUM_BUTTONS * sizeof(button_handle_t));
 
-        curr_program = 0; // Change these ater
+        curr_program = MENU_NO_PROGRAM;
 
         cursor_pos = 2; // Initial Cursor position
 
-        display.clear_display(&display);
-        display.print_text_on_line(&display, "Gabe's System", LINE_0);
-        display.print_8x8basic(&display, '*', LINE_0, 120);
-        display.print_text_on_line(&display, ">1.Program 1", LINE_2);
-        display.print_text_on_line(&display, " 2.Program 2", LINE_3);
-        display.print_text_on_line(&display, " 3.Program 3", LINE_4);
+        display->clear_display(display);
+        display->print_text_on_line(display, "Gabe's System", LINE_0);
+        display->print_8x8basic(display, '*', LINE_0, 120);
+        display->print_text_on_line(display, ">1.Program 1", LINE_2);
+        display->print_text_on_line(display, " 2.Program 2", LINE_3);
+        display->print_text_on_line(display, " 3.Program 3", LINE_4);
+        display->flush(display);
         program_count = 3;
     }
 
-    esp_err_t Menu::add_program(const char *program_name, void (*program_main)(void *))
+    esp_err_t Menu::add_program(const char *program_name, const program_ops_t *ops)
     {
-        size_t length = strlen(program_name);
-        if (length + 1 > MAX_PROGRAM_NAME_LEN)
-        {
-            ESP_LOGE(MENU_TAG, "Program name too long");
-            return ESP_ERR_INVALID_ARG;
-        }
         if (program_count == MAX_NUM_PROGRAMS)
         {
             ESP_LOGE(MENU_TAG, "Max number of programs reached.");
             return ESP_ERR_INVALID_ARG;
         }
 
-        programs[program_count].handle = NULL;
-        strncpy(programs[program_count].program_name, program_name, length);
-        // programs[program_count].program_name = program_name;
-        programs[program_count].program_main = program_main; // Program Main Function
+        esp_err_t esp_rc = program_init(&programs[program_count], program_name, ops);
+        if (esp_rc != ESP_OK)
+            return esp_rc;
         program_count++;
 
         std::string line_text = " " + std::to_string(program_count) + "." + programs[program_count - 1].program_name;
@@ -52,69 +50,87 @@ extern "C"
         char arr[MAX_CHARACTERS_PER_LINE];
         strcpy(arr, line_text.c_str());
 
-        display.print_text_on_line(&display, arr, program_count + 1);
+        display->print_text_on_line(display, arr, program_count + 1);
+        display->flush(display);
 
         return ESP_OK;
     }
 
+    void Menu::move_cursor(int8_t steps)
+    {
+        if (program_count == 0)
+            return;
+        steps %= program_count;
+        if (steps == 0)
+            return;
+
+        display->print_8x8basic(display, ' ', cursor_pos, 0);
+        cursor_pos = 2 + (cursor_pos - 2 + steps + program_count) % program_count; // Program rows start at line 2
+        display->print_8x8basic(display, '>', cursor_pos, 0);
+    }
+
     void Menu::cursor_down()
     {
-        display.print_8x8basic(&display, ' ', cursor_pos, 0);
-        cursor_pos = (cursor_pos == program_count + 1) ? 2 : cursor_pos + 1;
-        display.print_8x8basic(&display, '>', cursor_pos, 0);
+        move_cursor(1);
+        display->flush(display);
     }
 
     void Menu::cursor_up()
     {
-        display.print_8x8basic(&display, ' ', cursor_pos, 0);
-        cursor_pos = (cursor_pos == 2) ? program_count + 1 : cursor_pos - 1;
-        display.print_8x8basic(&display, '>', cursor_pos, 0);
+        move_cursor(-1);
+        display->flush(display);
+    }
+
+    void Menu::stop_current_program()
+    {
+        if (program_stop(&programs[curr_program], pdMS_TO_TICKS(PROGRAM_JOIN_TIMEOUT_MS)) == ESP_ERR_TIMEOUT)
+            ESP_LOGW(MENU_TAG, "%s was deleted without finishing", programs[curr_program].program_name);
+
+        display->print_8x8basic(display, ' ', curr_program + 2, 120);
+        curr_program = MENU_NO_PROGRAM; // Back to Menu
+        display->print_8x8basic(display, '*', LINE_0, 120);
+        display->flush(display);
+        register_menu_buttons(*this, buttons);
     }
 
     void Menu::program_select()
     {
-        if (curr_program == cursor_pos - 1) // End program if program already running
+        uint8_t selected = cursor_pos - 2;
+        if (programs[selected].ops == NULL)
         {
-            display.print_8x8basic(&display, ' ', cursor_pos, 120);
-            // Add program id to task tracker
+            ESP_LOGW(MENU_TAG, "No program in slot %d", selected + 1);
+            return;
+        }
 
-            vTaskDelete(programs[curr_program].handle);
-            programs[curr_program].handle = NULL;
-            register_menu_buttons(*this, buttons);
-            curr_program = 0;
+        bool was_running = curr_program == selected;
+        if (curr_program != MENU_NO_PROGRAM) // End the running program first
+            stop_current_program();
+        if (was_running)
+            return;
 
-            // Unregister buttons and start associated init function of task
-            // End associated init function of task
-        }
-        else // Start the program
+        printf("Starting program %d\n", selected + 1);
+        deregister_buttons();
+        if (program_start(&programs[selected], buttons) != ESP_OK)
         {
-            display.print_8x8basic(&display, ' ', LINE_0, 120);
-            display.print_8x8basic(&display, '*', cursor_pos, 120);
-            curr_program = cursor_pos - 2;
-            printf("Starting program %d\n", cursor_pos + 1);
-            
-            deregister_buttons();
-
-            TaskHandle_t handle;
-            xTaskCreate(programs[curr_program].program_main, programs[curr_program].program_name, 4096, &buttons, 1, &handle);
-            programs[curr_program].handle = handle;
+            register_menu_buttons(*this, buttons);
+            return;
         }
+
+        curr_program = selected;
+        display->print_8x8basic(display, ' ', LINE_0, 120);
+        display->print_8x8basic(display, '*', cursor_pos, 120);
+        display->flush(display);
     }
 
     void Menu::program_end()
     {
-        if (curr_program == 0) // Menu is already running
+        if (curr_program == MENU_NO_PROGRAM) // Menu is already running
         {
             ESP_LOGE(MENU_TAG, "Menu is already running! Cannot end Menu.");
             return;
         }
 
-        deregister_buttons();
-        vTaskDelete(programs[curr_program].handle);
-        display.print_8x8basic(&display, ' ', curr_program + 2, 120);
-        curr_program = 0; // Back to Menu
-        display.print_8x8basic(&display, '*', LINE_0, 120);
-        register_menu_buttons(*this, buttons);
+        stop_current_program();
     }
 
     void Menu::deregister_buttons()
@@ -124,28 +140,88 @@ extern "C"
         iot_button_unregister_cb(buttons[2], BUTTON_PRESS_DOWN);
     }
 
-    static void menu_button1_cb(void *arg, void *data)
+    void Menu::post_event(menu_event_t event)
+    {
+        if (xQueueSend(events, &event, 0) != pdTRUE)
+            ESP_LOGW(MENU_TAG, "Menu event queue full, dropping event %d", event);
+    }
+
+    bool Menu::handle_events(TickType_t timeout)
+    {
+        menu_event_t event;
+        if (xQueueReceive(events, &event, timeout) != pdTRUE)
+            return false;
+
+        // Handle everything that queued up behind it as one batch. Cursor moves are
+        // summed so a burst of presses costs a single redraw.
+        int8_t cursor_steps = 0;
+        do
+        {
+            switch (event)
+            {
+            case MENU_EVENT_CURSOR_UP:
+                cursor_steps--;
+                break;
+            case MENU_EVENT_CURSOR_DOWN:
+                cursor_steps++;
+                break;
+            case MENU_EVENT_SELECT:
+                move_cursor(cursor_steps); // Select what the cursor was on when pressed
+                cursor_steps = 0;
+                program_select();
+                break;
+            case MENU_EVENT_END:
+                move_cursor(cursor_steps);
+                cursor_steps = 0;
+                program_end();
+                break;
+            }
+        } while (xQueueReceive(events, &event, 0) == pdTRUE);
+
+        move_cursor(cursor_steps);
+        display->flush(display);
+        return true;
+    }
+
+    void Menu::run()
+    {
+        // Sleep until a button is pressed, no periodic wakeups
+        while (1)
+            handle_events(portMAX_DELAY);
+    }
+
+    Menu::~Menu()
+    {
+        if (curr_program != MENU_NO_PROGRAM)
+            stop_current_program();
+        for (uint8_t i = 0; i < program_count; i++)
+            program_deinit(&programs[i]);
+
+        deregister_buttons();
+        iot_button_unregister_cb(buttons[3], BUTTON_PRESS_DOWN);
+        if (events != NULL)
+            vQueueDelete(events);
+    }
+
+    // Button callbacks run in the esp_timer task: post an event and return, the menu task does the work
+    static void menu_button1_cb(void *, void *data)
     {
-        Menu *menu = (Menu *)data;
-        menu->cursor_up();
+        ((Menu *)data)->post_event(MENU_EVENT_CURSOR_UP);
     }
 
-    static void menu_button2_cb(void *arg, void *data)
+    static void menu_button2_cb(void *, void *data)
     {
-        Menu *menu = (Menu *)data;
-        menu->cursor_down();
+        ((Menu *)data)->post_event(MENU_EVENT_CURSOR_DOWN);
     }
 
-    static void menu_button3_cb(void *arg, void *data)
+    static void menu_button3_cb(void *, void *data)
     {
-        Menu *menu = (Menu *)data;
-        menu->program_select();
+        ((Menu *)data)->post_event(MENU_EVENT_SELECT);
     }
 
-    static void menu_button4_cb(void *arg, void *data)
+    static void menu_button4_cb(void *, void *data)
     {
-        Menu *menu = (Menu *)data;
-        menu->program_end();
+        ((Menu *)data)->post_event(MENU_EVENT_END);
     }
 
     void register_menu_buttons(Menu &menu, button_handle_t buttons[])
@@ -153,7 +229,7 @@ extern "C"
         iot_button_register_cb(buttons[0], BUTTON_PRESS_DOWN, menu_button1_cb, &menu);
         iot_button_register_cb(buttons[1], BUTTON_PRESS_DOWN, menu_button2_cb, &menu);
         iot_button_register_cb(buttons[2], BUTTON_PRESS_DOWN, menu_button3_cb, &menu);
-        printf("Number of callbacks: %d\n", iot_button_count_cb(buttons[3]));
+        printf("Number of callbacks: %u\n", (unsigned)iot_button_count_cb(buttons[3]));
         if (iot_button_count_cb(buttons[3]) == 0)
             iot_button_register_cb(buttons[3], BUTTON_PRESS_DOWN, menu_button4_cb, &menu);
     }
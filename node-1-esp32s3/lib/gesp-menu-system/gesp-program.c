@@ -0,0 +1,218 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "gesp-program.h"
+
+/**
+ * @brief Moves the program to state, unless program_stop() has already claimed the task
+ *
+ * @return false if the task is being deleted and must not touch the program again
+ */
+static bool program_enter(program_t *program, program_state_t state)
+{
+    bool entered = false;
+    portENTER_CRITICAL(&program->lock);
+    if (program->state != PROGRAM_STATE_KILLED)
+    {
+        program->state = state;
+        entered = true;
+    }
+    portEXIT_CRITICAL(&program->lock);
+    return entered;
+}
+
+static void program_task(void *pvParameter)
+{
+    program_t *program = (program_t *)pvParameter;
+    program_ctx_t *ctx = &program->ctx;
+
+    esp_err_t esp_rc = program->ops->init != NULL ? program->ops->init(ctx) : ESP_OK;
+    if (esp_rc != ESP_OK)
+        ESP_LOGE(PROGRAM_TAG, "%s failed to start | Code: 0x%.2X", program->program_name, esp_rc);
+    else if (program_enter(program, PROGRAM_STATE_RUNNING))
+    {
+        program->ops->run(ctx);
+        if (program_enter(program, PROGRAM_STATE_STOPPING) && program->ops->stop != NULL)
+            program->ops->stop(ctx);
+    }
+
+    if (program_enter(program, PROGRAM_STATE_EXITED))
+    {
+        xSemaphoreGive(program->done); // Last use of the program, the slot may be restarted after this
+        vTaskDelete(NULL);
+    }
+
+    // program_stop() gave up on us and owns the task now: wait to be deleted
+    for (;;)
+        vTaskDelay(portMAX_DELAY);
+}
+
+// Runs in the esp_timer task: hand the event to the program and return
+static void program_button_cb(void *arg, void *data)
+{
+    (void)arg; // The button handle, the registration already identifies it
+    program_button_t *registration = (program_button_t *)data;
+    xQueueSend(registration->ctx->events, &registration->value, 0);
+}
+
+esp_err_t program_init(program_t *program, const char *name, const program_ops_t *ops)
+{
+    ESP_RETURN_ON_FALSE(ops != NULL && ops->run != NULL, ESP_ERR_INVALID_ARG, PROGRAM_TAG, "Program has no run hook");
+    ESP_RETURN_ON_FALSE(strlen(name) < MAX_PROGRAM_NAME_LEN, ESP_ERR_INVALID_ARG, PROGRAM_TAG, "Program name too long");
+
+    memset(program, 0, sizeof(program_t));
+    strcpy(program->program_name, name);
+    program->ops = ops;
+    program->state = PROGRAM_STATE_IDLE;
+    program->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    program->ctx.events = xQueueCreate(PROGRAM_EVENT_QUEUE_LEN, sizeof(uint8_t));
+    program->done = xSemaphoreCreateBinary();
+    if (program->ctx.events == NULL || program->done == NULL)
+    {
+        program_deinit(program);
+        ESP_LOGE(PROGRAM_TAG, "No memory for program %s", name);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t program_start(program_t *program, const button_handle_t buttons[])
+{
+    ESP_RETURN_ON_FALSE(program->state == PROGRAM_STATE_IDLE, ESP_ERR_INVALID_STATE, PROGRAM_TAG, "%s is already running", program->program_name);
+
+    program_ctx_t *ctx = &program->ctx;
+    memcpy(ctx->buttons, buttons, sizeof(ctx->buttons));
+    ctx->registered_count = 0;
+    ctx->stop_requested = false;
+    ctx->user = NULL;
+    program->state = PROGRAM_STATE_INIT; // No task yet, nothing else reads it
+    xQueueReset(ctx->events);
+    xSemaphoreTake(program->done, 0);
+
+    uint32_t stack = program->ops->task_stack ? program->ops->task_stack : PROGRAM_DEFAULT_TASK_STACK;
+    if (xTaskCreate(program_task, program->program_name, stack, program, PROGRAM_TASK_PRIORITY, &program->handle) != pdPASS)
+    {
+        program->handle = NULL;
+        program->state = PROGRAM_STATE_IDLE;
+        ESP_LOGE(PROGRAM_TAG, "Failed to create task for %s", program->program_name);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Unregisters every button callback the program registered. Only called once the task has
+ * exited or been deleted, so nothing is still adding to ctx->registered.
+ */
+static void program_unregister_buttons(program_ctx_t *ctx)
+{
+    for (uint8_t i = 0; i < ctx->registered_count; i++)
+    {
+        const program_button_t *registration = &ctx->registered[i];
+        bool duplicate = false;
+        for (uint8_t j = 0; j < i; j++)
+        {
+            if (ctx->registered[j].button == registration->button && ctx->registered[j].event == registration->event)
+                duplicate = true;
+        }
+        if (!duplicate) // Unregistering clears every callback for the event
+            iot_button_unregister_cb(registration->button, registration->event);
+    }
+    ctx->registered_count = 0;
+}
+
+esp_err_t program_stop(program_t *program, TickType_t timeout)
+{
+    ESP_RETURN_ON_FALSE(program->state != PROGRAM_STATE_IDLE, ESP_ERR_INVALID_STATE, PROGRAM_TAG, "%s is not running", program->program_name);
+
+    program_ctx_t *ctx = &program->ctx;
+    esp_err_t esp_rc = ESP_OK;
+
+    // Stop jumps the queue. If it is full of stale button events they no longer matter.
+    ctx->stop_requested = true;
+    uint8_t stop = PROGRAM_EVENT_STOP;
+    if (xQueueSendToFront(ctx->events, &stop, 0) != pdTRUE)
+    {
+        xQueueReset(ctx->events);
+        xQueueSendToFront(ctx->events, &stop, 0);
+    }
+
+    if (xSemaphoreTake(program->done, timeout) != pdTRUE)
+    {
+        // Claim the task, unless it exited between the timeout and here
+        portENTER_CRITICAL(&program->lock);
+        program_state_t state = program->state;
+        if (state != PROGRAM_STATE_EXITED)
+            program->state = PROGRAM_STATE_KILLED;
+        portEXIT_CRITICAL(&program->lock);
+
+        if (state == PROGRAM_STATE_EXITED)
+            xSemaphoreTake(program->done, portMAX_DELAY); // Given right after EXITED, the task deletes itself
+        else
+        {
+            // The task can no longer change state or exit by itself, so the handle is still valid
+            ESP_LOGE(PROGRAM_TAG, "%s did not stop in time, deleting it", program->program_name);
+            vTaskDelete(program->handle);
+            if (state == PROGRAM_STATE_RUNNING && program->ops->stop != NULL)
+                program->ops->stop(ctx); // The task is gone, so nothing else touches its resources
+            else if (state != PROGRAM_STATE_RUNNING)
+                ESP_LOGW(PROGRAM_TAG, "%s was deleted in its %s hook, its resources may leak", program->program_name,
+                         state == PROGRAM_STATE_INIT ? "init" : "stop");
+            esp_rc = ESP_ERR_TIMEOUT;
+        }
+    }
+
+    // No more button events for a program that is gone
+    program_unregister_buttons(ctx);
+
+    program->handle = NULL;
+    program->state = PROGRAM_STATE_IDLE;
+    return esp_rc;
+}
+
+void program_deinit(program_t *program)
+{
+    if (program->ctx.events != NULL)
+        vQueueDelete(program->ctx.events);
+    if (program->done != NULL)
+        vSemaphoreDelete(program->done);
+    program->ctx.events = NULL;
+    program->done = NULL;
+}
+
+esp_err_t program_register_button(program_ctx_t *ctx, uint8_t button, button_event_t event, uint8_t value)
+{
+    ESP_RETURN_ON_FALSE(button < MAX_PROGRAM_BUTTONS && value < PROGRAM_EVENT_STOP, ESP_ERR_INVALID_ARG, PROGRAM_TAG, "Invalid button registration");
+    ESP_RETURN_ON_FALSE(!ctx->stop_requested, ESP_ERR_INVALID_STATE, PROGRAM_TAG, "Program is stopping");
+    ESP_RETURN_ON_FALSE(ctx->registered_count < MAX_PROGRAM_BUTTON_CBS, ESP_ERR_NO_MEM, PROGRAM_TAG, "Too many button callbacks");
+
+    program_button_t *registration = &ctx->registered[ctx->registered_count];
+    registration->ctx = ctx;
+    registration->button = ctx->buttons[button];
+    registration->event = event;
+    registration->value = value;
+
+    // Counted before registering, so a task deleted in between still has the callback unregistered
+    ctx->registered_count++;
+    esp_err_t esp_rc = iot_button_register_cb(registration->button, event, program_button_cb, registration);
+    if (esp_rc != ESP_OK)
+    {
+        ctx->registered_count--;
+        ESP_LOGE(PROGRAM_TAG, "Button registration failed | Code: 0x%.2X", esp_rc);
+    }
+    return esp_rc;
+}
+
+bool program_wait_event(program_ctx_t *ctx, uint8_t *ret_event, TickType_t timeout)
+{
+    if (ctx->stop_requested)
+        return false;
+
+    if (xQueueReceive(ctx->events, ret_event, timeout) != pdTRUE)
+    {
+        *ret_event = PROGRAM_EVENT_TIMEOUT;
+        return !ctx->stop_requested;
+    }
+    return *ret_event != PROGRAM_EVENT_STOP;
+}
@@ -0,0 +1,167 @@
+/**
+ * Program lifecycle for Gabe's Menu
+ *
+ * A program is a set of hooks run in its own task:
+ *  - init: acquire resources and register buttons. Runs first, in the program task.
+ *  - run: the program body. Returns once program_wait_event() reports a stop request.
+ *  - stop: release everything init acquired. Runs after run returns, in the program task.
+ *
+ * The menu asks a program to stop, joins its task with a timeout and then unregisters every
+ * button callback the program registered through program_register_button(). Button
+ * callbacks never run program code: they post an event to the program's queue, and the
+ * program handles it in its own task.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "esp_err.h"
+#include "iot_button.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PROGRAM_TAG "Gabe's Program"
+
+#define MAX_PROGRAM_NAME_LEN 10
+#define MAX_PROGRAM_BUTTONS 3       // Buttons handed to a program, the last button stays with the menu
+#define MAX_PROGRAM_BUTTON_CBS 6    // Button callbacks a program may register
+#define PROGRAM_EVENT_QUEUE_LEN 8
+#define PROGRAM_DEFAULT_TASK_STACK 4096
+#define PROGRAM_TASK_PRIORITY 1
+#define PROGRAM_JOIN_TIMEOUT_MS 1000
+
+#define PROGRAM_EVENT_STOP 0xFE    // Internal, never returned by program_wait_event()
+#define PROGRAM_EVENT_TIMEOUT 0xFF // No event arrived within the timeout
+
+    typedef struct program_ctx program_ctx_t;
+
+    // Program hooks. init and stop are optional, run is required.
+    typedef struct program_ops
+    {
+        esp_err_t (*init)(program_ctx_t *ctx); // On failure, must release anything it acquired itself
+        void (*run)(program_ctx_t *ctx);
+        void (*stop)(program_ctx_t *ctx);
+        uint32_t task_stack; // 0 for PROGRAM_DEFAULT_TASK_STACK
+    } program_ops_t;
+
+    // A button callback registered on behalf of a program
+    typedef struct program_button
+    {
+        program_ctx_t *ctx;
+        button_handle_t button;
+        button_event_t event;
+        uint8_t value; // Posted to the program's event queue
+    } program_button_t;
+
+    // State shared between the menu and a running program
+    struct program_ctx
+    {
+        button_handle_t buttons[MAX_PROGRAM_BUTTONS]; // Buttons the program may register
+        QueueHandle_t events;
+        program_button_t registered[MAX_PROGRAM_BUTTON_CBS];
+        uint8_t registered_count;
+        volatile bool stop_requested;
+        void *user; // Program state, set by init
+    };
+
+    // Program task lifecycle, as seen by program_stop()
+    typedef enum program_state
+    {
+        PROGRAM_STATE_IDLE,     // No task
+        PROGRAM_STATE_INIT,     // Task created, init hook running
+        PROGRAM_STATE_RUNNING,  // run hook running, stop hook not started
+        PROGRAM_STATE_STOPPING, // stop hook running
+        PROGRAM_STATE_EXITED,   // Hooks finished, the task is deleting itself
+        PROGRAM_STATE_KILLED,   // program_stop() timed out and is deleting the task
+    } program_state_t;
+
+    // Programs
+    typedef struct program
+    {
+        TaskHandle_t handle; // NULL when not running
+        char program_name[MAX_PROGRAM_NAME_LEN];
+        const program_ops_t *ops;
+        program_ctx_t ctx;
+        SemaphoreHandle_t done; // Given by the program task as its last act
+        program_state_t state;  // Changed under lock once the task exists
+        portMUX_TYPE lock;
+    } program_t;
+
+    /**
+     * @brief Prepares a program slot. Allocates its event queue and join semaphore once,
+     * they are reused every time the program is started.
+     *
+     * @param program Program slot
+     * @param name Program name, shorter than MAX_PROGRAM_NAME_LEN
+     * @param ops Program hooks, must stay valid while the program exists
+     *
+     * @return ESP_OK on success, ESP_ERR_NO_MEM if allocation failed
+     */
+    esp_err_t program_init(program_t *program, const char *name, const program_ops_t *ops);
+
+    /**
+     * @brief Starts the program task
+     *
+     * @param program Program slot
+     * @param buttons Buttons handed to the program (MAX_PROGRAM_BUTTONS)
+     *
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if already running, ESP_ERR_NO_MEM if task creation failed
+     */
+    esp_err_t program_start(program_t *program, const button_handle_t buttons[]);
+
+    /**
+     * @brief Requests a stop and waits for the task to exit. If it has not exited within timeout the
+     * task is deleted, unless it exited in the meantime. The program's button callbacks are
+     * unregistered once the task is gone.
+     * A task deleted while running has its stop hook run here instead. One deleted inside its
+     * init or stop hook does not, as those hooks may have been partway through.
+     *
+     * @param program Program slot
+     * @param timeout Join timeout
+     *
+     * @return ESP_OK if the program exited by itself, ESP_ERR_TIMEOUT if it had to be deleted
+     */
+    esp_err_t program_stop(program_t *program, TickType_t timeout);
+
+    /**
+     * @brief Releases the program slot's queue and semaphore. The program must not be running.
+     */
+    void program_deinit(program_t *program);
+
+    /**
+     * @brief Registers a button callback that posts value to the program's event queue.
+     * Unregistered automatically when the program stops. Call from init.
+     *
+     * @param ctx Program context
+     * @param button Index into ctx->buttons
+     * @param event Button event to listen for
+     * @param value Event value posted, below PROGRAM_EVENT_STOP
+     *
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE once a stop has been requested,
+     * ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM otherwise
+     */
+    esp_err_t program_register_button(program_ctx_t *ctx, uint8_t button, button_event_t event, uint8_t value);
+
+    /**
+     * @brief Waits for the next program event
+     *
+     * @param ctx Program context
+     * @param ret_event Event value, PROGRAM_EVENT_TIMEOUT if none arrived in time
+     * @param timeout Maximum time to wait, 0 to poll
+     *
+     * @return false once a stop has been requested, run should then return
+     */
+    bool program_wait_event(program_ctx_t *ctx, uint8_t *ret_event, TickType_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
@@ -15,16 +15,12 @@ extern "C"
         // register_menu_buttons(menu, params->button_handles);
 
         // Add programs to Menu here
-        menu.add_program("LEDs", led_strip_main); // LED  Strip Program
+        menu.add_program("LEDs", &led_strip_program); // LED  Strip Program
                                                   // Add Servo Control Program
                                                   // Add Stepper Control Program
                                                   // Add FDC1004 program
 
-        while (1) // Button context switching
-        {
-            // If queue is not empty, process the button context switch
-            vTaskDelay(10);
-        }
+        menu.run(); // Button events are processed here, never returns
     }
 
 #ifdef __cplusplus
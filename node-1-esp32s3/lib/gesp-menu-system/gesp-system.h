@@ -8,6 +8,7 @@ extern "C"
 
 #include <freertos/FreeRTOS.h>
 // #include "freertos/task.h"
+#include <freertos/queue.h>
 #include "driver/gpio.h"
 #include <driver/i2c_master.h>
 // #include "gesp-ssd1306.h"
@@ -16,33 +17,36 @@ extern "C"
 #include "esp_err.h"
 #include "esp_log.h"
 
+#include "gesp-program.h"
 #include "gled_strip.h"
 
 // I2C Configuration
 #define SSD1306_I2C_PORT I2C_NUM_0
 
 #define MAX_NUM_PROGRAMS 4
-#define MAX_PROGRAM_NAME_LEN 10
 #define MAX_NUM_BUTTONS 4
+#define MENU_NO_PROGRAM 0xFF // curr_program while the menu itself is in charge
+#define MENU_EVENT_QUEUE_LEN 16 // Button presses buffered while the menu task is busy
 
 #define MENU_TAG "Gabe's Menu"
 
     // button_handle_t button_handles[4];
 
-    // Programs
-    typedef struct program
+    // Button events posted to the menu task
+    typedef enum menu_event
     {
-        TaskHandle_t handle;
-        char program_name[MAX_PROGRAM_NAME_LEN];
-        void (*program_main)(void *);
-    } program_t;
+        MENU_EVENT_CURSOR_UP,
+        MENU_EVENT_CURSOR_DOWN,
+        MENU_EVENT_SELECT,
+        MENU_EVENT_END,
+    } menu_event_t;
 
     // Menu Task Peripheral Params
     typedef struct menu_peripherals
     {
         i2c_master_bus_handle_t master_handle;
         button_handle_t button_handles[4];
-        ssd1306_t display;
+        ssd1306_t *display; // Shared with the menu, never copied
     } menu_peripherals_t;
 
     // Built for SSD1306 screens
@@ -51,13 +55,17 @@ extern "C"
     public:
         /**
          * @brief Initialises a new MenuUI instance. Loads existing tasks from flash memory. Starts SSD1306 device.
+         * The display is shared, not copied: it must outlive the menu.
          */
-        Menu(ssd1306_t display1, button_handle_t buttons[]);
+        Menu(ssd1306_t *display1, button_handle_t buttons[]);
 
         /**
          * @brief Adds a program to the menu UI.
+         *
+         * @param program_name Name shown in the menu, shorter than MAX_PROGRAM_NAME_LEN
+         * @param ops Program lifecycle hooks, must outlive the menu
          */
-        esp_err_t add_program(const char *program_name, void (*program_main)(void *));
+        esp_err_t add_program(const char *program_name, const program_ops_t *ops);
 
         /**
          * @brief Moves cursor to next program.
@@ -70,25 +78,60 @@ extern "C"
         void cursor_up();
 
         /**
-         * @brief Selects current program & calls an initialisation function.
+         * @brief Starts the program under the cursor, stopping any other running program first.
+         * Stops it instead if it is already running.
          */
         void program_select();
 
         /**
-         * @brief Selects current program & calls an end function.
+         * @brief Stops the running program and returns control to the menu.
          */
         void program_end();
 
 
         void deregister_buttons();
 
+        /**
+         * @brief Queues a button event for the menu task. Safe to call from button callbacks
+         * (esp_timer context), never blocks.
+         */
+        void post_event(menu_event_t event);
+
+        /**
+         * @brief Waits for a button event, then handles it together with any that queued up behind
+         * it and redraws the display once for the whole batch.
+         *
+         * @param timeout Longest to wait for the first event
+         *
+         * @return true if a batch was handled, false if no event arrived in time
+         */
+        bool handle_events(TickType_t timeout);
+
+        /**
+         * @brief Menu event loop. Blocks until a button event arrives and handles each batch with
+         * handle_events(). Never returns.
+         */
+        void run();
+
         /**
          * @brief Destroys MenuUI instance.
          */
         ~Menu();
 
     private:
-        ssd1306_t display;
+        /**
+         * @brief Stops the running program, reclaims its resources and gives the buttons back to the menu.
+         */
+        void stop_current_program();
+
+        /**
+         * @brief Moves the cursor by steps rows (negative is up), wrapping around the program list.
+         * Only draws into the framebuffer, the caller flushes.
+         */
+        void move_cursor(int8_t steps);
+
+        ssd1306_t *display;
+        QueueHandle_t events;
         button_handle_t buttons[4];
         uint8_t curr_program;
         uint8_t program_count;
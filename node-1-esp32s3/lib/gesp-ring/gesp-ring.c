@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "gesp-ring.h"
+
+/*
+ * Slots are a sequence word followed by the record, copied a word at a time with
+ * atomic accesses (a per-slot seqlock). The producer first stamps the slot with
+ * the new sequence number, then stores the record words with release ordering, then
+ * publishes by advancing head. A reader loads the record words with acquire ordering
+ * and checks the stamp is unchanged after the copy: if it saw any word of a newer
+ * record, it also sees the newer stamp.
+ */
+struct sample_ring
+{
+    uint32_t mask;
+    uint32_t record_size;  // Bytes
+    uint32_t record_words;
+    uint32_t slot_words;   // Sequence word + record words
+    atomic_uint head;      // Sequence number of the next record, written by the producer only
+    atomic_uint words[];
+};
+
+static uint32_t round_up_pow2(uint32_t value)
+{
+    uint32_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+static atomic_uint *slot_at(sample_ring_handle_t ring, uint32_t seq)
+{
+    return &ring->words[(size_t)(seq & ring->mask) * ring->slot_words];
+}
+
+// Copies the record with sequence number seq out of its slot, false if it has been overwritten
+static bool copy_out(sample_ring_handle_t ring, uint32_t seq, void *ret_record)
+{
+    atomic_uint *slot = slot_at(ring, seq);
+    if (atomic_load_explicit(&slot[0], memory_order_acquire) != seq)
+        return false;
+
+    uint8_t *dest = ret_record;
+    for (uint32_t i = 0; i < ring->record_words; i++)
+    {
+        uint32_t word = atomic_load_explicit(&slot[1 + i], memory_order_acquire);
+        uint32_t len = i + 1 < ring->record_words ? 4 : ring->record_size - 4 * i;
+        memcpy(dest + 4 * i, &word, len);
+    }
+    return atomic_load_explicit(&slot[0], memory_order_relaxed) == seq;
+}
+
+esp_err_t sample_ring_new(uint32_t slots, size_t record_size, sample_ring_handle_t *ret_ring)
+{
+    ESP_RETURN_ON_FALSE(slots > 0 && record_size > 0 && ret_ring != NULL, ESP_ERR_INVALID_ARG, SAMPLE_RING_TAG, "Invalid argument");
+
+    slots = round_up_pow2(slots);
+    uint32_t record_words = (record_size + 3) / 4;
+    sample_ring_handle_t ring = calloc(1, sizeof(struct sample_ring) + (size_t)slots * (1 + record_words) * sizeof(atomic_uint));
+    ESP_RETURN_ON_FALSE(ring != NULL, ESP_ERR_NO_MEM, SAMPLE_RING_TAG, "No memory for sample ring");
+
+    ring->mask = slots - 1;
+    ring->record_size = record_size;
+    ring->record_words = record_words;
+    ring->slot_words = 1 + record_words;
+    atomic_init(&ring->head, 0);
+    for (uint32_t i = 0; i < slots; i++)
+        atomic_init(slot_at(ring, i), i - slots); // A sequence number no reader asks for yet
+
+    *ret_ring = ring;
+    return ESP_OK;
+}
+
+uint32_t sample_ring_push(sample_ring_handle_t ring, const void *record)
+{
+    uint32_t seq = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_uint *slot = slot_at(ring, seq);
+
+    // Stamp first: a reader still copying the old record sees the change and drops it
+    atomic_store_explicit(&slot[0], seq, memory_order_relaxed);
+    const uint8_t *src = record;
+    for (uint32_t i = 0; i < ring->record_words; i++)
+    {
+        uint32_t word = 0;
+        memcpy(&word, src + 4 * i, i + 1 < ring->record_words ? 4 : ring->record_size - 4 * i);
+        atomic_store_explicit(&slot[1 + i], word, memory_order_release);
+    }
+    atomic_store_explicit(&ring->head, seq + 1, memory_order_release);
+    return seq;
+}
+
+uint32_t sample_ring_count(sample_ring_handle_t ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+void sample_ring_reader_init(sample_ring_reader_t *reader, sample_ring_handle_t ring)
+{
+    reader->ring = ring;
+    reader->next = sample_ring_count(ring);
+    reader->overrun = 0;
+}
+
+esp_err_t sample_ring_read(sample_ring_reader_t *reader, void *ret_record, uint32_t *ret_seq)
+{
+    ESP_RETURN_ON_FALSE(reader != NULL && reader->ring != NULL && ret_record != NULL, ESP_ERR_INVALID_ARG, SAMPLE_RING_TAG,
+                        "Invalid argument");
+    sample_ring_handle_t ring = reader->ring;
+    while (1)
+    {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == reader->next)
+            return ESP_ERR_NOT_FOUND;
+
+        uint32_t behind = head - reader->next;
+        if (behind > ring->mask + 1)
+        {
+            // Lapped: skip to the oldest record still held
+            reader->overrun += behind - (ring->mask + 1);
+            reader->next = head - (ring->mask + 1);
+        }
+
+        uint32_t seq = reader->next++;
+        if (copy_out(ring, seq, ret_record))
+        {
+            if (ret_seq != NULL)
+                *ret_seq = seq;
+            return ESP_OK;
+        }
+        reader->overrun++; // Overwritten while being read
+    }
+}
+
+esp_err_t sample_ring_read_latest(sample_ring_handle_t ring, void *ret_record, uint32_t *ret_seq)
+{
+    ESP_RETURN_ON_FALSE(ring != NULL && ret_record != NULL, ESP_ERR_INVALID_ARG, SAMPLE_RING_TAG, "Invalid argument");
+    while (1)
+    {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == 0)
+            return ESP_ERR_NOT_FOUND;
+        if (copy_out(ring, head - 1, ret_record))
+        {
+            if (ret_seq != NULL)
+                *ret_seq = head - 1;
+            return ESP_OK;
+        }
+    }
+}
+
+esp_err_t sample_ring_del(sample_ring_handle_t ring)
+{
+    ESP_RETURN_ON_FALSE(ring != NULL, ESP_ERR_INVALID_ARG, SAMPLE_RING_TAG, "Invalid argument");
+    free(ring);
+    return ESP_OK;
+}
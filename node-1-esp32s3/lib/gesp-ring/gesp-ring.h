@@ -0,0 +1,101 @@
+/**
+ * Single producer / multi consumer sample ring
+ *
+ * The acquisition task pushes fixed size records (e.g. timestamped sensor samples)
+ * without ever blocking or waiting for readers. Any number of consumers (display,
+ * logging, level calculation) read at their own pace, each through its own reader
+ * that tracks the next sequence number. A reader that falls more than a ring behind
+ * skips to the oldest record still held and counts the records it missed.
+ *
+ * Every slot carries the sequence number of its record. Readers check it before and
+ * after copying, so a record being overwritten mid-copy is detected and dropped
+ * instead of returned torn. Lock-free, no allocation after sample_ring_new().
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+#define SAMPLE_RING_TAG "SAMPLE_RING"
+
+typedef struct sample_ring *sample_ring_handle_t;
+
+/**
+ * @brief A consumer's position in a ring. One per consumer task, not shared.
+ */
+typedef struct sample_ring_reader
+{
+    sample_ring_handle_t ring;
+    uint32_t next;    // Sequence number of the next record to read
+    uint32_t overrun; // Records lost because the producer lapped this reader
+} sample_ring_reader_t;
+
+/**
+ * @brief Creates a ring
+ *
+ * @param slots Records held, rounded up to a power of two
+ * @param record_size Size of a record in bytes
+ * @param ret_ring Returned ring handle
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for zero sizes, ESP_ERR_NO_MEM if allocation failed
+ */
+esp_err_t sample_ring_new(uint32_t slots, size_t record_size, sample_ring_handle_t *ret_ring);
+
+/**
+ * @brief Publishes a record, overwriting the oldest once the ring is full. Never blocks.
+ * Only one task may push to a ring.
+ *
+ * @param ring Ring handle
+ * @param record Record to copy in, record_size bytes
+ *
+ * @return Sequence number of the record
+ */
+uint32_t sample_ring_push(sample_ring_handle_t ring, const void *record);
+
+/**
+ * @brief Number of records pushed so far, i.e. the sequence number of the next record
+ */
+uint32_t sample_ring_count(sample_ring_handle_t ring);
+
+/**
+ * @brief Attaches a reader to a ring. It reads from the next record pushed.
+ *
+ * @param reader Reader to initialise
+ * @param ring Ring handle
+ */
+void sample_ring_reader_init(sample_ring_reader_t *reader, sample_ring_handle_t ring);
+
+/**
+ * @brief Reads the reader's next record. If the producer has lapped the reader, the lost
+ * records are added to reader->overrun and the oldest record still held is read instead.
+ *
+ * @param reader Reader
+ * @param ret_record Returned record, record_size bytes
+ * @param ret_seq Returned sequence number of the record, may be NULL
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if there is no new record
+ */
+esp_err_t sample_ring_read(sample_ring_reader_t *reader, void *ret_record, uint32_t *ret_seq);
+
+/**
+ * @brief Reads the newest record, for consumers that only need the current value
+ *
+ * @param ring Ring handle
+ * @param ret_record Returned record, record_size bytes
+ * @param ret_seq Returned sequence number of the record, may be NULL
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if nothing has been pushed yet
+ */
+esp_err_t sample_ring_read_latest(sample_ring_handle_t ring, void *ret_record, uint32_t *ret_seq);
+
+/**
+ * @brief Frees the ring. No task may use it or its readers afterwards.
+ *
+ * @param ring Ring handle
+ *
+ * @return ESP_OK
+ */
+esp_err_t sample_ring_del(sample_ring_handle_t ring);
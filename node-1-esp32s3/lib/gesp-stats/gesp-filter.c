@@ -0,0 +1,114 @@
+#include <string.h>
+#include "gesp-filter.h"
+#include "esp_log.h"
+#include "esp_check.h"
+
+/* ---------------------------------------------------------------------------
+ * FIR
+ * ------------------------------------------------------------------------- */
+
+esp_err_t filter_fir_init(filter_fir_t *fir, const float *coeffs, uint16_t taps, uint16_t decimation, uint16_t channels,
+                          float *delay, size_t delay_len)
+{
+    ESP_RETURN_ON_FALSE(fir != NULL && coeffs != NULL && delay != NULL, ESP_ERR_INVALID_ARG, FILTER_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(taps >= 1 && decimation >= 1 && channels >= 1, ESP_ERR_INVALID_ARG, FILTER_TAG,
+                        "Taps, decimation and channels must be at least 1");
+    ESP_RETURN_ON_FALSE(delay_len >= FILTER_FIR_DELAY_LEN((size_t)taps, channels), ESP_ERR_INVALID_ARG, FILTER_TAG,
+                        "Delay line needs %u floats", (unsigned)FILTER_FIR_DELAY_LEN(taps, channels));
+
+    fir->coeffs = coeffs;
+    fir->taps = taps;
+    fir->channels = channels;
+    fir->stride = FILTER_STRIDE(channels);
+    fir->decimation = decimation;
+    fir->phase = decimation;
+    fir->pos = 0;
+    fir->delay = delay;
+    memset(delay, 0, FILTER_FIR_DELAY_LEN((size_t)taps, channels) * sizeof(float));
+    return ESP_OK;
+}
+
+uint32_t filter_fir_process(filter_fir_t *fir, const float *in, float *out, uint32_t frames)
+{
+    const uint32_t stride = fir->stride;
+    const uint16_t taps = fir->taps; // Same type as pos
+    const float *coeffs = fir->coeffs;
+    uint32_t outputs = 0;
+
+    for (uint32_t n = 0; n < frames; n++)
+    {
+        // Newest frame first, written to both copies of the delay line
+        fir->pos = (fir->pos == 0 ? taps : fir->pos) - 1;
+        float *newest = fir->delay + (size_t)fir->pos * stride;
+        memcpy(newest, in + (size_t)n * stride, fir->channels * sizeof(float));
+        memcpy(newest + (size_t)taps * stride, newest, fir->channels * sizeof(float));
+
+        if (--fir->phase > 0)
+            continue; // Decimated away, only the delay line is updated
+        fir->phase = fir->decimation;
+
+        // One vector of lanes at a time, the accumulator stays in registers across the taps
+        float *y = out + (size_t)outputs * stride;
+        for (uint32_t c = 0; c < stride; c += FILTER_LANES)
+        {
+            float acc[FILTER_LANES] = {0};
+            const float *x = newest + c;
+            for (uint32_t k = 0; k < taps; k++, x += stride)
+                for (uint32_t l = 0; l < FILTER_LANES; l++)
+                    acc[l] += coeffs[k] * x[l];
+            for (uint32_t l = 0; l < FILTER_LANES; l++)
+                y[c + l] = acc[l];
+        }
+        outputs++;
+    }
+    return outputs;
+}
+
+/* ---------------------------------------------------------------------------
+ * IIR
+ * ------------------------------------------------------------------------- */
+
+esp_err_t filter_iir_init(filter_iir_t *iir, const filter_biquad_t *sections, uint8_t num_sections, uint16_t channels,
+                          float *state, size_t state_len)
+{
+    ESP_RETURN_ON_FALSE(iir != NULL && sections != NULL && state != NULL, ESP_ERR_INVALID_ARG, FILTER_TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(num_sections >= 1 && channels >= 1, ESP_ERR_INVALID_ARG, FILTER_TAG, "Sections and channels must be at least 1");
+    ESP_RETURN_ON_FALSE(state_len >= FILTER_IIR_STATE_LEN((size_t)num_sections, channels), ESP_ERR_INVALID_ARG, FILTER_TAG,
+                        "State needs %u floats", (unsigned)FILTER_IIR_STATE_LEN(num_sections, channels));
+
+    iir->sections = sections;
+    iir->num_sections = num_sections;
+    iir->channels = channels;
+    iir->stride = FILTER_STRIDE(channels);
+    iir->state = state;
+    memset(state, 0, FILTER_IIR_STATE_LEN((size_t)num_sections, channels) * sizeof(float));
+    return ESP_OK;
+}
+
+void filter_iir_process(filter_iir_t *iir, const float *in, float *out, uint32_t frames)
+{
+    const uint32_t stride = iir->stride;
+
+    // Section by section over the whole block, the later sections run in place on out
+    for (uint8_t s = 0; s < iir->num_sections; s++)
+    {
+        const filter_biquad_t bq = iir->sections[s];
+        float *s1 = iir->state + (size_t)2 * s * stride;
+        float *s2 = s1 + stride;
+        const float *x = s == 0 ? in : out;
+
+        for (uint32_t n = 0; n < frames; n++)
+        {
+            const float *xn = x + (size_t)n * stride;
+            float *yn = out + (size_t)n * stride;
+            for (uint32_t c = 0; c < stride; c++)
+            {
+                float xc = xn[c];
+                float yc = bq.b0 * xc + s1[c];
+                s1[c] = bq.b1 * xc - bq.a1 * yc + s2[c];
+                s2[c] = bq.b2 * xc - bq.a2 * yc;
+                yn[c] = yc;
+            }
+        }
+    }
+}
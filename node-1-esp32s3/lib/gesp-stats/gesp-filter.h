@@ -0,0 +1,127 @@
+/**
+ * Block filters for multi-channel sample streams
+ *
+ * FIR, decimating FIR and biquad IIR filters run over blocks of frames, all channels
+ * in lock-step with the same coefficients. A frame holds one sample of every channel,
+ * padded to a multiple of FILTER_LANES:
+ *
+ *     block[frame * FILTER_STRIDE(channels) + channel]
+ *
+ * Filter state is laid out the same way, so every inner loop runs over a whole frame
+ * of contiguous floats and maps onto SIMD lanes (SSE / AVX on the host, 128 bit
+ * vectors on the ESP32-S3). Meant for FDC1004 repeat-mode and ADC streams, where a
+ * block of frames is filtered at once instead of one channel and one sample at a time.
+ *
+ * All storage is provided by the caller.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+#define FILTER_TAG "FILTER"
+
+#define FILTER_LANES 4 // Floats per vector register
+#define FILTER_STRIDE(channels) (((channels) + FILTER_LANES - 1) / FILTER_LANES * FILTER_LANES)
+
+// Floats of delay line storage for a FIR filter
+#define FILTER_FIR_DELAY_LEN(taps, channels) (2 * (taps) * FILTER_STRIDE(channels))
+
+// Floats of state storage for an IIR filter
+#define FILTER_IIR_STATE_LEN(sections, channels) (2 * (sections) * FILTER_STRIDE(channels))
+
+/**
+ * @brief FIR filter, optionally decimating
+ */
+typedef struct filter_fir
+{
+    const float *coeffs; // taps coefficients, coeffs[0] applies to the newest sample
+    uint16_t taps;
+    uint16_t channels;
+    uint16_t stride;     // Floats per frame
+    uint16_t decimation; // Keep one output frame in decimation, 1 keeps all
+    uint16_t phase;      // Input frames until the next output
+    uint16_t pos;        // Newest frame in the delay line
+    float *delay;        // taps frames, stored twice so the taps are contiguous from pos
+} filter_fir_t;
+
+/**
+ * @brief Biquad section, a0 normalised to 1: y = b0 x + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2]
+ */
+typedef struct filter_biquad
+{
+    float b0, b1, b2, a1, a2;
+} filter_biquad_t;
+
+/**
+ * @brief Cascade of biquad sections
+ */
+typedef struct filter_iir
+{
+    const filter_biquad_t *sections;
+    uint8_t num_sections;
+    uint16_t channels;
+    uint16_t stride; // Floats per frame
+    float *state;    // Two frames per section, transposed direct form II
+} filter_iir_t;
+
+/**
+ * @brief Initialises a FIR filter with an empty (zero) delay line
+ *
+ * @param fir Filter to initialise
+ * @param coeffs Coefficients, must outlive the filter
+ * @param taps Number of coefficients
+ * @param decimation Output one frame per decimation input frames, 1 for none
+ * @param channels Channels per frame
+ * @param delay Delay line storage, must outlive the filter
+ * @param delay_len Floats in delay, at least FILTER_FIR_DELAY_LEN(taps, channels)
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad configuration or too little storage
+ */
+esp_err_t filter_fir_init(filter_fir_t *fir, const float *coeffs, uint16_t taps, uint16_t decimation, uint16_t channels,
+                          float *delay, size_t delay_len);
+
+/**
+ * @brief Filters a block of frames
+ *
+ * Padding lanes of the output are zero. out may be the same block as in.
+ *
+ * @param fir Filter
+ * @param in Input frames
+ * @param out Output frames, room for frames / decimation + 1 frames
+ * @param frames Number of input frames
+ *
+ * @return Number of output frames written
+ */
+uint32_t filter_fir_process(filter_fir_t *fir, const float *in, float *out, uint32_t frames);
+
+/**
+ * @brief Initialises a biquad cascade with zero state
+ *
+ * @param iir Filter to initialise
+ * @param sections Sections, applied in order, must outlive the filter
+ * @param num_sections Number of sections
+ * @param channels Channels per frame
+ * @param state State storage, must outlive the filter
+ * @param state_len Floats in state, at least FILTER_IIR_STATE_LEN(num_sections, channels)
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad configuration or too little storage
+ */
+esp_err_t filter_iir_init(filter_iir_t *iir, const filter_biquad_t *sections, uint8_t num_sections, uint16_t channels,
+                          float *state, size_t state_len);
+
+/**
+ * @brief Filters a block of frames
+ *
+ * Padding lanes are filtered like the others, keep them zero in the input. out may be
+ * the same block as in.
+ *
+ * @param iir Filter
+ * @param in Input frames
+ * @param out Output frames
+ * @param frames Number of frames
+ */
+void filter_iir_process(filter_iir_t *iir, const float *in, float *out, uint32_t frames);
@@ -0,0 +1,209 @@
+#include "gesp-stats.h"
+#include "esp_log.h"
+#include "esp_check.h"
+
+#define IS_POWER_OF_TWO(x) ((x) != 0 && ((x) & ((x) - 1)) == 0)
+
+/* ---------------------------------------------------------------------------
+ * Window
+ * ------------------------------------------------------------------------- */
+
+esp_err_t stats_window_init(stats_window_t *window, int32_t *storage, uint32_t capacity, uint32_t size)
+{
+    ESP_RETURN_ON_FALSE(window != NULL && storage != NULL && IS_POWER_OF_TWO(capacity), ESP_ERR_INVALID_ARG, STATS_TAG,
+                        "Storage capacity must be a power of two");
+    ESP_RETURN_ON_FALSE(size >= 1 && size <= capacity, ESP_ERR_INVALID_ARG, STATS_TAG, "Window size %lu out of range", (unsigned long)size);
+
+    window->samples = storage;
+    window->mask = capacity - 1;
+    window->window = size;
+    window->head = 0;
+    window->count = 0;
+    window->sum = 0;
+    return ESP_OK;
+}
+
+esp_err_t stats_window_resize(stats_window_t *window, uint32_t size)
+{
+    ESP_RETURN_ON_FALSE(size >= 1 && size <= window->mask + 1, ESP_ERR_INVALID_ARG, STATS_TAG, "Window size %lu out of range",
+                        (unsigned long)size);
+
+    // Storage keeps the last capacity samples, so growing only widens the window as new samples arrive
+    for (; window->count > size; window->count--)
+        window->sum -= window->samples[(window->head - window->count) & window->mask];
+    window->window = size;
+    return ESP_OK;
+}
+
+void stats_window_push(stats_window_t *window, int32_t sample)
+{
+    if (window->count == window->window)
+        window->sum -= window->samples[(window->head - window->window) & window->mask];
+    else
+        window->count++;
+    window->samples[window->head & window->mask] = sample;
+    window->sum += sample;
+    window->head++;
+}
+
+int32_t stats_window_mean(const stats_window_t *window)
+{
+    if (window->count == 0)
+        return 0;
+    int64_t half = window->count / 2;
+    int64_t sum = window->sum >= 0 ? window->sum + half : window->sum - half;
+    return (int32_t)(sum / window->count);
+}
+
+/* ---------------------------------------------------------------------------
+ * Welford
+ * ------------------------------------------------------------------------- */
+
+void stats_welford_reset(stats_welford_t *welford)
+{
+    welford->n = 0;
+    welford->mean = 0;
+    welford->m2 = 0;
+}
+
+void stats_welford_push(stats_welford_t *welford, int32_t sample)
+{
+    welford->n++;
+    double delta = sample - welford->mean;
+    welford->mean += delta / welford->n;
+    welford->m2 += delta * (sample - welford->mean);
+}
+
+double stats_welford_variance(const stats_welford_t *welford)
+{
+    return welford->n < 2 ? 0 : welford->m2 / (welford->n - 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * Exponential moving average
+ * ------------------------------------------------------------------------- */
+
+void stats_ema_init(stats_ema_t *ema, uint32_t alpha_q16)
+{
+    ema->value_q16 = 0;
+    ema->alpha_q16 = alpha_q16 == 0 || alpha_q16 > 65536 ? 65536 : alpha_q16;
+    ema->primed = false;
+}
+
+int32_t stats_ema_push(stats_ema_t *ema, int32_t sample)
+{
+    int64_t sample_q16 = (int64_t)sample * 65536;
+    if (!ema->primed)
+    {
+        ema->value_q16 = sample_q16;
+        ema->primed = true;
+    }
+    else
+    {
+        // diff * alpha / 2^16, split so the product fits 64 bits over the whole int32_t range
+        int64_t diff = sample_q16 - ema->value_q16;
+        ema->value_q16 += (diff / 65536) * ema->alpha_q16 + ((diff % 65536) * ema->alpha_q16) / 65536;
+    }
+    return (int32_t)((ema->value_q16 + (ema->value_q16 >= 0 ? 32768 : -32768)) / 65536);
+}
+
+/* ---------------------------------------------------------------------------
+ * Median
+ * ------------------------------------------------------------------------- */
+
+esp_err_t stats_median_init(stats_median_t *median, uint8_t n)
+{
+    ESP_RETURN_ON_FALSE(n % 2 == 1 && n <= STATS_MEDIAN_MAX, ESP_ERR_INVALID_ARG, STATS_TAG, "Median length %u must be odd and at most %d",
+                        n, STATS_MEDIAN_MAX);
+    median->n = n;
+    median->next = 0;
+    median->count = 0;
+    return ESP_OK;
+}
+
+int32_t stats_median_push(stats_median_t *median, int32_t sample)
+{
+    if (median->n == 1)
+        return sample;
+
+    median->history[median->next] = sample;
+    median->next = median->next + 1 == median->n ? 0 : median->next + 1;
+    if (median->count < median->n)
+        median->count++;
+
+    // Insertion sort of at most STATS_MEDIAN_MAX values
+    int32_t sorted[STATS_MEDIAN_MAX];
+    for (uint8_t i = 0; i < median->count; i++)
+    {
+        int32_t value = median->history[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = value;
+    }
+    return sorted[median->count / 2];
+}
+
+/* ---------------------------------------------------------------------------
+ * Log2 histogram
+ * ------------------------------------------------------------------------- */
+
+uint8_t stats_log2_bucket(int64_t value, uint8_t buckets)
+{
+    uint8_t bucket = 0;
+    while (value > 1 && bucket < buckets - 1)
+    {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+int64_t stats_log2_percentile(const uint32_t *histogram, uint8_t buckets, int64_t max, uint8_t percentile)
+{
+    uint64_t total = 0;
+    for (uint8_t i = 0; i < buckets; i++)
+        total += histogram[i];
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (total * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < buckets; i++)
+    {
+        seen += histogram[i];
+        if (seen >= rank)
+        {
+            int64_t bound = (int64_t)1 << (i + 1);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+/* ---------------------------------------------------------------------------
+ * Filter chain
+ * ------------------------------------------------------------------------- */
+
+esp_err_t stats_channel_init(stats_channel_t *channel, const stats_config_t *config, int32_t *storage, uint32_t capacity)
+{
+    ESP_RETURN_ON_FALSE(channel != NULL && config != NULL, ESP_ERR_INVALID_ARG, STATS_TAG, "Invalid argument");
+    ESP_RETURN_ON_ERROR(stats_median_init(&channel->median, config->median_n), STATS_TAG, "Median init failed");
+    ESP_RETURN_ON_ERROR(stats_window_init(&channel->window, storage, capacity, config->window), STATS_TAG, "Window init failed");
+    stats_ema_init(&channel->ema, config->ema_alpha_q16);
+    stats_welford_reset(&channel->welford);
+    channel->use_ema = config->ema_alpha_q16 != 0;
+    channel->use_welford = config->welford;
+    return ESP_OK;
+}
+
+int32_t stats_channel_push(stats_channel_t *channel, int32_t sample)
+{
+    int32_t filtered = stats_median_push(&channel->median, sample);
+    stats_window_push(&channel->window, filtered);
+    if (channel->use_ema)
+        stats_ema_push(&channel->ema, filtered);
+    if (channel->use_welford)
+        stats_welford_push(&channel->welford, filtered);
+    return stats_window_mean(&channel->window);
+}
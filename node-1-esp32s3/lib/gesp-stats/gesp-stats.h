@@ -0,0 +1,200 @@
+/**
+ * Streaming statistics for sensor samples
+ *
+ * Every update is O(1) and allocation free:
+ *  - windowed mean from a running sum over caller provided storage, with the
+ *    window size set at runtime (storage capacity is a power of two)
+ *  - Welford mean / variance since the last reset
+ *  - exponential moving average with a Q16 smoothing factor
+ *  - median of the last N samples, to reject single sample spikes
+ *  - log2 histograms of latencies and jitter, with percentile estimates
+ *
+ * A filter chain always runs the median and window. The EMA and Welford statistics
+ * are opt-in per channel, Welford being a double precision divide per sample.
+ *
+ * Samples are int32_t, e.g. the FDC1004 driver's attofarads. The window sum is an
+ * int64_t and never drifts, whatever the number of samples.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#define STATS_TAG "STATS"
+
+#define STATS_MEDIAN_MAX 7 // Longest median filter, must be odd
+
+#define STATS_EMA_ALPHA_Q16(alpha) ((uint32_t)((alpha) * 65536)) // Smoothing factor 0 < alpha <= 1 as Q16
+
+/**
+ * @brief Windowed running sum over caller provided storage
+ */
+typedef struct stats_window
+{
+    int32_t *samples; // Caller storage, capacity is a power of two
+    uint32_t mask;    // Capacity - 1
+    uint32_t window;  // Samples averaged, 1 - capacity
+    uint32_t head;    // Free running write index
+    uint32_t count;   // Samples held, up to window
+    int64_t sum;      // Sum of the samples held
+} stats_window_t;
+
+/**
+ * @brief Welford running mean and variance
+ */
+typedef struct stats_welford
+{
+    uint64_t n;
+    double mean;
+    double m2; // Sum of squared differences from the mean
+} stats_welford_t;
+
+/**
+ * @brief Exponential moving average
+ */
+typedef struct stats_ema
+{
+    int64_t value_q16;
+    uint32_t alpha_q16;
+    bool primed; // The first sample seeds the average
+} stats_ema_t;
+
+/**
+ * @brief Median of the last n samples
+ */
+typedef struct stats_median
+{
+    int32_t history[STATS_MEDIAN_MAX];
+    uint8_t n; // Odd, 1 - STATS_MEDIAN_MAX. 1 passes samples through.
+    uint8_t next;
+    uint8_t count;
+} stats_median_t;
+
+/**
+ * @brief One channel's filter chain: median spike filter, then window, EMA and Welford in parallel
+ */
+typedef struct stats_channel
+{
+    stats_median_t median;
+    stats_window_t window;
+    stats_ema_t ema;         // Only updated when use_ema is set
+    stats_welford_t welford; // Only updated when use_welford is set
+    bool use_ema;
+    bool use_welford;
+} stats_channel_t;
+
+/**
+ * @brief Filter chain configuration
+ */
+typedef struct stats_config
+{
+    uint8_t median_n;   // Median filter length, odd, 1 to disable
+    uint32_t window;    // Window size, at most the storage capacity
+    uint32_t ema_alpha_q16; // See STATS_EMA_ALPHA_Q16(), 0 to disable the EMA
+    bool welford;           // Keep Welford mean and variance
+} stats_config_t;
+
+/**
+ * @brief Initialises a window
+ *
+ * @param window Window to initialise
+ * @param storage Sample storage, must outlive the window
+ * @param capacity Number of samples in storage, a power of two
+ * @param size Window size, 1 - capacity
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if capacity is not a power of two or size is out of range
+ */
+esp_err_t stats_window_init(stats_window_t *window, int32_t *storage, uint32_t capacity, uint32_t size);
+
+/**
+ * @brief Changes the window size. Keeps the most recent samples that fit.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if size is out of range
+ */
+esp_err_t stats_window_resize(stats_window_t *window, uint32_t size);
+
+/**
+ * @brief Adds a sample, dropping the oldest once the window is full
+ */
+void stats_window_push(stats_window_t *window, int32_t sample);
+
+/**
+ * @brief Mean of the samples in the window, rounded to nearest. 0 when empty.
+ */
+int32_t stats_window_mean(const stats_window_t *window);
+
+void stats_welford_reset(stats_welford_t *welford);
+
+void stats_welford_push(stats_welford_t *welford, int32_t sample);
+
+/**
+ * @brief Sample variance since the last reset, 0 for fewer than two samples
+ */
+double stats_welford_variance(const stats_welford_t *welford);
+
+void stats_ema_init(stats_ema_t *ema, uint32_t alpha_q16);
+
+/**
+ * @brief Adds a sample
+ *
+ * @return The updated average, rounded to nearest
+ */
+int32_t stats_ema_push(stats_ema_t *ema, int32_t sample);
+
+/**
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if n is even or longer than STATS_MEDIAN_MAX
+ */
+esp_err_t stats_median_init(stats_median_t *median, uint8_t n);
+
+/**
+ * @brief Adds a sample
+ *
+ * @return Median of the last n samples, or of those seen so far while filling
+ */
+int32_t stats_median_push(stats_median_t *median, int32_t sample);
+
+/**
+ * @brief Log2 histogram bucket of a value. Bucket 0 holds 0 and 1, bucket n holds [2^n, 2^(n+1)),
+ * the last bucket everything above.
+ *
+ * @param value Value to place, negative values go to bucket 0
+ * @param buckets Number of buckets in the histogram
+ *
+ * @return Bucket index
+ */
+uint8_t stats_log2_bucket(int64_t value, uint8_t buckets);
+
+/**
+ * @brief Estimates a percentile from a log2 histogram, see stats_log2_bucket()
+ *
+ * @param histogram Bucket counts
+ * @param buckets Number of buckets in the histogram
+ * @param max Largest value counted
+ * @param percentile Percentile to estimate (0 - 100)
+ *
+ * @return Upper bound of the bucket holding the percentile, at most max. 0 for an empty histogram.
+ */
+int64_t stats_log2_percentile(const uint32_t *histogram, uint8_t buckets, int64_t max, uint8_t percentile);
+
+/**
+ * @brief Initialises a filter chain
+ *
+ * @param channel Chain to initialise
+ * @param config Filter configuration
+ * @param storage Window storage, must outlive the chain
+ * @param capacity Number of samples in storage, a power of two
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad configuration
+ */
+esp_err_t stats_channel_init(stats_channel_t *channel, const stats_config_t *config, int32_t *storage, uint32_t capacity);
+
+/**
+ * @brief Runs a sample through the median filter and adds the result to the window, and to the EMA and
+ * Welford statistics when enabled
+ *
+ * @return The windowed mean
+ */
+int32_t stats_channel_push(stats_channel_t *channel, int32_t sample);
@@ -0,0 +1,361 @@
+#include <stdlib.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "gled_effect.h"
+
+struct gled_anim
+{
+    const gled_keyframe_t *keyframes;
+    uint8_t num_keyframes;
+    uint16_t num_leds;
+    uint32_t loop_ms;    // Sum of the keyframe durations
+    uint16_t gamma[256]; // Gamma curve in 8.8, kept so dim brightness levels do not collapse to the same few values
+    uint8_t lut[256];    // Gamma and brightness
+    uint8_t frame[];     // num_leds GRB pixels
+};
+
+struct gled_frame_clock
+{
+    uint32_t period_us;
+    esp_timer_handle_t timer;
+    esp_timer_handle_t fence; // Fired once by gled_frame_clock_stop(), behind any frame callback still running
+    atomic_bool fenced;
+    TaskHandle_t task;
+    atomic_uint released; // Index of the latest frame released, written by the timer only
+    uint32_t shown;       // Index of the latest frame returned
+    uint32_t dropped;
+};
+
+/* ---------------------------------------------------------------------------
+ * Rendering
+ * ------------------------------------------------------------------------- */
+
+// Exact at both ends: weight 0 gives a, GLED_FIXED_ONE gives b
+static inline uint8_t blend(uint8_t a, uint8_t b, uint32_t weight)
+{
+    return (a * (GLED_FIXED_ONE - weight) + b * weight) >> 8;
+}
+
+static inline void put_pixel(gled_anim_handle_t anim, uint32_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t *pixel = &anim->frame[index * 3];
+    pixel[0] = anim->lut[g];
+    pixel[1] = anim->lut[r];
+    pixel[2] = anim->lut[b];
+}
+
+static inline void put_blend(gled_anim_handle_t anim, uint32_t index, gled_rgb_t a, gled_rgb_t b, uint32_t weight)
+{
+    put_pixel(anim, index, blend(a.r, b.r, weight), blend(a.g, b.g, weight), blend(a.b, b.b, weight));
+}
+
+// One colour for the whole strip, corrected once
+static void render_solid(gled_anim_handle_t anim, gled_rgb_t a, gled_rgb_t b, uint32_t weight)
+{
+    put_blend(anim, 0, a, b, weight);
+    for (uint32_t i = 1; i < anim->num_leds; i++)
+    {
+        anim->frame[i * 3] = anim->frame[0];
+        anim->frame[i * 3 + 1] = anim->frame[1];
+        anim->frame[i * 3 + 2] = anim->frame[2];
+    }
+}
+
+static void render_fade(gled_anim_handle_t anim, const gled_keyframe_t *key, uint32_t time_ms)
+{
+    uint32_t weight = time_ms >= key->period_ms ? GLED_FIXED_ONE : (uint64_t)time_ms * GLED_FIXED_ONE / key->period_ms;
+    render_solid(anim, key->colour_a, key->colour_b, weight);
+}
+
+static void render_breathing(gled_anim_handle_t anim, const gled_keyframe_t *key, uint32_t time_ms)
+{
+    uint32_t weight = GLED_FIXED_ONE;
+    if (key->period_ms)
+    {
+        // Triangle wave, gamma correction rounds it into a breath
+        uint32_t phase = (uint64_t)(time_ms % key->period_ms) * 2 * GLED_FIXED_ONE / key->period_ms;
+        weight = phase <= GLED_FIXED_ONE ? phase : 2 * GLED_FIXED_ONE - phase;
+    }
+    render_solid(anim, key->colour_b, key->colour_a, weight);
+}
+
+static void render_chase(gled_anim_handle_t anim, const gled_keyframe_t *key, uint32_t time_ms)
+{
+    // Positions in 8.8 pixels, the chase edges are blended by how much of each pixel they cover
+    const uint32_t strip = (uint32_t)anim->num_leds << 8;
+    const uint32_t width = (uint32_t)key->width << 8;
+    const gled_rgb_t on = key->colour_a, off = key->colour_b; // Locals, frame writes may alias the keyframe
+    uint32_t head = key->period_ms ? (uint64_t)(time_ms % key->period_ms) * strip / key->period_ms : 0;
+
+    // Distance of each pixel's start from the chase start, walking the strip once
+    uint32_t offset = strip - head;
+    for (uint32_t i = 0; i < anim->num_leds; i++, offset += GLED_FIXED_ONE)
+    {
+        if (offset >= strip)
+            offset -= strip;
+        // The pixel spans [offset, offset + 1), the chase [0, width) and, wrapped, [strip, strip + width)
+        uint32_t end = offset + GLED_FIXED_ONE;
+        uint32_t cover = 0;
+        if (offset < width)
+            cover += (end < width ? end : width) - offset;
+        if (end > strip)
+            cover += (end - strip < width ? end - strip : width);
+        put_blend(anim, i, off, on, cover);
+    }
+}
+
+static void render_rainbow(gled_anim_handle_t anim, const gled_keyframe_t *key, uint32_t time_ms)
+{
+    // Hue in 1/65536 of the wheel, stepped in fixed point rather than divided per pixel
+    uint32_t hue = key->period_ms ? (uint64_t)(time_ms % key->period_ms) * 65536 / key->period_ms : 0;
+    const uint32_t step = 65536 / anim->num_leds;
+    for (uint32_t i = 0; i < anim->num_leds; i++, hue += step)
+    {
+        uint32_t sector = ((hue & 0xFFFF) * 6) >> 8; // 8.8: sector in the high byte, position within it in the low
+        uint8_t rise = sector & 0xFF;
+        uint8_t fall = 255 - rise;
+        switch (sector >> 8)
+        {
+        case 0:
+            put_pixel(anim, i, 255, rise, 0);
+            break;
+        case 1:
+            put_pixel(anim, i, fall, 255, 0);
+            break;
+        case 2:
+            put_pixel(anim, i, 0, 255, rise);
+            break;
+        case 3:
+            put_pixel(anim, i, 0, fall, 255);
+            break;
+        case 4:
+            put_pixel(anim, i, rise, 0, 255);
+            break;
+        default:
+            put_pixel(anim, i, 255, 0, fall);
+        }
+    }
+}
+
+static void render_gradient(gled_anim_handle_t anim, const gled_keyframe_t *key, uint32_t time_ms)
+{
+    (void)time_ms; // Gradients stand still
+    if (anim->num_leds == 1)
+    {
+        put_blend(anim, 0, key->colour_a, key->colour_b, 0);
+        return;
+    }
+    // Weight in 8.16, the step rounded up so the last pixel reaches colour_b exactly
+    const uint32_t step = ((GLED_FIXED_ONE << 8) + anim->num_leds - 2) / (anim->num_leds - 1);
+    const gled_rgb_t first = key->colour_a, last = key->colour_b;
+    uint32_t weight = 0;
+    for (uint32_t i = 0; i < anim->num_leds; i++, weight += step)
+    {
+        uint32_t w = weight >> 8;
+        put_blend(anim, i, first, last, w < GLED_FIXED_ONE ? w : GLED_FIXED_ONE);
+    }
+}
+
+typedef void (*render_fn_t)(gled_anim_handle_t anim, const gled_keyframe_t *key, uint32_t time_ms);
+
+static const render_fn_t renderers[GLED_EFFECT_MAX] = {
+    [GLED_EFFECT_FADE] = render_fade,
+    [GLED_EFFECT_CHASE] = render_chase,
+    [GLED_EFFECT_RAINBOW] = render_rainbow,
+    [GLED_EFFECT_BREATHING] = render_breathing,
+    [GLED_EFFECT_GRADIENT] = render_gradient,
+};
+
+/* ---------------------------------------------------------------------------
+ * Animation
+ * ------------------------------------------------------------------------- */
+
+esp_err_t gled_anim_new(const gled_anim_config_t *config, gled_anim_handle_t *ret_anim)
+{
+    ESP_RETURN_ON_FALSE(config != NULL && config->keyframes != NULL && ret_anim != NULL, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG,
+                        "Invalid argument");
+    ESP_RETURN_ON_FALSE(config->num_keyframes > 0 && config->num_leds > 0, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG,
+                        "Keyframes and LEDs must be at least 1");
+
+    uint32_t loop_ms = 0;
+    for (uint8_t k = 0; k < config->num_keyframes; k++)
+    {
+        const gled_keyframe_t *key = &config->keyframes[k];
+        ESP_RETURN_ON_FALSE(key->effect < GLED_EFFECT_MAX && key->duration_ms > 0, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG,
+                            "Keyframe %u: bad effect or zero duration", k);
+        ESP_RETURN_ON_FALSE(key->effect != GLED_EFFECT_CHASE || key->width <= config->num_leds, ESP_ERR_INVALID_ARG,
+                            GLED_EFFECT_TAG, "Keyframe %u: chase longer than the strip", k);
+        ESP_RETURN_ON_FALSE(loop_ms + key->duration_ms > loop_ms, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG, "Animation too long");
+        loop_ms += key->duration_ms;
+    }
+
+    gled_anim_handle_t anim = calloc(1, sizeof(struct gled_anim) + (size_t)config->num_leds * 3);
+    ESP_RETURN_ON_FALSE(anim != NULL, ESP_ERR_NO_MEM, GLED_EFFECT_TAG, "No memory for animation");
+    anim->keyframes = config->keyframes;
+    anim->num_keyframes = config->num_keyframes;
+    anim->num_leds = config->num_leds;
+    anim->loop_ms = loop_ms;
+
+    // The only floating point, once per animation
+    float gamma = config->gamma > 0 ? config->gamma : GLED_DEFAULT_GAMMA;
+    for (uint32_t i = 0; i < 256; i++)
+        anim->gamma[i] = (uint16_t)lroundf(powf(i / 255.0f, gamma) * 255.0f * GLED_FIXED_ONE);
+    gled_anim_set_brightness(anim, config->brightness);
+
+    *ret_anim = anim;
+    return ESP_OK;
+}
+
+esp_err_t gled_anim_set_brightness(gled_anim_handle_t anim, uint8_t brightness)
+{
+    ESP_RETURN_ON_FALSE(anim != NULL, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG, "Invalid argument");
+    const uint32_t full = 255 * GLED_FIXED_ONE;
+    for (uint32_t i = 0; i < 256; i++)
+        anim->lut[i] = (anim->gamma[i] * brightness + full / 2) / full;
+    return ESP_OK;
+}
+
+const uint8_t *gled_anim_render(gled_anim_handle_t anim, uint32_t time_ms)
+{
+    uint32_t key_ms = time_ms % anim->loop_ms;
+    const gled_keyframe_t *key = anim->keyframes;
+    while (key_ms >= key->duration_ms)
+    {
+        key_ms -= key->duration_ms;
+        key++;
+    }
+    renderers[key->effect](anim, key, key_ms);
+    return anim->frame;
+}
+
+esp_err_t gled_anim_show(gled_anim_handle_t anim, led_strip_handle_t strip, uint32_t time_ms)
+{
+    ESP_RETURN_ON_FALSE(anim != NULL && strip != NULL, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG, "Invalid argument");
+    const uint8_t *frame = gled_anim_render(anim, time_ms);
+    ESP_RETURN_ON_ERROR(led_strip_set_pixels(strip, 0, anim->num_leds, frame, LED_PIXEL_ORDER_GRB), GLED_EFFECT_TAG,
+                        "Failed to set pixels");
+    return led_strip_refresh_async(strip);
+}
+
+esp_err_t gled_anim_del(gled_anim_handle_t anim)
+{
+    ESP_RETURN_ON_FALSE(anim != NULL, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG, "Invalid argument");
+    free(anim);
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------------------
+ * Frame clock
+ * ------------------------------------------------------------------------- */
+
+// Runs in the esp_timer task: releases the next frame
+static void gled_frame_clock_cb(void *arg)
+{
+    gled_frame_clock_handle_t clock = (gled_frame_clock_handle_t)arg;
+    atomic_fetch_add_explicit(&clock->released, 1, memory_order_release);
+    xTaskNotifyGive(clock->task);
+}
+
+// The esp_timer task runs one callback at a time, so by now no frame callback is using the clock
+static void gled_frame_clock_fence_cb(void *arg)
+{
+    gled_frame_clock_handle_t clock = (gled_frame_clock_handle_t)arg;
+    atomic_store_explicit(&clock->fenced, true, memory_order_release); // Last touch of the clock
+}
+
+esp_err_t gled_frame_clock_start(uint32_t fps, gled_frame_clock_handle_t *ret_clock)
+{
+    ESP_RETURN_ON_FALSE(fps > 0 && fps <= GLED_MAX_FPS && ret_clock != NULL, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG,
+                        "Invalid argument");
+
+    gled_frame_clock_handle_t clock = calloc(1, sizeof(struct gled_frame_clock));
+    ESP_RETURN_ON_FALSE(clock != NULL, ESP_ERR_NO_MEM, GLED_EFFECT_TAG, "No memory for frame clock");
+    clock->period_us = 1000000 / fps;
+    clock->task = xTaskGetCurrentTaskHandle();
+    atomic_init(&clock->released, 0);
+    atomic_init(&clock->fenced, false);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = gled_frame_clock_cb,
+        .arg = clock,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "gled_frame",
+        .skip_unhandled_events = false,
+    };
+    esp_err_t esp_rc = esp_timer_create(&timer_args, &clock->timer);
+    if (esp_rc != ESP_OK)
+    {
+        free(clock);
+        return esp_rc;
+    }
+    timer_args.callback = gled_frame_clock_fence_cb;
+    timer_args.name = "gled_frame_fence";
+    esp_rc = esp_timer_create(&timer_args, &clock->fence);
+    if (esp_rc != ESP_OK)
+    {
+        esp_timer_delete(clock->timer);
+        free(clock);
+        return esp_rc;
+    }
+
+    // The periodic timer reloads from its previous alarm, so frames do not drift
+    esp_rc = esp_timer_start_periodic(clock->timer, clock->period_us);
+    if (esp_rc != ESP_OK)
+    {
+        esp_timer_delete(clock->fence);
+        esp_timer_delete(clock->timer);
+        free(clock);
+        return esp_rc;
+    }
+
+    *ret_clock = clock;
+    return ESP_OK;
+}
+
+esp_err_t gled_frame_clock_wait(gled_frame_clock_handle_t clock, TickType_t timeout, uint32_t *ret_time_ms)
+{
+    ESP_RETURN_ON_FALSE(clock != NULL && ret_time_ms != NULL, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG, "Invalid argument");
+    // A wake up can be for a frame already returned, when the previous wait read it before its notification
+    uint32_t frame;
+    do
+    {
+        if (ulTaskNotifyTake(pdTRUE, timeout) == 0)
+            return ESP_ERR_TIMEOUT;
+        frame = atomic_load_explicit(&clock->released, memory_order_acquire);
+    } while (frame == clock->shown);
+
+    // Frames released while the caller was busy are skipped, this one serves the latest
+    clock->dropped += frame - clock->shown - 1;
+    clock->shown = frame;
+    *ret_time_ms = (uint64_t)frame * clock->period_us / 1000;
+    return ESP_OK;
+}
+
+uint32_t gled_frame_clock_dropped(gled_frame_clock_handle_t clock)
+{
+    return clock->dropped;
+}
+
+esp_err_t gled_frame_clock_stop(gled_frame_clock_handle_t clock)
+{
+    ESP_RETURN_ON_FALSE(clock != NULL, ESP_ERR_INVALID_ARG, GLED_EFFECT_TAG, "Invalid argument");
+    esp_timer_stop(clock->timer);
+
+    // A frame callback may already be running: wait for the fence queued behind it before freeing
+    esp_err_t esp_rc = esp_timer_start_once(clock->fence, 0);
+    if (esp_rc != ESP_OK)
+        return esp_rc;
+    while (!atomic_load_explicit(&clock->fenced, memory_order_acquire))
+        vTaskDelay(1);
+
+    esp_timer_delete(clock->fence);
+    esp_timer_delete(clock->timer);
+    if (xTaskGetCurrentTaskHandle() == clock->task)
+        ulTaskNotifyTake(pdTRUE, 0); // A frame released before the stop must not wake a later wait of the task
+    free(clock);
+    return ESP_OK;
+}
@@ -0,0 +1,162 @@
+/**
+ * Keyframed LED strip animations
+ *
+ * An animation is a loop of keyframes, each running one effect (fade, chase, rainbow,
+ * breathing, gradient) for its duration. Frames are rendered for an absolute time, so
+ * the same time always gives the same frame whatever the frame rate.
+ *
+ * Colour maths is integer only: blend weights and sub-pixel positions are 8.8 fixed
+ * point (GLED_FIXED_ONE is 1.0). Gamma correction and global brightness are one 256 entry
+ * table, applied as each pixel is written, and the frame is kept in GRB order so
+ * led_strip_set_pixels() copies it straight into a GRB strip.
+ *
+ * The frame clock releases frames at start + k * period from a periodic esp_timer, so
+ * render and refresh time do not accumulate into the frame period. Ticks (10 ms) are too
+ * coarse for vTaskDelayUntil at animation rates.
+ *
+ * @author Gabriel Thien (https://github.com/losgab)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <led_strip.h>
+#include "freertos/FreeRTOS.h"
+
+#define GLED_EFFECT_TAG "GLED Effect"
+
+#define GLED_FIXED_ONE 256       // 1.0 in 8.8 fixed point
+#define GLED_DEFAULT_GAMMA 2.2f  // Used when the configured gamma is 0
+#define GLED_MAX_FPS 1000
+
+typedef struct gled_rgb
+{
+    uint8_t r, g, b;
+} gled_rgb_t;
+
+typedef enum gled_effect
+{
+    GLED_EFFECT_FADE,      // colour_a to colour_b over period_ms, then holds colour_b
+    GLED_EFFECT_CHASE,     // width pixels of colour_a over colour_b, one lap of the strip per period_ms
+    GLED_EFFECT_RAINBOW,   // One hue wheel along the strip, scrolled a wheel per period_ms. Colours unused
+    GLED_EFFECT_BREATHING, // colour_b to colour_a and back every period_ms
+    GLED_EFFECT_GRADIENT,  // colour_a at the first pixel to colour_b at the last. Period unused
+    GLED_EFFECT_MAX,
+} gled_effect_t;
+
+/**
+ * @brief One step of an animation
+ */
+typedef struct gled_keyframe
+{
+    gled_effect_t effect;
+    gled_rgb_t colour_a;
+    gled_rgb_t colour_b;
+    uint32_t duration_ms; // Time on this keyframe, at least 1
+    uint32_t period_ms;   // Effect cycle, 0 for the end state (fade, breathing) or standing still (chase, rainbow)
+    uint16_t width;       // Chase length in pixels, at most the strip length
+} gled_keyframe_t;
+
+/**
+ * @brief Animation configuration
+ */
+typedef struct gled_anim_config
+{
+    const gled_keyframe_t *keyframes; // Must stay valid while the animation exists
+    uint8_t num_keyframes;
+    uint16_t num_leds;
+    float gamma;        // Gamma exponent, 1.0 for none, 0 for GLED_DEFAULT_GAMMA
+    uint8_t brightness; // Global brightness, 255 for full
+} gled_anim_config_t;
+
+typedef struct gled_anim *gled_anim_handle_t;
+typedef struct gled_frame_clock *gled_frame_clock_handle_t;
+
+/**
+ * @brief Creates an animation and its frame buffer
+ *
+ * @param config Animation configuration
+ * @param ret_anim Returned animation handle
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad keyframe or argument, ESP_ERR_NO_MEM if allocation failed
+ */
+esp_err_t gled_anim_new(const gled_anim_config_t *config, gled_anim_handle_t *ret_anim);
+
+/**
+ * @brief Sets the global brightness. Rebuilds the colour table from the stored gamma curve, no floating point.
+ *
+ * @param anim Animation handle
+ * @param brightness Global brightness, 255 for full
+ *
+ * @return ESP_OK
+ */
+esp_err_t gled_anim_set_brightness(gled_anim_handle_t anim, uint8_t brightness);
+
+/**
+ * @brief Renders the frame at a time into the animation's frame buffer. Keyframes loop.
+ *
+ * @param anim Animation handle
+ * @param time_ms Animation time
+ *
+ * @return Frame, num_leds pixels in GRB order, gamma corrected and scaled. Valid until the next render.
+ */
+const uint8_t *gled_anim_render(gled_anim_handle_t anim, uint32_t time_ms);
+
+/**
+ * @brief Renders the frame at a time and refreshes the strip with it. Does not wait for the frame
+ * to be sent on strips that refresh asynchronously, see led_strip_refresh_async().
+ *
+ * @param anim Animation handle
+ * @param strip LED strip handle, at least num_leds long
+ * @param time_ms Animation time
+ *
+ * @return ESP_OK on success, otherwise the strip's error
+ */
+esp_err_t gled_anim_show(gled_anim_handle_t anim, led_strip_handle_t strip, uint32_t time_ms);
+
+/**
+ * @brief Frees the animation
+ *
+ * @param anim Animation handle
+ *
+ * @return ESP_OK
+ */
+esp_err_t gled_anim_del(gled_anim_handle_t anim);
+
+/**
+ * @brief Starts a frame clock that releases frames to the calling task. Frame k is due at
+ * start + k * period, the period rounded to whole microseconds.
+ *
+ * @param fps Frames per second, 1 to GLED_MAX_FPS
+ * @param ret_clock Returned frame clock handle
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad argument, ESP_ERR_NO_MEM if allocation failed
+ */
+esp_err_t gled_frame_clock_start(uint32_t fps, gled_frame_clock_handle_t *ret_clock);
+
+/**
+ * @brief Waits for the next frame. Only the task that started the clock may wait on it. If frames
+ * were released while the caller was busy, the latest is returned and the others are counted as dropped.
+ *
+ * @param clock Frame clock handle
+ * @param timeout Maximum time to wait
+ * @param ret_time_ms Returned animation time of the frame, k * period
+ *
+ * @return ESP_OK, ESP_ERR_TIMEOUT if no frame was released in time
+ */
+esp_err_t gled_frame_clock_wait(gled_frame_clock_handle_t clock, TickType_t timeout, uint32_t *ret_time_ms);
+
+/**
+ * @brief Frames released but never returned by gled_frame_clock_wait() because the caller was late
+ */
+uint32_t gled_frame_clock_dropped(gled_frame_clock_handle_t clock);
+
+/**
+ * @brief Stops and frees the frame clock. Waits for a frame callback already running in the esp_timer
+ * task, so must not be called from an esp_timer callback.
+ *
+ * @param clock Frame clock handle
+ *
+ * @return ESP_OK, or the esp_timer error if the wait could not be started and the clock was not freed
+ */
+esp_err_t gled_frame_clock_stop(gled_frame_clock_handle_t clock);
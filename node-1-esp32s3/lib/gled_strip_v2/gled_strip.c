@@ -1,4 +1,6 @@
+#include <string.h>
 #include "gled_strip.h"
+#include "esp_check.h"
 
 static uint8_t palette[MAX_COLOURS][CHANNELS] =
     {
@@ -12,9 +14,16 @@ static uint8_t palette[MAX_COLOURS][CHANNELS] =
 
 void led_strip_set_colour(led_strip_handle_t strip, uint8_t num_leds, colour_t colour)
 {
-    for (uint8_t a = 0; a < num_leds; a++)
+    // led_strip_fill() would paint the whole strip, only the first num_leds are ours. They are sent in runs
+    // through led_strip_set_pixels() rather than a set_pixel dispatch per LED.
+    uint8_t run[GLED_COLOUR_RUN][CHANNELS];
+    for (uint8_t i = 0; i < GLED_COLOUR_RUN; i++)
+        memcpy(run[i], palette[colour], CHANNELS);
+
+    for (uint8_t a = 0; a < num_leds; a += GLED_COLOUR_RUN)
     {
-        led_strip_set_pixel(strip, a, palette[colour][0], palette[colour][1], palette[colour][2]);
+        uint8_t count = num_leds - a < GLED_COLOUR_RUN ? num_leds - a : GLED_COLOUR_RUN;
+        led_strip_set_pixels(strip, a, count, &run[0][0], LED_PIXEL_ORDER_RGB);
     }
     led_strip_refresh(strip);
 }
@@ -34,55 +43,67 @@ esp_err_t create_led_strip_device(gpio_num_t pin, uint8_t num_leds, led_strip_ha
         .flags.with_dma = true,            // whether to enable the DMA feature
     };
 
-    led_strip_new_rmt_device(&strip_config, &rmt_config, ret_strip);
+    ESP_RETURN_ON_ERROR(led_strip_new_rmt_device(&strip_config, &rmt_config, ret_strip), GLED_TAG, "Failed to create LED strip");
     led_strip_clear(*ret_strip);
     return ESP_OK;
 }
 
-static void button1_cb(void *arg, void *data)
+static esp_err_t led_strip_program_init(program_ctx_t *ctx)
 {
-    led_strip_handle_t strip = *(led_strip_handle_t *)data;
-    led_strip_set_colour(strip, NUM_LEDS, RED);
-}
+    led_strip_handle_t strip;
+    ESP_RETURN_ON_ERROR(create_led_strip_device(GPIO_NUM_42, NUM_LEDS, &strip), GLED_TAG, "LED Strip demo failed to start");
+    ctx->user = strip;
 
-static void button2_cb(void *arg, void *data)
-{
-    led_strip_handle_t strip = *(led_strip_handle_t *)data;
-    led_strip_set_colour(strip, NUM_LEDS, GREEN);
+    // Buttons post the colour to the program task, nothing runs in the button callbacks
+    static const colour_t button_colours[MAX_PROGRAM_BUTTONS] = {RED, GREEN, BLUE};
+    for (uint8_t i = 0; i < MAX_PROGRAM_BUTTONS; i++)
+    {
+        esp_err_t esp_rc = program_register_button(ctx, i, BUTTON_PRESS_DOWN, button_colours[i]);
+        if (esp_rc != ESP_OK)
+        {
+            // Registrations made so far are unregistered when the program stops, the strip is ours to release
+            led_strip_del(strip);
+            ctx->user = NULL;
+            ESP_LOGE(GLED_TAG, "LED Strip demo failed to register button %u | Code: 0x%.2X", i, esp_rc);
+            return esp_rc;
+        }
+    }
+
+    printf("LED Strip demo started\n");
+    return ESP_OK;
 }
 
-static void button3_cb(void *arg, void *data)
+static void led_strip_program_run(program_ctx_t *ctx)
 {
-    led_strip_handle_t strip = *(led_strip_handle_t *)data;
-    led_strip_set_colour(strip, NUM_LEDS, BLUE);
+    led_strip_handle_t strip = (led_strip_handle_t)ctx->user;
+    uint8_t event, next;
+
+    // Sleeps until a button is pressed or the menu ends the program
+    while (program_wait_event(ctx, &event, portMAX_DELAY))
+    {
+        // Only the newest colour in a burst is worth a refresh
+        bool running;
+        while ((running = program_wait_event(ctx, &next, 0)) && next != PROGRAM_EVENT_TIMEOUT)
+            event = next;
+        if (!running)
+            break;
+
+        led_strip_set_colour(strip, NUM_LEDS, event);
+    }
 }
 
-static void button4_cb(void *arg, void *data)
+static void led_strip_program_stop(program_ctx_t *ctx)
 {
-    led_strip_handle_t strip = *(led_strip_handle_t *)data;
+    led_strip_handle_t strip = (led_strip_handle_t)ctx->user;
     led_strip_clear(strip);
+    led_strip_del(strip); // Releases the RMT channel
+    ctx->user = NULL;
     printf("LED Strip demo stopped. Resources freed.\n");
-    led_strip_del(strip);
 }
 
-void led_strip_main(void *pvParameter)
-{
-    button_handle_t *buttons = (button_handle_t *)pvParameter;
-
-    // Initialise LED Strips
-    led_strip_handle_t strip1;
-    ESP_ERROR_CHECK(create_led_strip_device(GPIO_NUM_42, 2, &strip1));
-    led_strip_clear(strip1);
-
-    iot_button_register_cb(buttons[0], BUTTON_PRESS_DOWN, button1_cb, &strip1);
-    iot_button_register_cb(buttons[1], BUTTON_PRESS_DOWN, button2_cb, &strip1);
-    iot_button_register_cb(buttons[2], BUTTON_PRESS_DOWN, button3_cb, &strip1);
-    iot_button_register_cb(buttons[3], BUTTON_PRESS_DOWN, button4_cb, &strip1);
-
-    printf("LED Strip demo started\n");
-
-    while (1)
-    {
-        vTaskDelay(10);
-    }
-}
+const program_ops_t led_strip_program = {
+    .init = led_strip_program_init,
+    .run = led_strip_program_run,
+    .stop = led_strip_program_stop,
+    .task_stack = 4096,
+};
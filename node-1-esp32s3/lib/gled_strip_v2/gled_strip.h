@@ -9,11 +9,15 @@
 #include <driver/gpio.h>
 #include <freertos/FreeRTOS.h>
 #include <iot_button.h>
+#include "gesp-program.h"
 
 #define MAX_COLOURS 6
 #define CHANNELS 3
 
 #define NUM_LEDS 2
+#define GLED_COLOUR_RUN 16 // Pixels per led_strip_set_pixels() call in led_strip_set_colour()
+
+#define GLED_TAG "GLED Strip"
 
 typedef enum colour // Colours
 {
@@ -29,7 +33,7 @@ typedef enum colour // Colours
  * @brief Convenience function for setting colour of the LED strip. Auto refreshes.
  *
  * @param strip LED strip handle
- * @param num_leds Number of LEDs
+ * @param num_leds Number of LEDs to colour, from the start of the strip
  * @param colour Colour of the LEDs from enumeration
  *
  * @return void
@@ -47,4 +51,5 @@ void led_strip_set_colour(led_strip_handle_t strip, uint8_t num_leds, colour_t c
 */
 esp_err_t create_led_strip_device(gpio_num_t pin, uint8_t num_leds, led_strip_handle_t *ret_strip);
 
-void led_strip_main(void *pvParameter);
\ No newline at end of file
+// LED strip demo for Gabe's Menu. Buttons 1 - 3 set the strip red, green and blue.
+extern const program_ops_t led_strip_program;
\ No newline at end of file
@@ -38,6 +38,7 @@ TaskHandle_t task_menu;
 i2c_master_bus_handle_t handle0;
 i2c_master_bus_handle_t handle1;
 menu_peripherals_t params;
+ssd1306_t display;
 
 // Peripherals
 
@@ -87,7 +88,13 @@ extern "C" void app_main()
     i2c_master_init(I2C_NUM_0, I2C_0_MASTER_SDA, I2C_0_MASTER_SCL, &handle0);
     i2c_master_init(I2C_NUM_1, I2C_1_MASTER_SDA, I2C_1_MASTER_SCL, &handle1);
     params.master_handle = handle0;
-    gesp_ssd1306_init(handle0, &params.display);
+    gesp_ssd1306_init(handle0, &display);
+    params.display = &display;
+
+    // Display uploads are queued on the bus engine, so the menu keeps handling buttons while a frame goes out
+    i2c_async_handle_t display_engine;
+    ESP_ERROR_CHECK(i2c_async_new(handle0, NULL, &display_engine));
+    ESP_ERROR_CHECK(ssd1306_set_async(&display, display_engine));
 
     // level_calc_t level_sensor = init_fdc1004(handle0);
 